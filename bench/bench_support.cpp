@@ -0,0 +1,89 @@
+#include "bench_support.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+#include <new>
+
+namespace {
+
+std::atomic<size_t> g_allocations{0};
+
+}  // namespace
+
+void* operator new(size_t size) {
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* memory = std::malloc(size == 0 ? 1 : size)) {
+    return memory;
+  }
+  throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+// std::pmr::new_delete_resource() allocates through the aligned forms.
+void* operator new(size_t size, std::align_val_t alignment) {
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  const size_t align = std::max(static_cast<size_t>(alignment), sizeof(void*));
+  const size_t rounded = (std::max<size_t>(size, 1U) + align - 1U) / align * align;
+#ifdef _WIN32
+  void* memory = _aligned_malloc(rounded, align);
+#else
+  void* memory = std::aligned_alloc(align, rounded);
+#endif
+  if (memory != nullptr) {
+    return memory;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept {
+#ifdef _WIN32
+  _aligned_free(memory);
+#else
+  std::free(memory);
+#endif
+}
+
+void operator delete(void* memory, size_t, std::align_val_t alignment) noexcept {
+  operator delete(memory, alignment);
+}
+
+void operator delete(void* memory) noexcept {
+  std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+  std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+  std::free(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept {
+  std::free(memory);
+}
+
+namespace bench {
+
+size_t allocationCount() {
+  return g_allocations.load(std::memory_order_relaxed);
+}
+
+void printHeader() {
+  std::printf("%-44s %14s %12s %12s\n", "Benchmark", "Iterations", "ns/op", "allocs/op");
+  std::printf("%.*s\n", 85, "-------------------------------------------------------------------------------------");
+}
+
+void printResult(std::string_view name, size_t iterations, double nanosPerIteration, double allocationsPerIteration) {
+  std::printf("%-44.*s %14zu %12.1f %12.2f\n", static_cast<int>(name.size()), name.data(), iterations,
+              nanosPerIteration, allocationsPerIteration);
+}
+
+}  // namespace bench
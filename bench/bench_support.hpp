@@ -0,0 +1,54 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <string_view>
+
+// Minimal Google Benchmark-style harness: each case is calibrated until it runs
+// for a measurable amount of time, then reported as time and heap allocations
+// per iteration. Allocations are counted by replacing the global operator new
+// in bench_support.cpp.
+namespace bench {
+
+size_t allocationCount();
+
+template <typename T>
+inline void doNotOptimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+  asm volatile("" : : "g"(&value) : "memory");
+#else
+  static const void* volatile sink;
+  sink = &value;
+#endif
+}
+
+void printHeader();
+void printResult(std::string_view name, size_t iterations, double nanosPerIteration, double allocationsPerIteration);
+
+// Returns the time per iteration in nanoseconds.
+template <typename Body>
+double run(std::string_view name, Body&& body) {
+  using Clock = std::chrono::steady_clock;
+  constexpr auto kMinimumDuration = std::chrono::milliseconds(200);
+
+  size_t iterations = 1U;
+  while (true) {
+    const size_t allocationsBefore = allocationCount();
+    const auto start = Clock::now();
+    for (size_t iteration = 0; iteration < iterations; ++iteration) {
+      body();
+    }
+    const auto elapsed = Clock::now() - start;
+    const size_t allocations = allocationCount() - allocationsBefore;
+    if (elapsed >= kMinimumDuration || iterations >= (size_t{1} << 30)) {
+      const double nanos = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+      const double nanosPerIteration = nanos / static_cast<double>(iterations);
+      printResult(name, iterations, nanosPerIteration, static_cast<double>(allocations) / static_cast<double>(iterations));
+      return nanosPerIteration;
+    }
+    iterations *= 2U;
+  }
+}
+
+}  // namespace bench
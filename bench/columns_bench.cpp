@@ -0,0 +1,117 @@
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "bench_support.hpp"
+#include "column_scan.hpp"
+#include "item_store.hpp"
+#include "money.hpp"
+
+namespace {
+
+constexpr size_t kItemCount = 1'000'000U;
+
+// Names as people enter them: mostly the predefined categories, the rest free
+// text long enough to live on the heap.
+std::vector<csfj::Item> sampleItems() {
+  std::vector<csfj::Item> items;
+  items.reserve(kItemCount);
+  std::uint64_t state = 0x9E3779B97F4A7C15ULL;
+  const auto next = [&state] {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+  };
+  for (size_t index = 0; index < kItemCount; ++index) {
+    std::string name = next() % 4U != 0U ? std::string(csfj::kItemCategories[next() % csfj::kItemCategories.size()])
+                                          : "Servicio contratado número " + std::to_string(next() % 10'000U);
+    items.push_back({std::move(name), static_cast<int>(1U + next() % 200U),
+                     csfj::Money::fromCents(static_cast<std::int64_t>(next() % 100'000'000ULL))});
+  }
+  return items;
+}
+
+// The aggregations as they read a std::vector<Item>, one Item (and, for the
+// category, its name) at a time.
+csfj::Money rowTotal(const std::vector<csfj::Item>& items) {
+  csfj::Money total;
+  for (const csfj::Item& item : items) {
+    total += item.getTotalCost();
+  }
+  return total;
+}
+
+csfj::CategoryTotals rowTotalsByCategory(const std::vector<csfj::Item>& items) {
+  csfj::CategoryTotals totals;
+  for (const csfj::Item& item : items) {
+    const size_t category = csfj::categoryIndex(item.name);
+    ++totals.count[category];
+    totals.total[category] += item.getTotalCost();
+  }
+  return totals;
+}
+
+constexpr int kMinQuantity = 100;
+constexpr csfj::Money kMaxUnitCost = csfj::Money::fromCents(50'000'000);
+
+csfj::Money rowFilteredTotal(const std::vector<csfj::Item>& items) {
+  csfj::Money total;
+  for (const csfj::Item& item : items) {
+    if (item.quantity >= kMinQuantity && item.unitCost <= kMaxUnitCost) {
+      total += item.getTotalCost();
+    }
+  }
+  return total;
+}
+
+csfj::Money columnFilteredTotal(const csfj::ItemSnapshot& items) {
+  csfj::ColumnFilter filter;
+  filter.minQuantity = kMinQuantity;
+  filter.maxUnitCents = kMaxUnitCost.cents();
+  std::uint64_t mask[csfj::ItemSnapshot::kChunkSize / 64U];
+  std::int64_t cents = 0;
+  for (size_t chunk = 0; chunk < items.chunkCount(); ++chunk) {
+    const csfj::ItemSnapshot::Columns& columns = items.columns(chunk);
+    const size_t rows = items.chunkSize(chunk);
+    csfj::filterRows(columns.category.data(), columns.quantity.data(), columns.unitCents.data(),
+                     columns.totalCents.data(), rows, filter, mask);
+    cents += csfj::maskedSum(columns.totalCents.data(), rows, mask);
+  }
+  return csfj::Money::fromCents(cents);
+}
+
+}  // namespace
+
+int main() {
+  const std::vector<csfj::Item> items = sampleItems();
+  csfj::ItemStore store;
+  store.load(items, 0U);
+  const auto snapshot = store.snapshot();
+
+  // Both layouts must agree, and the summary load() reduced from the columns
+  // must match the one the rows give.
+  const csfj::CategoryTotals rows = rowTotalsByCategory(items);
+  const csfj::CategoryTotals columns = csfj::totalsByCategory(*snapshot);
+  size_t mismatches = csfj::sumTotals(*snapshot) != rowTotal(items) ? 1U : 0U;
+  mismatches += snapshot->summary().total != rowTotal(items) ? 1U : 0U;
+  mismatches += columnFilteredTotal(*snapshot) != rowFilteredTotal(items) ? 1U : 0U;
+  for (size_t category = 0; category < rows.count.size(); ++category) {
+    mismatches += rows.count[category] != columns.count[category] || rows.total[category] != columns.total[category]
+                      ? 1U
+                      : 0U;
+    mismatches += snapshot->summary().categories[category].subtotal != rows.total[category] ? 1U : 0U;
+  }
+  std::printf("Items: %zu; diferencias entre filas y columnas: %zu\n\n", snapshot->size(), mismatches);
+
+  bench::printHeader();
+  bench::run("rows/grand_total_1M", [&] { bench::doNotOptimize(rowTotal(items)); });
+  bench::run("columns/grand_total_1M", [&] { bench::doNotOptimize(csfj::sumTotals(*snapshot)); });
+  bench::run("rows/category_totals_1M", [&] { bench::doNotOptimize(rowTotalsByCategory(items)); });
+  bench::run("columns/category_totals_1M", [&] { bench::doNotOptimize(csfj::totalsByCategory(*snapshot)); });
+  bench::run("rows/filtered_total_1M", [&] { bench::doNotOptimize(rowFilteredTotal(items)); });
+  bench::run("columns/filtered_total_1M", [&] { bench::doNotOptimize(columnFilteredTotal(*snapshot)); });
+  return 0;
+}
@@ -0,0 +1,115 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "bench_support.hpp"
+#include "csv_import.hpp"
+#include "item_store.hpp"
+#include "money.hpp"
+#include "text_format.hpp"
+
+namespace {
+
+constexpr size_t kRowCount = 100'000U;
+
+std::vector<csfj::Item> sampleItems() {
+  std::vector<csfj::Item> items;
+  items.reserve(kRowCount);
+  std::uint64_t state = 0x9E3779B97F4A7C15ULL;
+  for (size_t index = 0; index < kRowCount; ++index) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    std::string name(csfj::kItemCategories[state % csfj::kItemCategories.size()]);
+    if (state % 7U == 0U) {
+      name = "Taller \"" + std::to_string(index) + "\", sede norte";
+    }
+    items.push_back({std::move(name), static_cast<int>(1U + state % 40U),
+                     csfj::Money::fromCents(static_cast<std::int64_t>(state % 10'000'000ULL))});
+  }
+  return items;
+}
+
+// Same layout as CsvExportStream in main.cpp.
+std::string exportCsv(const std::vector<csfj::Item>& items) {
+  std::string out = "Nombre,Cantidad,Costo Unitario,Total\r\n";
+  csfj::Money total;
+  for (const csfj::Item& item : items) {
+    csfj::appendEscapedCsv(out, item.name);
+    out += ',';
+    csfj::appendInteger(out, item.quantity);
+    out += ",\"";
+    csfj::appendMoney(out, item.unitCost);
+    out += "\",\"";
+    csfj::appendMoney(out, item.getTotalCost());
+    out += "\"\r\n";
+    total += item.getTotalCost();
+  }
+  out += "\"Total\",,,\"";
+  csfj::appendMoney(out, total);
+  out += "\"\r\n";
+  return out;
+}
+
+// Feeds `csv` in pieces of `chunkSize` bytes, the way a request body arrives.
+size_t importRows(std::string_view csv, size_t chunkSize) {
+  csfj::CsvItemReader reader;
+  for (size_t offset = 0; offset < csv.size(); offset += chunkSize) {
+    reader.feed(csv.substr(offset, chunkSize));
+  }
+  reader.finish();
+  return reader.items().size();
+}
+
+size_t scalarFindDelimiter(std::string_view text) {
+  for (size_t offset = 0; offset < text.size(); ++offset) {
+    const char ch = text[offset];
+    if (ch == '"' || ch == ',' || ch == '\r' || ch == '\n') {
+      return offset;
+    }
+  }
+  return text.size();
+}
+
+void printRowsPerSecond(std::string_view name, double nanosPerImport) {
+  std::printf("  %-42.*s %14.0f filas/s\n", static_cast<int>(name.size()), name.data(),
+              static_cast<double>(kRowCount) * 1e9 / nanosPerImport);
+}
+
+}  // namespace
+
+int main() {
+  const std::vector<csfj::Item> items = sampleItems();
+  const std::string csv = exportCsv(items);
+
+  // Importing an export must give back the same sheet, whichever way the body
+  // is split.
+  size_t mismatches = 0U;
+  for (const size_t chunkSize : {csv.size(), size_t{16384}, size_t{1460}, size_t{7}}) {
+    csfj::CsvItemReader reader;
+    for (size_t offset = 0; offset < csv.size(); offset += chunkSize) {
+      reader.feed(std::string_view(csv).substr(offset, chunkSize));
+    }
+    mismatches += reader.finish() && exportCsv(reader.items()) == csv ? 0U : 1U;
+  }
+  std::printf("Filas: %zu (%zu bytes); importaciones que no reproducen la exportación: %zu\n\n", kRowCount, csv.size(),
+              mismatches);
+
+  bench::printHeader();
+  const double whole = bench::run("csv/import_whole_body", [&] { bench::doNotOptimize(importRows(csv, csv.size())); });
+  const double chunked = bench::run("csv/import_16KiB_chunks", [&] { bench::doNotOptimize(importRows(csv, 16384U)); });
+  const double segments = bench::run("csv/import_1460B_segments", [&] { bench::doNotOptimize(importRows(csv, 1460U)); });
+
+  const std::string longCell(4096U, 'x');
+  bench::run("scan/scalar_4KiB_cell", [&] { bench::doNotOptimize(scalarFindDelimiter(longCell)); });
+  bench::run("scan/findCsvDelimiter_4KiB_cell", [&] { bench::doNotOptimize(csfj::findCsvDelimiter(longCell)); });
+
+  std::printf("\n");
+  printRowsPerSecond("csv/import_whole_body", whole);
+  printRowsPerSecond("csv/import_16KiB_chunks", chunked);
+  printRowsPerSecond("csv/import_1460B_segments", segments);
+  return 0;
+}
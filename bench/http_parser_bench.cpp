@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <cctype>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "bench_support.hpp"
+#include "http_parser.hpp"
+
+namespace {
+
+const std::string kBrowserGet =
+    "GET /edit?index=12 HTTP/1.1\r\n"
+    "Host: localhost:8080\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:128.0) Gecko/20100101 Firefox/128.0\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+    "Accept-Language: es-CO,es;q=0.8,en-US;q=0.5,en;q=0.3\r\n"
+    "Accept-Encoding: gzip, deflate, br, zstd\r\n"
+    "Referer: http://localhost:8080/\r\n"
+    "Connection: keep-alive\r\n"
+    "Upgrade-Insecure-Requests: 1\r\n"
+    "Sec-Fetch-Dest: document\r\n"
+    "Sec-Fetch-Mode: navigate\r\n"
+    "Sec-Fetch-Site: same-origin\r\n"
+    "Priority: u=0, i\r\n"
+    "\r\n";
+
+const std::string kFormPost =
+    "POST /submit HTTP/1.1\r\n"
+    "Host: localhost:8080\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:128.0) Gecko/20100101 Firefox/128.0\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+    "Content-Type: application/x-www-form-urlencoded\r\n"
+    "Content-Length: 73\r\n"
+    "Origin: http://localhost:8080\r\n"
+    "Connection: keep-alive\r\n"
+    "\r\n"
+    "itemNameSelect=Hora+docente&itemName=&itemQuantity=12&itemCost=1%27234.50";
+
+// The request handling that the string_view parser replaced, kept here as the
+// baseline: header block copies, an istringstream for the request line and a
+// lowercase std::string map for the headers.
+std::string legacyTrim(const std::string& input) {
+  const auto first = std::find_if_not(input.begin(), input.end(), [](unsigned char ch) { return std::isspace(ch); });
+  const auto last = std::find_if_not(input.rbegin(), input.rend(), [](unsigned char ch) { return std::isspace(ch); }).base();
+  if (first >= last) {
+    return {};
+  }
+  return std::string(first, last);
+}
+
+std::string legacyToLower(std::string value) {
+  std::transform(value.begin(), value.end(), value.begin(), [](unsigned char ch) { return static_cast<char>(std::tolower(ch)); });
+  return value;
+}
+
+std::unordered_map<std::string, std::string> legacyParseHeaders(const std::string& headerBlock) {
+  std::unordered_map<std::string, std::string> headers;
+  size_t cursor = 0U;
+  while (cursor < headerBlock.size()) {
+    const auto lineEnd = headerBlock.find("\r\n", cursor);
+    const auto length = (lineEnd == std::string::npos) ? headerBlock.size() - cursor : lineEnd - cursor;
+    const auto line = headerBlock.substr(cursor, length);
+    cursor = (lineEnd == std::string::npos) ? headerBlock.size() : lineEnd + 2;
+    if (line.empty()) {
+      continue;
+    }
+    const auto colonPos = line.find(':');
+    if (colonPos == std::string::npos) {
+      continue;
+    }
+    headers[legacyToLower(legacyTrim(line.substr(0, colonPos)))] = legacyTrim(line.substr(colonPos + 1));
+  }
+  return headers;
+}
+
+size_t legacyParse(const std::string& request) {
+  const size_t headerEndPos = request.find("\r\n\r\n");
+  int expectedContentLength = 0;
+  {
+    const auto headers = legacyParseHeaders(request.substr(0, headerEndPos));
+    const auto contentLengthIt = headers.find("content-length");
+    if (contentLengthIt != headers.end()) {
+      expectedContentLength = std::stoi(contentLengthIt->second);
+    }
+  }
+
+  const auto requestLineEnd = request.find("\r\n");
+  std::istringstream requestLineStream(request.substr(0, requestLineEnd));
+  std::string method;
+  std::string rawPath;
+  requestLineStream >> method >> rawPath;
+
+  std::string path = rawPath;
+  std::string queryString;
+  const auto queryPos = rawPath.find('?');
+  if (queryPos != std::string::npos) {
+    path = rawPath.substr(0, queryPos);
+    queryString = rawPath.substr(queryPos + 1);
+  }
+
+  const size_t headersBlockStart = requestLineEnd + 2;
+  const auto headers = legacyParseHeaders(request.substr(headersBlockStart, headerEndPos - headersBlockStart));
+  const std::string body = request.substr(headerEndPos + 4);
+  return path.size() + queryString.size() + headers.size() + body.size() + static_cast<size_t>(expectedContentLength);
+}
+
+size_t parseWhole(const std::string& request) {
+  csfj::HttpRequestParser parser;
+  csfj::HttpRequest parsed;
+  parser.parse(request, parsed);
+  return parsed.path.size() + parsed.query.size() + parsed.headerCount + parsed.body.size() +
+         parsed.header("content-type").size();
+}
+
+// Feeds the request in 64-byte slices, as a slow client would deliver it.
+size_t parseTrickled(const std::string& request) {
+  csfj::HttpRequestParser parser;
+  csfj::HttpRequest parsed;
+  for (size_t received = 64U; received < request.size(); received += 64U) {
+    parser.parse(std::string_view(request).substr(0, received), parsed);
+  }
+  parser.parse(request, parsed);
+  return parsed.headerCount + parsed.body.size();
+}
+
+// Eight keep-alive requests delivered in a single read.
+size_t parsePipelined(const std::string& pipeline) {
+  csfj::HttpRequestParser parser;
+  csfj::HttpRequest parsed;
+  std::string_view pending = pipeline;
+  size_t total = 0U;
+  while (!pending.empty() && parser.parse(pending, parsed) == csfj::ParseStatus::kComplete) {
+    total += parsed.headerCount;
+    pending.remove_prefix(parsed.length());
+    parser.reset();
+  }
+  return total;
+}
+
+}  // namespace
+
+int main() {
+  std::string pipeline;
+  for (int index = 0; index < 8; ++index) {
+    pipeline += kBrowserGet;
+  }
+
+  bench::printHeader();
+  bench::run("legacy/browser_get", [] { bench::doNotOptimize(legacyParse(kBrowserGet)); });
+  bench::run("legacy/form_post", [] { bench::doNotOptimize(legacyParse(kFormPost)); });
+  bench::run("string_view/browser_get", [] { bench::doNotOptimize(parseWhole(kBrowserGet)); });
+  bench::run("string_view/form_post", [] { bench::doNotOptimize(parseWhole(kFormPost)); });
+  bench::run("string_view/form_post_trickled_64b", [] { bench::doNotOptimize(parseTrickled(kFormPost)); });
+  bench::run("string_view/pipelined_x8", [&pipeline] { bench::doNotOptimize(parsePipelined(pipeline)); });
+  return 0;
+}
@@ -0,0 +1,355 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "bench_support.hpp"
+#include "http_parser.hpp"
+#include "item_index.hpp"
+#include "item_json.hpp"
+#include "item_store.hpp"
+#include "money.hpp"
+#include "request_arena.hpp"
+
+namespace {
+
+constexpr size_t kBatchSize = 100U;
+constexpr size_t kQueryItems = 100'000U;
+
+const std::string kFormBody = "itemNameSelect=Hora+docente&itemName=&itemQuantity=12&itemCost=1%27234.50";
+const std::string kJsonBody = R"({"name":"Hora docente","quantity":12,"unitCost":"1'234.50"})";
+
+// The parsing and validation handlePostSubmit does before touching the store,
+// with the fields drawn from a request arena as on the server.
+bool parseFormItem(std::string_view body, csfj::Item& item, csfj::RequestArena& arena) {
+  arena.reset();
+  const csfj::FormFields formValues(body, &arena);
+  const auto selectIt = formValues.find("itemNameSelect");
+  const auto costIt = formValues.find("itemCost");
+  const auto quantityIt = formValues.find("itemQuantity");
+  if (selectIt == formValues.end() || costIt == formValues.end() || quantityIt == formValues.end()) {
+    return false;
+  }
+  try {
+    item.quantity = std::stoi(std::string(quantityIt->second));
+  } catch (const std::exception&) {
+    return false;
+  }
+  item.name = selectIt->second;
+  return csfj::parseMoney(csfj::normalizeCostInput(costIt->second), item.unitCost);
+}
+
+std::vector<csfj::Item> sampleItems() {
+  std::vector<csfj::Item> items;
+  std::uint64_t state = 0x9E3779B97F4A7C15ULL;
+  for (size_t index = 0; index < kBatchSize; ++index) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    std::string name(csfj::kItemCategories[state % csfj::kItemCategories.size()]);
+    if (state % 5U == 0U) {
+      name += " \"especial\"\n\\ \xC3\xB1";
+    }
+    items.push_back({std::move(name), static_cast<int>(1U + state % 40U),
+                     csfj::Money::fromCents(static_cast<std::int64_t>(state % 10'000'000ULL))});
+  }
+  return items;
+}
+
+std::string batchBody(const std::vector<csfj::Item>& items) {
+  std::string json = "[";
+  for (size_t index = 0; index < items.size(); ++index) {
+    if (index != 0U) {
+      json += ',';
+    }
+    csfj::appendItemJson(json, index, items[index]);
+  }
+  json += ']';
+  return json;
+}
+
+// Serializing items and reading them back must give the same items.
+size_t countRoundTripMismatches(const std::vector<csfj::Item>& items) {
+  std::vector<csfj::ItemChange> changes;
+  std::string error;
+  size_t failedChange = 0U;
+  if (!csfj::parseItemChanges(batchBody(items), changes, error, failedChange) || changes.size() != items.size()) {
+    return items.size();
+  }
+  size_t mismatches = 0U;
+  for (size_t index = 0; index < items.size(); ++index) {
+    const csfj::ItemChange& change = changes[index];
+    const bool same = change.index == index && change.name == items[index].name &&
+                      change.quantity == items[index].quantity && change.unitCost == items[index].unitCost;
+    mismatches += same ? 0U : 1U;
+  }
+  return mismatches;
+}
+
+// Escapes and layouts a hand-written client may send.
+size_t countDecodingMismatches() {
+  struct Case {
+    std::string_view json;
+    std::string_view name;
+  };
+  const Case cases[] = {
+      {R"({"name":"Caf\u00e9 \ud83d\ude00","quantity":1,"unitCost":1})", "Caf\xC3\xA9 \xF0\x9F\x98\x80"},
+      {R"( { "total" : {"a":[1,{"b":null}],"c":true} , "name" : "a\/b\t" , "quantity" : 1 , "unitCost" : 0.5 } )",
+       "a/b\t"},
+  };
+  size_t mismatches = 0U;
+  for (const Case& entry : cases) {
+    csfj::ItemChange change;
+    std::string error;
+    mismatches += csfj::parseItemChange(entry.json, change, error) && change.name == entry.name ? 0U : 1U;
+  }
+  for (const std::string_view invalid : {R"({"name":"a",})", R"({"name":"a"} x)", R"({"name":"\ud800"})",
+                                         R"([{"name":"a"},])", R"({"quantity":01})"}) {
+    csfj::ItemChange change;
+    std::vector<csfj::ItemChange> changes;
+    std::string error;
+    size_t failedChange = 0U;
+    const bool accepted = invalid.front() == '[' ? csfj::parseItemChanges(invalid, changes, error, failedChange)
+                                                 : csfj::parseItemChange(invalid, change, error);
+    mismatches += accepted ? 1U : 0U;
+  }
+  return mismatches;
+}
+
+struct Random {
+  std::uint64_t state = 0x2545F4914F6CDD1DULL;
+
+  std::uint64_t next() {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+  }
+};
+
+// A category two times in three, otherwise one of a few hundred free names
+// sharing prefixes.
+csfj::Item randomItem(Random& random) {
+  std::string name;
+  if (random.next() % 3U != 0U) {
+    name = csfj::kItemCategories[random.next() % csfj::kItemCategories.size()];
+  } else {
+    name = "Taller " + std::to_string(random.next() % 400U);
+  }
+  return {std::move(name), static_cast<int>(1U + random.next() % 200U),
+          csfj::Money::fromCents(static_cast<std::int64_t>(random.next() % 100'000'000ULL))};
+}
+
+csfj::ItemQuery randomQuery(Random& random) {
+  csfj::ItemQuery query;
+  const auto pick = [&random](unsigned percent) { return random.next() % 100U < percent; };
+  if (pick(30U)) {
+    query.category = random.next() % (csfj::kItemCategories.size() + 1U);
+  }
+  if (pick(10U)) {
+    query.name = pick(50U) ? std::string(csfj::kItemCategories[random.next() % csfj::kItemCategories.size()])
+                           : "Taller " + std::to_string(random.next() % 400U);
+  }
+  if (pick(15U)) {
+    query.namePrefix = "Taller " + std::to_string(random.next() % 40U);
+  }
+  if (pick(30U)) {
+    query.minQuantity = static_cast<int>(random.next() % 200U);
+  }
+  if (pick(30U)) {
+    query.maxQuantity = static_cast<int>(random.next() % 200U);
+  }
+  if (pick(30U)) {
+    query.minUnitCost = csfj::Money::fromCents(static_cast<std::int64_t>(random.next() % 100'000'000ULL));
+  }
+  if (pick(30U)) {
+    query.maxUnitCost = csfj::Money::fromCents(static_cast<std::int64_t>(random.next() % 100'000'000ULL));
+  }
+  if (pick(20U)) {
+    query.minTotal = csfj::Money::fromCents(static_cast<std::int64_t>(random.next() % 10'000'000'000ULL));
+  }
+  if (pick(20U)) {
+    query.maxTotal = csfj::Money::fromCents(static_cast<std::int64_t>(random.next() % 10'000'000'000ULL));
+  }
+  query.sortBy = static_cast<csfj::ItemField>(random.next() % 5U);
+  query.descending = pick(50U);
+  query.offset = pick(50U) ? 0U : random.next() % 500U;
+  query.limit = 1U + random.next() % 200U;
+  return query;
+}
+
+// The pass over every item the indexes replace: filter, then sort.
+std::vector<size_t> scanQuery(const csfj::ItemSnapshot& items,
+                              const csfj::ItemQuery& query,
+                              size_t& total,
+                              csfj::Money& totalCost) {
+  std::vector<size_t> matches;
+  totalCost = csfj::Money{};
+  for (size_t index = 0; index < items.size(); ++index) {
+    if (query.matches(items[index])) {
+      matches.push_back(index);
+      totalCost += items[index].getTotalCost();
+    }
+  }
+  const auto key = [&](size_t index) {
+    const csfj::Item& item = items[index];
+    switch (query.sortBy) {
+      case csfj::ItemField::kQuantity:
+        return static_cast<std::int64_t>(item.quantity);
+      case csfj::ItemField::kUnitCost:
+        return item.unitCost.cents();
+      case csfj::ItemField::kTotal:
+        return item.getTotalCost().cents();
+      default:
+        return std::int64_t{0};
+    }
+  };
+  // Ties keep item order in either direction.
+  std::sort(matches.begin(), matches.end(), [&](size_t left, size_t right) {
+    const size_t low = query.descending ? right : left;
+    const size_t high = query.descending ? left : right;
+    if (query.sortBy == csfj::ItemField::kName && items[low].name != items[high].name) {
+      return items[low].name < items[high].name;
+    }
+    if (query.sortBy == csfj::ItemField::kIndex) {
+      return low < high;
+    }
+    return key(low) != key(high) ? key(low) < key(high) : left < right;
+  });
+  total = matches.size();
+  const size_t first = std::min(query.offset, matches.size());
+  const size_t last = std::min(matches.size(), first + query.limit);
+  return {matches.begin() + static_cast<std::ptrdiff_t>(first), matches.begin() + static_cast<std::ptrdiff_t>(last)};
+}
+
+// Fills `store` through every write path, so the indexes are checked after
+// appends, batches and replacements alike.
+void fillQueryStore(csfj::ItemStore& store, Random& random) {
+  std::vector<csfj::Item> loaded;
+  for (size_t index = 0; index < kQueryItems / 2U; ++index) {
+    loaded.push_back(randomItem(random));
+  }
+  store.load(std::move(loaded), 0U);
+  while (store.snapshot()->size() < kQueryItems) {
+    std::vector<csfj::Item> batch;
+    for (size_t index = 0; index < 1000U; ++index) {
+      batch.push_back(randomItem(random));
+    }
+    store.appendBatch(std::move(batch));
+    store.append(randomItem(random));
+    for (int write = 0; write < 100; ++write) {
+      store.replace(random.next() % store.snapshot()->size(), randomItem(random));
+    }
+    std::vector<csfj::ItemChange> changes(20U);
+    for (csfj::ItemChange& change : changes) {
+      csfj::Item item = randomItem(random);
+      change.index = random.next() % store.snapshot()->size();
+      change.name = std::move(item.name);
+      change.unitCost = item.unitCost;
+    }
+    changes.back().index.reset();
+    changes.back().quantity = 1;
+    store.applyBatch(changes);
+  }
+}
+
+size_t countQueryMismatches(const csfj::ItemStore& store, Random& random) {
+  size_t mismatches = 0U;
+  for (int sample = 0; sample < 500; ++sample) {
+    const csfj::ItemQuery query = randomQuery(random);
+    const csfj::ItemQueryResult result = store.query(query);
+    size_t total = 0U;
+    csfj::Money totalCost;
+    const std::vector<size_t> expected = scanQuery(*result.items, query, total, totalCost);
+    mismatches += result.total != total || result.totalCost != totalCost || result.positions != expected ? 1U : 0U;
+  }
+  return mismatches;
+}
+
+}  // namespace
+
+int main() {
+  const std::vector<csfj::Item> items = sampleItems();
+  const std::string batch = batchBody(items);
+  std::printf("Diferencias JSON ida y vuelta: %zu; casos de decodificación fallidos: %zu\n\n",
+              countRoundTripMismatches(items), countDecodingMismatches());
+
+  std::vector<std::string> formBodies;
+  for (size_t index = 0; index < kBatchSize; ++index) {
+    formBodies.push_back(kFormBody);
+  }
+
+  csfj::RequestArena arena;
+  bench::printHeader();
+  bench::run("form/parse_submit_body", [&] {
+    csfj::Item item;
+    bench::doNotOptimize(parseFormItem(kFormBody, item, arena));
+    bench::doNotOptimize(item);
+  });
+  bench::run("json/parseItemChange", [&] {
+    csfj::ItemChange change;
+    std::string error;
+    bench::doNotOptimize(csfj::parseItemChange(kJsonBody, change, error));
+    bench::doNotOptimize(change);
+  });
+
+  bench::run("form/100_submit_bodies", [&] {
+    for (const std::string& body : formBodies) {
+      csfj::Item item;
+      bench::doNotOptimize(parseFormItem(body, item, arena));
+      bench::doNotOptimize(item);
+    }
+  });
+  std::vector<csfj::ItemChange> changes;
+  std::string error;
+  size_t failedChange = 0U;
+  bench::run("json/parseItemChanges_100_reused", [&] {
+    bench::doNotOptimize(csfj::parseItemChanges(batch, changes, error, failedChange));
+    bench::doNotOptimize(changes);
+  });
+
+  std::string out;
+  bench::run("json/appendItemJson_100_reused", [&] {
+    out.clear();
+    for (size_t index = 0; index < items.size(); ++index) {
+      csfj::appendItemJson(out, index, items[index]);
+    }
+    bench::doNotOptimize(out);
+  });
+
+  Random random;
+  csfj::ItemStore store;
+  fillQueryStore(store, random);
+  std::printf("\nConsultas comparadas con un recorrido completo sobre %zu items: diferencias %zu\n\n",
+              store.snapshot()->size(), countQueryMismatches(store, random));
+  bench::printHeader();
+  csfj::ItemQuery narrowCost;
+  narrowCost.minUnitCost = csfj::Money::fromCents(5'000'000);
+  narrowCost.maxUnitCost = csfj::Money::fromCents(5'010'000);
+  narrowCost.sortBy = csfj::ItemField::kUnitCost;
+  csfj::ItemQuery topTotals;
+  topTotals.category = 1U;
+  topTotals.sortBy = csfj::ItemField::kTotal;
+  topTotals.descending = true;
+  topTotals.limit = 10U;
+  csfj::ItemQuery prefix;
+  prefix.namePrefix = "Taller 12";
+  prefix.maxQuantity = 50;
+  const std::pair<const char*, const csfj::ItemQuery*> queries[] = {
+      {"unitCost_narrow_range", &narrowCost}, {"category_top10_by_total", &topTotals}, {"namePrefix", &prefix}};
+  for (const auto& [name, query] : queries) {
+    bench::run(std::string("query/") + name, [&] { bench::doNotOptimize(store.query(*query)); });
+    bench::run(std::string("query/scan_") + name, [&] {
+      size_t total = 0U;
+      csfj::Money totalCost;
+      bench::doNotOptimize(scanQuery(*store.snapshot(), *query, total, totalCost));
+    });
+  }
+  bench::run("store/replace_100k_indexed", [&] {
+    store.replace(random.next() % kQueryItems, randomItem(random));
+  });
+  return 0;
+}
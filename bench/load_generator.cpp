@@ -0,0 +1,512 @@
+// Closed-loop load generator: every connection runs on its own thread, sends a
+// request, waits for the whole response and sends the next one, so the
+// reported latency is what one client sees. Drives a running server over
+// loopback (or any address) with a weighted mix of GET /, GET /export,
+// POST /submit and POST /update, on the default sheet or spread over several
+// named ones.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+enum RequestKind : size_t { kIndex, kExport, kSubmit, kUpdate, kKindCount };
+
+constexpr const char* kKindNames[kKindCount] = {"GET /", "GET /export", "POST /submit", "POST /update"};
+constexpr const char* kMixKeys[kKindCount] = {"index", "export", "submit", "update"};
+
+struct LoadOptions {
+  std::string host = "127.0.0.1";
+  unsigned short port = 8080;
+  int connections = 16;
+  int durationSeconds = 10;
+  bool keepAlive = true;
+  unsigned weights[kKindCount] = {80U, 5U, 10U, 5U};
+  // 0 for the default sheet; otherwise connection i uses /s/load-{i % sheets}/.
+  int sheets = 0;
+};
+
+struct KindResults {
+  std::vector<std::uint64_t> latencies;
+  std::uint64_t bytes = 0U;
+  std::uint64_t errors = 0U;
+};
+
+struct ClientResults {
+  KindResults kinds[kKindCount];
+  std::uint64_t connects = 0U;
+};
+
+// Items the server is known to hold in each sheet used, so updates target
+// existing indexes.
+std::vector<std::atomic<std::uint64_t>> g_knownItems;
+
+// The path prefix of sheet `sheet`, or "" for the default sheet.
+std::string sheetPrefix(const LoadOptions& options, size_t sheet) {
+  return options.sheets == 0 ? std::string() : "/s/load-" + std::to_string(sheet);
+}
+
+class Connection {
+public:
+  Connection(const sockaddr_in& address, bool keepAlive) : address_(address), keepAlive_(keepAlive) {}
+
+  ~Connection() {
+    close();
+  }
+
+  Connection(const Connection&) = delete;
+  Connection& operator=(const Connection&) = delete;
+
+  // Sends `request` and reads the whole response. Returns its status code, or
+  // 0 when the connection failed. `bodyBytes` receives the body size and
+  // `body`, when given, a Content-Length delimited body.
+  int exchange(const std::string& request, size_t& bodyBytes, std::uint64_t& connects, std::string* body = nullptr) {
+    if (socket_ < 0) {
+      if (!open()) {
+        return 0;
+      }
+      ++connects;
+    }
+    if (!sendAll(request)) {
+      close();
+      return 0;
+    }
+    bool closeAfter = false;
+    const int status = readResponse(bodyBytes, closeAfter, body);
+    if (status == 0 || closeAfter || !keepAlive_) {
+      close();
+    }
+    return status;
+  }
+
+private:
+  bool open() {
+    socket_ = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (socket_ < 0) {
+      return false;
+    }
+    const int enabled = 1;
+    setsockopt(socket_, IPPROTO_TCP, TCP_NODELAY, &enabled, sizeof(enabled));
+    if (connect(socket_, reinterpret_cast<const sockaddr*>(&address_), sizeof(address_)) != 0) {
+      close();
+      return false;
+    }
+    buffer_.clear();
+    return true;
+  }
+
+  void close() {
+    if (socket_ >= 0) {
+      ::close(socket_);
+      socket_ = -1;
+    }
+  }
+
+  bool sendAll(std::string_view bytes) {
+    while (!bytes.empty()) {
+      const ssize_t sent = send(socket_, bytes.data(), bytes.size(), MSG_NOSIGNAL);
+      if (sent <= 0) {
+        return false;
+      }
+      bytes.remove_prefix(static_cast<size_t>(sent));
+    }
+    return true;
+  }
+
+  // Appends whatever the socket has to the buffer; false on EOF or error.
+  bool receiveMore() {
+    char chunk[64 * 1024];
+    const ssize_t received = recv(socket_, chunk, sizeof(chunk), 0);
+    if (received <= 0) {
+      return false;
+    }
+    buffer_.append(chunk, static_cast<size_t>(received));
+    return true;
+  }
+
+  // Makes sure the buffer holds at least `size` bytes.
+  bool fill(size_t size) {
+    while (buffer_.size() < size) {
+      if (!receiveMore()) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  static std::string_view headerValue(std::string_view head, std::string_view lowerName) {
+    size_t lineStart = head.find("\r\n");
+    while (lineStart != std::string_view::npos && lineStart + 2U < head.size()) {
+      lineStart += 2U;
+      const size_t lineEnd = head.find("\r\n", lineStart);
+      const std::string_view line = head.substr(lineStart, lineEnd - lineStart);
+      const size_t colon = line.find(':');
+      if (colon == lowerName.size() &&
+          std::equal(lowerName.begin(), lowerName.end(), line.begin(),
+                     [](char expected, char actual) { return expected == (actual | 0x20); })) {
+        std::string_view value = line.substr(colon + 1U);
+        while (!value.empty() && value.front() == ' ') {
+          value.remove_prefix(1);
+        }
+        return value;
+      }
+      lineStart = lineEnd;
+    }
+    return {};
+  }
+
+  int readResponse(size_t& bodyBytes, bool& closeAfter, std::string* body) {
+    size_t headEnd = std::string::npos;
+    while ((headEnd = buffer_.find("\r\n\r\n")) == std::string::npos) {
+      if (!receiveMore()) {
+        return 0;
+      }
+    }
+    const std::string head = buffer_.substr(0, headEnd + 2U);
+    size_t position = headEnd + 4U;
+    if (head.size() < 12U || head.compare(0, 5, "HTTP/") != 0) {
+      return 0;
+    }
+    const int status = std::atoi(head.c_str() + 9);
+    closeAfter = headerValue(head, "connection") == "close";
+
+    if (headerValue(head, "transfer-encoding") == "chunked") {
+      bodyBytes = 0U;
+      while (true) {
+        size_t lineEnd = std::string::npos;
+        while ((lineEnd = buffer_.find("\r\n", position)) == std::string::npos) {
+          if (!receiveMore()) {
+            return 0;
+          }
+        }
+        const size_t chunkSize = std::strtoul(buffer_.c_str() + position, nullptr, 16);
+        position = lineEnd + 2U + chunkSize + 2U;
+        if (!fill(position)) {
+          return 0;
+        }
+        bodyBytes += chunkSize;
+        if (chunkSize == 0U) {
+          break;
+        }
+      }
+    } else {
+      const std::string_view length = headerValue(head, "content-length");
+      if (length.empty()) {
+        // Delimited by the server closing the connection.
+        while (receiveMore()) {
+        }
+        bodyBytes = buffer_.size() - position;
+        closeAfter = true;
+        buffer_.clear();
+        return status;
+      }
+      bodyBytes = std::strtoul(std::string(length).c_str(), nullptr, 10);
+      if (!fill(position + bodyBytes)) {
+        return 0;
+      }
+      if (body != nullptr) {
+        body->assign(buffer_, position, bodyBytes);
+      }
+      position += bodyBytes;
+    }
+    buffer_.erase(0, position);
+    return status;
+  }
+
+  sockaddr_in address_;
+  bool keepAlive_;
+  int socket_ = -1;
+  std::string buffer_;
+};
+
+std::string buildRequest(RequestKind kind,
+                         std::uint64_t random,
+                         bool keepAlive,
+                         const std::string& prefix,
+                         std::uint64_t knownItems) {
+  std::string request;
+  std::string body;
+  switch (kind) {
+    case kIndex:
+      request = "GET " + prefix + "/ HTTP/1.1\r\n";
+      break;
+    case kExport:
+      request = "GET " + prefix + "/export HTTP/1.1\r\n";
+      break;
+    case kSubmit:
+      request = "POST " + prefix + "/submit HTTP/1.1\r\n";
+      body = "itemNameSelect=Refrigerio&itemName=&itemQuantity=" + std::to_string(1U + random % 20U) +
+             "&itemCost=" + std::to_string(1000U + random % 90000U) + ".50";
+      break;
+    case kUpdate: {
+      const std::uint64_t items = std::max<std::uint64_t>(1U, knownItems);
+      request = "POST " + prefix + "/update HTTP/1.1\r\n";
+      body = "itemIndex=" + std::to_string(random % items) + "&itemNameSelect=Transporte&itemName=&itemQuantity=" +
+             std::to_string(1U + random % 20U) + "&itemCost=" + std::to_string(500U + random % 9000U);
+      break;
+    }
+    case kKindCount:
+      break;
+  }
+  request += "Host: localhost\r\n";
+  request += keepAlive ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
+  if (!body.empty()) {
+    request += "Content-Type: application/x-www-form-urlencoded\r\nContent-Length: " + std::to_string(body.size()) +
+               "\r\n";
+  }
+  request += "\r\n";
+  request += body;
+  return request;
+}
+
+std::uint64_t nextRandom(std::uint64_t& state) {
+  state ^= state << 13;
+  state ^= state >> 7;
+  state ^= state << 17;
+  return state;
+}
+
+void runClient(const LoadOptions& options,
+               const sockaddr_in& address,
+               unsigned seed,
+               Clock::time_point deadline,
+               ClientResults& results) {
+  unsigned totalWeight = 0U;
+  for (const unsigned weight : options.weights) {
+    totalWeight += weight;
+  }
+  std::uint64_t state = 0x9E3779B97F4A7C15ULL ^ (static_cast<std::uint64_t>(seed + 1U) * 0xBF58476D1CE4E5B9ULL);
+  const size_t sheet = seed % g_knownItems.size();
+  const std::string prefix = sheetPrefix(options, sheet);
+  std::atomic<std::uint64_t>& knownItems = g_knownItems[sheet];
+  Connection connection(address, options.keepAlive);
+  size_t bodyBytes = 0U;
+
+  while (Clock::now() < deadline) {
+    const std::uint64_t random = nextRandom(state);
+    unsigned pick = static_cast<unsigned>(random % totalWeight);
+    size_t kind = 0U;
+    while (pick >= options.weights[kind]) {
+      pick -= options.weights[kind++];
+    }
+    const std::string request = buildRequest(static_cast<RequestKind>(kind), random >> 16, options.keepAlive, prefix,
+                                             knownItems.load(std::memory_order_relaxed));
+
+    const auto start = Clock::now();
+    const int status = connection.exchange(request, bodyBytes, results.connects);
+    const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+
+    KindResults& kindResults = results.kinds[kind];
+    if (status == 0 || status >= 400) {
+      ++kindResults.errors;
+      if (status == 0) {
+        // The server is gone or refusing; do not spin.
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      }
+      continue;
+    }
+    kindResults.latencies.push_back(static_cast<std::uint64_t>(elapsed));
+    kindResults.bytes += bodyBytes;
+    if (kind == kSubmit) {
+      knownItems.fetch_add(1U, std::memory_order_relaxed);
+    }
+  }
+}
+
+// Item count of each sheet from its /summary, so updates start with valid
+// indexes. An empty sheet gets one item, which also creates a named sheet.
+bool primeItemCounts(const LoadOptions& options, const sockaddr_in& address) {
+  g_knownItems = std::vector<std::atomic<std::uint64_t>>(static_cast<size_t>(std::max(options.sheets, 1)));
+  Connection connection(address, true);
+  std::uint64_t connects = 0U;
+  size_t bodyBytes = 0U;
+  for (size_t sheet = 0; sheet < g_knownItems.size(); ++sheet) {
+    const std::string prefix = sheetPrefix(options, sheet);
+    std::string summary;
+    if (connection.exchange("GET " + prefix + "/summary HTTP/1.1\r\nHost: localhost\r\n\r\n", bodyBytes, connects,
+                            &summary) != 200) {
+      return false;
+    }
+    const size_t count = summary.find("\"count\":");
+    g_knownItems[sheet] = count == std::string::npos ? 0U : std::strtoull(summary.c_str() + count + 8U, nullptr, 10);
+    if (g_knownItems[sheet] == 0U) {
+      if (connection.exchange(buildRequest(kSubmit, 0U, true, prefix, 0U), bodyBytes, connects) != 303) {
+        return false;
+      }
+      g_knownItems[sheet] = 1U;
+    }
+  }
+  return true;
+}
+
+double percentile(const std::vector<std::uint64_t>& sorted, double quantile) {
+  if (sorted.empty()) {
+    return 0.0;
+  }
+  const size_t rank = static_cast<size_t>(quantile * static_cast<double>(sorted.size() - 1U) + 0.5);
+  return static_cast<double>(sorted[rank]) / 1e3;
+}
+
+void printRow(const char* name, std::vector<std::uint64_t>& latencies, std::uint64_t errors, std::uint64_t bytes,
+              double seconds) {
+  std::sort(latencies.begin(), latencies.end());
+  std::printf("%-14s %10zu %8llu %12.1f %10.1f %10.1f %10.1f %10.1f\n", name, latencies.size(),
+              static_cast<unsigned long long>(errors), static_cast<double>(latencies.size()) / seconds,
+              static_cast<double>(bytes) / seconds / (1024.0 * 1024.0), percentile(latencies, 0.5),
+              percentile(latencies, 0.99), percentile(latencies, 0.999));
+}
+
+int parsePositive(const std::string& name, const char* value) {
+  char* end = nullptr;
+  const long parsed = std::strtol(value, &end, 10);
+  if (*end != '\0' || parsed <= 0 || parsed > 1'000'000) {
+    throw std::invalid_argument("Valor inválido para " + name + ": " + value);
+  }
+  return static_cast<int>(parsed);
+}
+
+// "index=80,export=5,submit=10,update=5"; kinds left out get weight 0.
+void parseMix(const std::string& mix, LoadOptions& options) {
+  std::fill(std::begin(options.weights), std::end(options.weights), 0U);
+  unsigned total = 0U;
+  size_t start = 0U;
+  while (start < mix.size()) {
+    const size_t comma = std::min(mix.find(',', start), mix.size());
+    const std::string entry = mix.substr(start, comma - start);
+    const size_t equals = entry.find('=');
+    const std::string key = entry.substr(0, equals);
+    const auto keyIt = std::find_if(std::begin(kMixKeys), std::end(kMixKeys),
+                                    [&key](const char* candidate) { return key == candidate; });
+    if (equals == std::string::npos || keyIt == std::end(kMixKeys)) {
+      throw std::invalid_argument("Entrada inválida en --mix: " + entry);
+    }
+    const unsigned weight = static_cast<unsigned>(std::strtoul(entry.c_str() + equals + 1U, nullptr, 10));
+    options.weights[keyIt - std::begin(kMixKeys)] = weight;
+    total += weight;
+    start = comma + 1U;
+  }
+  if (total == 0U) {
+    throw std::invalid_argument("--mix no tiene ningún peso positivo");
+  }
+}
+
+LoadOptions parseLoadOptions(int argc, char** argv) {
+  LoadOptions options;
+  for (int index = 1; index < argc; ++index) {
+    const std::string argument = argv[index];
+    if (argument == "--host" && index + 1 < argc) {
+      options.host = argv[++index];
+    } else if (argument == "--port" && index + 1 < argc) {
+      options.port = static_cast<unsigned short>(parsePositive(argument, argv[++index]));
+    } else if (argument == "--connections" && index + 1 < argc) {
+      options.connections = parsePositive(argument, argv[++index]);
+    } else if (argument == "--duration" && index + 1 < argc) {
+      options.durationSeconds = parsePositive(argument, argv[++index]);
+    } else if (argument == "--no-keep-alive") {
+      options.keepAlive = false;
+    } else if (argument == "--mix" && index + 1 < argc) {
+      parseMix(argv[++index], options);
+    } else if (argument == "--sheets" && index + 1 < argc) {
+      options.sheets = parsePositive(argument, argv[++index]);
+    } else {
+      throw std::invalid_argument("Argumento desconocido: " + argument);
+    }
+  }
+  return options;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  LoadOptions options;
+  try {
+    options = parseLoadOptions(argc, argv);
+  } catch (const std::exception& ex) {
+    std::fprintf(stderr, "%s\nUso: bench_load [--host IP] [--port N] [--connections N] [--duration S] "
+                         "[--no-keep-alive] [--mix index=80,export=5,submit=10,update=5] [--sheets N]\n",
+                 ex.what());
+    return 2;
+  }
+
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(options.port);
+  if (inet_pton(AF_INET, options.host.c_str(), &address.sin_addr) != 1) {
+    std::fprintf(stderr, "Dirección IPv4 inválida: %s\n", options.host.c_str());
+    return 2;
+  }
+  if (!primeItemCounts(options, address)) {
+    std::fprintf(stderr, "No se pudo conectar con %s:%u\n", options.host.c_str(), options.port);
+    return 1;
+  }
+
+  std::printf("%d conexión(es), %d s, keep-alive %s, mezcla index=%u export=%u submit=%u update=%u, %zu hoja(s)\n\n",
+              options.connections, options.durationSeconds, options.keepAlive ? "sí" : "no", options.weights[kIndex],
+              options.weights[kExport], options.weights[kSubmit], options.weights[kUpdate], g_knownItems.size());
+
+  std::vector<ClientResults> results(static_cast<size_t>(options.connections));
+  std::vector<std::thread> threads;
+  const auto start = Clock::now();
+  const auto deadline = start + std::chrono::seconds(options.durationSeconds);
+  for (int index = 0; index < options.connections; ++index) {
+    threads.emplace_back(runClient, std::cref(options), std::cref(address), static_cast<unsigned>(index), deadline,
+                         std::ref(results[static_cast<size_t>(index)]));
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+  std::printf("%-14s %10s %8s %12s %10s %10s %10s %10s\n", "Petición", "Respuestas", "Errores", "resp/s", "MiB/s",
+              "p50 µs", "p99 µs", "p999 µs");
+  std::printf("%.*s\n", 92,
+              "--------------------------------------------------------------------------------------------");
+  std::vector<std::uint64_t> all;
+  std::uint64_t allErrors = 0U;
+  std::uint64_t allBytes = 0U;
+  std::uint64_t connects = 0U;
+  for (size_t kind = 0; kind < kKindCount; ++kind) {
+    std::vector<std::uint64_t> latencies;
+    std::uint64_t errors = 0U;
+    std::uint64_t bytes = 0U;
+    for (ClientResults& client : results) {
+      KindResults& kindResults = client.kinds[kind];
+      latencies.insert(latencies.end(), kindResults.latencies.begin(), kindResults.latencies.end());
+      errors += kindResults.errors;
+      bytes += kindResults.bytes;
+    }
+    if (options.weights[kind] == 0U) {
+      continue;
+    }
+    all.insert(all.end(), latencies.begin(), latencies.end());
+    allErrors += errors;
+    allBytes += bytes;
+    printRow(kKindNames[kind], latencies, errors, bytes, seconds);
+  }
+  for (const ClientResults& client : results) {
+    connects += client.connects;
+  }
+  printRow("Total", all, allErrors, allBytes, seconds);
+  std::printf("\nConexiones abiertas: %llu\n", static_cast<unsigned long long>(connects));
+  return allErrors == 0U ? 0 : 1;
+}
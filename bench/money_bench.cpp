@@ -0,0 +1,120 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "bench_support.hpp"
+#include "money.hpp"
+
+namespace {
+
+// The double/ostringstream formatting that csfj::Money replaced, kept here as
+// the baseline.
+std::string legacyFormatCurrency(double value) {
+  std::ostringstream out;
+  out << std::fixed << std::setprecision(2) << value;
+  return out.str();
+}
+
+std::string legacyFormatCurrencyWithGrouping(double value) {
+  std::ostringstream out;
+  out << std::fixed << std::setprecision(2) << value;
+  std::string number = out.str();
+  const auto dotPos = number.find('.');
+  std::string integerPart = dotPos == std::string::npos ? number : number.substr(0, dotPos);
+  const std::string decimalPart = dotPos == std::string::npos ? std::string{} : number.substr(dotPos);
+
+  std::vector<std::string> groups;
+  for (std::ptrdiff_t end = static_cast<std::ptrdiff_t>(integerPart.size()); end > 0; end -= 3) {
+    const std::ptrdiff_t start = std::max<std::ptrdiff_t>(0, end - 3);
+    groups.emplace_back(integerPart.substr(static_cast<size_t>(start), static_cast<size_t>(end - start)));
+  }
+  std::reverse(groups.begin(), groups.end());
+
+  if (groups.empty()) {
+    groups.emplace_back("0");
+  }
+
+  std::string grouped = groups[0];
+  for (size_t index = 1; index < groups.size(); ++index) {
+    grouped += (index == 1 && groups.size() > 2) ? '\'' : ',';
+    grouped += groups[index];
+  }
+
+  return grouped + decimalPart;
+}
+
+std::vector<std::int64_t> sampleCents() {
+  std::vector<std::int64_t> cents;
+  std::uint64_t state = 0x9E3779B97F4A7C15ULL;
+  for (int index = 0; index < 4096; ++index) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    cents.push_back(static_cast<std::int64_t>(state % 100'000'000'000ULL));
+  }
+  return cents;
+}
+
+// The new formatting must reproduce the old output exactly.
+size_t countMismatches(const std::vector<std::int64_t>& cents) {
+  size_t mismatches = 0U;
+  for (const std::int64_t value : cents) {
+    const double asDouble = static_cast<double>(value) / 100.0;
+    const csfj::Money amount = csfj::Money::fromCents(value);
+    mismatches += legacyFormatCurrency(asDouble) != csfj::formatMoney(amount) ? 1U : 0U;
+    mismatches += legacyFormatCurrencyWithGrouping(asDouble) != csfj::formatMoneyWithGrouping(amount) ? 1U : 0U;
+  }
+  return mismatches;
+}
+
+}  // namespace
+
+int main() {
+  const std::vector<std::int64_t> cents = sampleCents();
+  std::printf("Diferencias con el formateo anterior: %zu\n\n", countMismatches(cents));
+
+  size_t cursor = 0U;
+  const auto nextCents = [&cents, &cursor] { return cents[cursor++ & (cents.size() - 1U)]; };
+
+  bench::printHeader();
+  bench::run("legacy/formatCurrency", [&] {
+    bench::doNotOptimize(legacyFormatCurrency(static_cast<double>(nextCents()) / 100.0));
+  });
+  bench::run("legacy/formatCurrencyWithGrouping", [&] {
+    bench::doNotOptimize(legacyFormatCurrencyWithGrouping(static_cast<double>(nextCents()) / 100.0));
+  });
+
+  char buffer[csfj::kMaxMoneyChars];
+  bench::run("money/writeMoney", [&] {
+    bench::doNotOptimize(csfj::writeMoney(buffer, csfj::Money::fromCents(nextCents())));
+    bench::doNotOptimize(buffer);
+  });
+  bench::run("money/writeMoneyWithGrouping", [&] {
+    bench::doNotOptimize(csfj::writeMoneyWithGrouping(buffer, csfj::Money::fromCents(nextCents())));
+    bench::doNotOptimize(buffer);
+  });
+
+  std::string out;
+  out.reserve(64);
+  bench::run("money/appendMoneyWithGrouping_reused", [&] {
+    out.clear();
+    csfj::appendMoneyWithGrouping(out, csfj::Money::fromCents(nextCents()));
+    bench::doNotOptimize(out);
+  });
+
+  std::vector<std::string> inputs;
+  for (const std::int64_t value : cents) {
+    inputs.push_back(csfj::formatMoney(csfj::Money::fromCents(value)));
+  }
+  bench::run("legacy/stod", [&] { bench::doNotOptimize(std::stod(inputs[cursor++ & (inputs.size() - 1U)])); });
+  bench::run("money/parseMoney", [&] {
+    csfj::Money parsed;
+    bench::doNotOptimize(csfj::parseMoney(inputs[cursor++ & (inputs.size() - 1U)], parsed));
+    bench::doNotOptimize(parsed);
+  });
+  return 0;
+}
@@ -0,0 +1,158 @@
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "bench_support.hpp"
+#include "embedded_assets.hpp"
+#include "http_parser.hpp"
+#include "item_store.hpp"
+#include "legacy_text_format.hpp"
+#include "money.hpp"
+#include "request_arena.hpp"
+#include "template_engine.hpp"
+#include "text_format.hpp"
+
+namespace {
+
+constexpr size_t kPageRows = 100U;
+
+const std::string kSubmitBody = "itemNameSelect=Hora+docente&itemName=&itemQuantity=12&itemCost=1%27234.50";
+const std::string kUpdateBody =
+    "itemIndex=42&itemNameSelect=Otro...&itemName=Taller+de+%22lectura%22+%26+escritura+%C3%B1&itemQuantity=3&"
+    "itemCost=98%2C500.00";
+
+const std::string kPlainName = "Servicios profesionales de acompañamiento pedagógico";
+const std::string kMarkupName = "<b>Taller \"A&B\"</b> 'sede norte' <script>alert(1)</script>";
+const std::string kLongPlainName = [] {
+  std::string text;
+  while (text.size() < 1024U) {
+    text += kPlainName + " ";
+  }
+  return text;
+}();
+
+struct Row {
+  std::string name;
+  int quantity;
+  csfj::Money unitCost;
+};
+
+std::vector<Row> sampleRows() {
+  std::vector<Row> rows;
+  for (size_t index = 0; index < kPageRows; ++index) {
+    rows.push_back({std::string(csfj::kItemCategories[index % csfj::kItemCategories.size()]),
+                    static_cast<int>(1U + index % 40U), csfj::Money::fromCents(static_cast<long long>(index) * 98765)});
+  }
+  return rows;
+}
+
+// Same layout as appendItemRow in main.cpp.
+void appendRow(std::string& out, size_t index, const Row& row) {
+  out += "      <tr><td>";
+  csfj::appendInteger(out, static_cast<long long>(index + 1));
+  out += "</td><td>";
+  csfj::appendEscapedHtml(out, row.name);
+  out += "</td><td>";
+  csfj::appendInteger(out, row.quantity);
+  out += "</td><td>";
+  csfj::appendMoneyWithGrouping(out, row.unitCost);
+  out += "</td><td>";
+  csfj::appendMoneyWithGrouping(out, row.unitCost * row.quantity);
+  out += "</td><td class=\"actions\"><form class=\"action-form\" method=\"GET\" action=\"edit\">"
+         "<input type=\"hidden\" name=\"index\" value=\"";
+  csfj::appendInteger(out, static_cast<long long>(index));
+  out += "\"><button class=\"action-button\" type=\"submit\">Editar</button></form></td></tr>\n";
+}
+
+}  // namespace
+
+int main() {
+  const csfj::EmbeddedTemplate* indexSource = csfj::embedded::findTemplate("index.html");
+  const csfj::EmbeddedTemplate* editSource = csfj::embedded::findTemplate("edit.html");
+  if (indexSource == nullptr || editSource == nullptr) {
+    std::fprintf(stderr, "Las plantillas no se incluyeron en el binario.\n");
+    return 1;
+  }
+  const csfj::CompiledTemplate indexTemplate(*indexSource,
+                                             {"items_rows", "total_cost", "item_count", "page_offset", "pagination"});
+  const csfj::CompiledTemplate editTemplate(*editSource, {"item_index", "item_name", "item_quantity", "item_cost"});
+  const std::vector<Row> rows = sampleRows();
+
+  bench::printHeader();
+  bench::run("form/FormFields_submit_heap", [] {
+    const csfj::FormFields fields(kSubmitBody);
+    bench::doNotOptimize(fields.find("itemCost"));
+  });
+  csfj::RequestArena arena;
+  bench::run("form/FormFields_submit_arena", [&arena] {
+    arena.reset();
+    const csfj::FormFields fields(kSubmitBody, &arena);
+    bench::doNotOptimize(fields.find("itemCost"));
+  });
+  bench::run("form/FormFields_update_escaped_arena", [&arena] {
+    arena.reset();
+    const csfj::FormFields fields(kUpdateBody, &arena);
+    bench::doNotOptimize(fields.find("itemName"));
+  });
+  bench::run("form/urlDecode_plain", [] { bench::doNotOptimize(csfj::urlDecode("Hora+docente")); });
+  bench::run("form/urlDecode_escaped", [] {
+    bench::doNotOptimize(csfj::urlDecode("Taller+de+%22lectura%22+%26+escritura+%C3%B1"));
+  });
+  bench::run("form/legacy_urlDecode_escaped", [] {
+    bench::doNotOptimize(legacy::urlDecode("Taller+de+%22lectura%22+%26+escritura+%C3%B1"));
+  });
+  bench::run("form/urlDecode_long_plain", [] { bench::doNotOptimize(csfj::urlDecode(kLongPlainName)); });
+  bench::run("form/legacy_urlDecode_long_plain", [] { bench::doNotOptimize(legacy::urlDecode(kLongPlainName)); });
+
+  bench::run("html/escapeHtml_plain", [] { bench::doNotOptimize(csfj::escapeHtml(kPlainName)); });
+  bench::run("html/escapeHtml_markup", [] { bench::doNotOptimize(csfj::escapeHtml(kMarkupName)); });
+  bench::run("html/legacy_escapeHtml_markup", [] { bench::doNotOptimize(legacy::escapeHtml(kMarkupName)); });
+  bench::run("html/escapeHtml_long_plain", [] { bench::doNotOptimize(csfj::escapeHtml(kLongPlainName)); });
+  bench::run("html/legacy_escapeHtml_long_plain", [] { bench::doNotOptimize(legacy::escapeHtml(kLongPlainName)); });
+  std::string out;
+  bench::run("html/appendEscapedHtml_markup_reused", [&out] {
+    out.clear();
+    csfj::appendEscapedHtml(out, kMarkupName);
+    bench::doNotOptimize(out);
+  });
+  bench::run("csv/appendEscapedCsv_markup_reused", [&out] {
+    out.clear();
+    csfj::appendEscapedCsv(out, kMarkupName);
+    bench::doNotOptimize(out);
+  });
+
+  // formatCurrencyWithGrouping's replacement; bench_money compares it with the
+  // original ostringstream version.
+  bench::run("money/formatMoneyWithGrouping", [] {
+    bench::doNotOptimize(csfj::formatMoneyWithGrouping(csfj::Money::fromCents(123456789)));
+  });
+
+  bench::run("template/edit_renderTo", [&] {
+    csfj::SlotValue values[4];
+    values[0] = csfj::integerSlot(42);
+    values[1] = csfj::htmlSlot(kMarkupName);
+    values[2] = csfj::integerSlot(3);
+    values[3] = csfj::currencySlot(csfj::Money::fromCents(9850000));
+    std::string page;
+    editTemplate.renderTo(page, values, 4U);
+    bench::doNotOptimize(page);
+  });
+  bench::run("template/index_100_rows_renderSegments", [&] {
+    const auto writeRows = [&rows](std::string& text) {
+      for (size_t index = 0; index < rows.size(); ++index) {
+        appendRow(text, index, rows[index]);
+      }
+    };
+    csfj::SlotValue values[5];
+    values[0] = csfj::writerSlot(writeRows);
+    values[1] = csfj::groupedCurrencySlot(csfj::Money::fromCents(4889452500));
+    values[2] = csfj::integerSlot(static_cast<long long>(rows.size()));
+    values[3] = csfj::integerSlot(0);
+    values[4] = csfj::textSlot("");
+    csfj::SegmentedText page;
+    indexTemplate.renderSegments(page, values, 5U, rows.size() * 400U);
+    bench::doNotOptimize(page);
+  });
+  return 0;
+}
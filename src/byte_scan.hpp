@@ -0,0 +1,150 @@
+#pragma once
+
+#include <bitset>
+#include <cstddef>
+#include <string_view>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #include <emmintrin.h>
+  #define CSFJ_SCAN_SSE2 1
+  #ifdef __AVX2__
+    #include <immintrin.h>
+    #define CSFJ_SCAN_AVX2 1
+  #endif
+  #ifdef _MSC_VER
+    #include <intrin.h>
+  #endif
+#endif
+
+// Searches for a small set of byte values 32 (AVX2) or 16 (SSE2) bytes per
+// step, with a scalar loop for the tail and for targets without SSE2. AVX2 is
+// only used when the compiler targets it (CSFJ_ENABLE_AVX2 in CMake).
+namespace csfj {
+
+namespace scan_detail {
+
+inline unsigned lowestSetBit(unsigned mask) {
+#ifdef _MSC_VER
+  unsigned long index = 0;
+  _BitScanForward(&index, mask);
+  return static_cast<unsigned>(index);
+#else
+  return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+
+inline size_t bitCount(unsigned mask) {
+  return std::bitset<32>(mask).count();
+}
+
+#ifdef CSFJ_SCAN_SSE2
+template <char... Bytes>
+unsigned matchMask(const char* data) {
+  const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+  __m128i hits = _mm_setzero_si128();
+  ((hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, _mm_set1_epi8(Bytes)))), ...);
+  return static_cast<unsigned>(_mm_movemask_epi8(hits));
+}
+#endif
+
+#ifdef CSFJ_SCAN_AVX2
+template <char... Bytes>
+unsigned wideMatchMask(const char* data) {
+  const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+  __m256i hits = _mm256_setzero_si256();
+  ((hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(block, _mm256_set1_epi8(Bytes)))), ...);
+  return static_cast<unsigned>(_mm256_movemask_epi8(hits));
+}
+#endif
+
+template <char... Bytes>
+bool isAnyOf(char ch) {
+  return ((ch == Bytes) || ...);
+}
+
+}  // namespace scan_detail
+
+#ifdef CSFJ_SCAN_AVX2
+constexpr size_t kScanBlock = 32U;
+#else
+constexpr size_t kScanBlock = 16U;
+#endif
+
+// Bit i is set when text[offset + i] is one of `Bytes`, for the kScanBlock bytes
+// starting at `offset` or as many as are left. Lets a caller handle every match
+// of a block without scanning it again.
+template <char... Bytes>
+unsigned blockMatchMask(std::string_view text, size_t offset) {
+  const char* data = text.data();
+#ifdef CSFJ_SCAN_AVX2
+  if (offset + 32U <= text.size()) {
+    return scan_detail::wideMatchMask<Bytes...>(data + offset);
+  }
+#elif defined(CSFJ_SCAN_SSE2)
+  if (offset + 16U <= text.size()) {
+    return scan_detail::matchMask<Bytes...>(data + offset);
+  }
+#endif
+  const size_t end = offset + kScanBlock < text.size() ? offset + kScanBlock : text.size();
+  unsigned mask = 0U;
+  for (size_t index = offset; index < end; ++index) {
+    mask |= scan_detail::isAnyOf<Bytes...>(data[index]) ? 1U << (index - offset) : 0U;
+  }
+  return mask;
+}
+
+// Returns the offset of the first byte of `text` at or after `from` that is one
+// of `Bytes`, or text.size() when there is none.
+template <char... Bytes>
+size_t findAnyByte(std::string_view text, size_t from = 0U) {
+  const char* data = text.data();
+  const size_t size = text.size();
+  size_t offset = from;
+#ifdef CSFJ_SCAN_AVX2
+  for (; offset + 32U <= size; offset += 32U) {
+    const unsigned mask = scan_detail::wideMatchMask<Bytes...>(data + offset);
+    if (mask != 0U) {
+      return offset + scan_detail::lowestSetBit(mask);
+    }
+  }
+#endif
+#ifdef CSFJ_SCAN_SSE2
+  for (; offset + 16U <= size; offset += 16U) {
+    const unsigned mask = scan_detail::matchMask<Bytes...>(data + offset);
+    if (mask != 0U) {
+      return offset + scan_detail::lowestSetBit(mask);
+    }
+  }
+#endif
+  for (; offset < size; ++offset) {
+    if (scan_detail::isAnyOf<Bytes...>(data[offset])) {
+      return offset;
+    }
+  }
+  return size;
+}
+
+// Number of bytes of `text` that are one of `Bytes`.
+template <char... Bytes>
+size_t countAnyByte(std::string_view text) {
+  const char* data = text.data();
+  const size_t size = text.size();
+  size_t offset = 0U;
+  size_t count = 0U;
+#ifdef CSFJ_SCAN_AVX2
+  for (; offset + 32U <= size; offset += 32U) {
+    count += scan_detail::bitCount(scan_detail::wideMatchMask<Bytes...>(data + offset));
+  }
+#endif
+#ifdef CSFJ_SCAN_SSE2
+  for (; offset + 16U <= size; offset += 16U) {
+    count += scan_detail::bitCount(scan_detail::matchMask<Bytes...>(data + offset));
+  }
+#endif
+  for (; offset < size; ++offset) {
+    count += scan_detail::isAnyOf<Bytes...>(data[offset]) ? 1U : 0U;
+  }
+  return count;
+}
+
+}  // namespace csfj
@@ -0,0 +1,247 @@
+#include "column_scan.hpp"
+
+#include "byte_scan.hpp"  // CSFJ_SCAN_SSE2 / CSFJ_SCAN_AVX2 and the intrinsics headers
+
+namespace csfj {
+
+namespace {
+
+#ifdef CSFJ_SCAN_AVX2
+std::int64_t horizontalSum(__m256i lanes) {
+  std::int64_t values[4];
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(values), lanes);
+  return values[0] + values[1] + values[2] + values[3];
+}
+
+// All ones in lane j when bit j of `bits` is set.
+__m256i laneMask(std::uint64_t bits) {
+  const __m256i lanes = _mm256_setr_epi64x(1, 2, 4, 8);
+  return _mm256_cmpeq_epi64(_mm256_and_si256(_mm256_set1_epi64x(static_cast<long long>(bits)), lanes), lanes);
+}
+#elif defined(CSFJ_SCAN_SSE2)
+std::int64_t horizontalSum(__m128i lanes) {
+  std::int64_t values[2];
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(values), lanes);
+  return values[0] + values[1];
+}
+#endif
+
+// The masks below cover up to 64 rows: bit i stands for values[i].
+
+std::uint64_t equalMask(const std::uint8_t* values, size_t rows, std::uint8_t wanted) {
+  std::uint64_t bits = 0U;
+  size_t row = 0U;
+#ifdef CSFJ_SCAN_AVX2
+  const __m256i pattern = _mm256_set1_epi8(static_cast<char>(wanted));
+  for (; row + 32U <= rows; row += 32U) {
+    const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + row));
+    bits |= static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, pattern))))
+            << row;
+  }
+#endif
+#ifdef CSFJ_SCAN_SSE2
+  const __m128i narrowPattern = _mm_set1_epi8(static_cast<char>(wanted));
+  for (; row + 16U <= rows; row += 16U) {
+    const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + row));
+    bits |= static_cast<std::uint64_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, narrowPattern))) << row;
+  }
+#endif
+  for (; row < rows; ++row) {
+    bits |= static_cast<std::uint64_t>(values[row] == wanted) << row;
+  }
+  return bits;
+}
+
+std::uint64_t rangeMask(const std::int32_t* values, size_t rows, std::int32_t low, std::int32_t high) {
+  std::uint64_t bits = 0U;
+  size_t row = 0U;
+#ifdef CSFJ_SCAN_AVX2
+  const __m256i wideLow = _mm256_set1_epi32(low);
+  const __m256i wideHigh = _mm256_set1_epi32(high);
+  for (; row + 8U <= rows; row += 8U) {
+    const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + row));
+    const __m256i outside = _mm256_or_si256(_mm256_cmpgt_epi32(wideLow, block), _mm256_cmpgt_epi32(block, wideHigh));
+    bits |= static_cast<std::uint64_t>(~_mm256_movemask_ps(_mm256_castsi256_ps(outside)) & 0xFF) << row;
+  }
+#endif
+#ifdef CSFJ_SCAN_SSE2
+  const __m128i narrowLow = _mm_set1_epi32(low);
+  const __m128i narrowHigh = _mm_set1_epi32(high);
+  for (; row + 4U <= rows; row += 4U) {
+    const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + row));
+    const __m128i outside = _mm_or_si128(_mm_cmpgt_epi32(narrowLow, block), _mm_cmpgt_epi32(block, narrowHigh));
+    bits |= static_cast<std::uint64_t>(~_mm_movemask_ps(_mm_castsi128_ps(outside)) & 0xF) << row;
+  }
+#endif
+  for (; row < rows; ++row) {
+    bits |= static_cast<std::uint64_t>((values[row] >= low) & (values[row] <= high)) << row;
+  }
+  return bits;
+}
+
+// SSE2 has no 64-bit comparison, so without AVX2 this one is scalar.
+std::uint64_t rangeMask(const std::int64_t* values, size_t rows, std::int64_t low, std::int64_t high) {
+  std::uint64_t bits = 0U;
+  size_t row = 0U;
+#ifdef CSFJ_SCAN_AVX2
+  const __m256i wideLow = _mm256_set1_epi64x(low);
+  const __m256i wideHigh = _mm256_set1_epi64x(high);
+  for (; row + 4U <= rows; row += 4U) {
+    const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + row));
+    const __m256i outside = _mm256_or_si256(_mm256_cmpgt_epi64(wideLow, block), _mm256_cmpgt_epi64(block, wideHigh));
+    bits |= static_cast<std::uint64_t>(~_mm256_movemask_pd(_mm256_castsi256_pd(outside)) & 0xF) << row;
+  }
+#endif
+  for (; row < rows; ++row) {
+    bits |= static_cast<std::uint64_t>((values[row] >= low) & (values[row] <= high)) << row;
+  }
+  return bits;
+}
+
+// Sums values[0, count) a vector at a time and stores in `summed` how many of
+// them that covered, leaving the rest (fewer than one step) to the caller.
+// Without SSE2 or AVX2 the loop is scalar and covers them all.
+std::int64_t sumVectors(const std::int64_t* values, size_t count, size_t& summed) {
+  size_t index = 0U;
+  std::int64_t sum = 0;
+#ifdef CSFJ_SCAN_AVX2
+  // Two accumulators keep two additions in flight.
+  __m256i first = _mm256_setzero_si256();
+  __m256i second = _mm256_setzero_si256();
+  for (; index + 8U <= count; index += 8U) {
+    first = _mm256_add_epi64(first, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + index)));
+    second = _mm256_add_epi64(second, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + index + 4U)));
+  }
+  sum = horizontalSum(_mm256_add_epi64(first, second));
+#elif defined(CSFJ_SCAN_SSE2)
+  __m128i first = _mm_setzero_si128();
+  __m128i second = _mm_setzero_si128();
+  for (; index + 4U <= count; index += 4U) {
+    first = _mm_add_epi64(first, _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + index)));
+    second = _mm_add_epi64(second, _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + index + 2U)));
+  }
+  sum = horizontalSum(_mm_add_epi64(first, second));
+#else
+  for (; index < count; ++index) {
+    sum += values[index];
+  }
+#endif
+  summed = index;
+  return sum;
+}
+
+}  // namespace
+
+std::int64_t sumColumn(const std::int64_t* values, size_t count) {
+  size_t index = 0U;
+  std::int64_t sum = sumVectors(values, count, index);
+  for (; index < count; ++index) {
+    sum += values[index];
+  }
+  return sum;
+}
+
+std::int64_t maskedSum(const std::int64_t* values, size_t count, const std::uint64_t* mask) {
+  std::int64_t sum = 0;
+  for (size_t base = 0; base < count; base += 64U) {
+    const size_t rows = count - base < 64U ? count - base : 64U;
+    std::uint64_t bits = mask[base / 64U];
+    if (bits == 0U) {
+      continue;
+    }
+    if (rows == 64U && bits == ~std::uint64_t{0}) {
+      // 64 is a whole number of vectors, so there is no tail to add; calling
+      // sumColumn() here made GCC reason about a tail loop past the end.
+      size_t summed = 0U;
+      sum += sumVectors(values + base, 64U, summed);
+      continue;
+    }
+    size_t row = 0U;
+#ifdef CSFJ_SCAN_AVX2
+    __m256i lanes = _mm256_setzero_si256();
+    for (; row + 4U <= rows; row += 4U, bits >>= 4U) {
+      const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + base + row));
+      lanes = _mm256_add_epi64(lanes, _mm256_and_si256(block, laneMask(bits & 0xFU)));
+    }
+    sum += horizontalSum(lanes);
+#elif defined(CSFJ_SCAN_SSE2)
+    __m128i lanes = _mm_setzero_si128();
+    for (; row + 2U <= rows; row += 2U, bits >>= 2U) {
+      const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + base + row));
+      const __m128i select = _mm_set_epi64x(-static_cast<long long>((bits >> 1U) & 1U), -static_cast<long long>(bits & 1U));
+      lanes = _mm_add_epi64(lanes, _mm_and_si128(block, select));
+    }
+    sum += horizontalSum(lanes);
+#endif
+    for (; row < rows; ++row, bits >>= 1U) {
+      sum += (bits & 1U) != 0U ? values[base + row] : 0;
+    }
+  }
+  return sum;
+}
+
+// A grouped sum has no SSE2/AVX2 form short of one masked pass per category,
+// which loses to this loop past a handful of categories. Two sets of totals
+// let consecutive rows of the same category update independently.
+void sumByCategory(const std::uint8_t* categories,
+                   const std::int64_t* values,
+                   size_t count,
+                   std::uint64_t* counts,
+                   std::int64_t* sums) {
+  std::uint64_t evenCounts[kMaxCategoryIds] = {};
+  std::uint64_t oddCounts[kMaxCategoryIds] = {};
+  std::int64_t evenSums[kMaxCategoryIds] = {};
+  std::int64_t oddSums[kMaxCategoryIds] = {};
+  size_t index = 0U;
+  for (; index + 2U <= count; index += 2U) {
+    ++evenCounts[categories[index]];
+    evenSums[categories[index]] += values[index];
+    ++oddCounts[categories[index + 1U]];
+    oddSums[categories[index + 1U]] += values[index + 1U];
+  }
+  if (index < count) {
+    ++evenCounts[categories[index]];
+    evenSums[categories[index]] += values[index];
+  }
+  for (size_t id = 0; id < kMaxCategoryIds; ++id) {
+    counts[id] += evenCounts[id] + oddCounts[id];
+    sums[id] += evenSums[id] + oddSums[id];
+  }
+}
+
+void filterRows(const std::uint8_t* categories,
+                const std::int32_t* quantities,
+                const std::int64_t* unitCents,
+                const std::int64_t* totalCents,
+                size_t count,
+                const ColumnFilter& filter,
+                std::uint64_t* mask) {
+  constexpr std::int32_t kAnyQuantityLow = std::numeric_limits<std::int32_t>::min();
+  constexpr std::int32_t kAnyQuantityHigh = std::numeric_limits<std::int32_t>::max();
+  constexpr std::int64_t kAnyCentsLow = std::numeric_limits<std::int64_t>::min();
+  constexpr std::int64_t kAnyCentsHigh = std::numeric_limits<std::int64_t>::max();
+  const bool byQuantity = filter.minQuantity != kAnyQuantityLow || filter.maxQuantity != kAnyQuantityHigh;
+  const bool byUnitCost = filter.minUnitCents != kAnyCentsLow || filter.maxUnitCents != kAnyCentsHigh;
+  const bool byTotal = filter.minTotalCents != kAnyCentsLow || filter.maxTotalCents != kAnyCentsHigh;
+  // One column at a time, skipping filters left open and, once no row of a
+  // word is left, the remaining columns.
+  for (size_t base = 0; base < count; base += 64U) {
+    const size_t rows = count - base < 64U ? count - base : 64U;
+    std::uint64_t bits = rows == 64U ? ~std::uint64_t{0} : (std::uint64_t{1} << rows) - 1U;
+    if (filter.category >= 0) {
+      bits &= equalMask(categories + base, rows, static_cast<std::uint8_t>(filter.category));
+    }
+    if (byQuantity && bits != 0U) {
+      bits &= rangeMask(quantities + base, rows, filter.minQuantity, filter.maxQuantity);
+    }
+    if (byUnitCost && bits != 0U) {
+      bits &= rangeMask(unitCents + base, rows, filter.minUnitCents, filter.maxUnitCents);
+    }
+    if (byTotal && bits != 0U) {
+      bits &= rangeMask(totalCents + base, rows, filter.minTotalCents, filter.maxTotalCents);
+    }
+    mask[base / 64U] = bits;
+  }
+}
+
+}  // namespace csfj
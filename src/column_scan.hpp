@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+// Reductions and range filters over the item columns (see ItemSnapshot::
+// Columns): 4 values per step with AVX2 (CSFJ_ENABLE_AVX2 in CMake), 2 with
+// SSE2 where 64-bit additions suffice, and a scalar loop for the tail and for
+// other targets.
+namespace csfj {
+
+// Sum of values[0, count).
+std::int64_t sumColumn(const std::int64_t* values, size_t count);
+
+// Sum of the values[i] whose bit i is set in `mask`, for i < count.
+std::int64_t maskedSum(const std::int64_t* values, size_t count, const std::uint64_t* mask);
+
+// Adds the count and the sum of `values` of each row to counts[id] and
+// sums[id], id being the row's category. Every id must be below
+// kMaxCategoryIds.
+constexpr size_t kMaxCategoryIds = 16U;
+void sumByCategory(const std::uint8_t* categories,
+                   const std::int64_t* values,
+                   size_t count,
+                   std::uint64_t* counts,
+                   std::int64_t* sums);
+
+// Inclusive ranges over the numeric columns; the defaults let every row pass.
+struct ColumnFilter {
+  // A category id, or -1 for any.
+  int category = -1;
+  std::int32_t minQuantity = std::numeric_limits<std::int32_t>::min();
+  std::int32_t maxQuantity = std::numeric_limits<std::int32_t>::max();
+  std::int64_t minUnitCents = std::numeric_limits<std::int64_t>::min();
+  std::int64_t maxUnitCents = std::numeric_limits<std::int64_t>::max();
+  std::int64_t minTotalCents = std::numeric_limits<std::int64_t>::min();
+  std::int64_t maxTotalCents = std::numeric_limits<std::int64_t>::max();
+};
+
+// Sets bit i of `mask` when row i passes `filter` and clears it otherwise,
+// for i < count; `mask` needs (count + 63) / 64 words.
+void filterRows(const std::uint8_t* categories,
+                const std::int32_t* quantities,
+                const std::int64_t* unitCents,
+                const std::int64_t* totalCents,
+                size_t count,
+                const ColumnFilter& filter,
+                std::uint64_t* mask);
+
+}  // namespace csfj
@@ -0,0 +1,177 @@
+#include "csv_import.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <utility>
+
+#include "byte_scan.hpp"
+#include "money.hpp"
+
+namespace csfj {
+
+namespace {
+
+std::string_view trimSpaces(std::string_view value) {
+  while (!value.empty() && value.front() == ' ') {
+    value.remove_prefix(1);
+  }
+  while (!value.empty() && value.back() == ' ') {
+    value.remove_suffix(1);
+  }
+  return value;
+}
+
+// Same rule as the form: a whole positive number.
+bool parseQuantity(std::string_view text, int& quantity) {
+  text = trimSpaces(text);
+  const char* first = text.data();
+  const char* last = first + text.size();
+  const auto [end, error] = std::from_chars(first, last, quantity);
+  return error == std::errc{} && end == last && first != last && quantity >= 1;
+}
+
+}  // namespace
+
+size_t findCsvDelimiter(std::string_view text) {
+  return findAnyByte<'"', ',', '\r', '\n'>(text);
+}
+
+bool CsvItemReader::feed(std::string_view bytes) {
+  size_t cursor = 0U;
+  while (cursor < bytes.size() && error_.empty()) {
+    switch (state_) {
+      case State::kFieldStart:
+        if (fieldCount_ == fields_.size()) {
+          fields_.emplace_back();
+        }
+        fields_[fieldCount_].clear();
+        if (bytes[cursor] == '"') {
+          ++cursor;
+          state_ = State::kQuoted;
+        } else {
+          state_ = State::kUnquoted;
+        }
+        break;
+
+      case State::kUnquoted: {
+        const size_t run = findCsvDelimiter(bytes.substr(cursor));
+        fields_[fieldCount_].append(bytes.data() + cursor, run);
+        cursor += run;
+        if (cursor == bytes.size()) {
+          break;
+        }
+        const char delimiter = bytes[cursor++];
+        if (delimiter == ',') {
+          endField();
+        } else if (delimiter == '\n') {
+          endField();
+          ++line_;
+          endRow();
+        } else if (delimiter == '"') {
+          // A stray quote in an unquoted cell is kept as text.
+          fields_[fieldCount_].push_back('"');
+        }
+        // A '\r' is dropped; in CRLF the row ends at the '\n'.
+        break;
+      }
+
+      case State::kQuoted: {
+        // Quoted cells only end at a quote, which memchr finds a block at a time.
+        const char* start = bytes.data() + cursor;
+        const auto* quote = static_cast<const char*>(std::memchr(start, '"', bytes.size() - cursor));
+        const size_t run = quote == nullptr ? bytes.size() - cursor : static_cast<size_t>(quote - start);
+        fields_[fieldCount_].append(start, run);
+        line_ += static_cast<size_t>(std::count(start, start + run, '\n'));
+        cursor += run;
+        if (quote != nullptr) {
+          ++cursor;
+          state_ = State::kQuoteInQuoted;
+        }
+        break;
+      }
+
+      case State::kQuoteInQuoted:
+        if (bytes[cursor] == '"') {
+          fields_[fieldCount_].push_back('"');
+          ++cursor;
+          state_ = State::kQuoted;
+        } else {
+          state_ = State::kUnquoted;
+        }
+        break;
+    }
+  }
+  return error_.empty();
+}
+
+bool CsvItemReader::finish() {
+  if (!error_.empty()) {
+    return false;
+  }
+  if (state_ == State::kQuoted) {
+    fail(rowStartLine_, "comillas sin cerrar.");
+    return false;
+  }
+  if (state_ != State::kFieldStart || fieldCount_ > 0U) {
+    endField();
+    endRow();
+  }
+  return error_.empty();
+}
+
+void CsvItemReader::endField() {
+  ++fieldCount_;
+  state_ = State::kFieldStart;
+}
+
+void CsvItemReader::endRow() {
+  const size_t count = fieldCount_;
+  fieldCount_ = 0U;
+  const size_t rowLine = rowStartLine_;
+  rowStartLine_ = line_;
+
+  if (count == 1U && fields_[0].empty()) {
+    return;
+  }
+  if (!headerChecked_) {
+    headerChecked_ = true;
+    if (fields_[0] == "Nombre") {
+      return;
+    }
+  }
+  if (fields_[0] == "Total" && count >= 2U && fields_[1].empty()) {
+    return;
+  }
+
+  if (count < 3U || count > 4U) {
+    fail(rowLine, "se esperaban las columnas Nombre, Cantidad, Costo Unitario y Total.");
+    return;
+  }
+  if (fields_[0].empty()) {
+    fail(rowLine, "falta el nombre del item.");
+    return;
+  }
+  int quantity = 0;
+  if (!parseQuantity(fields_[1], quantity)) {
+    fail(rowLine, "cantidad inválida. Debe ser un número entero positivo.");
+    return;
+  }
+  const std::string normalizedCost = normalizeCostInput(fields_[2]);
+  Money cost;
+  Money itemTotal;
+  if (!parseMoney(normalizedCost, cost) || !multiplyMoney(cost, quantity, itemTotal)) {
+    fail(rowLine, "costo inválido. Usa un número positivo.");
+    return;
+  }
+  items_.push_back({std::move(fields_[0]), quantity, cost});
+}
+
+void CsvItemReader::fail(size_t line, std::string_view message) {
+  // A rejected import keeps nothing.
+  error_ = "Línea " + std::to_string(line) + ": ";
+  error_ += message;
+  items_.clear();
+}
+
+}  // namespace csfj
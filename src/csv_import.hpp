@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "item_store.hpp"
+
+namespace csfj {
+
+// Returns the offset of the first `"`, `,`, `\r` or `\n` in `text`, or its
+// size when there is none. Scans 16 bytes per step with SSE2 (32 with AVX2)
+// where available.
+size_t findCsvDelimiter(std::string_view text);
+
+// Incremental reader for the CSV layout /export writes: a `Nombre,Cantidad,
+// Costo Unitario,Total` header, one row per item and a closing `"Total"` row.
+// The header and total rows are skipped, the Total column is ignored and cost
+// cells go through normalizeCostInput, so hand-edited sheets with grouped
+// amounts load as well. Input may be split anywhere, even inside a quoted
+// field; rows are validated as soon as their line ends.
+class CsvItemReader {
+public:
+  // Parses `bytes`, which continue whatever was fed before. Returns false once
+  // the input has been rejected; later calls do nothing.
+  bool feed(std::string_view bytes);
+
+  // Ends the input, taking a last row without a line break as complete.
+  bool finish();
+
+  bool failed() const {
+    return !error_.empty();
+  }
+
+  // Names the offending line when the input was rejected.
+  const std::string& error() const {
+    return error_;
+  }
+
+  std::vector<Item>& items() {
+    return items_;
+  }
+
+private:
+  enum class State {
+    kFieldStart,
+    kUnquoted,
+    kQuoted,
+    // A quote inside a quoted field: either an escaped quote or its end.
+    kQuoteInQuoted,
+  };
+
+  void endField();
+  void endRow();
+  void fail(size_t line, std::string_view message);
+
+  State state_ = State::kFieldStart;
+  // Cells of the row being read; strings are reused from row to row.
+  std::vector<std::string> fields_;
+  size_t fieldCount_ = 0U;
+  size_t line_ = 1U;
+  size_t rowStartLine_ = 1U;
+  bool headerChecked_ = false;
+  std::vector<Item> items_;
+  std::string error_;
+};
+
+}  // namespace csfj
@@ -0,0 +1,121 @@
+#include "directory_watcher.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <system_error>
+#include <utility>
+
+#ifdef __linux__
+  #include <poll.h>
+  #include <sys/inotify.h>
+  #include <unistd.h>
+#endif
+
+namespace csfj {
+
+namespace {
+
+// How long the directories must stay quiet before onChange runs.
+constexpr auto kDebounce = std::chrono::milliseconds(100);
+// How often the thread checks whether the watcher is being destroyed.
+constexpr int kStopPollMs = 250;
+
+}  // namespace
+
+DirectoryWatcher::~DirectoryWatcher() {
+  stopping_.store(true, std::memory_order_relaxed);
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+#ifdef __linux__
+  if (descriptor_ >= 0) {
+    close(descriptor_);
+  }
+#endif
+}
+
+#ifdef __linux__
+
+bool DirectoryWatcher::start(const std::vector<std::filesystem::path>& directories, std::function<void()> onChange) {
+  descriptor_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (descriptor_ < 0) {
+    return false;
+  }
+  for (const std::filesystem::path& directory : directories) {
+    watchTree(directory);
+  }
+  if (directories_.empty()) {
+    return false;
+  }
+  onChange_ = std::move(onChange);
+  thread_ = std::thread([this] { run(); });
+  return true;
+}
+
+void DirectoryWatcher::watchTree(const std::filesystem::path& root) {
+  constexpr uint32_t kEvents = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR;
+  const int watch = inotify_add_watch(descriptor_, root.c_str(), kEvents);
+  if (watch < 0) {
+    return;
+  }
+  directories_[watch] = root;
+  std::error_code error;
+  for (std::filesystem::directory_iterator it(root, error), end; !error && it != end; it.increment(error)) {
+    if (it->is_directory(error)) {
+      watchTree(it->path());
+    }
+  }
+}
+
+void DirectoryWatcher::run() {
+  using Clock = std::chrono::steady_clock;
+  alignas(inotify_event) char buffer[4096];
+  bool pending = false;
+  Clock::time_point lastChange;
+  while (!stopping_.load(std::memory_order_relaxed)) {
+    int timeoutMs = kStopPollMs;
+    if (pending) {
+      const auto quiet = Clock::now() - lastChange;
+      if (quiet >= kDebounce) {
+        pending = false;
+        onChange_();
+        continue;
+      }
+      timeoutMs = static_cast<int>(std::chrono::ceil<std::chrono::milliseconds>(kDebounce - quiet).count());
+    }
+
+    pollfd descriptor{descriptor_, POLLIN, 0};
+    if (poll(&descriptor, 1, timeoutMs) <= 0) {
+      continue;
+    }
+    ssize_t length = 0;
+    while ((length = read(descriptor_, buffer, sizeof(buffer))) > 0) {
+      for (ssize_t offset = 0; offset < length;) {
+        const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+        if ((event->mask & IN_ISDIR) != 0U && (event->mask & (IN_CREATE | IN_MOVED_TO)) != 0U) {
+          const auto parent = directories_.find(event->wd);
+          if (parent != directories_.end()) {
+            watchTree(parent->second / event->name);
+          }
+        }
+        offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+      }
+      pending = true;
+      lastChange = Clock::now();
+    }
+  }
+}
+
+#else
+
+bool DirectoryWatcher::start(const std::vector<std::filesystem::path>&, std::function<void()>) {
+  return false;
+}
+
+void DirectoryWatcher::watchTree(const std::filesystem::path&) {}
+
+void DirectoryWatcher::run() {}
+
+#endif
+
+}  // namespace csfj
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+#include <filesystem>
+#include <functional>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace csfj {
+
+// Calls a function on a background thread shortly after files under some
+// directories are written, created, removed or renamed. Changes are debounced,
+// so a burst of them (an editor saving through a temporary file, a checkout)
+// gives one call. Uses inotify, so it only watches on Linux; subdirectories
+// created after start() are watched too.
+class DirectoryWatcher {
+public:
+  DirectoryWatcher() = default;
+  ~DirectoryWatcher();
+  DirectoryWatcher(const DirectoryWatcher&) = delete;
+  DirectoryWatcher& operator=(const DirectoryWatcher&) = delete;
+
+  // Returns false, watching nothing, when the platform has no inotify or none
+  // of `directories` can be watched. Call at most once.
+  bool start(const std::vector<std::filesystem::path>& directories, std::function<void()> onChange);
+
+private:
+  void run();
+  void watchTree(const std::filesystem::path& root);
+
+  std::function<void()> onChange_;
+  int descriptor_ = -1;
+  // Watched directory by watch descriptor, to name the directories created in
+  // them.
+  std::unordered_map<int, std::filesystem::path> directories_;
+  std::atomic<bool> stopping_{false};
+  std::thread thread_;
+};
+
+}  // namespace csfj
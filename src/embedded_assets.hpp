@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+#include "static_files.hpp"
+#include "template_engine.hpp"
+
+// templates/*.html and every file of static/, compiled into the binary by the
+// build (csfj_assets in CMakeLists.txt), so the server does not depend on its
+// working directory. Static file names are relative to static/.
+namespace csfj::embedded {
+
+extern const EmbeddedTemplate kTemplates[];
+extern const size_t kTemplateCount;
+extern const EmbeddedFile kStaticFiles[];
+extern const size_t kStaticFileCount;
+
+// Returns nullptr when no template has that name.
+inline const EmbeddedTemplate* findTemplate(std::string_view name) {
+  for (size_t index = 0; index < kTemplateCount; ++index) {
+    if (kTemplates[index].name == name) {
+      return &kTemplates[index];
+    }
+  }
+  return nullptr;
+}
+
+}  // namespace csfj::embedded
@@ -0,0 +1,357 @@
+#include "http_parser.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <string>
+
+#include "byte_scan.hpp"
+
+namespace csfj {
+
+namespace {
+
+constexpr std::string_view kLineEnd = "\r\n";
+constexpr std::string_view kHeaderEnd = "\r\n\r\n";
+
+char asciiLower(char ch) {
+  return (ch >= 'A' && ch <= 'Z') ? static_cast<char>(ch - 'A' + 'a') : ch;
+}
+
+bool isBlank(char ch) {
+  return ch == ' ' || ch == '\t';
+}
+
+std::string_view trimBlanks(std::string_view value) {
+  while (!value.empty() && isBlank(value.front())) {
+    value.remove_prefix(1);
+  }
+  while (!value.empty() && isBlank(value.back())) {
+    value.remove_suffix(1);
+  }
+  return value;
+}
+
+// Whether the parameters of an Accept-Encoding entry leave it enabled: only
+// "q=0", "q=0.", "q=0.0"... disable it.
+bool qualityEnabled(std::string_view parameters) {
+  parameters = trimBlanks(parameters);
+  if (parameters.size() < 3U || asciiLower(parameters[0]) != 'q' || parameters[1] != '=') {
+    return true;
+  }
+  for (const char ch : parameters.substr(2)) {
+    if (ch != '.' && ch != '0') {
+      return true;
+    }
+  }
+  return false;
+}
+
+std::string_view nextToken(std::string_view& line) {
+  while (!line.empty() && line.front() == ' ') {
+    line.remove_prefix(1);
+  }
+  const size_t end = line.find(' ');
+  const std::string_view token = line.substr(0, end);
+  line.remove_prefix(end == std::string_view::npos ? line.size() : end);
+  return token;
+}
+
+bool parseRequestLine(std::string_view line, HttpRequest& request) {
+  request.method = nextToken(line);
+  request.target = nextToken(line);
+  const std::string_view version = nextToken(line);
+  // Only HTTP/1.x is spoken; an HTTP/0.9 line without a version, or one for a
+  // later major version, is rejected rather than answered as if it were 1.1.
+  if (request.method.empty() || request.target.empty() || (version != "HTTP/1.0" && version != "HTTP/1.1") ||
+      !nextToken(line).empty()) {
+    return false;
+  }
+  request.http10 = version == "HTTP/1.0";
+
+  const size_t queryPos = request.target.find('?');
+  request.path = request.target.substr(0, queryPos);
+  request.query = queryPos == std::string_view::npos ? std::string_view{} : request.target.substr(queryPos + 1);
+  return true;
+}
+
+// Bodies are only framed by Content-Length. A Transfer-Encoding, or a second
+// Content-Length, would leave the end of the body open to interpretation, so
+// that the rest of it could be read as a further pipelined request.
+ParseStatus parseHeaderLines(std::string_view block, HttpRequest& request) {
+  request.headerCount = 0U;
+  request.contentLength = 0U;
+  std::string_view connection;
+  bool hasContentLength = false;
+
+  while (!block.empty()) {
+    const size_t lineEnd = block.find(kLineEnd);
+    const std::string_view line = block.substr(0, lineEnd);
+    block.remove_prefix(lineEnd == std::string_view::npos ? block.size() : lineEnd + kLineEnd.size());
+
+    const size_t colonPos = line.find(':');
+    if (colonPos == std::string_view::npos) {
+      continue;
+    }
+    if (request.headerCount == kMaxRequestHeaders) {
+      return ParseStatus::kHeadersTooLarge;
+    }
+    HttpHeader& header = request.headers[request.headerCount++];
+    header.name = trimBlanks(line.substr(0, colonPos));
+    header.value = trimBlanks(line.substr(colonPos + 1));
+
+    if (equalsIgnoreCase(header.name, "content-length")) {
+      const char* first = header.value.data();
+      const char* last = first + header.value.size();
+      const auto [end, error] = std::from_chars(first, last, request.contentLength);
+      if (hasContentLength || error != std::errc{} || end != last || first == last) {
+        return ParseStatus::kInvalid;
+      }
+      hasContentLength = true;
+    } else if (equalsIgnoreCase(header.name, "transfer-encoding")) {
+      return ParseStatus::kTransferEncoding;
+    } else if (equalsIgnoreCase(header.name, "connection")) {
+      connection = header.value;
+    }
+  }
+
+  // HTTP/1.1 connections persist unless the client opts out; HTTP/1.0 ones only
+  // when the client asks for it.
+  request.keepAlive = request.http10 ? containsIgnoreCase(connection, "keep-alive")
+                                     : !containsIgnoreCase(connection, "close");
+  return ParseStatus::kComplete;
+}
+
+std::string_view rebase(std::string_view view, std::uintptr_t oldBase, const char* newBase) {
+  if (view.empty()) {
+    return view;
+  }
+  const auto offset = reinterpret_cast<std::uintptr_t>(view.data()) - oldBase;
+  return std::string_view(newBase + offset, view.size());
+}
+
+void rebaseRequest(HttpRequest& request, std::uintptr_t oldBase, const char* newBase) {
+  request.method = rebase(request.method, oldBase, newBase);
+  request.target = rebase(request.target, oldBase, newBase);
+  request.path = rebase(request.path, oldBase, newBase);
+  request.query = rebase(request.query, oldBase, newBase);
+  for (size_t index = 0; index < request.headerCount; ++index) {
+    request.headers[index].name = rebase(request.headers[index].name, oldBase, newBase);
+    request.headers[index].value = rebase(request.headers[index].value, oldBase, newBase);
+  }
+}
+
+}  // namespace
+
+std::string_view HttpRequest::header(std::string_view name) const {
+  for (size_t index = 0; index < headerCount; ++index) {
+    if (equalsIgnoreCase(headers[index].name, name)) {
+      return headers[index].value;
+    }
+  }
+  return {};
+}
+
+bool equalsIgnoreCase(std::string_view left, std::string_view right) {
+  if (left.size() != right.size()) {
+    return false;
+  }
+  for (size_t index = 0; index < left.size(); ++index) {
+    if (asciiLower(left[index]) != asciiLower(right[index])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool containsIgnoreCase(std::string_view haystack, std::string_view needle) {
+  if (needle.size() > haystack.size()) {
+    return false;
+  }
+  for (size_t start = 0; start + needle.size() <= haystack.size(); ++start) {
+    if (equalsIgnoreCase(haystack.substr(start, needle.size()), needle)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool acceptsEncoding(std::string_view acceptEncoding, std::string_view coding) {
+  bool wildcard = false;
+  while (!acceptEncoding.empty()) {
+    const size_t comma = acceptEncoding.find(',');
+    const std::string_view entry = acceptEncoding.substr(0, comma);
+    acceptEncoding.remove_prefix(comma == std::string_view::npos ? acceptEncoding.size() : comma + 1);
+
+    const size_t semicolon = entry.find(';');
+    const std::string_view name = trimBlanks(entry.substr(0, semicolon));
+    const bool enabled = semicolon == std::string_view::npos || qualityEnabled(entry.substr(semicolon + 1));
+    if (equalsIgnoreCase(name, coding)) {
+      return enabled;
+    }
+    if (name == "*") {
+      wildcard = enabled;
+    }
+  }
+  return wildcard;
+}
+
+namespace {
+
+int hexDigit(char ch) {
+  if (ch >= '0' && ch <= '9') {
+    return ch - '0';
+  }
+  if (ch >= 'a' && ch <= 'f') {
+    return ch - 'a' + 10;
+  }
+  if (ch >= 'A' && ch <= 'F') {
+    return ch - 'A' + 10;
+  }
+  return -1;
+}
+
+// The byte that `%` followed by `first` and `second` decodes to, or -1 when the
+// `%` is kept as text. Matches the std::stoi(hex, nullptr, 16) this replaced,
+// quirks included: one leading space or sign is skipped ("%+7" is 0x07, "%-1"
+// is 0xFF) and parsing stops at the first non-hex digit ("%4g" is 0x04).
+int decodeEscape(char first, char second) {
+  const int high = hexDigit(first);
+  if (high >= 0) {
+    const int low = hexDigit(second);
+    return low >= 0 ? high * 16 + low : high;
+  }
+  const int digit = hexDigit(second);
+  const bool skipped = first == ' ' || (first >= '\t' && first <= '\r') || first == '+' || first == '-';
+  if (digit < 0 || !skipped) {
+    return -1;
+  }
+  return first == '-' ? (256 - digit) & 0xFF : digit;
+}
+
+template <typename String>
+void appendUrlDecoded(String& result, std::string_view value) {
+  size_t index = 0U;
+  while (index < value.size()) {
+    const size_t special = findAnyByte<'+', '%'>(value, index);
+    result.append(value.data() + index, special - index);
+    if (special == value.size()) {
+      break;
+    }
+    index = special + 1U;
+    if (value[special] == '+') {
+      result.push_back(' ');
+      continue;
+    }
+    // A `%` in the last two characters is kept as text.
+    const int decoded = special + 2U < value.size() ? decodeEscape(value[special + 1U], value[special + 2U]) : -1;
+    if (decoded >= 0) {
+      result.push_back(static_cast<char>(decoded));
+      index = special + 3U;
+    } else {
+      result.push_back('%');
+    }
+  }
+}
+
+}  // namespace
+
+std::string urlDecode(std::string_view value) {
+  std::string result;
+  result.reserve(value.size());
+  appendUrlDecoded(result, value);
+  return result;
+}
+
+FormFields::FormFields(std::string_view body, std::pmr::memory_resource* resource)
+    : decoded_(resource), fields_(resource) {
+  // Decoding never lengthens the text, so the buffer never reallocates and the
+  // views into it stay valid.
+  decoded_.reserve(body.size());
+  fields_.reserve(static_cast<size_t>(std::count(body.begin(), body.end(), '&')) + 1U);
+  size_t start = 0U;
+  while (start <= body.size()) {
+    const auto amp = body.find('&', start);
+    const auto token = body.substr(start, (amp == std::string_view::npos) ? std::string_view::npos : amp - start);
+    const auto equal = token.find('=');
+    if (equal != std::string_view::npos) {
+      const std::string_view name = decode(token.substr(0, equal));
+      const std::string_view value = decode(token.substr(equal + 1));
+      fields_.emplace_back(name, value);
+    }
+    if (amp == std::string_view::npos) {
+      break;
+    }
+    start = amp + 1;
+  }
+}
+
+FormFields::const_iterator FormFields::find(std::string_view name) const {
+  for (size_t index = fields_.size(); index > 0U; --index) {
+    if (fields_[index - 1U].first == name) {
+      return &fields_[index - 1U];
+    }
+  }
+  return end();
+}
+
+std::string_view FormFields::decode(std::string_view text) {
+  if (findAnyByte<'+', '%'>(text) == text.size()) {
+    return text;
+  }
+  const size_t offset = decoded_.size();
+  appendUrlDecoded(decoded_, text);
+  return std::string_view(decoded_).substr(offset);
+}
+
+ParseStatus HttpRequestParser::parse(std::string_view buffer, HttpRequest& request) {
+  if (!headersParsed_) {
+    const size_t searchFrom = scannedUpTo_ >= kHeaderEnd.size() - 1 ? scannedUpTo_ - (kHeaderEnd.size() - 1) : 0U;
+    const size_t headerEnd = buffer.find(kHeaderEnd, searchFrom);
+    if (headerEnd == std::string_view::npos) {
+      scannedUpTo_ = buffer.size();
+      return buffer.size() >= limits_.maxHeaderBytes ? ParseStatus::kHeadersTooLarge : ParseStatus::kIncomplete;
+    }
+    if (headerEnd + kHeaderEnd.size() > limits_.maxHeaderBytes) {
+      return ParseStatus::kHeadersTooLarge;
+    }
+
+    const std::string_view head = buffer.substr(0, headerEnd);
+    const size_t requestLineEnd = head.find(kLineEnd);
+    const std::string_view requestLine = head.substr(0, requestLineEnd);
+    const std::string_view headerBlock =
+        requestLineEnd == std::string_view::npos ? std::string_view{} : head.substr(requestLineEnd + kLineEnd.size());
+    if (!parseRequestLine(requestLine, request)) {
+      return ParseStatus::kInvalid;
+    }
+    const ParseStatus headerStatus = parseHeaderLines(headerBlock, request);
+    if (headerStatus != ParseStatus::kComplete) {
+      return headerStatus;
+    }
+    request.headerLength = headerEnd + kHeaderEnd.size();
+    request.body = {};
+    headersParsed_ = true;
+  } else if (reinterpret_cast<std::uintptr_t>(buffer.data()) != base_) {
+    rebaseRequest(request, base_, buffer.data());
+  }
+  base_ = reinterpret_cast<std::uintptr_t>(buffer.data());
+
+  // Rejected before any of the body is waited for; also keeps length() from
+  // overflowing.
+  if (request.contentLength > limits_.maxBodyBytes) {
+    return ParseStatus::kBodyTooLarge;
+  }
+
+  if (buffer.size() < request.length()) {
+    return ParseStatus::kIncomplete;
+  }
+  request.body = buffer.substr(request.headerLength, request.contentLength);
+  return ParseStatus::kComplete;
+}
+
+void HttpRequestParser::reset() {
+  scannedUpTo_ = 0U;
+  headersParsed_ = false;
+  base_ = 0U;
+}
+
+}  // namespace csfj
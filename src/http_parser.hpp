@@ -0,0 +1,135 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace csfj {
+
+constexpr size_t kMaxRequestHeaders = 32;
+constexpr size_t kDefaultMaxHeaderBytes = 16U * 1024U;
+constexpr size_t kDefaultMaxBodyBytes = 16U * 1024U * 1024U;
+
+struct HttpHeader {
+  std::string_view name;
+  std::string_view value;
+};
+
+// A parsed request. Every view points into the connection's receive buffer and
+// stays valid only until that buffer is modified.
+struct HttpRequest {
+  std::string_view method;
+  std::string_view target;
+  std::string_view path;
+  std::string_view query;
+  std::string_view body;
+  std::array<HttpHeader, kMaxRequestHeaders> headers{};
+  size_t headerCount = 0U;
+  size_t headerLength = 0U;
+  size_t contentLength = 0U;
+  bool http10 = false;
+  bool keepAlive = false;
+
+  // Bytes taken by the request line, the headers, the blank line and the body.
+  size_t length() const {
+    return headerLength + contentLength;
+  }
+
+  // Case-insensitive lookup. Returns an empty view when the header is absent.
+  std::string_view header(std::string_view name) const;
+};
+
+enum class ParseStatus {
+  kIncomplete,
+  kComplete,
+  kInvalid,
+  // The request line and headers exceed RequestLimits::maxHeaderBytes, or
+  // there are more than kMaxRequestHeaders headers.
+  kHeadersTooLarge,
+  // Content-Length exceeds RequestLimits::maxBodyBytes; the headers are parsed.
+  kBodyTooLarge,
+  // The request has a Transfer-Encoding, which is not supported; its body
+  // cannot be delimited.
+  kTransferEncoding,
+};
+
+// Bounds on what a request may make the server buffer.
+struct RequestLimits {
+  size_t maxHeaderBytes = kDefaultMaxHeaderBytes;
+  size_t maxBodyBytes = kDefaultMaxBodyBytes;
+};
+
+bool equalsIgnoreCase(std::string_view left, std::string_view right);
+bool containsIgnoreCase(std::string_view haystack, std::string_view needle);
+
+// Whether an Accept-Encoding value lists `coding` (or "*") without q=0.
+bool acceptsEncoding(std::string_view acceptEncoding, std::string_view coding);
+
+// Decodes `+` and `%XX` escapes of a form field or query parameter.
+std::string urlDecode(std::string_view value);
+
+// The decoded fields of an application/x-www-form-urlencoded body (or query
+// string); a repeated field keeps its last value. Names and values without
+// escapes are views into the body, the others are decoded into one buffer
+// drawn from `resource`, so with a request arena parsing a form allocates
+// nothing from the heap. The body must outlive the object, which is neither
+// copied nor moved because its views may point into itself.
+class FormFields {
+public:
+  using Field = std::pair<std::string_view, std::string_view>;
+  using const_iterator = const Field*;
+
+  explicit FormFields(std::string_view body,
+                      std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+  FormFields(const FormFields&) = delete;
+  FormFields& operator=(const FormFields&) = delete;
+
+  const_iterator find(std::string_view name) const;
+
+  const_iterator begin() const {
+    return fields_.data();
+  }
+
+  const_iterator end() const {
+    return fields_.data() + fields_.size();
+  }
+
+private:
+  std::string_view decode(std::string_view text);
+
+  std::pmr::string decoded_;
+  std::pmr::vector<Field> fields_;
+};
+
+// Incremental parser for the request at the front of a receive buffer. The same
+// growing buffer can be passed in repeatedly: the search for the end of the
+// header block resumes where it stopped, the header block is parsed exactly
+// once, and the views are rebased if the buffer moved between calls. Nothing
+// is allocated.
+class HttpRequestParser {
+public:
+  HttpRequestParser() = default;
+  explicit HttpRequestParser(const RequestLimits& limits) : limits_(limits) {}
+
+  ParseStatus parse(std::string_view buffer, HttpRequest& request);
+  void reset();
+
+  // Whether the request line and headers are available in the request passed
+  // to parse(), even though its body may still be arriving.
+  bool headersParsed() const {
+    return headersParsed_;
+  }
+
+private:
+  RequestLimits limits_;
+  size_t scannedUpTo_ = 0U;
+  bool headersParsed_ = false;
+  std::uintptr_t base_ = 0U;
+};
+
+}  // namespace csfj
@@ -0,0 +1,374 @@
+#include "item_index.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+
+#include "column_scan.hpp"
+
+#ifdef _MSC_VER
+  #include <intrin.h>
+#endif
+
+namespace csfj {
+
+namespace {
+
+constexpr size_t kLastPosition = std::numeric_limits<size_t>::max();
+
+// How many rows of a column pass cost as much as one index step (see run()).
+constexpr size_t kColumnScanDivisor = 64U;
+
+template <typename Key>
+using Ordered = std::set<std::pair<Key, size_t>>;
+
+template <typename Key>
+using Range = std::pair<typename Ordered<Key>::const_iterator, typename Ordered<Key>::const_iterator>;
+
+// The entries whose key lies in [low, high]; a missing bound is open.
+template <typename Key>
+Range<Key> keyRange(const Ordered<Key>& index, const std::optional<Key>& low, const std::optional<Key>& high) {
+  if (low && high && *high < *low) {
+    return {index.end(), index.end()};
+  }
+  return {low ? index.lower_bound({*low, 0U}) : index.begin(),
+          high ? index.upper_bound({*high, kLastPosition}) : index.end()};
+}
+
+// The entries whose name starts with `prefix`: from the prefix itself up to
+// the smallest string past every such name (the prefix with its last byte
+// below 0xFF incremented).
+Range<std::string> prefixRange(const Ordered<std::string>& index, const std::string& prefix) {
+  const auto first = index.lower_bound({prefix, 0U});
+  std::string bound = prefix;
+  while (!bound.empty() && static_cast<unsigned char>(bound.back()) == 0xFFU) {
+    bound.pop_back();
+  }
+  if (bound.empty()) {
+    return {first, index.end()};
+  }
+  bound.back() = static_cast<char>(static_cast<unsigned char>(bound.back()) + 1U);
+  return {first, index.lower_bound({bound, 0U})};
+}
+
+unsigned countTrailingZeros(std::uint64_t bits) {
+#ifdef _MSC_VER
+  unsigned long index = 0;
+  _BitScanForward64(&index, bits);
+  return static_cast<unsigned>(index);
+#else
+  return static_cast<unsigned>(__builtin_ctzll(bits));
+#endif
+}
+
+std::optional<std::int64_t> centsOf(const std::optional<Money>& amount) {
+  return amount ? std::optional<std::int64_t>(amount->cents()) : std::nullopt;
+}
+
+// Counts up to `limit` entries; probing a range never costs more than the
+// best candidate found so far.
+template <typename Iterator>
+size_t countUpTo(Iterator first, Iterator last, size_t limit) {
+  size_t count = 0U;
+  for (; first != last && count < limit; ++first) {
+    ++count;
+  }
+  return count;
+}
+
+// The numeric filters and the category of `query` as a column filter.
+ColumnFilter columnFilter(const ItemQuery& query) {
+  ColumnFilter filter;
+  if (query.category) {
+    filter.category = static_cast<int>(*query.category);
+  }
+  filter.minQuantity = query.minQuantity.value_or(filter.minQuantity);
+  filter.maxQuantity = query.maxQuantity.value_or(filter.maxQuantity);
+  filter.minUnitCents = centsOf(query.minUnitCost).value_or(filter.minUnitCents);
+  filter.maxUnitCents = centsOf(query.maxUnitCost).value_or(filter.maxUnitCents);
+  filter.minTotalCents = centsOf(query.minTotal).value_or(filter.minTotalCents);
+  filter.maxTotalCents = centsOf(query.maxTotal).value_or(filter.maxTotalCents);
+  return filter;
+}
+
+// One pass over every chunk's columns. Rows that pass the numeric filters are
+// checked against `names` (the name filters) when given, and the totals of the
+// survivors are summed from the same mask.
+void scanColumns(const ItemSnapshot& items,
+                 const ItemQuery& query,
+                 const ItemQuery* names,
+                 std::vector<size_t>& matches,
+                 std::int64_t& totalCents) {
+  constexpr size_t kMaskWords = ItemSnapshot::kChunkSize / 64U;
+  const ColumnFilter filter = columnFilter(query);
+  std::uint64_t mask[kMaskWords];
+  for (size_t chunk = 0; chunk < items.chunkCount(); ++chunk) {
+    const ItemSnapshot::Columns& columns = items.columns(chunk);
+    const size_t rows = items.chunkSize(chunk);
+    filterRows(columns.category.data(), columns.quantity.data(), columns.unitCents.data(), columns.totalCents.data(),
+               rows, filter, mask);
+    for (size_t word = 0; word * 64U < rows; ++word) {
+      for (std::uint64_t bits = mask[word]; bits != 0U; bits &= bits - 1U) {
+        const size_t row = word * 64U + static_cast<size_t>(countTrailingZeros(bits));
+        const size_t position = chunk * ItemSnapshot::kChunkSize + row;
+        if (names != nullptr && !names->matches(items[position])) {
+          mask[word] &= ~(std::uint64_t{1} << (row % 64U));
+          continue;
+        }
+        matches.push_back(position);
+      }
+    }
+    totalCents += maskedSum(columns.totalCents.data(), rows, mask);
+  }
+}
+
+}  // namespace
+
+bool ItemQuery::matches(const Item& item) const {
+  if (category && categoryIndex(item.name) != *category) {
+    return false;
+  }
+  if (name && item.name != *name) {
+    return false;
+  }
+  if (namePrefix && item.name.compare(0U, namePrefix->size(), *namePrefix) != 0) {
+    return false;
+  }
+  if ((minQuantity && item.quantity < *minQuantity) || (maxQuantity && item.quantity > *maxQuantity)) {
+    return false;
+  }
+  if ((minUnitCost && item.unitCost < *minUnitCost) || (maxUnitCost && item.unitCost > *maxUnitCost)) {
+    return false;
+  }
+  if (minTotal || maxTotal) {
+    const Money total = item.getTotalCost();
+    if ((minTotal && total < *minTotal) || (maxTotal && total > *maxTotal)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void ItemIndex::insert(size_t position, const Item& item) {
+  categories_[categoryIndex(item.name)].insert(position);
+  names_.emplace(item.name, position);
+  quantities_.emplace(item.quantity, position);
+  unitCosts_.emplace(item.unitCost.cents(), position);
+  totals_.emplace(item.getTotalCost().cents(), position);
+}
+
+void ItemIndex::erase(size_t position, const Item& item) {
+  categories_[categoryIndex(item.name)].erase(position);
+  names_.erase({item.name, position});
+  quantities_.erase({item.quantity, position});
+  unitCosts_.erase({item.unitCost.cents(), position});
+  totals_.erase({item.getTotalCost().cents(), position});
+}
+
+void ItemIndex::clear() {
+  for (auto& positions : categories_) {
+    positions.clear();
+  }
+  names_.clear();
+  quantities_.clear();
+  unitCosts_.clear();
+  totals_.clear();
+}
+
+ItemIndex::Candidates ItemIndex::candidates(const ItemSnapshot& list, const ItemQuery& query) const {
+  const bool byName = query.name || query.namePrefix;
+  const auto names = query.name ? keyRange(names_, query.name, query.name)
+                                : query.namePrefix ? prefixRange(names_, *query.namePrefix)
+                                                   : Range<std::string>{names_.begin(), names_.end()};
+  const auto quantities = keyRange(quantities_, query.minQuantity, query.maxQuantity);
+  const auto unitCosts = keyRange(unitCosts_, centsOf(query.minUnitCost), centsOf(query.maxUnitCost));
+  const auto totals = keyRange(totals_, centsOf(query.minTotal), centsOf(query.maxTotal));
+
+  // Drive from the smallest candidate set. A pass over the columns counts as
+  // 1/kColumnScanDivisor of its rows, since it streams through contiguous
+  // integers while an index step is a cache miss. An index ordered by the sort
+  // key wins ties, and is a candidate even unfiltered, since walking it leaves
+  // nothing to sort.
+  enum class Source { kColumns, kCategory, kName, kQuantity, kUnitCost, kTotal };
+  Source source = Source::kColumns;
+  size_t best = list.size() / kColumnScanDivisor;
+  bool ordered = query.sortBy == ItemField::kIndex;
+  if (query.category && categories_[*query.category].size() < best) {
+    source = Source::kCategory;
+    best = categories_[*query.category].size();
+  }
+  const auto consider = [&](Source candidate, ItemField field, bool filtered, auto first, auto last) {
+    const bool sorted = field == query.sortBy;
+    if (!filtered && !sorted) {
+      return;
+    }
+    // Unfiltered, the range is the whole index; no need to walk it.
+    const size_t count = filtered ? countUpTo(first, last, sorted ? best + 1U : best) : list.size();
+    if (count < best || (sorted && count == best)) {
+      source = candidate;
+      best = count;
+      // One exact name lists its positions in item order.
+      ordered = sorted || (field == ItemField::kName && query.name && query.sortBy == ItemField::kIndex);
+    }
+  };
+  consider(Source::kName, ItemField::kName, byName, names.first, names.second);
+  consider(Source::kQuantity, ItemField::kQuantity, query.minQuantity || query.maxQuantity, quantities.first,
+           quantities.second);
+  consider(Source::kUnitCost, ItemField::kUnitCost, query.minUnitCost || query.maxUnitCost, unitCosts.first,
+           unitCosts.second);
+  consider(Source::kTotal, ItemField::kTotal, query.minTotal || query.maxTotal, totals.first, totals.second);
+
+  // The filters the source does not already apply.
+  Candidates result;
+  result.scan = source == Source::kColumns;
+  result.ordered = ordered;
+  ItemQuery& residual = result.residual;
+  residual = query;
+  switch (source) {
+    case Source::kColumns:
+      residual = ItemQuery{};
+      residual.name = query.name;
+      residual.namePrefix = query.namePrefix;
+      break;
+    case Source::kCategory:
+      residual.category.reset();
+      break;
+    case Source::kName:
+      // With both an exact name and a prefix, the walk covers the name only.
+      if (!query.name) {
+        residual.namePrefix.reset();
+      }
+      residual.name.reset();
+      break;
+    case Source::kQuantity:
+      residual.minQuantity.reset();
+      residual.maxQuantity.reset();
+      break;
+    case Source::kUnitCost:
+      residual.minUnitCost.reset();
+      residual.maxUnitCost.reset();
+      break;
+    case Source::kTotal:
+      residual.minTotal.reset();
+      residual.maxTotal.reset();
+      break;
+  }
+
+  const auto collect = [&result](auto first, auto last) {
+    for (; first != last; ++first) {
+      result.positions.push_back(first->second);
+    }
+  };
+  if (source != Source::kColumns) {
+    result.positions.reserve(best);
+  }
+  switch (source) {
+    case Source::kColumns:
+      break;
+    case Source::kCategory:
+      result.positions.assign(categories_[*query.category].begin(), categories_[*query.category].end());
+      break;
+    case Source::kName:
+      collect(names.first, names.second);
+      break;
+    case Source::kQuantity:
+      collect(quantities.first, quantities.second);
+      break;
+    case Source::kUnitCost:
+      collect(unitCosts.first, unitCosts.second);
+      break;
+    case Source::kTotal:
+      collect(totals.first, totals.second);
+      break;
+  }
+  return result;
+}
+
+ItemQueryResult ItemIndex::finish(std::shared_ptr<const ItemSnapshot> items,
+                                  const ItemQuery& query,
+                                  Candidates candidates) {
+  const ItemSnapshot& list = *items;
+  const ItemQuery& residual = candidates.residual;
+  const bool ordered = candidates.ordered;
+
+  // `matches` comes out in ascending sort order when `ordered` is set.
+  std::vector<size_t> matches;
+  std::int64_t totalCents = 0;
+  if (candidates.scan) {
+    const bool byName = residual.name || residual.namePrefix;
+    scanColumns(list, query, byName ? &residual : nullptr, matches, totalCents);
+  } else {
+    matches = std::move(candidates.positions);
+    size_t kept = 0U;
+    for (const size_t position : matches) {
+      if (residual.matches(list[position])) {
+        matches[kept++] = position;
+        totalCents +=
+            list.columns(position / ItemSnapshot::kChunkSize).totalCents[position % ItemSnapshot::kChunkSize];
+      }
+    }
+    matches.resize(kept);
+  }
+
+  ItemQueryResult result;
+  result.total = matches.size();
+  result.totalCost = Money::fromCents(totalCents);
+  const size_t first = std::min(query.offset, matches.size());
+  const size_t end = first + std::min(query.limit, matches.size() - first);
+  // Numeric keys come from the columns, which stay denser in cache than the
+  // items. Negative, zero or positive as `left`'s sort key is below, equal to
+  // or above `right`'s.
+  const auto compareKeys = [&](size_t left, size_t right) -> int {
+    const auto& leftColumns = list.columns(left / ItemSnapshot::kChunkSize);
+    const auto& rightColumns = list.columns(right / ItemSnapshot::kChunkSize);
+    const size_t leftRow = left % ItemSnapshot::kChunkSize;
+    const size_t rightRow = right % ItemSnapshot::kChunkSize;
+    const auto compare = [](const auto& leftKey, const auto& rightKey) {
+      return leftKey < rightKey ? -1 : (rightKey < leftKey ? 1 : 0);
+    };
+    switch (query.sortBy) {
+      case ItemField::kIndex:
+        return compare(left, right);
+      case ItemField::kName:
+        return list[left].name.compare(list[right].name);
+      case ItemField::kQuantity:
+        return compare(leftColumns.quantity[leftRow], rightColumns.quantity[rightRow]);
+      case ItemField::kUnitCost:
+        return compare(leftColumns.unitCents[leftRow], rightColumns.unitCents[rightRow]);
+      case ItemField::kTotal:
+        return compare(leftColumns.totalCents[leftRow], rightColumns.totalCents[rightRow]);
+    }
+    return 0;
+  };
+  if (ordered) {
+    if (query.descending) {
+      // Reversing also reverses each run of equal keys; put those back in item
+      // order.
+      std::reverse(matches.begin(), matches.end());
+      for (auto run = matches.begin(); run != matches.end();) {
+        auto runEnd = std::next(run);
+        while (runEnd != matches.end() && compareKeys(*run, *runEnd) == 0) {
+          ++runEnd;
+        }
+        std::reverse(run, runEnd);
+        run = runEnd;
+      }
+    }
+  } else {
+    // Only the requested page needs to be in order.
+    std::partial_sort(matches.begin(), matches.begin() + static_cast<std::ptrdiff_t>(end), matches.end(),
+                      [&](size_t left, size_t right) {
+                        const int order = compareKeys(left, right);
+                        if (order != 0) {
+                          return query.descending ? order > 0 : order < 0;
+                        }
+                        return left < right;
+                      });
+  }
+  result.positions.assign(matches.begin() + static_cast<std::ptrdiff_t>(first),
+                          matches.begin() + static_cast<std::ptrdiff_t>(end));
+  result.items = std::move(items);
+  return result;
+}
+
+}  // namespace csfj
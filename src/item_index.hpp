@@ -0,0 +1,105 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "item_store.hpp"
+#include "money.hpp"
+
+namespace csfj {
+
+enum class ItemField {
+  kIndex,
+  kName,
+  kQuantity,
+  kUnitCost,
+  kTotal,
+};
+
+// A filtered, sorted page of items. Filters are optional and combine with AND;
+// ranges include both ends. Ties in the sort key keep item order, so a query
+// always returns its matches in the same order.
+struct ItemQuery {
+  // categoryIndex() of the names to keep; kOtherCategory keeps every name that
+  // is not a predefined category.
+  std::optional<size_t> category;
+  std::optional<std::string> name;
+  std::optional<std::string> namePrefix;
+  std::optional<int> minQuantity;
+  std::optional<int> maxQuantity;
+  std::optional<Money> minUnitCost;
+  std::optional<Money> maxUnitCost;
+  std::optional<Money> minTotal;
+  std::optional<Money> maxTotal;
+  ItemField sortBy = ItemField::kIndex;
+  bool descending = false;
+  size_t offset = 0U;
+  size_t limit = 100U;
+
+  bool matches(const Item& item) const;
+};
+
+struct ItemQueryResult {
+  // The version the query ran against; `positions` index into it.
+  std::shared_ptr<const ItemSnapshot> items;
+  // Matches before paging, and the sum of their totals.
+  size_t total = 0U;
+  Money totalCost;
+  std::vector<size_t> positions;
+};
+
+// Secondary indexes over one item list, kept in step with it by ItemStore on
+// every write: the positions of each category, and positions ordered by name,
+// quantity, unit cost and total. A query walks whichever of them narrows it
+// down most and checks the remaining filters on the items themselves, so a
+// selective filter costs O(log n + matches) instead of a pass over the list.
+// Filters that keep a large share of the list run as one pass over the
+// snapshot's columns instead.
+//
+// A query runs in two steps so that only the first reads the index: it picks
+// the source and copies out its candidate positions, never more than
+// 1/64 of the list. The second works on the snapshot alone.
+class ItemIndex {
+public:
+  // The positions the chosen index yields for a query, in that index's
+  // order, and the filters still to check on them; or, when `scan` is set, a
+  // pass over the columns.
+  struct Candidates {
+    bool scan = false;
+    // Whether the positions are already in sort order.
+    bool ordered = false;
+    ItemQuery residual;
+    std::vector<size_t> positions;
+  };
+
+  void insert(size_t position, const Item& item);
+  void erase(size_t position, const Item& item);
+  void clear();
+
+  // `list` must be the list the index describes.
+  Candidates candidates(const ItemSnapshot& list, const ItemQuery& query) const;
+  // Filters, sums, sorts and pages the candidates found in `items`.
+  static ItemQueryResult finish(std::shared_ptr<const ItemSnapshot> items,
+                                const ItemQuery& query,
+                                Candidates candidates);
+
+private:
+  template <typename Key>
+  using Ordered = std::set<std::pair<Key, size_t>>;
+
+  // Indexed by categoryIndex(); a direct table, since the categories are fixed.
+  std::array<std::set<size_t>, kItemCategories.size() + 1U> categories_;
+  Ordered<std::string> names_;
+  Ordered<int> quantities_;
+  Ordered<std::int64_t> unitCosts_;
+  Ordered<std::int64_t> totals_;
+};
+
+}  // namespace csfj
@@ -0,0 +1,706 @@
+#include "item_journal.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+  #ifndef WIN32_LEAN_AND_MEAN
+    #define WIN32_LEAN_AND_MEAN
+  #endif
+  #ifndef NOMINMAX
+    #define NOMINMAX
+  #endif
+  #include <io.h>
+  #include <windows.h>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+namespace csfj {
+
+namespace {
+
+constexpr std::string_view kLogMagic = "CSFJLOG1";
+constexpr std::string_view kSnapshotMagic = "CSFJSNP1";
+constexpr std::string_view kSnapshotFile = "items.snapshot";
+constexpr std::string_view kSnapshotTempFile = "items.snapshot.tmp";
+constexpr std::string_view kLogPrefix = "items-";
+constexpr std::string_view kLogSuffix = ".log";
+constexpr std::uint8_t kAppendRecord = 1U;
+constexpr std::uint8_t kReplaceRecord = 2U;
+// Several writes in one record, so a torn batch is dropped as a whole.
+constexpr std::uint8_t kAppendBatchRecord = 3U;
+// Entries carry their own index; see ItemWrite.
+constexpr std::uint8_t kWriteBatchRecord = 4U;
+constexpr size_t kRecordFrameSize = 8U;
+constexpr size_t kSnapshotWriteChunk = 1U << 20;
+
+// CRC-32 (IEEE 802.3, as used by zlib), table driven.
+std::uint32_t crc32Update(std::uint32_t crc, const unsigned char* data, size_t size) {
+  static const std::array<std::uint32_t, 256> table = [] {
+    std::array<std::uint32_t, 256> entries{};
+    for (std::uint32_t index = 0; index < entries.size(); ++index) {
+      std::uint32_t value = index;
+      for (int bit = 0; bit < 8; ++bit) {
+        value = (value & 1U) != 0U ? 0xEDB88320U ^ (value >> 1) : value >> 1;
+      }
+      entries[index] = value;
+    }
+    return entries;
+  }();
+  crc = ~crc;
+  for (size_t index = 0; index < size; ++index) {
+    crc = table[(crc ^ data[index]) & 0xFFU] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+std::uint32_t crc32(std::string_view bytes) {
+  return crc32Update(0U, reinterpret_cast<const unsigned char*>(bytes.data()), bytes.size());
+}
+
+// Fixed-width little-endian encoding, independent of the host byte order.
+void putUint(std::string& out, std::uint64_t value, size_t width) {
+  for (size_t byte = 0; byte < width; ++byte) {
+    out.push_back(static_cast<char>((value >> (8U * byte)) & 0xFFU));
+  }
+}
+
+void putItem(std::string& out, const Item& item) {
+  putUint(out, static_cast<std::uint32_t>(item.quantity), 4U);
+  putUint(out, static_cast<std::uint64_t>(item.unitCost.cents()), 8U);
+  putUint(out, item.name.size(), 4U);
+  out += item.name;
+}
+
+class ByteReader {
+public:
+  explicit ByteReader(std::string_view bytes) : bytes_(bytes) {}
+
+  size_t remaining() const {
+    return bytes_.size() - offset_;
+  }
+
+  bool readUint(std::uint64_t& value, size_t width) {
+    if (remaining() < width) {
+      return false;
+    }
+    value = 0U;
+    for (size_t byte = 0; byte < width; ++byte) {
+      value |= static_cast<std::uint64_t>(static_cast<unsigned char>(bytes_[offset_ + byte])) << (8U * byte);
+    }
+    offset_ += width;
+    return true;
+  }
+
+  bool readBytes(size_t length, std::string_view& out) {
+    if (remaining() < length) {
+      return false;
+    }
+    out = bytes_.substr(offset_, length);
+    offset_ += length;
+    return true;
+  }
+
+  bool readItem(Item& item) {
+    std::uint64_t quantity = 0U;
+    std::uint64_t cents = 0U;
+    std::uint64_t nameLength = 0U;
+    std::string_view name;
+    if (!readUint(quantity, 4U) || !readUint(cents, 8U) || !readUint(nameLength, 4U) ||
+        !readBytes(static_cast<size_t>(nameLength), name)) {
+      return false;
+    }
+    item.name.assign(name.data(), name.size());
+    item.quantity = static_cast<int>(static_cast<std::uint32_t>(quantity));
+    item.unitCost = Money::fromCents(static_cast<std::int64_t>(cents));
+    return true;
+  }
+
+private:
+  std::string_view bytes_;
+  size_t offset_ = 0U;
+};
+
+// Read-only memory mapping of a whole file.
+class MappedFile {
+public:
+  explicit MappedFile(const std::filesystem::path& path) {
+#ifdef _WIN32
+    file_ = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                        nullptr);
+    if (file_ == INVALID_HANDLE_VALUE) {
+      throw std::runtime_error("No se pudo abrir " + path.string());
+    }
+    LARGE_INTEGER fileSize{};
+    GetFileSizeEx(file_, &fileSize);
+    size_ = static_cast<size_t>(fileSize.QuadPart);
+    if (size_ > 0U) {
+      mapping_ = CreateFileMappingW(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+      data_ = mapping_ == nullptr ? nullptr : MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+      if (data_ == nullptr) {
+        release();
+        throw std::runtime_error("No se pudo mapear " + path.string());
+      }
+    }
+#else
+    descriptor_ = ::open(path.c_str(), O_RDONLY);
+    if (descriptor_ == -1) {
+      throw std::runtime_error("No se pudo abrir " + path.string());
+    }
+    struct stat status {};
+    fstat(descriptor_, &status);
+    size_ = static_cast<size_t>(status.st_size);
+    if (size_ > 0U) {
+      data_ = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, descriptor_, 0);
+      if (data_ == MAP_FAILED) {
+        data_ = nullptr;
+        release();
+        throw std::runtime_error("No se pudo mapear " + path.string());
+      }
+    }
+#endif
+  }
+
+  ~MappedFile() {
+    release();
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  std::string_view bytes() const {
+    return data_ == nullptr ? std::string_view{} : std::string_view(static_cast<const char*>(data_), size_);
+  }
+
+private:
+  void release() {
+#ifdef _WIN32
+    if (data_ != nullptr) {
+      UnmapViewOfFile(data_);
+    }
+    if (mapping_ != nullptr) {
+      CloseHandle(mapping_);
+    }
+    if (file_ != INVALID_HANDLE_VALUE) {
+      CloseHandle(file_);
+    }
+    data_ = nullptr;
+    mapping_ = nullptr;
+    file_ = INVALID_HANDLE_VALUE;
+#else
+    if (data_ != nullptr) {
+      munmap(data_, size_);
+    }
+    if (descriptor_ != -1) {
+      ::close(descriptor_);
+    }
+    data_ = nullptr;
+    descriptor_ = -1;
+#endif
+  }
+
+#ifdef _WIN32
+  HANDLE file_ = INVALID_HANDLE_VALUE;
+  HANDLE mapping_ = nullptr;
+#else
+  int descriptor_ = -1;
+#endif
+  void* data_ = nullptr;
+  size_t size_ = 0U;
+};
+
+bool syncFile(std::FILE* file) {
+  if (std::fflush(file) != 0) {
+    return false;
+  }
+#ifdef _WIN32
+  return _commit(_fileno(file)) == 0;
+#else
+  return fsync(fileno(file)) == 0;
+#endif
+}
+
+// Makes a rename or unlink in `directory` durable.
+void syncDirectory(const std::filesystem::path& directory) {
+#ifndef _WIN32
+  const int descriptor = ::open(directory.c_str(), O_RDONLY);
+  if (descriptor != -1) {
+    fsync(descriptor);
+    ::close(descriptor);
+  }
+#else
+  (void)directory;
+#endif
+}
+
+// The journal cannot acknowledge writes it failed to persist, and carrying on
+// would let memory and disk diverge silently.
+[[noreturn]] void failStorage(const std::string& message) {
+  std::cerr << "Error fatal: " << message << std::endl;
+  std::abort();
+}
+
+std::filesystem::path logPath(const std::filesystem::path& directory, std::uint64_t generation) {
+  std::string digits = std::to_string(generation);
+  digits.insert(0, digits.size() < 8U ? 8U - digits.size() : 0U, '0');
+  return directory / (std::string(kLogPrefix) + digits + std::string(kLogSuffix));
+}
+
+// Returns the generation encoded in a log file name, or 0 for other files.
+std::uint64_t logGeneration(const std::filesystem::path& file) {
+  const std::string name = file.filename().string();
+  if (name.size() <= kLogPrefix.size() + kLogSuffix.size() || name.compare(0, kLogPrefix.size(), kLogPrefix) != 0 ||
+      name.compare(name.size() - kLogSuffix.size(), kLogSuffix.size(), kLogSuffix) != 0) {
+    return 0U;
+  }
+  std::uint64_t generation = 0U;
+  for (size_t index = kLogPrefix.size(); index < name.size() - kLogSuffix.size(); ++index) {
+    if (name[index] < '0' || name[index] > '9') {
+      return 0U;
+    }
+    generation = generation * 10U + static_cast<std::uint64_t>(name[index] - '0');
+  }
+  return generation;
+}
+
+void loadSnapshot(const std::filesystem::path& path, std::vector<Item>& items, std::uint64_t& sequence) {
+  const MappedFile file(path);
+  const std::string_view bytes = file.bytes();
+  if (bytes.size() < kSnapshotMagic.size() + 4U || bytes.substr(0, kSnapshotMagic.size()) != kSnapshotMagic) {
+    throw std::runtime_error("Instantánea de items inválida: " + path.string());
+  }
+
+  const std::string_view body = bytes.substr(kSnapshotMagic.size(), bytes.size() - kSnapshotMagic.size() - 4U);
+  ByteReader trailer(bytes.substr(bytes.size() - 4U));
+  std::uint64_t storedCrc = 0U;
+  trailer.readUint(storedCrc, 4U);
+  if (crc32(body) != static_cast<std::uint32_t>(storedCrc)) {
+    throw std::runtime_error("Instantánea de items corrupta: " + path.string());
+  }
+
+  ByteReader reader(body);
+  std::uint64_t count = 0U;
+  if (!reader.readUint(sequence, 8U) || !reader.readUint(count, 8U)) {
+    throw std::runtime_error("Instantánea de items inválida: " + path.string());
+  }
+  items.clear();
+  items.reserve(static_cast<size_t>(std::min<std::uint64_t>(count, body.size())));
+  for (std::uint64_t index = 0; index < count; ++index) {
+    Item item;
+    if (!reader.readItem(item)) {
+      throw std::runtime_error("Instantánea de items inválida: " + path.string());
+    }
+    items.push_back(std::move(item));
+  }
+}
+
+// Applies the records of one log file that are newer than `sequence`. A torn
+// or corrupt record ends the file: it can only be the unacknowledged tail of a
+// write interrupted by a crash.
+void replayLog(const std::filesystem::path& path, std::vector<Item>& items, std::uint64_t& sequence) {
+  const MappedFile file(path);
+  const std::string_view bytes = file.bytes();
+  if (bytes.size() < kLogMagic.size() || bytes.substr(0, kLogMagic.size()) != kLogMagic) {
+    return;
+  }
+
+  ByteReader reader(bytes.substr(kLogMagic.size()));
+  while (reader.remaining() >= kRecordFrameSize) {
+    std::uint64_t length = 0U;
+    std::uint64_t storedCrc = 0U;
+    std::string_view payload;
+    reader.readUint(length, 4U);
+    reader.readUint(storedCrc, 4U);
+    if (!reader.readBytes(static_cast<size_t>(length), payload) ||
+        crc32(payload) != static_cast<std::uint32_t>(storedCrc)) {
+      return;
+    }
+
+    ByteReader record(payload);
+    std::uint64_t recordSequence = 0U;
+    std::uint64_t type = 0U;
+    std::uint64_t index = 0U;
+    if (!record.readUint(recordSequence, 8U) || !record.readUint(type, 1U) || !record.readUint(index, 8U)) {
+      return;
+    }
+    if (recordSequence <= sequence) {
+      continue;
+    }
+    if (type == kAppendBatchRecord) {
+      const size_t firstNew = items.size();
+      for (std::uint64_t count = 0; count < index; ++count) {
+        Item item;
+        if (!record.readItem(item)) {
+          items.resize(firstNew);
+          return;
+        }
+        items.push_back(std::move(item));
+      }
+      sequence = recordSequence;
+      continue;
+    }
+    if (type == kWriteBatchRecord) {
+      std::vector<ItemWrite> writes(static_cast<size_t>(std::min<std::uint64_t>(index, payload.size())));
+      for (ItemWrite& write : writes) {
+        std::uint64_t target = 0U;
+        if (!record.readUint(target, 8U) || !record.readItem(write.item)) {
+          return;
+        }
+        write.index = static_cast<size_t>(target);
+      }
+      for (ItemWrite& write : writes) {
+        if (write.index == items.size()) {
+          items.push_back(std::move(write.item));
+        } else if (write.index < items.size()) {
+          items[write.index] = std::move(write.item);
+        }
+      }
+      sequence = recordSequence;
+      continue;
+    }
+    Item item;
+    if (!record.readItem(item)) {
+      return;
+    }
+    if (type == kAppendRecord) {
+      items.push_back(std::move(item));
+    } else if (type == kReplaceRecord && index < items.size()) {
+      items[static_cast<size_t>(index)] = std::move(item);
+    }
+    sequence = recordSequence;
+  }
+}
+
+void writeSnapshot(const std::filesystem::path& directory, const StoreCheckpoint& checkpoint) {
+  const std::filesystem::path tempPath = directory / kSnapshotTempFile;
+  std::FILE* file = std::fopen(tempPath.string().c_str(), "wb");
+  if (file == nullptr) {
+    failStorage("no se pudo crear " + tempPath.string());
+  }
+
+  std::string buffer;
+  buffer.reserve(kSnapshotWriteChunk + 4096U);
+  std::uint32_t crc = 0U;
+  bool ok = std::fwrite(kSnapshotMagic.data(), 1U, kSnapshotMagic.size(), file) == kSnapshotMagic.size();
+  const auto writeBuffer = [&] {
+    crc = crc32Update(crc, reinterpret_cast<const unsigned char*>(buffer.data()), buffer.size());
+    ok = ok && std::fwrite(buffer.data(), 1U, buffer.size(), file) == buffer.size();
+    buffer.clear();
+  };
+
+  putUint(buffer, checkpoint.sequence, 8U);
+  putUint(buffer, checkpoint.items->size(), 8U);
+  for (const Item& item : *checkpoint.items) {
+    putItem(buffer, item);
+    if (buffer.size() >= kSnapshotWriteChunk) {
+      writeBuffer();
+    }
+  }
+  writeBuffer();
+  putUint(buffer, crc, 4U);
+  ok = ok && std::fwrite(buffer.data(), 1U, buffer.size(), file) == buffer.size();
+  ok = syncFile(file) && ok;
+  ok = std::fclose(file) == 0 && ok;
+  if (!ok) {
+    failStorage("no se pudo escribir " + tempPath.string());
+  }
+
+  std::error_code error;
+  std::filesystem::rename(tempPath, directory / kSnapshotFile, error);
+  if (error) {
+    failStorage("no se pudo publicar la instantánea de items: " + error.message());
+  }
+  syncDirectory(directory);
+}
+
+}  // namespace
+
+JournalThreads::JournalThreads(size_t flusherCount, std::function<void()> onDurable)
+    : onDurable_(std::move(onDurable)) {
+  for (size_t index = 0; index < std::max<size_t>(flusherCount, 1U); ++index) {
+    flushers_.emplace_back([this] { runFlusher(); });
+  }
+  compactor_ = std::thread([this] { runCompactor(); });
+}
+
+JournalThreads::~JournalThreads() {
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    stopping_ = true;
+  }
+  flushWanted_.notify_all();
+  compactionWanted_.notify_all();
+  for (std::thread& flusher : flushers_) {
+    flusher.join();
+  }
+  compactor_.join();
+}
+
+void JournalThreads::requestFlush(ItemJournal& journal) {
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (journal.flushQueued_ || journal.detached_) {
+      return;
+    }
+    journal.flushQueued_ = true;
+    flushQueue_.push_back(&journal);
+  }
+  flushWanted_.notify_one();
+}
+
+void JournalThreads::requestCompaction(ItemJournal& journal) {
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (journal.compactionQueued_ || journal.detached_) {
+      return;
+    }
+    journal.compactionQueued_ = true;
+    compactionQueue_.push_back(&journal);
+  }
+  compactionWanted_.notify_one();
+}
+
+void JournalThreads::detach(ItemJournal& journal) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  journal.detached_ = true;
+  flushQueue_.erase(std::remove(flushQueue_.begin(), flushQueue_.end(), &journal), flushQueue_.end());
+  compactionQueue_.erase(std::remove(compactionQueue_.begin(), compactionQueue_.end(), &journal),
+                         compactionQueue_.end());
+  journalIdle_.wait(lock, [&journal] { return journal.busyThreads_ == 0; });
+}
+
+void JournalThreads::runFlusher() {
+  while (true) {
+    ItemJournal* journal = nullptr;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      flushWanted_.wait(lock, [this] { return !flushQueue_.empty() || stopping_; });
+      if (stopping_) {
+        return;
+      }
+      journal = flushQueue_.front();
+      flushQueue_.pop_front();
+      // Records encoded from here on queue the journal again, for the next
+      // batch; whichever thread takes it waits for this flush to end.
+      journal->flushQueued_ = false;
+      ++journal->busyThreads_;
+    }
+    journal->flush();
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      --journal->busyThreads_;
+    }
+    journalIdle_.notify_all();
+  }
+}
+
+void JournalThreads::runCompactor() {
+  while (true) {
+    ItemJournal* journal = nullptr;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      compactionWanted_.wait(lock, [this] { return !compactionQueue_.empty() || stopping_; });
+      if (stopping_) {
+        return;
+      }
+      journal = compactionQueue_.front();
+      compactionQueue_.pop_front();
+      journal->compactionQueued_ = false;
+      ++journal->busyThreads_;
+    }
+    journal->compact();
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      --journal->busyThreads_;
+    }
+    journalIdle_.notify_all();
+  }
+}
+
+ItemJournal::ItemJournal(std::filesystem::path directory,
+                         std::uintmax_t compactionThresholdBytes,
+                         JournalThreads& threads)
+    : directory_(std::move(directory)), compactionThresholdBytes_(compactionThresholdBytes), threads_(threads) {}
+
+ItemJournal::~ItemJournal() {
+  if (store_ != nullptr) {
+    store_->setWriteLog(nullptr);
+  }
+  threads_.detach(*this);
+
+  std::lock_guard<std::mutex> fileGuard(fileMutex_);
+  if (log_ != nullptr) {
+    flushPendingLocked();
+    std::fclose(log_);
+  }
+}
+
+void ItemJournal::open(ItemStore& store) {
+  std::filesystem::create_directories(directory_);
+  std::filesystem::remove(directory_ / kSnapshotTempFile);
+
+  std::vector<Item> items;
+  std::uint64_t sequence = 0U;
+  const std::filesystem::path snapshotPath = directory_ / kSnapshotFile;
+  if (std::filesystem::exists(snapshotPath)) {
+    loadSnapshot(snapshotPath, items, sequence);
+  }
+
+  std::vector<std::pair<std::uint64_t, std::filesystem::path>> logs;
+  for (const auto& entry : std::filesystem::directory_iterator(directory_)) {
+    const std::uint64_t generation = logGeneration(entry.path());
+    if (generation != 0U) {
+      logs.emplace_back(generation, entry.path());
+    }
+  }
+  std::sort(logs.begin(), logs.end());
+  for (const auto& [generation, path] : logs) {
+    replayLog(path, items, sequence);
+    logBytes_ += std::filesystem::file_size(path);
+    generation_ = generation;
+  }
+
+  store.load(std::move(items), sequence);
+  lastSequence_ = sequence;
+  durableSequence_.store(sequence, std::memory_order_release);
+
+  // Always start a fresh log file: an older one may end in a torn record.
+  ++generation_;
+  openLogFile();
+  store_ = &store;
+  store.setWriteLog(this);
+
+  if (logBytes_ >= compactionThresholdBytes_) {
+    threads_.requestCompaction(*this);
+  }
+}
+
+std::uint64_t ItemJournal::recordAppend(const Item& item) {
+  return record(kAppendRecord, 0U, [&item](std::string& out) { putItem(out, item); });
+}
+
+std::uint64_t ItemJournal::recordAppendBatch(const std::vector<Item>& items) {
+  return record(kAppendBatchRecord, items.size(), [&items](std::string& out) {
+    for (const Item& item : items) {
+      putItem(out, item);
+    }
+  });
+}
+
+std::uint64_t ItemJournal::recordWrites(const std::vector<ItemWrite>& writes) {
+  return record(kWriteBatchRecord, writes.size(), [&writes](std::string& out) {
+    for (const ItemWrite& write : writes) {
+      putUint(out, write.index, 8U);
+      putItem(out, write.item);
+    }
+  });
+}
+
+std::uint64_t ItemJournal::recordReplace(size_t index, const Item& item) {
+  return record(kReplaceRecord, index, [&item](std::string& out) { putItem(out, item); });
+}
+
+template <typename EncodeItems>
+std::uint64_t ItemJournal::record(std::uint8_t type, size_t index, const EncodeItems& encodeItems) {
+  std::unique_lock<std::mutex> guard(mutex_);
+  const std::uint64_t sequence = ++lastSequence_;
+
+  const size_t frameStart = pending_.size();
+  pending_.append(kRecordFrameSize, '\0');
+  putUint(pending_, sequence, 8U);
+  putUint(pending_, type, 1U);
+  putUint(pending_, index, 8U);
+  encodeItems(pending_);
+
+  const std::string_view payload = std::string_view(pending_).substr(frameStart + kRecordFrameSize);
+  std::string frame;
+  putUint(frame, payload.size(), 4U);
+  putUint(frame, crc32(payload), 4U);
+  pending_.replace(frameStart, kRecordFrameSize, frame);
+  guard.unlock();
+
+  threads_.requestFlush(*this);
+  return sequence;
+}
+
+void ItemJournal::openLogFile() {
+  const std::filesystem::path path = logPath(directory_, generation_);
+  log_ = std::fopen(path.string().c_str(), "wb");
+  if (log_ == nullptr || std::fwrite(kLogMagic.data(), 1U, kLogMagic.size(), log_) != kLogMagic.size() ||
+      !syncFile(log_)) {
+    failStorage("no se pudo crear el registro de items " + path.string());
+  }
+  syncDirectory(directory_);
+}
+
+// Writes and fsyncs everything encoded so far. Callers hold fileMutex_.
+void ItemJournal::flushPendingLocked() {
+  std::uint64_t batchSequence = 0U;
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    flushing_.swap(pending_);
+    batchSequence = lastSequence_;
+  }
+  if (flushing_.empty()) {
+    return;
+  }
+
+  if (std::fwrite(flushing_.data(), 1U, flushing_.size(), log_) != flushing_.size() || !syncFile(log_)) {
+    failStorage("no se pudo escribir el registro de items");
+  }
+  logBytes_ += flushing_.size();
+  flushing_.clear();
+  durableSequence_.store(batchSequence, std::memory_order_release);
+  if (threads_.onDurable_) {
+    threads_.onDurable_();
+  }
+
+  if (logBytes_ >= compactionThresholdBytes_) {
+    threads_.requestCompaction(*this);
+  }
+}
+
+// Records encoded while this batch is being synced form the next batch.
+void ItemJournal::flush() {
+  std::lock_guard<std::mutex> fileGuard(fileMutex_);
+  flushPendingLocked();
+}
+
+// Rotates the log first, so every record in the older files precedes the
+// checkpoint taken next; those files are deleted once the snapshot is durable.
+void ItemJournal::compact() {
+  std::uint64_t firstKeptGeneration = 0U;
+  {
+    std::lock_guard<std::mutex> fileGuard(fileMutex_);
+    flushPendingLocked();
+    std::fclose(log_);
+    ++generation_;
+    openLogFile();
+    logBytes_ = 0U;
+    firstKeptGeneration = generation_;
+  }
+
+  writeSnapshot(directory_, store_->checkpoint());
+
+  for (const auto& entry : std::filesystem::directory_iterator(directory_)) {
+    const std::uint64_t generation = logGeneration(entry.path());
+    if (generation != 0U && generation < firstKeptGeneration) {
+      std::error_code error;
+      std::filesystem::remove(entry.path(), error);
+    }
+  }
+  syncDirectory(directory_);
+}
+
+}  // namespace csfj
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "item_store.hpp"
+
+namespace csfj {
+
+class ItemJournal;
+
+// The threads that sync and compact every journal of the process, so their
+// number does not grow with the number of sheets. Each journal queues itself
+// when it has records to sync or outgrew the compaction threshold, and is
+// queued at most once at a time. Flushes of different journals overlap, one
+// per flusher thread; compactions run one after another.
+class JournalThreads {
+public:
+  // `onDurable` runs on a flusher thread after every group commit.
+  JournalThreads(size_t flusherCount, std::function<void()> onDurable = {});
+  // Every journal using these threads must be destroyed first.
+  ~JournalThreads();
+  JournalThreads(const JournalThreads&) = delete;
+  JournalThreads& operator=(const JournalThreads&) = delete;
+
+private:
+  friend class ItemJournal;
+
+  void requestFlush(ItemJournal& journal);
+  void requestCompaction(ItemJournal& journal);
+  // Drops the journal's queued work and waits for any running on it; later
+  // requests from it are ignored.
+  void detach(ItemJournal& journal);
+  void runFlusher();
+  void runCompactor();
+
+  std::function<void()> onDurable_;
+  // Guards the queues and the scheduling fields of every journal.
+  std::mutex mutex_;
+  std::condition_variable flushWanted_;
+  std::condition_variable compactionWanted_;
+  std::condition_variable journalIdle_;
+  std::deque<ItemJournal*> flushQueue_;
+  std::deque<ItemJournal*> compactionQueue_;
+  bool stopping_ = false;
+  std::vector<std::thread> flushers_;
+  std::thread compactor_;
+};
+
+// Durable storage for the item store: an append-only, checksummed write-ahead
+// log plus a compact snapshot, both in one data directory.
+//
+// Writes are encoded into an in-memory batch while the store's write mutex is
+// held. A flusher thread writes each batch and fsyncs it once (group commit),
+// then advances durableSequence() and calls the JournalThreads' `onDurable`,
+// so callers waiting to acknowledge a write learn that its sequence number is
+// durable without polling. When the log outgrows the compaction threshold the
+// compactor thread rotates it, writes a snapshot of the store and deletes the
+// log files the snapshot covers, so startup maps one snapshot and replays only
+// the log written after it.
+class ItemJournal : public ItemWriteLog {
+public:
+  ItemJournal(std::filesystem::path directory, std::uintmax_t compactionThresholdBytes, JournalThreads& threads);
+  ~ItemJournal() override;
+  ItemJournal(const ItemJournal&) = delete;
+  ItemJournal& operator=(const ItemJournal&) = delete;
+
+  // Recovers the snapshot and log tail into `store`, then logs its writes.
+  void open(ItemStore& store);
+
+  std::uint64_t durableSequence() const {
+    return durableSequence_.load(std::memory_order_acquire);
+  }
+
+  std::uint64_t recordAppend(const Item& item) override;
+  std::uint64_t recordAppendBatch(const std::vector<Item>& items) override;
+  std::uint64_t recordWrites(const std::vector<ItemWrite>& writes) override;
+  std::uint64_t recordReplace(size_t index, const Item& item) override;
+
+private:
+  friend class JournalThreads;
+
+  // `index` is the entry count for batch records; `encodeItems` appends the
+  // record's items to the payload.
+  template <typename EncodeItems>
+  std::uint64_t record(std::uint8_t type, size_t index, const EncodeItems& encodeItems);
+  void openLogFile();
+  void flush();
+  void flushPendingLocked();
+  void compact();
+
+  std::filesystem::path directory_;
+  std::uintmax_t compactionThresholdBytes_;
+  JournalThreads& threads_;
+  ItemStore* store_ = nullptr;
+
+  // Guards the encoding batch and sequence counter; held briefly by writers.
+  std::mutex mutex_;
+  std::string pending_;
+  std::uint64_t lastSequence_ = 0U;
+
+  // Guarded by the JournalThreads' mutex: whether the journal waits in each
+  // queue, how many threads work on it and whether it is being destroyed.
+  bool flushQueued_ = false;
+  bool compactionQueued_ = false;
+  int busyThreads_ = 0;
+  bool detached_ = false;
+
+  // Guards the open log file; taken before mutex_ when both are needed.
+  std::mutex fileMutex_;
+  std::FILE* log_ = nullptr;
+  std::uint64_t generation_ = 0U;
+  std::uintmax_t logBytes_ = 0U;
+  std::string flushing_;
+
+  std::atomic<std::uint64_t> durableSequence_{0U};
+};
+
+}  // namespace csfj
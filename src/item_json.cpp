@@ -0,0 +1,134 @@
+#include "item_json.hpp"
+
+#include <charconv>
+
+#include "money.hpp"
+#include "text_format.hpp"
+
+namespace csfj {
+
+namespace {
+
+constexpr std::string_view kInvalidJson = "JSON inválido.";
+
+template <typename Integer>
+bool parseWhole(std::string_view text, Integer& value) {
+  const char* first = text.data();
+  const char* last = first + text.size();
+  const auto [end, error] = std::from_chars(first, last, value);
+  return error == std::errc{} && end == last && first != last;
+}
+
+bool readCost(JsonReader& reader, Money& cost) {
+  std::string_view text;
+  if (reader.peek() == JsonType::kNumber) {
+    return reader.readNumber(text) && parseMoney(text, cost);
+  }
+  return reader.readString(text) && parseMoney(normalizeCostInput(text), cost);
+}
+
+}  // namespace
+
+void appendItemJson(std::string& out, size_t index, const Item& item) {
+  out += "{\"index\":";
+  appendInteger(out, static_cast<long long>(index));
+  out += ",\"name\":";
+  appendJsonString(out, item.name);
+  out += ",\"quantity\":";
+  appendInteger(out, item.quantity);
+  out += ",\"unitCost\":";
+  appendMoney(out, item.unitCost);
+  out += ",\"total\":";
+  appendMoney(out, item.getTotalCost());
+  out += '}';
+}
+
+bool readItemChange(JsonReader& reader, ItemChange& change, std::string& error) {
+  change = ItemChange{};
+  if (!reader.beginObject()) {
+    error = "Se esperaba un objeto con los campos del item.";
+    return false;
+  }
+  std::string_view key;
+  while (reader.nextMember(key)) {
+    std::string_view text;
+    if (key == "name") {
+      if (!reader.readString(text) || text.empty()) {
+        error = "name debe ser un texto no vacío.";
+        return false;
+      }
+      change.name.emplace(text);
+    } else if (key == "quantity") {
+      int quantity = 0;
+      if (!reader.readNumber(text) || !parseWhole(text, quantity) || quantity < 1) {
+        error = "quantity debe ser un número entero positivo.";
+        return false;
+      }
+      change.quantity = quantity;
+    } else if (key == "unitCost") {
+      Money cost;
+      if (!readCost(reader, cost)) {
+        error = "unitCost debe ser un monto positivo.";
+        return false;
+      }
+      change.unitCost = cost;
+    } else if (key == "index") {
+      size_t index = 0U;
+      if (!reader.readNumber(text) || !parseWhole(text, index)) {
+        error = "index debe ser un número entero no negativo.";
+        return false;
+      }
+      change.index = index;
+    } else if (key == "total") {
+      reader.skipValue();
+    } else {
+      error = "Campo desconocido: ";
+      error += key;
+      return false;
+    }
+  }
+  if (reader.failed()) {
+    error = kInvalidJson;
+    return false;
+  }
+  return true;
+}
+
+bool parseItemChange(std::string_view json, ItemChange& change, std::string& error) {
+  JsonReader reader(json);
+  if (!readItemChange(reader, change, error)) {
+    return false;
+  }
+  if (!reader.atEnd()) {
+    error = kInvalidJson;
+    return false;
+  }
+  return true;
+}
+
+bool parseItemChanges(std::string_view json,
+                      std::vector<ItemChange>& changes,
+                      std::string& error,
+                      size_t& failedChange) {
+  changes.clear();
+  failedChange = 0U;
+  JsonReader reader(json);
+  if (!reader.beginArray()) {
+    error = "Se esperaba un arreglo de items.";
+    return false;
+  }
+  while (reader.nextElement()) {
+    failedChange = changes.size();
+    if (!readItemChange(reader, changes.emplace_back(), error)) {
+      return false;
+    }
+  }
+  if (!reader.atEnd()) {
+    failedChange = changes.size();
+    error = kInvalidJson;
+    return false;
+  }
+  return true;
+}
+
+}  // namespace csfj
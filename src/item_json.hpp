@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "item_store.hpp"
+#include "json_reader.hpp"
+
+namespace csfj {
+
+// JSON form of an item for /api/items, with amounts as plain numbers:
+// {"index":3,"name":"Refrigerio","quantity":2,"unitCost":12.50,"total":25.00}
+void appendItemJson(std::string& out, size_t index, const Item& item);
+
+// Reads one item object into `change`. Members are "name" (non-empty string),
+// "quantity" (whole number >= 1), "unitCost" (a number, or a string following
+// the normalizeCostInput rules) and "index"; "total" is accepted and ignored
+// because it is derived. On failure `error` says why.
+bool readItemChange(JsonReader& reader, ItemChange& change, std::string& error);
+
+// A whole body holding one item object.
+bool parseItemChange(std::string_view json, ItemChange& change, std::string& error);
+
+// A whole body holding an array of item objects. On failure `failedChange` is
+// the position of the offending object.
+bool parseItemChanges(std::string_view json,
+                      std::vector<ItemChange>& changes,
+                      std::string& error,
+                      size_t& failedChange);
+
+}  // namespace csfj
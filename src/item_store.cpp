@@ -0,0 +1,401 @@
+#include "item_store.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <unordered_map>
+#include <utility>
+
+#include "column_scan.hpp"
+#include "item_index.hpp"
+
+namespace csfj {
+
+size_t categoryIndex(std::string_view itemName) {
+  for (size_t index = 0; index < kItemCategories.size(); ++index) {
+    if (kItemCategories[index] == itemName) {
+      return index;
+    }
+  }
+  return kOtherCategory;
+}
+
+namespace {
+
+thread_local std::uint64_t t_lockWaitNanos = 0U;
+
+// Takes `lock`, adding the wait to t_lockWaitNanos. Only contended
+// acquisitions are timed, so the common case stays free.
+template <typename Lock>
+void lockTimed(Lock& lock) {
+  if (lock.try_lock()) {
+    return;
+  }
+  const auto start = std::chrono::steady_clock::now();
+  lock.lock();
+  t_lockWaitNanos += static_cast<std::uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+}  // namespace
+
+void ItemSnapshot::Chunk::push_back(Item item) {
+  rows.emplace_back();
+  set(rows.size() - 1U, std::move(item));
+}
+
+void ItemSnapshot::Chunk::set(size_t row, Item item) {
+  columns.category[row] = static_cast<std::uint8_t>(categoryIndex(item.name));
+  columns.quantity[row] = item.quantity;
+  columns.unitCents[row] = item.unitCost.cents();
+  columns.totalCents[row] = item.getTotalCost().cents();
+  rows[row] = std::move(item);
+}
+
+Money sumTotals(const ItemSnapshot& items) {
+  std::int64_t cents = 0;
+  for (size_t chunk = 0; chunk < items.chunkCount(); ++chunk) {
+    cents += sumColumn(items.columns(chunk).totalCents.data(), items.chunkSize(chunk));
+  }
+  return Money::fromCents(cents);
+}
+
+CategoryTotals totalsByCategory(const ItemSnapshot& items) {
+  static_assert(kItemCategories.size() + 1U <= kMaxCategoryIds, "category ids must fit sumByCategory's tables");
+  std::uint64_t counts[kMaxCategoryIds] = {};
+  std::int64_t sums[kMaxCategoryIds] = {};
+  for (size_t chunk = 0; chunk < items.chunkCount(); ++chunk) {
+    const ItemSnapshot::Columns& columns = items.columns(chunk);
+    sumByCategory(columns.category.data(), columns.totalCents.data(), items.chunkSize(chunk), counts, sums);
+  }
+  CategoryTotals totals;
+  for (size_t category = 0; category < totals.count.size(); ++category) {
+    totals.count[category] = counts[category];
+    totals.total[category] = Money::fromCents(sums[category]);
+  }
+  return totals;
+}
+
+ItemStore::ItemStore() : current_(std::make_shared<const ItemSnapshot>()), index_(std::make_unique<ItemIndex>()) {}
+
+ItemStore::~ItemStore() = default;
+
+std::shared_ptr<const ItemSnapshot> ItemStore::snapshot() const {
+  return std::atomic_load(&current_);
+}
+
+StoreCheckpoint ItemStore::checkpoint() {
+  std::lock_guard<std::mutex> guard(writeMutex_);
+  return {current_, lastSequence_};
+}
+
+void ItemStore::load(std::vector<Item> items, std::uint64_t sequence) {
+  std::lock_guard<std::mutex> guard(writeMutex_);
+  for (auto& costs : unitCosts_) {
+    costs.clear();
+  }
+  auto next = std::make_shared<ItemSnapshot>();
+  for (size_t start = 0; start < items.size(); start += ItemSnapshot::kChunkSize) {
+    const size_t end = std::min(items.size(), start + ItemSnapshot::kChunkSize);
+    auto chunk = std::make_shared<ItemSnapshot::Chunk>();
+    chunk->rows.reserve(ItemSnapshot::kChunkSize);
+    for (size_t index = start; index < end; ++index) {
+      chunk->push_back(std::move(items[index]));
+    }
+    next->chunks_.push_back(std::move(chunk));
+  }
+  next->size_ = items.size();
+
+  // Counts and subtotals reduce from the columns in one pass; only the
+  // ordered unit costs behind min/max need every item inserted.
+  const CategoryTotals totals = totalsByCategory(*next);
+  for (size_t chunk = 0; chunk < next->chunks_.size(); ++chunk) {
+    const ItemSnapshot::Columns& columns = next->columns(chunk);
+    for (size_t row = 0; row < next->chunkSize(chunk); ++row) {
+      unitCosts_[columns.category[row]].insert(Money::fromCents(columns.unitCents[row]));
+    }
+  }
+  ItemSummary& summary = next->summary_;
+  summary.count = next->size_;
+  for (size_t category = 0; category < summary.categories.size(); ++category) {
+    CategorySummary& categorySummary = summary.categories[category];
+    categorySummary.count = totals.count[category];
+    categorySummary.subtotal = totals.total[category];
+    summary.total += totals.total[category];
+    const auto& costs = unitCosts_[category];
+    categorySummary.minUnitCost = costs.empty() ? Money{} : *costs.begin();
+    categorySummary.maxUnitCost = costs.empty() ? Money{} : *costs.rbegin();
+  }
+  next->version_ = sequence;
+  lastSequence_ = sequence;
+  std::unique_lock<std::shared_mutex> indexGuard(indexMutex_);
+  index_->clear();
+  for (size_t position = 0; position < next->size_; ++position) {
+    index_->insert(position, (*next)[position]);
+  }
+  std::atomic_store(&current_, std::shared_ptr<const ItemSnapshot>(std::move(next)));
+}
+
+void ItemStore::setWriteLog(ItemWriteLog* log) {
+  std::lock_guard<std::mutex> guard(writeMutex_);
+  writeLog_ = log;
+}
+
+std::optional<std::uint64_t> ItemStore::append(Item item) {
+  const auto guard = lockWrites();
+  Money total;
+  if (!addMoney(current_->summary_.total, item.getTotalCost(), total)) {
+    return std::nullopt;
+  }
+  lastSequence_ = writeLog_ != nullptr ? writeLog_->recordAppend(item) : lastSequence_ + 1U;
+  auto next = std::make_shared<ItemSnapshot>(*current_);
+  const size_t offset = next->size_ % ItemSnapshot::kChunkSize;
+  if (offset == 0U) {
+    auto chunk = std::make_shared<ItemSnapshot::Chunk>();
+    chunk->rows.reserve(ItemSnapshot::kChunkSize);
+    chunk->push_back(std::move(item));
+    next->chunks_.push_back(std::move(chunk));
+  } else {
+    auto chunk = std::make_shared<ItemSnapshot::Chunk>(*next->chunks_.back());
+    chunk->push_back(std::move(item));
+    next->chunks_.back() = std::move(chunk);
+  }
+  ++next->size_;
+  addToSummary(next->summary_, (*next)[next->size_ - 1U]);
+  next->version_ = lastSequence_;
+  publish(std::move(next));
+  return lastSequence_;
+}
+
+std::optional<std::uint64_t> ItemStore::appendBatch(std::vector<Item> items) {
+  const auto guard = lockWrites();
+  Money total = current_->summary_.total;
+  for (const Item& item : items) {
+    if (!addMoney(total, item.getTotalCost(), total)) {
+      return std::nullopt;
+    }
+  }
+  lastSequence_ = writeLog_ != nullptr ? writeLog_->recordAppendBatch(items) : lastSequence_ + 1U;
+  auto next = std::make_shared<ItemSnapshot>(*current_);
+  size_t index = 0U;
+  // Top up the shared last chunk with one copy, then fill fresh chunks.
+  const size_t offset = next->size_ % ItemSnapshot::kChunkSize;
+  if (offset != 0U) {
+    auto chunk = std::make_shared<ItemSnapshot::Chunk>(*next->chunks_.back());
+    for (; index < items.size() && chunk->rows.size() < ItemSnapshot::kChunkSize; ++index) {
+      addToSummary(next->summary_, items[index]);
+      chunk->push_back(std::move(items[index]));
+    }
+    next->chunks_.back() = std::move(chunk);
+  }
+  while (index < items.size()) {
+    auto chunk = std::make_shared<ItemSnapshot::Chunk>();
+    chunk->rows.reserve(ItemSnapshot::kChunkSize);
+    for (; index < items.size() && chunk->rows.size() < ItemSnapshot::kChunkSize; ++index) {
+      addToSummary(next->summary_, items[index]);
+      chunk->push_back(std::move(items[index]));
+    }
+    next->chunks_.push_back(std::move(chunk));
+  }
+  next->size_ += items.size();
+  next->version_ = lastSequence_;
+  publish(std::move(next));
+  return lastSequence_;
+}
+
+BatchResult ItemStore::replace(size_t index, Item item) {
+  const auto guard = lockWrites();
+  BatchResult result;
+  Money total;
+  if (index >= current_->size()) {
+    result.status = BatchStatus::kNoSuchItem;
+  } else if (!addMoney(current_->summary_.total - (*current_)[index].getTotalCost(), item.getTotalCost(), total)) {
+    result.status = BatchStatus::kTotalOverflow;
+  }
+  if (result.status != BatchStatus::kApplied) {
+    return result;
+  }
+  lastSequence_ = writeLog_ != nullptr ? writeLog_->recordReplace(index, item) : lastSequence_ + 1U;
+  auto next = std::make_shared<ItemSnapshot>(*current_);
+  auto& slot = next->chunks_[index / ItemSnapshot::kChunkSize];
+  auto chunk = std::make_shared<ItemSnapshot::Chunk>(*slot);
+  const size_t row = index % ItemSnapshot::kChunkSize;
+  removeFromSummary(next->summary_, chunk->rows[row]);
+  chunk->set(row, std::move(item));
+  addToSummary(next->summary_, chunk->rows[row]);
+  slot = std::move(chunk);
+  next->version_ = lastSequence_;
+  publish(std::move(next), {index});
+  result.sequence = lastSequence_;
+  return result;
+}
+
+BatchResult ItemStore::applyBatch(const std::vector<ItemChange>& changes) {
+  const auto guard = lockWrites();
+  BatchResult result;
+  result.writes.reserve(changes.size());
+
+  // Resolve first, so a bad change is found before anything is logged or the
+  // summary bookkeeping is touched. `latest` maps an index already written in
+  // this batch to its last write.
+  const size_t baseSize = current_->size();
+  size_t size = baseSize;
+  Money sheetTotal = current_->summary_.total;
+  std::unordered_map<size_t, size_t> latest;
+  for (size_t position = 0; position < changes.size(); ++position) {
+    const ItemChange& change = changes[position];
+    ItemWrite write{};
+    if (change.index) {
+      if (*change.index >= size) {
+        result.status = BatchStatus::kNoSuchItem;
+      } else {
+        write.index = *change.index;
+        const auto it = latest.find(write.index);
+        write.item = it != latest.end() ? result.writes[it->second].item : (*current_)[write.index];
+      }
+    } else if (!change.name || !change.quantity || !change.unitCost) {
+      result.status = BatchStatus::kMissingField;
+    } else {
+      write.index = size++;
+    }
+    if (result.status == BatchStatus::kApplied) {
+      // Zero for an append, whose item is still empty.
+      const Money previousTotal = write.item.getTotalCost();
+      if (change.name) {
+        write.item.name = *change.name;
+      }
+      if (change.quantity) {
+        write.item.quantity = *change.quantity;
+      }
+      if (change.unitCost) {
+        write.item.unitCost = *change.unitCost;
+      }
+      Money total;
+      if (!multiplyMoney(write.item.unitCost, write.item.quantity, total) ||
+          !addMoney(sheetTotal - previousTotal, total, sheetTotal)) {
+        result.status = BatchStatus::kTotalOverflow;
+      }
+    }
+    if (result.status != BatchStatus::kApplied) {
+      result.failedChange = position;
+      result.writes.clear();
+      return result;
+    }
+    latest[write.index] = result.writes.size();
+    result.writes.push_back(std::move(write));
+  }
+  if (result.writes.empty()) {
+    result.sequence = lastSequence_;
+    return result;
+  }
+
+  lastSequence_ = writeLog_ != nullptr ? writeLog_->recordWrites(result.writes) : lastSequence_ + 1U;
+
+  auto next = std::make_shared<ItemSnapshot>(*current_);
+  // Chunks this batch already copied, so each is copied at most once.
+  std::vector<ItemSnapshot::Chunk*> writable(next->chunks_.size(), nullptr);
+  const auto writableChunk = [&](size_t chunkIndex) -> ItemSnapshot::Chunk& {
+    if (writable[chunkIndex] == nullptr) {
+      auto chunk = std::make_shared<ItemSnapshot::Chunk>(*next->chunks_[chunkIndex]);
+      writable[chunkIndex] = chunk.get();
+      next->chunks_[chunkIndex] = std::move(chunk);
+    }
+    return *writable[chunkIndex];
+  };
+  std::vector<size_t> replaced;
+  for (const ItemWrite& write : result.writes) {
+    if (write.index == next->size_) {
+      if (next->size_ % ItemSnapshot::kChunkSize == 0U) {
+        auto chunk = std::make_shared<ItemSnapshot::Chunk>();
+        chunk->rows.reserve(ItemSnapshot::kChunkSize);
+        writable.push_back(chunk.get());
+        next->chunks_.push_back(std::move(chunk));
+      }
+      writableChunk(next->chunks_.size() - 1U).push_back(write.item);
+      ++next->size_;
+      addToSummary(next->summary_, write.item);
+    } else {
+      ItemSnapshot::Chunk& chunk = writableChunk(write.index / ItemSnapshot::kChunkSize);
+      const size_t row = write.index % ItemSnapshot::kChunkSize;
+      removeFromSummary(next->summary_, chunk.rows[row]);
+      chunk.set(row, write.item);
+      addToSummary(next->summary_, chunk.rows[row]);
+      if (write.index < baseSize) {
+        replaced.push_back(write.index);
+      }
+    }
+  }
+  std::sort(replaced.begin(), replaced.end());
+  replaced.erase(std::unique(replaced.begin(), replaced.end()), replaced.end());
+  next->version_ = lastSequence_;
+  publish(std::move(next), replaced);
+  result.sequence = lastSequence_;
+  return result;
+}
+
+ItemQueryResult ItemStore::query(const ItemQuery& query) const {
+  std::shared_ptr<const ItemSnapshot> items;
+  ItemIndex::Candidates candidates;
+  {
+    std::shared_lock<std::shared_mutex> guard(indexMutex_, std::defer_lock);
+    lockTimed(guard);
+    items = current_;
+    candidates = index_->candidates(*items, query);
+  }
+  // A writer may publish from here on; `items` stays the version the
+  // candidates were taken from.
+  return ItemIndex::finish(std::move(items), query, std::move(candidates));
+}
+
+std::uint64_t ItemStore::takeLockWaitNanos() {
+  return std::exchange(t_lockWaitNanos, 0U);
+}
+
+std::unique_lock<std::mutex> ItemStore::lockWrites() {
+  std::unique_lock<std::mutex> lock(writeMutex_, std::defer_lock);
+  lockTimed(lock);
+  return lock;
+}
+
+void ItemStore::publish(std::shared_ptr<ItemSnapshot> next, const std::vector<size_t>& replaced) {
+  std::unique_lock<std::shared_mutex> guard(indexMutex_);
+  for (const size_t position : replaced) {
+    index_->erase(position, (*current_)[position]);
+    index_->insert(position, (*next)[position]);
+  }
+  for (size_t position = current_->size(); position < next->size_; ++position) {
+    index_->insert(position, (*next)[position]);
+  }
+  std::atomic_store(&current_, std::shared_ptr<const ItemSnapshot>(std::move(next)));
+}
+
+void ItemStore::addToSummary(ItemSummary& summary, const Item& item) {
+  const Money itemTotal = item.getTotalCost();
+  ++summary.count;
+  summary.total += itemTotal;
+
+  const size_t category = categoryIndex(item.name);
+  auto& costs = unitCosts_[category];
+  costs.insert(item.unitCost);
+  CategorySummary& categorySummary = summary.categories[category];
+  ++categorySummary.count;
+  categorySummary.subtotal += itemTotal;
+  categorySummary.minUnitCost = *costs.begin();
+  categorySummary.maxUnitCost = *costs.rbegin();
+}
+
+void ItemStore::removeFromSummary(ItemSummary& summary, const Item& item) {
+  const Money itemTotal = item.getTotalCost();
+  --summary.count;
+  summary.total -= itemTotal;
+
+  const size_t category = categoryIndex(item.name);
+  auto& costs = unitCosts_[category];
+  costs.erase(costs.find(item.unitCost));
+  CategorySummary& categorySummary = summary.categories[category];
+  --categorySummary.count;
+  categorySummary.subtotal -= itemTotal;
+  categorySummary.minUnitCost = costs.empty() ? Money{} : *costs.begin();
+  categorySummary.maxUnitCost = costs.empty() ? Money{} : *costs.rbegin();
+}
+
+}  // namespace csfj
@@ -0,0 +1,318 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "money.hpp"
+
+namespace csfj {
+
+class ItemIndex;
+struct ItemQuery;
+struct ItemQueryResult;
+
+struct Item {
+  std::string name;
+  int quantity;
+  Money unitCost;
+
+  // Exact; handlers reject items whose total would overflow.
+  Money getTotalCost() const {
+    return unitCost * quantity;
+  }
+};
+
+// The predefined categories offered by the item dropdown. Items whose name is
+// not one of them are summarized under kOtherCategory.
+constexpr std::array<std::string_view, 10> kItemCategories = {
+    "Hora docente",
+    "Viáticos",
+    "Transporte",
+    "Material didáctico",
+    "Refrigerio",
+    "Alquiler de espacio",
+    "Equipamiento",
+    "Servicios profesionales",
+    "Publicidad",
+    "Certificaciones",
+};
+constexpr size_t kOtherCategory = kItemCategories.size();
+constexpr std::string_view kOtherCategoryName = "Otros";
+
+size_t categoryIndex(std::string_view itemName);
+
+struct CategorySummary {
+  size_t count = 0U;
+  Money subtotal;
+  Money minUnitCost;
+  Money maxUnitCost;
+};
+
+// Aggregates over a whole snapshot, maintained by the store on every write so
+// reading them never walks the items.
+struct ItemSummary {
+  size_t count = 0U;
+  Money total;
+  std::array<CategorySummary, kItemCategories.size() + 1U> categories{};
+};
+
+// An immutable version of the item list. Items live in fixed-size chunks that
+// consecutive versions share, so a write copies one chunk and the chunk index
+// rather than the whole list. A snapshot never changes once published and can
+// be read from any thread without locking.
+class ItemSnapshot {
+public:
+  static constexpr size_t kChunkSize = 256U;
+
+  // The numeric fields of a chunk's items, one contiguous array per field, so
+  // totals and range scans stream through plain integers instead of Items and
+  // their name strings. The category is the name interned as categoryIndex().
+  struct Columns {
+    std::array<std::uint8_t, kChunkSize> category;
+    std::array<std::int32_t, kChunkSize> quantity;
+    std::array<std::int64_t, kChunkSize> unitCents;
+    std::array<std::int64_t, kChunkSize> totalCents;
+  };
+
+  class const_iterator {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Item;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const Item*;
+    using reference = const Item&;
+
+    const_iterator(const ItemSnapshot* snapshot, size_t index) : snapshot_(snapshot), index_(index) {}
+
+    reference operator*() const {
+      return (*snapshot_)[index_];
+    }
+
+    pointer operator->() const {
+      return &(*snapshot_)[index_];
+    }
+
+    const_iterator& operator++() {
+      ++index_;
+      return *this;
+    }
+
+    bool operator==(const const_iterator& other) const {
+      return index_ == other.index_;
+    }
+
+    bool operator!=(const const_iterator& other) const {
+      return index_ != other.index_;
+    }
+
+  private:
+    const ItemSnapshot* snapshot_;
+    size_t index_;
+  };
+
+  size_t size() const {
+    return size_;
+  }
+
+  bool empty() const {
+    return size_ == 0U;
+  }
+
+  const Item& operator[](size_t index) const {
+    return chunks_[index / kChunkSize]->rows[index % kChunkSize];
+  }
+
+  // Chunk `chunk` holds items [chunk * kChunkSize, chunk * kChunkSize +
+  // chunkSize(chunk)); only the last one may be partly filled.
+  size_t chunkCount() const {
+    return chunks_.size();
+  }
+
+  size_t chunkSize(size_t chunk) const {
+    return chunks_[chunk]->rows.size();
+  }
+
+  const Columns& columns(size_t chunk) const {
+    return chunks_[chunk]->columns;
+  }
+
+  const_iterator begin() const {
+    return const_iterator(this, 0U);
+  }
+
+  const_iterator end() const {
+    return const_iterator(this, size_);
+  }
+
+  const ItemSummary& summary() const {
+    return summary_;
+  }
+
+  // Sequence number of the last write in this version. Strictly increases
+  // with every write, so equal versions always hold equal contents.
+  std::uint64_t version() const {
+    return version_;
+  }
+
+private:
+  friend class ItemStore;
+
+  // Rows and columns change together, so a chunk is copied as one.
+  struct Chunk {
+    std::vector<Item> rows;
+    Columns columns;
+
+    void push_back(Item item);
+    void set(size_t row, Item item);
+  };
+
+  std::vector<std::shared_ptr<const Chunk>> chunks_;
+  size_t size_ = 0U;
+  ItemSummary summary_;
+  std::uint64_t version_ = 0U;
+};
+
+// Count and sum of item totals per categoryIndex(), reduced from the columns.
+struct CategoryTotals {
+  std::array<std::uint64_t, kItemCategories.size() + 1U> count{};
+  std::array<Money, kItemCategories.size() + 1U> total{};
+};
+
+Money sumTotals(const ItemSnapshot& items);
+CategoryTotals totalsByCategory(const ItemSnapshot& items);
+
+// A resolved write of a batch. Applied in order, a write whose index equals
+// the current item count appends; any lower index replaces that item.
+struct ItemWrite {
+  size_t index = 0U;
+  Item item;
+};
+
+// One change of a batch. Without `index` it appends a new item and needs every
+// field; with it, it updates that item (which may have been appended earlier in
+// the same batch) and fields left empty keep their value.
+struct ItemChange {
+  std::optional<size_t> index;
+  std::optional<std::string> name;
+  std::optional<int> quantity;
+  std::optional<Money> unitCost;
+};
+
+enum class BatchStatus {
+  kApplied,
+  kMissingField,
+  kNoSuchItem,
+  kTotalOverflow,
+};
+
+struct BatchResult {
+  BatchStatus status = BatchStatus::kApplied;
+  // The rejected change when status is not kApplied.
+  size_t failedChange = 0U;
+  std::uint64_t sequence = 0U;
+  // One per change, in order, with the index it wrote.
+  std::vector<ItemWrite> writes;
+};
+
+// Receives every write while the store's write mutex is held, so it sees writes
+// in exactly the order they were applied. Returns the sequence number assigned
+// to the write; a batch is one write and gets one number.
+class ItemWriteLog {
+public:
+  virtual ~ItemWriteLog() = default;
+  virtual std::uint64_t recordAppend(const Item& item) = 0;
+  virtual std::uint64_t recordAppendBatch(const std::vector<Item>& items) = 0;
+  virtual std::uint64_t recordWrites(const std::vector<ItemWrite>& writes) = 0;
+  virtual std::uint64_t recordReplace(size_t index, const Item& item) = 0;
+};
+
+// A snapshot together with the sequence number of the last write it contains.
+struct StoreCheckpoint {
+  std::shared_ptr<const ItemSnapshot> items;
+  std::uint64_t sequence = 0U;
+};
+
+// The shared item list. Readers take the current snapshot with one atomic
+// shared_ptr load and keep it for as long as they need; writers build the next
+// version copy-on-write and publish it with an atomic store, serialized among
+// themselves by a mutex that readers never touch. Queries are the exception:
+// they read the secondary indexes, which writers update in place, so they take
+// a shared lock that writers hold exclusively only while publishing. A query
+// holds it only to copy out its candidate positions (ItemIndex::candidates),
+// so a long query does not hold up writers.
+class ItemStore {
+public:
+  ItemStore();
+  ~ItemStore();
+
+  std::shared_ptr<const ItemSnapshot> snapshot() const;
+  StoreCheckpoint checkpoint();
+
+  // Replaces the whole list without logging; used for recovery at startup.
+  void load(std::vector<Item> items, std::uint64_t sequence);
+
+  // Every later write is passed to `log`, which must outlive the store's use.
+  void setWriteLog(ItemWriteLog* log);
+
+  // The write calls return the write's sequence number, which becomes the
+  // version of the snapshot they publish; without a write log writes are
+  // numbered locally. Every item total fits in Money (multiplyMoney), and a
+  // write is refused when the sheet total would not, so no total or subtotal
+  // derived from the items can overflow either.
+
+  // Returns nothing, writing nothing, when the sheet total would overflow.
+  std::optional<std::uint64_t> append(Item item);
+  // Appends all of `items` as one write: readers see either none or all of
+  // them. `items` must not be empty. Returns nothing, writing nothing, when the
+  // sheet total would overflow.
+  std::optional<std::uint64_t> appendBatch(std::vector<Item> items);
+  // Fails with kNoSuchItem when `index` is out of range and kTotalOverflow
+  // when the sheet total would overflow; `writes` stays empty.
+  BatchResult replace(size_t index, Item item);
+
+  // Resolves every change against the current items and, if all of them are
+  // valid, applies them as one write under one acquisition of the write mutex.
+  // Otherwise nothing is written and the result names the first bad change;
+  // kTotalOverflow names the change whose item total, or the sheet total after
+  // which, does not fit.
+  BatchResult applyBatch(const std::vector<ItemChange>& changes);
+
+  // Runs `query` (see item_index.hpp) against the current snapshot.
+  ItemQueryResult query(const ItemQuery& query) const;
+
+  // Time the calling thread has spent waiting for the write mutex in the four
+  // write calls above, or for the index lock in query(), since its previous
+  // call, which resets it.
+  static std::uint64_t takeLockWaitNanos();
+
+private:
+  std::unique_lock<std::mutex> lockWrites();
+  void addToSummary(ItemSummary& summary, const Item& item);
+  void removeFromSummary(ItemSummary& summary, const Item& item);
+  // Brings the index from current_ to `next` and publishes `next`. `replaced`
+  // lists, once each, the positions below current_->size() whose item
+  // changed; every position past it was appended.
+  void publish(std::shared_ptr<ItemSnapshot> next, const std::vector<size_t>& replaced = {});
+
+  std::mutex writeMutex_;
+  std::shared_ptr<const ItemSnapshot> current_;
+  ItemWriteLog* writeLog_ = nullptr;
+  std::uint64_t lastSequence_ = 0U;
+  // Unit costs per category, ordered so min/max survive the removal of the
+  // current extreme on update. Only touched by writers.
+  std::array<std::multiset<Money>, kItemCategories.size() + 1U> unitCosts_;
+  mutable std::shared_mutex indexMutex_;
+  std::unique_ptr<ItemIndex> index_;
+};
+
+}  // namespace csfj
@@ -0,0 +1,361 @@
+#include "json_reader.hpp"
+
+namespace csfj {
+
+namespace {
+
+bool isDigit(char ch) {
+  return ch >= '0' && ch <= '9';
+}
+
+int hexValue(char ch) {
+  if (ch >= '0' && ch <= '9') {
+    return ch - '0';
+  }
+  if (ch >= 'a' && ch <= 'f') {
+    return ch - 'a' + 10;
+  }
+  if (ch >= 'A' && ch <= 'F') {
+    return ch - 'A' + 10;
+  }
+  return -1;
+}
+
+// Reads the four hex digits of a \u escape starting at `text[position]`.
+bool readHex4(std::string_view text, size_t position, std::uint32_t& value) {
+  if (position + 4U > text.size()) {
+    return false;
+  }
+  value = 0U;
+  for (size_t index = position; index < position + 4U; ++index) {
+    const int digit = hexValue(text[index]);
+    if (digit < 0) {
+      return false;
+    }
+    value = (value << 4) | static_cast<std::uint32_t>(digit);
+  }
+  return true;
+}
+
+void appendUtf8(std::string& out, std::uint32_t codePoint) {
+  if (codePoint < 0x80U) {
+    out.push_back(static_cast<char>(codePoint));
+  } else if (codePoint < 0x800U) {
+    out.push_back(static_cast<char>(0xC0U | (codePoint >> 6)));
+    out.push_back(static_cast<char>(0x80U | (codePoint & 0x3FU)));
+  } else if (codePoint < 0x10000U) {
+    out.push_back(static_cast<char>(0xE0U | (codePoint >> 12)));
+    out.push_back(static_cast<char>(0x80U | ((codePoint >> 6) & 0x3FU)));
+    out.push_back(static_cast<char>(0x80U | (codePoint & 0x3FU)));
+  } else {
+    out.push_back(static_cast<char>(0xF0U | (codePoint >> 18)));
+    out.push_back(static_cast<char>(0x80U | ((codePoint >> 12) & 0x3FU)));
+    out.push_back(static_cast<char>(0x80U | ((codePoint >> 6) & 0x3FU)));
+    out.push_back(static_cast<char>(0x80U | (codePoint & 0x3FU)));
+  }
+}
+
+}  // namespace
+
+JsonType JsonReader::peek() {
+  if (failed_) {
+    return JsonType::kInvalid;
+  }
+  skipWhitespace();
+  if (position_ >= text_.size()) {
+    return JsonType::kInvalid;
+  }
+  const char ch = text_[position_];
+  switch (ch) {
+    case '{':
+      return JsonType::kObject;
+    case '[':
+      return JsonType::kArray;
+    case '"':
+      return JsonType::kString;
+    case 't':
+    case 'f':
+      return JsonType::kBoolean;
+    case 'n':
+      return JsonType::kNull;
+    default:
+      return ch == '-' || isDigit(ch) ? JsonType::kNumber : JsonType::kInvalid;
+  }
+}
+
+bool JsonReader::beginObject() {
+  return open('{');
+}
+
+bool JsonReader::nextMember(std::string_view& key) {
+  if (!nextInContainer('}') || !readString(key)) {
+    return false;
+  }
+  skipWhitespace();
+  if (position_ >= text_.size() || text_[position_] != ':') {
+    return fail();
+  }
+  ++position_;
+  return true;
+}
+
+bool JsonReader::beginArray() {
+  return open('[');
+}
+
+bool JsonReader::nextElement() {
+  return nextInContainer(']');
+}
+
+bool JsonReader::readString(std::string_view& value) {
+  if (failed_) {
+    return false;
+  }
+  skipWhitespace();
+  if (position_ >= text_.size() || text_[position_] != '"') {
+    return fail();
+  }
+  const size_t start = position_ + 1U;
+  size_t cursor = start;
+  // The common case: no escapes, so the value is a view into the text.
+  for (; cursor < text_.size(); ++cursor) {
+    const char ch = text_[cursor];
+    if (ch == '"') {
+      value = text_.substr(start, cursor - start);
+      position_ = cursor + 1U;
+      return true;
+    }
+    if (ch == '\\') {
+      break;
+    }
+    if (static_cast<unsigned char>(ch) < 0x20U) {
+      return fail();
+    }
+  }
+
+  scratch_.assign(text_.data() + start, cursor - start);
+  while (cursor < text_.size()) {
+    const char ch = text_[cursor];
+    if (ch == '"') {
+      value = scratch_;
+      position_ = cursor + 1U;
+      return true;
+    }
+    if (static_cast<unsigned char>(ch) < 0x20U) {
+      return fail();
+    }
+    if (ch != '\\') {
+      scratch_.push_back(ch);
+      ++cursor;
+      continue;
+    }
+    if (cursor + 1U >= text_.size()) {
+      return fail();
+    }
+    const char escape = text_[cursor + 1U];
+    cursor += 2U;
+    switch (escape) {
+      case '"':
+      case '\\':
+      case '/':
+        scratch_.push_back(escape);
+        break;
+      case 'b':
+        scratch_.push_back('\b');
+        break;
+      case 'f':
+        scratch_.push_back('\f');
+        break;
+      case 'n':
+        scratch_.push_back('\n');
+        break;
+      case 'r':
+        scratch_.push_back('\r');
+        break;
+      case 't':
+        scratch_.push_back('\t');
+        break;
+      case 'u': {
+        std::uint32_t codePoint = 0U;
+        if (!readHex4(text_, cursor, codePoint)) {
+          return fail();
+        }
+        cursor += 4U;
+        if (codePoint >= 0xDC00U && codePoint <= 0xDFFFU) {
+          return fail();
+        }
+        if (codePoint >= 0xD800U && codePoint <= 0xDBFFU) {
+          std::uint32_t low = 0U;
+          if (cursor + 2U > text_.size() || text_[cursor] != '\\' || text_[cursor + 1U] != 'u' ||
+              !readHex4(text_, cursor + 2U, low) || low < 0xDC00U || low > 0xDFFFU) {
+            return fail();
+          }
+          cursor += 6U;
+          codePoint = 0x10000U + ((codePoint - 0xD800U) << 10) + (low - 0xDC00U);
+        }
+        appendUtf8(scratch_, codePoint);
+        break;
+      }
+      default:
+        return fail();
+    }
+  }
+  return fail();
+}
+
+bool JsonReader::readNumber(std::string_view& text) {
+  if (failed_) {
+    return false;
+  }
+  skipWhitespace();
+  size_t cursor = position_;
+  const auto digitsFrom = [this, &cursor] {
+    const size_t first = cursor;
+    while (cursor < text_.size() && isDigit(text_[cursor])) {
+      ++cursor;
+    }
+    return cursor > first;
+  };
+
+  if (cursor < text_.size() && text_[cursor] == '-') {
+    ++cursor;
+  }
+  if (cursor < text_.size() && text_[cursor] == '0') {
+    ++cursor;
+  } else if (!digitsFrom()) {
+    return fail();
+  }
+  if (cursor < text_.size() && text_[cursor] == '.') {
+    ++cursor;
+    if (!digitsFrom()) {
+      return fail();
+    }
+  }
+  if (cursor < text_.size() && (text_[cursor] == 'e' || text_[cursor] == 'E')) {
+    ++cursor;
+    if (cursor < text_.size() && (text_[cursor] == '+' || text_[cursor] == '-')) {
+      ++cursor;
+    }
+    if (!digitsFrom()) {
+      return fail();
+    }
+  }
+  text = text_.substr(position_, cursor - position_);
+  position_ = cursor;
+  return true;
+}
+
+bool JsonReader::readBoolean(bool& value) {
+  if (peek() != JsonType::kBoolean) {
+    return fail();
+  }
+  value = text_[position_] == 't';
+  return literal(value ? "true" : "false");
+}
+
+bool JsonReader::readNull() {
+  return literal("null");
+}
+
+bool JsonReader::skipValue() {
+  std::string_view ignored;
+  bool flag = false;
+  switch (peek()) {
+    case JsonType::kObject:
+      beginObject();
+      while (nextMember(ignored)) {
+        skipValue();
+      }
+      return !failed_;
+    case JsonType::kArray:
+      beginArray();
+      while (nextElement()) {
+        skipValue();
+      }
+      return !failed_;
+    case JsonType::kString:
+      return readString(ignored);
+    case JsonType::kNumber:
+      return readNumber(ignored);
+    case JsonType::kBoolean:
+      return readBoolean(flag);
+    case JsonType::kNull:
+      return readNull();
+    case JsonType::kInvalid:
+      break;
+  }
+  return fail();
+}
+
+bool JsonReader::atEnd() {
+  skipWhitespace();
+  return !failed_ && depth_ == 0U && position_ == text_.size();
+}
+
+void JsonReader::skipWhitespace() {
+  while (position_ < text_.size()) {
+    const char ch = text_[position_];
+    if (ch != ' ' && ch != '\t' && ch != '\n' && ch != '\r') {
+      return;
+    }
+    ++position_;
+  }
+}
+
+bool JsonReader::fail() {
+  failed_ = true;
+  return false;
+}
+
+bool JsonReader::open(char bracket) {
+  if (failed_) {
+    return false;
+  }
+  skipWhitespace();
+  if (position_ >= text_.size() || text_[position_] != bracket || depth_ == kMaxDepth) {
+    return fail();
+  }
+  ++position_;
+  awaitingFirst_ |= std::uint64_t{1} << depth_;
+  ++depth_;
+  return true;
+}
+
+bool JsonReader::nextInContainer(char closing) {
+  if (failed_ || depth_ == 0U) {
+    return fail();
+  }
+  skipWhitespace();
+  if (position_ >= text_.size()) {
+    return fail();
+  }
+  const std::uint64_t first = std::uint64_t{1} << (depth_ - 1U);
+  const bool awaitingFirst = (awaitingFirst_ & first) != 0U;
+  awaitingFirst_ &= ~first;
+  if (text_[position_] == closing) {
+    ++position_;
+    --depth_;
+    return false;
+  }
+  if (!awaitingFirst) {
+    if (text_[position_] != ',') {
+      return fail();
+    }
+    ++position_;
+  }
+  return true;
+}
+
+bool JsonReader::literal(std::string_view word) {
+  if (failed_) {
+    return false;
+  }
+  skipWhitespace();
+  if (text_.substr(position_, word.size()) != word) {
+    return fail();
+  }
+  position_ += word.size();
+  return true;
+}
+
+}  // namespace csfj
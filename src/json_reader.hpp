@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace csfj {
+
+enum class JsonType {
+  kObject,
+  kArray,
+  kString,
+  kNumber,
+  kBoolean,
+  kNull,
+  kInvalid,
+};
+
+// A pull parser over one JSON text: the caller walks objects and arrays and
+// reads the values it expects, so nothing is built that is not used. Strings
+// without escapes come back as views into the text; escaped ones are decoded
+// into a scratch buffer the reader reuses, so a view returned by readString()
+// or nextMember() is valid until the next call that reads a string. After any
+// error every call fails and failed() is true.
+class JsonReader {
+public:
+  explicit JsonReader(std::string_view text) : text_(text) {}
+
+  // Type of the next value, without consuming it.
+  JsonType peek();
+
+  bool beginObject();
+  // Reads the key of the next member of the innermost open object, leaving the
+  // reader at its value. Returns false at the closing brace, which it consumes,
+  // and on errors.
+  bool nextMember(std::string_view& key);
+
+  bool beginArray();
+  // Moves to the next element of the innermost open array. Returns false at the
+  // closing bracket, which it consumes, and on errors.
+  bool nextElement();
+
+  bool readString(std::string_view& value);
+  // The number exactly as written, e.g. "12.50"; callers parse it themselves.
+  bool readNumber(std::string_view& text);
+  bool readBoolean(bool& value);
+  bool readNull();
+  bool skipValue();
+
+  // Whether only whitespace is left after the top-level value.
+  bool atEnd();
+
+  bool failed() const {
+    return failed_;
+  }
+
+private:
+  static constexpr size_t kMaxDepth = 64U;
+
+  void skipWhitespace();
+  bool fail();
+  bool open(char bracket);
+  bool nextInContainer(char closing);
+  bool literal(std::string_view word);
+
+  std::string_view text_;
+  size_t position_ = 0U;
+  size_t depth_ = 0U;
+  // Bit n is set while the container at depth n + 1 has not produced any member
+  // or element yet, so the next one must not be preceded by a comma.
+  std::uint64_t awaitingFirst_ = 0U;
+  bool failed_ = false;
+  std::string scratch_;
+};
+
+}  // namespace csfj
@@ -1,17 +1,26 @@
 #include <algorithm>
-#include <cctype>
+#include <atomic>
+#include <charconv>
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
 #include <chrono>
 #include <cstring>
 #include <exception>
 #include <filesystem>
 #include <fstream>
-#include <iomanip>
 #include <iostream>
-#include <mutex>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
+#include <optional>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #ifdef _WIN32
@@ -21,199 +30,257 @@
   #pragma comment(lib, "Ws2_32.lib")
 #else
   #include <arpa/inet.h>
+  #include <cerrno>
+  #include <fcntl.h>
+  #include <netdb.h>
   #include <netinet/in.h>
+  #include <netinet/tcp.h>
+  #include <poll.h>
   #include <sys/socket.h>
+  #include <sys/uio.h>
   #include <unistd.h>
+  #ifdef __linux__
+    #include <pthread.h>
+    #include <sched.h>
+    #include <sys/epoll.h>
+  #endif
   typedef int SOCKET;
   const int INVALID_SOCKET = -1;
   const int SOCKET_ERROR = -1;
 #endif
 
+#include "csv_import.hpp"
+#include "directory_watcher.hpp"
+#include "http_parser.hpp"
+#include "item_index.hpp"
+#include "item_journal.hpp"
+#include "item_json.hpp"
+#include "item_store.hpp"
+#include "metrics.hpp"
+#include "money.hpp"
+#include "request_arena.hpp"
+#include "response_cache.hpp"
+#include "response_writer.hpp"
+#include "sheet_registry.hpp"
+#include "static_files.hpp"
+#include "template_engine.hpp"
+#include "text_format.hpp"
+
+#ifdef CSFJ_EMBEDDED_ASSETS
+  #include "embedded_assets.hpp"
+#endif
+
 namespace {
 
 constexpr unsigned short kServerPort = 8080;
+constexpr const char* kDefaultBindAddress = "0.0.0.0";
 constexpr int kSocketBufferSize = 4096;
+constexpr int kDefaultKeepAliveTimeoutSeconds = 5;
+constexpr int kDefaultHeaderTimeoutSeconds = 10;
+constexpr int kDefaultBodyTimeoutSeconds = 60;
+constexpr int kDefaultSendTimeoutSeconds = 30;
+constexpr int kDefaultMaxRequestsPerConnection = 100;
+constexpr int kDefaultMaxConnections = 10000;
+// How long in-flight requests get to finish after SIGTERM or Ctrl+C.
+constexpr int kDefaultDrainTimeoutSeconds = 10;
+// Deadlines are checked this often, so they fire up to this late.
+constexpr int kIdleSweepIntervalMs = 1000;
+// Once this much output waits for a client, its pipelined requests are neither
+// answered nor read until the client catches up.
+constexpr size_t kMaxOutputBacklog = 1024U * 1024U;
+// Input read past the end of the request being parsed, for pipelined requests.
+constexpr size_t kInputReadAhead = 64U * 1024U;
+constexpr size_t kBodyChunkSize = 16U * 1024U;
+constexpr size_t kMaxGatherPieces = 64U;
+constexpr size_t kDefaultPageSize = 100U;
+constexpr size_t kMaxPageSize = 1000U;
+// Per sheet.
+constexpr size_t kResponseCacheEntries = 64U;
+// Larger CSV exports are streamed without keeping a copy for the cache, so
+// each one in flight only holds a chunk in memory.
+constexpr size_t kMaxCachedExportBytes = 4U * 1024U * 1024U;
+constexpr int kDefaultMaxSheets = 256;
+constexpr const char* kCsvCacheKey = "csv";
+constexpr std::string_view kApiItemsPath = "/api/items";
+constexpr const char* kDefaultDataDirectory = "data";
+constexpr std::uintmax_t kCompactionThresholdBytes = 4U * 1024U * 1024U;
+// Without a DurabilityWakeup pipe (on Windows), how often a worker rechecks
+// the journals while responses wait for an fsync.
+constexpr int kDurabilityPollMs = 1;
+
+using csfj::Item;
+
+csfj::SheetRegistry* g_sheets = nullptr;
+// Stands in for named sheets that do not exist yet when they are only read,
+// so a typo in a URL shows an empty sheet without creating one. Never written.
+csfj::Sheet g_blankSheet("", {}, 0U, kResponseCacheEntries);
+csfj::MetricsRegistry g_metrics;
+// Connections held by all workers, checked against --max-connections.
+std::atomic<int> g_openConnections{0};
+// Set by SIGTERM or SIGINT; workers then stop accepting and drain.
+std::atomic<bool> g_stopRequested{false};
+static_assert(std::atomic<bool>::is_always_lock_free, "g_stopRequested is written from a signal handler");
+#ifndef _WIN32
+// Written by the signal handler so that workers blocked in their poller wake
+// up at once. Without it (on Windows) they notice within kIdleSweepIntervalMs.
+int g_stopPipe[2] = {-1, -1};
+#endif
 
-struct Item {
-  std::string name;
-  int quantity;
-  double unitCost;
-  
-  double getTotalCost() const {
-    return quantity * unitCost;
+// A second signal exits without waiting for the drain.
+void requestStop(int) {
+  if (g_stopRequested.exchange(true, std::memory_order_relaxed)) {
+    std::_Exit(1);
   }
-};
-
-std::vector<Item> g_items;
-std::mutex g_itemsMutex;
+#ifndef _WIN32
+  const int savedErrno = errno;
+  const char byte = 0;
+  [[maybe_unused]] const auto written = write(g_stopPipe[1], &byte, 1);
+  errno = savedErrno;
+#endif
+}
 
 #ifdef _WIN32
+constexpr int kSendFlags = 0;
+
 void closeSocket(SOCKET socket) {
   shutdown(socket, SD_BOTH);
   closesocket(socket);
 }
-#else
-void closeSocket(SOCKET socket) {
-  shutdown(socket, SHUT_RDWR);
-  close(socket);
-}
-#endif
 
-std::string trim(const std::string& input) {
-  const auto first = std::find_if_not(input.begin(), input.end(), [](unsigned char ch) { return std::isspace(ch); });
-  const auto last = std::find_if_not(input.rbegin(), input.rend(), [](unsigned char ch) { return std::isspace(ch); }).base();
-  if (first >= last) {
-    return {};
-  }
-  return std::string(first, last);
+bool setNonBlocking(SOCKET socket) {
+  u_long enabled = 1;
+  return ioctlsocket(socket, FIONBIO, &enabled) == 0;
 }
 
-std::string toLower(std::string value) {
-  std::transform(value.begin(), value.end(), value.begin(), [](unsigned char ch) { return static_cast<char>(std::tolower(ch)); });
-  return value;
+bool lastSocketErrorWouldBlock() {
+  return WSAGetLastError() == WSAEWOULDBLOCK;
 }
 
-std::unordered_map<std::string, std::string> parseHeaders(const std::string& headerBlock) {
-  std::unordered_map<std::string, std::string> headers;
-  size_t cursor = 0U;
-  while (cursor < headerBlock.size()) {
-    const auto lineEnd = headerBlock.find("\r\n", cursor);
-    const auto length = (lineEnd == std::string::npos) ? headerBlock.size() - cursor : lineEnd - cursor;
-    const auto line = headerBlock.substr(cursor, length);
-    cursor = (lineEnd == std::string::npos) ? headerBlock.size() : lineEnd + 2;
-    if (line.empty()) {
-      continue;
-    }
-    const auto colonPos = line.find(':');
-    if (colonPos == std::string::npos) {
-      continue;
-    }
-    const auto key = toLower(trim(line.substr(0, colonPos)));
-    const auto value = trim(line.substr(colonPos + 1));
-    headers[key] = value;
+// Sends `count` (at most kMaxGatherPieces) buffers in order with one call.
+// Returns the bytes sent or -1.
+long sendGather(SOCKET socket, const std::string_view* parts, size_t count) {
+  WSABUF buffers[kMaxGatherPieces];
+  for (size_t index = 0; index < count; ++index) {
+    buffers[index].buf = const_cast<char*>(parts[index].data());
+    buffers[index].len = static_cast<ULONG>(parts[index].size());
   }
-  return headers;
-}
-
-std::string urlDecode(const std::string& value) {
-  std::string result;
-  result.reserve(value.size());
-  for (size_t index = 0; index < value.size(); ++index) {
-    const char current = value[index];
-    if (current == '+') {
-      result.push_back(' ');
-    } else if (current == '%' && index + 2 < value.size()) {
-      const auto hex = value.substr(index + 1, 2);
-      try {
-        const auto decoded = static_cast<char>(std::stoi(hex, nullptr, 16));
-        result.push_back(decoded);
-        index += 2;
-      } catch (const std::exception&) {
-        result.push_back(current);
-      }
-    } else {
-      result.push_back(current);
-    }
+  DWORD bytesSent = 0;
+  if (WSASend(socket, buffers, static_cast<DWORD>(count), &bytesSent, 0, nullptr, nullptr) == SOCKET_ERROR) {
+    return -1;
   }
-  return result;
+  return static_cast<long>(bytesSent);
 }
+#else
+constexpr int kSendFlags = MSG_NOSIGNAL;
 
-std::unordered_map<std::string, std::string> parseFormBody(const std::string& body) {
-  std::unordered_map<std::string, std::string> formValues;
-  size_t start = 0U;
-  while (start <= body.size()) {
-    const auto amp = body.find('&', start);
-    const auto token = body.substr(start, (amp == std::string::npos) ? std::string::npos : amp - start);
-    const auto equal = token.find('=');
-    if (equal != std::string::npos) {
-      const auto key = urlDecode(token.substr(0, equal));
-      const auto value = urlDecode(token.substr(equal + 1));
-      formValues[key] = value;
-    }
-    if (amp == std::string::npos) {
-      break;
-    }
-    start = amp + 1;
-  }
-  return formValues;
+void closeSocket(SOCKET socket) {
+  shutdown(socket, SHUT_RDWR);
+  close(socket);
 }
 
-std::string escapeHtml(const std::string& value) {
-  std::string sanitized;
-  sanitized.reserve(value.size());
-  for (const char ch : value) {
-    switch (ch) {
-      case '&':
-        sanitized += "&amp;";
-        break;
-      case '<':
-        sanitized += "&lt;";
-        break;
-      case '>':
-        sanitized += "&gt;";
-        break;
-      case '"':
-        sanitized += "&quot;";
-        break;
-      case '\'':
-        sanitized += "&#39;";
-        break;
-      default:
-        sanitized.push_back(ch);
-        break;
-    }
-  }
-  return sanitized;
+bool setNonBlocking(SOCKET socket) {
+  const int flags = fcntl(socket, F_GETFL, 0);
+  return flags != -1 && fcntl(socket, F_SETFL, flags | O_NONBLOCK) != -1;
 }
 
-std::string formatCurrency(double value) {
-  std::ostringstream out;
-  out << std::fixed << std::setprecision(2) << value;
-  return out.str();
+bool lastSocketErrorWouldBlock() {
+  return errno == EAGAIN || errno == EWOULDBLOCK;
 }
 
-std::string formatCurrencyWithGrouping(double value) {
-  std::ostringstream out;
-  out << std::fixed << std::setprecision(2) << value;
-  std::string number = out.str();
-  const auto dotPos = number.find('.');
-  std::string integerPart = dotPos == std::string::npos ? number : number.substr(0, dotPos);
-  const std::string decimalPart = dotPos == std::string::npos ? std::string{} : number.substr(dotPos);
-
-  std::vector<std::string> groups;
-  for (std::ptrdiff_t end = static_cast<std::ptrdiff_t>(integerPart.size()); end > 0; end -= 3) {
-    const std::ptrdiff_t start = std::max<std::ptrdiff_t>(0, end - 3);
-    groups.emplace_back(integerPart.substr(static_cast<size_t>(start), static_cast<size_t>(end - start)));
+// Sends `count` (at most kMaxGatherPieces) buffers in order with one call.
+// Returns the bytes sent or -1.
+long sendGather(SOCKET socket, const std::string_view* parts, size_t count) {
+  iovec buffers[kMaxGatherPieces];
+  for (size_t index = 0; index < count; ++index) {
+    buffers[index].iov_base = const_cast<char*>(parts[index].data());
+    buffers[index].iov_len = parts[index].size();
   }
-  std::reverse(groups.begin(), groups.end());
+  msghdr message{};
+  message.msg_iov = buffers;
+  message.msg_iovlen = count;
+  return static_cast<long>(sendmsg(socket, &message, kSendFlags));
+}
+#endif
 
-  if (groups.empty()) {
-    groups.emplace_back("0");
-  }
+// Sets an int-valued socket option; Winsock takes the value as a char pointer.
+bool setSocketOption(SOCKET socket, int level, int name, int value) {
+  return setsockopt(socket, level, name, reinterpret_cast<const char*>(&value), sizeof(value)) == 0;
+}
 
-  std::string grouped = groups[0];
-  for (size_t index = 1; index < groups.size(); ++index) {
-    grouped += (index == 1 && groups.size() > 2) ? '\'' : ',';
-    grouped += groups[index];
-  }
+// Produces a response body piece by piece while the socket drains, for bodies
+// that are too large or too slow to build up front.
+class BodyStream {
+public:
+  virtual ~BodyStream() = default;
 
-  return grouped + decimalPart;
-}
+  // Appends roughly kBodyChunkSize bytes of body to `out`. Returns false once
+  // the body is complete.
+  virtual bool next(std::string& out) = 0;
+};
 
-std::string normalizeCostInput(const std::string& raw) {
-  std::string normalized;
-  normalized.reserve(raw.size());
-  for (char ch : raw) {
-    if (ch == '\'' || ch == ',' || std::isspace(static_cast<unsigned char>(ch))) {
-      continue;
-    }
-    normalized.push_back(ch);
-  }
-  return normalized;
-}
+// A response handed to the output queue but not yet fully written, with the
+// sample it will be recorded as. Its bytes are those the queue counts between
+// `startOffset` and `endOffset`; a streamed body's end is only known once the
+// stream finishes.
+struct InFlightResponse {
+  static constexpr std::uint64_t kStreaming = UINT64_MAX;
+
+  csfj::RequestSample sample;
+  std::chrono::steady_clock::time_point started;
+  std::chrono::steady_clock::time_point queued;
+  std::uint64_t startOffset = 0U;
+  std::uint64_t endOffset = 0U;
+  // Formatting a streamed body happens while it is being sent.
+  std::uint64_t streamNanos = 0U;
+};
+
+// Per-socket state owned by a reactor worker. Requests are accumulated in
+// `input` as bytes arrive (several pipelined requests may be buffered at once,
+// the unanswered ones start at `inputStart`) and responses are queued in
+// `output` until the socket accepts them. `request` holds views into `input`
+// for the request currently being parsed.
+struct Connection {
+  SOCKET socket = INVALID_SOCKET;
+  std::string input;
+  size_t inputStart = 0U;
+  csfj::HttpRequestParser parser;
+  csfj::HttpRequest request;
+  csfj::OutputQueue output;
+  // Temporaries of the request being handled; reset once it is answered.
+  csfj::RequestArena arena;
+  std::unique_ptr<BodyStream> bodyStream;
+  // Reads a CSV import while its body arrives; `importBodyFed` counts the body
+  // bytes already handed to it.
+  std::unique_ptr<csfj::CsvItemReader> importReader;
+  size_t importBodyFed = 0U;
+  bool chunkedBody = false;
+  bool keepAlive = false;
+  int requestsServed = 0;
+  bool closeAfterWrite = false;
+  bool peerClosed = false;
+  // The socket may hold bytes that were not read yet, because reading was held
+  // back; they are read without waiting for another readiness event.
+  bool unreadInput = false;
+  // The last write made by this connection, as the sheet written and the
+  // sequence number in its journal; responses are held back until it is
+  // durable.
+  const csfj::Sheet* awaitingSheet = nullptr;
+  std::uint64_t awaitingSequence = 0U;
+  // When bytes were last received or sent, and when the headers of the request
+  // being parsed were complete; the idle and body deadlines count from them.
+  std::chrono::steady_clock::time_point lastActivity;
+  std::chrono::steady_clock::time_point headersReceived;
+  // Metrics: when the first bytes of the current request were parsed, the
+  // parse time spent on it so far, the status of the last response queued and
+  // the responses in `output`, oldest first.
+  std::chrono::steady_clock::time_point requestStarted;
+  std::uint64_t parseNanos = 0U;
+  int responseStatus = 0;
+  std::vector<InFlightResponse> inFlight;
+};
 
-std::string loadTemplateFile(const std::string& filename) {
-  const std::filesystem::path templatePath = std::filesystem::path("templates") / filename;
+std::string loadTemplateFile(const std::filesystem::path& directory, const std::string& filename) {
+  const std::filesystem::path templatePath = directory / "templates" / filename;
   std::ifstream file(templatePath, std::ios::binary);
   if (!file) {
     throw std::runtime_error("No se pudo abrir la plantilla: " + templatePath.string());
@@ -223,159 +290,520 @@ std::string loadTemplateFile(const std::string& filename) {
   return content.str();
 }
 
-const std::string& indexTemplate() {
-  static const std::string templateContent = loadTemplateFile("index.html");
-  return templateContent;
+// Slot numbers follow the order of the names passed to CompiledTemplate.
+enum IndexSlot : size_t {
+  kItemsRowsSlot,
+  kTotalCostSlot,
+  kItemCountSlot,
+  kPageOffsetSlot,
+  kPaginationSlot,
+  kIndexSlotCount
+};
+enum EditSlot : size_t { kItemIndexSlot, kItemNameSlot, kItemQuantitySlot, kItemCostSlot, kEditSlotCount };
+
+// `source` is a template read from disk (std::string) or an EmbeddedTemplate.
+template <typename Source>
+csfj::CompiledTemplate compileIndexTemplate(Source&& source) {
+  return csfj::CompiledTemplate(std::forward<Source>(source),
+                                {"items_rows", "total_cost", "item_count", "page_offset", "pagination"});
+}
+
+template <typename Source>
+csfj::CompiledTemplate compileEditTemplate(Source&& source) {
+  return csfj::CompiledTemplate(std::forward<Source>(source), {"item_index", "item_name", "item_quantity", "item_cost"});
+}
+
+// The templates and static files the server renders and serves. Normally the
+// copies compiled into the binary; with --dev-assets they are read from disk
+// and every change there publishes a new set with the next generation. A
+// replaced set is never freed, since cached pages and queued responses point
+// into it; it only happens while developing.
+struct AssetSet {
+  std::uint64_t generation;
+  csfj::CompiledTemplate indexTemplate;
+  csfj::CompiledTemplate editTemplate;
+  csfj::StaticFileTable staticFiles;
+};
+
+std::atomic<const AssetSet*> g_assets{nullptr};
+
+const AssetSet& currentAssets() {
+  return *g_assets.load(std::memory_order_acquire);
+}
+
+// Reads `directory`/templates and `directory`/static.
+std::unique_ptr<AssetSet> loadAssets(const std::filesystem::path& directory, std::uint64_t generation) {
+  return std::unique_ptr<AssetSet>(new AssetSet{generation,
+                                                compileIndexTemplate(loadTemplateFile(directory, "index.html")),
+                                                compileEditTemplate(loadTemplateFile(directory, "edit.html")),
+                                                csfj::StaticFileTable::load(directory / "static", "/static/")});
+}
+
+#ifdef CSFJ_EMBEDDED_ASSETS
+const csfj::EmbeddedTemplate& embeddedTemplate(std::string_view name) {
+  const csfj::EmbeddedTemplate* embedded = csfj::embedded::findTemplate(name);
+  if (embedded == nullptr) {
+    throw std::runtime_error("La plantilla " + std::string(name) + " no está incluida en el binario");
+  }
+  return *embedded;
 }
 
-const std::string& editTemplate() {
-  static const std::string templateContent = loadTemplateFile("edit.html");
-  return templateContent;
+std::unique_ptr<AssetSet> embeddedAssets() {
+  return std::unique_ptr<AssetSet>(new AssetSet{
+      0U, compileIndexTemplate(embeddedTemplate("index.html")), compileEditTemplate(embeddedTemplate("edit.html")),
+      csfj::StaticFileTable::fromEmbedded(csfj::embedded::kStaticFiles, csfj::embedded::kStaticFileCount, "/static/")});
+}
+#else
+// Built without the embedding step (e.g. compiling src/*.cpp by hand): read
+// the assets from the working directory.
+std::unique_ptr<AssetSet> embeddedAssets() {
+  return loadAssets(".", 0U);
 }
+#endif
 
-void replaceAll(std::string& target, const std::string& placeholder, const std::string& value) {
-  size_t position = 0U;
-  while ((position = target.find(placeholder, position)) != std::string::npos) {
-    target.replace(position, placeholder.size(), value);
-    position += value.size();
+// Called by the asset watcher after files change under `directory`. A set
+// that fails to load (a template saved half-way, say) leaves the current one
+// in place until the next change.
+void reloadAssets(const std::filesystem::path& directory) {
+  try {
+    std::unique_ptr<AssetSet> next = loadAssets(directory, currentAssets().generation + 1U);
+    g_assets.store(next.release(), std::memory_order_release);
+    std::cout << "Plantillas y archivos estáticos recargados desde " << directory.string() << std::endl;
+  } catch (const std::exception& ex) {
+    std::cerr << "No se pudieron recargar las plantillas: " << ex.what() << std::endl;
   }
 }
 
 std::string renderTemplateError(const std::string& message) {
-  return std::string{"<html><body><h1>Error interno</h1><p>"} + escapeHtml(message) + "</p></body></html>";
+  return std::string{"<html><body><h1>Error interno</h1><p>"} + csfj::escapeHtml(message) + "</p></body></html>";
 }
 
-std::string escapeCsv(const std::string& value) {
-  std::ostringstream out;
-  out << '"';
-  for (const char ch : value) {
-    if (ch == '"') {
-      out << "\"\"";
-    } else {
-      out << ch;
+constexpr size_t kItemRowSizeHint = 400U;
+
+void appendItemRow(std::string& out, size_t index, const Item& item) {
+  out += "      <tr><td>";
+  csfj::appendInteger(out, static_cast<long long>(index + 1));
+  out += "</td><td>";
+  csfj::appendEscapedHtml(out, item.name);
+  out += "</td><td>";
+  csfj::appendInteger(out, item.quantity);
+  out += "</td><td>";
+  csfj::appendMoneyWithGrouping(out, item.unitCost);
+  out += "</td><td>";
+  csfj::appendMoneyWithGrouping(out, item.getTotalCost());
+  out += "</td><td class=\"actions\"><form class=\"action-form\" method=\"GET\" action=\"edit\">"
+         "<input type=\"hidden\" name=\"index\" value=\"";
+  csfj::appendInteger(out, static_cast<long long>(index));
+  out += "\"><button class=\"action-button\" type=\"submit\">Editar</button></form></td></tr>\n";
+}
+
+// A window of the item list. Items are never removed, so an offset keeps
+// pointing at the same item across writes and doubles as a stable cursor.
+struct PageWindow {
+  size_t offset = 0U;
+  size_t limit = kDefaultPageSize;
+};
+
+// Reads `offset` and `limit` from a query string. Returns false when either is
+// present but not a non-negative integer; `limit` is clamped to kMaxPageSize.
+bool parsePageWindow(std::string_view query, PageWindow& window, std::pmr::memory_resource* resource) {
+  const csfj::FormFields values(query, resource);
+  const auto readNumber = [&values](const char* key, size_t& out) {
+    const auto it = values.find(key);
+    if (it == values.end()) {
+      return true;
     }
+    const std::string_view text = it->second;
+    const auto result = std::from_chars(text.data(), text.data() + text.size(), out);
+    return !text.empty() && result.ec == std::errc() && result.ptr == text.data() + text.size();
+  };
+  if (!readNumber("offset", window.offset) || !readNumber("limit", window.limit)) {
+    return false;
   }
-  out << '"';
-  return out.str();
+  window.limit = std::min(std::max<size_t>(window.limit, 1U), kMaxPageSize);
+  return true;
 }
 
-std::string loadStaticFile(const std::string& filename) {
-  const std::filesystem::path staticPath = std::filesystem::path("static") / filename;
-  std::ifstream file(staticPath, std::ios::binary);
-  if (!file) {
-    throw std::runtime_error("No se pudo abrir el activo estático: " + staticPath.string());
+// Relative, so the link stays on whichever sheet the page belongs to.
+void appendPageLink(std::string& out, size_t offset, size_t limit, std::string_view label) {
+  out += "<a href=\"?offset=";
+  csfj::appendInteger(out, static_cast<long long>(offset));
+  out += "&amp;limit=";
+  csfj::appendInteger(out, static_cast<long long>(limit));
+  out += "\">";
+  out += label;
+  out += "</a>";
+}
+
+// Previous/next links and the range shown, for browsers without JavaScript.
+void appendPagination(std::string& out, size_t itemCount, const PageWindow& window, size_t shown) {
+  out += "<span>";
+  if (window.offset > 0U) {
+    appendPageLink(out, window.offset > window.limit ? window.offset - window.limit : 0U, window.limit,
+                   "&laquo; Anterior");
   }
-  std::ostringstream content;
-  content << file.rdbuf();
-  return content.str();
+  out += "</span><span>";
+  if (shown == 0U) {
+    out += "Sin items en esta página (";
+    csfj::appendInteger(out, static_cast<long long>(itemCount));
+    out += " en total)";
+  } else {
+    out += "Items ";
+    csfj::appendInteger(out, static_cast<long long>(window.offset + 1U));
+    out += "&ndash;";
+    csfj::appendInteger(out, static_cast<long long>(window.offset + shown));
+    out += " de ";
+    csfj::appendInteger(out, static_cast<long long>(itemCount));
+  }
+  out += "</span><span>";
+  if (window.offset + shown < itemCount) {
+    appendPageLink(out, window.offset + shown, window.limit, "Siguiente &raquo;");
+  }
+  out += "</span>";
 }
 
-const std::string& stylesAsset() {
-  static const std::string content = loadStaticFile("styles.css");
-  return content;
+// Renders only the rows in `window`; the footer total still covers the whole
+// sheet because it comes from the snapshot's aggregates.
+csfj::SegmentedText renderItemsTable(const csfj::CompiledTemplate& compiled,
+                                      const csfj::ItemSnapshot& items,
+                                      const PageWindow& window) {
+  const size_t first = std::min(window.offset, items.size());
+  const size_t last = std::min(items.size(), first + window.limit);
+  const auto writeRows = [&items, first, last](std::string& out) {
+    for (size_t index = first; index < last; ++index) {
+      appendItemRow(out, index, items[index]);
+    }
+  };
+  const auto writePagination = [&items, &window, first, last](std::string& out) {
+    appendPagination(out, items.size(), window, last - first);
+  };
+  csfj::SegmentedText page;
+  csfj::SlotValue values[kIndexSlotCount];
+  values[kItemsRowsSlot] = csfj::writerSlot(writeRows);
+  values[kTotalCostSlot] = csfj::groupedCurrencySlot(items.summary().total);
+  values[kItemCountSlot] = csfj::integerSlot(static_cast<long long>(items.size()));
+  values[kPageOffsetSlot] = csfj::integerSlot(static_cast<long long>(first));
+  values[kPaginationSlot] = csfj::writerSlot(writePagination);
+  compiled.renderSegments(page, values, kIndexSlotCount, (last - first) * kItemRowSizeHint);
+  return page;
 }
 
-const std::string& formatterAsset() {
-  static const std::string content = loadStaticFile("formatter.js");
-  return content;
+// Rows for the virtual-scrolling table: {"total":N,"offset":O,"rows":[[name,
+// quantity,"unit cost","total"],...]}, with the amounts already formatted the
+// way the HTML table shows them.
+std::string renderRowsJson(const csfj::ItemSnapshot& items, const PageWindow& window) {
+  const size_t first = std::min(window.offset, items.size());
+  const size_t last = std::min(items.size(), first + window.limit);
+
+  std::string json;
+  json.reserve(64U + (last - first) * 64U);
+  json += "{\"total\":";
+  csfj::appendInteger(json, static_cast<long long>(items.size()));
+  json += ",\"offset\":";
+  csfj::appendInteger(json, static_cast<long long>(first));
+  json += ",\"rows\":[";
+  for (size_t index = first; index < last; ++index) {
+    const Item& item = items[index];
+    if (index != first) {
+      json += ',';
+    }
+    json += '[';
+    csfj::appendJsonString(json, item.name);
+    json += ',';
+    csfj::appendInteger(json, item.quantity);
+    json += ",\"";
+    csfj::appendMoneyWithGrouping(json, item.unitCost);
+    json += "\",\"";
+    csfj::appendMoneyWithGrouping(json, item.getTotalCost());
+    json += "\"]";
+  }
+  json += "]}";
+  return json;
 }
 
-std::string renderItemsTable() {
-  std::ostringstream rows;
-  double totalCost = 0.0;
-  {
-    std::lock_guard<std::mutex> guard(g_itemsMutex);
-    for (size_t index = 0; index < g_items.size(); ++index) {
-      const Item& item = g_items[index];
-      const double itemTotal = item.getTotalCost();
-      rows << "      <tr><td>" << (index + 1) << "</td><td>" << escapeHtml(item.name)
-           << "</td><td>" << item.quantity
-           << "</td><td>" << formatCurrencyWithGrouping(item.unitCost)
-           << "</td><td>" << formatCurrencyWithGrouping(itemTotal)
-           << "</td><td class=\"actions\"><form class=\"action-form\" method=\"GET\" action=\"/edit\">"
-           << "<input type=\"hidden\" name=\"index\" value=\"" << index << "\">"
-           << "<button class=\"action-button\" type=\"submit\">Editar</button></form></td></tr>\n";
-      totalCost += itemTotal;
+// A page of items for /api/items: {"total":N,"offset":O,"items":[...]}, each
+// item as appendItemJson writes it.
+std::string renderItemsJson(const csfj::ItemSnapshot& items, const PageWindow& window) {
+  const size_t first = std::min(window.offset, items.size());
+  const size_t last = std::min(items.size(), first + window.limit);
+
+  std::string json;
+  json.reserve(64U + (last - first) * 96U);
+  json += "{\"total\":";
+  csfj::appendInteger(json, static_cast<long long>(items.size()));
+  json += ",\"offset\":";
+  csfj::appendInteger(json, static_cast<long long>(first));
+  json += ",\"items\":[";
+  for (size_t index = first; index < last; ++index) {
+    if (index != first) {
+      json += ',';
     }
+    csfj::appendItemJson(json, index, items[index]);
   }
+  json += "]}";
+  return json;
+}
 
-  std::string page;
-  try {
-    page = indexTemplate();
-  } catch (const std::exception& ex) {
-    return renderTemplateError(ex.what());
+// Same shape for /api/items/query, where `total` counts the matches and
+// `totalCost` adds up their totals.
+std::string renderQueryJson(const csfj::ItemQueryResult& result, size_t offset) {
+  std::string json;
+  json.reserve(96U + result.positions.size() * 96U);
+  json += "{\"total\":";
+  csfj::appendInteger(json, static_cast<long long>(result.total));
+  json += ",\"totalCost\":";
+  csfj::appendMoney(json, result.totalCost);
+  json += ",\"offset\":";
+  csfj::appendInteger(json, static_cast<long long>(std::min(offset, result.total)));
+  json += ",\"items\":[";
+  for (size_t position = 0; position < result.positions.size(); ++position) {
+    if (position != 0U) {
+      json += ',';
+    }
+    const size_t index = result.positions[position];
+    csfj::appendItemJson(json, index, (*result.items)[index]);
   }
+  json += "]}";
+  return json;
+}
 
-  replaceAll(page, "{{items_rows}}", rows.str());
-  replaceAll(page, "{{total_cost}}", formatCurrencyWithGrouping(totalCost));
+std::string renderEditPage(const csfj::CompiledTemplate& compiled, size_t index, const Item& item) {
+  csfj::SlotValue values[kEditSlotCount];
+  values[kItemIndexSlot] = csfj::integerSlot(static_cast<long long>(index));
+  values[kItemNameSlot] = csfj::htmlSlot(item.name);
+  values[kItemQuantitySlot] = csfj::integerSlot(item.quantity);
+  values[kItemCostSlot] = csfj::currencySlot(item.unitCost);
 
+  std::string page;
+  compiled.renderTo(page, values, kEditSlotCount);
   return page;
 }
 
-std::string renderEditPage(size_t index, const Item& item) {
-  std::string page;
-  try {
-    page = editTemplate();
-  } catch (const std::exception& ex) {
-    return renderTemplateError(ex.what());
+// The code in a status line such as "HTTP/1.1 404 Not Found".
+int statusCode(std::string_view statusLine) {
+  int code = 0;
+  const size_t space = statusLine.find(' ');
+  if (space != std::string_view::npos) {
+    std::from_chars(statusLine.data() + space + 1U, statusLine.data() + statusLine.size(), code);
   }
+  return code;
+}
 
-  replaceAll(page, "{{item_index}}", std::to_string(index));
-  replaceAll(page, "{{item_name}}", escapeHtml(item.name));
-  replaceAll(page, "{{item_quantity}}", std::to_string(item.quantity));
-  replaceAll(page, "{{item_cost}}", formatCurrency(item.unitCost));
+std::string_view connectionHeader(const Connection& client) {
+  return client.keepAlive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n";
+}
 
-  return page;
+void appendHead(csfj::ResponseHead& head,
+                std::string_view statusLine,
+                std::string_view contentType,
+                std::string_view extraHeaders,
+                size_t contentLength) {
+  head.append(statusLine).append("\r\nContent-Type: ").append(contentType).append("\r\n").append(extraHeaders);
+  head.append("Content-Length: ").appendNumber(contentLength).append("\r\n");
+}
+
+// Small bodies are copied into the connection's output queue together with
+// the head.
+void sendResponse(Connection& client,
+                  std::string_view statusLine,
+                  std::string_view contentType,
+                  std::string_view body,
+                  std::string_view extraHeaders = {}) {
+  csfj::ResponseHead head;
+  appendHead(head, statusLine, contentType, extraHeaders, body.size());
+  head.append(connectionHeader(client));
+  client.output.append(head.view());
+  client.output.append(body);
+  client.responseStatus = statusCode(statusLine);
 }
 
-void sendResponse(SOCKET client,
-                  const std::string& statusLine,
-                  const std::string& contentType,
-                  const std::string& body,
-                  const std::string& extraHeaders = std::string{}) {
-  std::ostringstream response;
-  response << statusLine << "\r\n"
-           << "Content-Type: " << contentType << "\r\n";
-  if (!extraHeaders.empty()) {
-    response << extraHeaders;
+// Large bodies are queued by reference, piece by piece, and kept alive by the
+// queue until written.
+void sendResponse(Connection& client,
+                  std::string_view statusLine,
+                  std::string_view contentType,
+                  const std::shared_ptr<const csfj::SegmentedText>& body,
+                  std::string_view extraHeaders = {}) {
+  csfj::ResponseHead head;
+  appendHead(head, statusLine, contentType, extraHeaders, body->size());
+  head.append(connectionHeader(client));
+  client.output.append(head.view());
+  for (size_t index = 0; index < body->pieceCount(); ++index) {
+    client.output.appendExternal(body->piece(index), body);
   }
-  response << "Content-Length: " << body.size() << "\r\n"
-           << "Connection: close\r\n\r\n"
-           << body;
-  const auto payload = response.str();
-  send(client, payload.data(), static_cast<int>(payload.size()), 0);
+  client.responseStatus = statusCode(statusLine);
 }
 
-void sendRedirect(SOCKET client, const std::string& location) {
-  std::ostringstream response;
-  response << "HTTP/1.1 303 See Other\r\n"
-           << "Location: " << location << "\r\n"
-           << "Content-Length: 0\r\n"
-           << "Connection: close\r\n\r\n";
-  const auto payload = response.str();
-  send(client, payload.data(), static_cast<int>(payload.size()), 0);
+// Entity tag for everything rendered from store version `version` with the
+// assets of `generation`. Versions restart from the journal after a restart,
+// so the tag also carries the process start time: a new binary may render the
+// same version differently.
+std::pmr::string entityTag(std::uint64_t generation, std::uint64_t version, std::pmr::memory_resource* resource) {
+  static const std::string epoch = std::to_string(
+      std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+  char generationDigits[20];
+  char versionDigits[20];
+  const auto generationEnd = std::to_chars(generationDigits, generationDigits + sizeof(generationDigits), generation);
+  const auto versionEnd = std::to_chars(versionDigits, versionDigits + sizeof(versionDigits), version);
+  std::pmr::string tag(resource);
+  tag.reserve(epoch.size() + sizeof(generationDigits) + sizeof(versionDigits) + 4U);
+  tag.append(1, '"').append(epoch).append(1, '-').append(generationDigits, generationEnd.ptr).append(1, '-');
+  tag.append(versionDigits, versionEnd.ptr).append(1, '"');
+  return tag;
 }
 
-bool tryServeStaticAsset(const std::string& path, SOCKET client) {
-  try {
-    if (path == "/static/styles.css") {
-      sendResponse(client, "HTTP/1.1 200 OK", "text/css; charset=utf-8", stylesAsset());
-      return true;
+// Whether an If-None-Match value ("*" or a comma-separated list of possibly
+// weak tags) matches `etag`.
+bool entityTagMatches(std::string_view ifNoneMatch, std::string_view etag) {
+  while (!ifNoneMatch.empty()) {
+    const size_t comma = ifNoneMatch.find(',');
+    std::string_view candidate = ifNoneMatch.substr(0, comma);
+    while (!candidate.empty() && (candidate.front() == ' ' || candidate.front() == '\t')) {
+      candidate.remove_prefix(1);
+    }
+    while (!candidate.empty() && (candidate.back() == ' ' || candidate.back() == '\t')) {
+      candidate.remove_suffix(1);
+    }
+    if (candidate.substr(0, 2) == "W/") {
+      candidate.remove_prefix(2);
     }
-    if (path == "/static/formatter.js") {
-      sendResponse(client, "HTTP/1.1 200 OK", "application/javascript; charset=utf-8", formatterAsset());
+    if (candidate == "*" || candidate == etag) {
       return true;
     }
-  } catch (const std::exception& ex) {
-    const auto errorPage = renderTemplateError(ex.what());
-    sendResponse(client, "HTTP/1.1 500 Internal Server Error", "text/html; charset=utf-8", errorPage);
-    return true;
+    if (comma == std::string_view::npos) {
+      break;
+    }
+    ifNoneMatch.remove_prefix(comma + 1);
   }
   return false;
 }
 
-void handlePostSubmit(const std::string& body, SOCKET client) {
-  const auto formValues = parseFormBody(body);
+// Validator headers for responses rendered from the item store: browsers keep
+// the body but revalidate it on every view.
+std::pmr::string validatorHeaders(std::string_view etag, std::pmr::memory_resource* resource) {
+  std::pmr::string headers(resource);
+  headers.append("ETag: ").append(etag).append("\r\nCache-Control: no-cache\r\n");
+  return headers;
+}
+
+void sendNotModified(Connection& client, std::string_view etag) {
+  csfj::ResponseHead head;
+  head.append("HTTP/1.1 304 Not Modified\r\n").append(validatorHeaders(etag, &client.arena));
+  head.append(connectionHeader(client));
+  client.output.append(head.view());
+  client.responseStatus = 304;
+}
+
+// Answers with 304 when the client's copy is already at the current version.
+bool sendNotModifiedIfFresh(Connection& client, std::string_view etag) {
+  if (!entityTagMatches(client.request.header("if-none-match"), etag)) {
+    return false;
+  }
+  sendNotModified(client, etag);
+  return true;
+}
+
+void sendRedirect(Connection& client, std::string_view location) {
+  csfj::ResponseHead head;
+  head.append("HTTP/1.1 303 See Other\r\nLocation: ").append(location).append("\r\nContent-Length: 0\r\n");
+  head.append(connectionHeader(client));
+  client.output.append(head.view());
+  client.responseStatus = 303;
+}
+
+// Sends the status line and headers now and leaves the body to `stream`, which
+// flushOutput pulls from as the socket drains. HTTP/1.1 clients get
+// Transfer-Encoding: chunked; HTTP/1.0 clients get the raw body delimited by
+// closing the connection.
+void sendStreamedResponse(Connection& client,
+                          std::string_view statusLine,
+                          std::string_view contentType,
+                          std::unique_ptr<BodyStream> stream,
+                          std::string_view extraHeaders = {}) {
+  client.chunkedBody = !client.request.http10;
+  if (!client.chunkedBody) {
+    client.keepAlive = false;
+    client.closeAfterWrite = true;
+  }
+
+  csfj::ResponseHead head;
+  head.append(statusLine).append("\r\nContent-Type: ").append(contentType).append("\r\n").append(extraHeaders);
+  if (client.chunkedBody) {
+    head.append("Transfer-Encoding: chunked\r\n");
+  }
+  head.append(connectionHeader(client));
+  client.output.append(head.view());
+  client.bodyStream = std::move(stream);
+  client.responseStatus = statusCode(statusLine);
+}
+
+// Serves from the static file table. Asset sets are never freed, so both the
+// precomputed head and the body are queued by reference.
+bool tryServeStaticAsset(const csfj::StaticFileTable& staticFiles, std::string_view path, Connection& client) {
+  const csfj::StaticFile* file = staticFiles.find(path);
+  if (file == nullptr) {
+    return false;
+  }
+  const bool gzip = file->hasGzip && csfj::acceptsEncoding(client.request.header("accept-encoding"), "gzip");
+  const csfj::StaticVariant& variant = gzip ? file->gzip : file->identity;
+  const int connection = client.keepAlive ? 1 : 0;
+  if (entityTagMatches(client.request.header("if-none-match"), variant.etag)) {
+    client.output.appendExternal(variant.notModifiedHead[connection]);
+    client.responseStatus = 304;
+    return true;
+  }
+  client.output.appendExternal(variant.okHead[connection]);
+  client.output.appendExternal(variant.body);
+  client.responseStatus = 200;
+  return true;
+}
+
+constexpr std::string_view kSheetTotalOverflowMessage = "El total de la hoja sería demasiado grande.";
+
+// Records a write to `sheet` as the one the connection's responses wait for.
+void awaitWrite(Connection& client, const csfj::Sheet& sheet, std::uint64_t sequence) {
+  client.awaitingSheet = &sheet;
+  client.awaitingSequence = sequence;
+}
+
+// The sheet a request addresses. A named sheet that does not exist yet reads
+// as the blank sheet and is only created by write(), which handlers call once
+// the write has been validated, so requests that fail or write nothing never
+// create one.
+class SheetTarget {
+public:
+  SheetTarget(csfj::Sheet* existing, std::string_view name) : existing_(existing), name_(name) {}
+
+  // Null while a named sheet does not exist.
+  csfj::Sheet* existing() const {
+    return existing_;
+  }
+
+  csfj::Sheet& read() const {
+    return existing_ != nullptr ? *existing_ : g_blankSheet;
+  }
+
+  // The sheet, created if needed. Answers 507 and returns nullptr when that
+  // would exceed --max-sheets.
+  csfj::Sheet* write(Connection& client) {
+    if (existing_ == nullptr) {
+      existing_ = g_sheets->findOrCreate(name_);
+    }
+    if (existing_ == nullptr) {
+      sendResponse(client, "HTTP/1.1 507 Insufficient Storage", "text/plain; charset=utf-8",
+                   "Se alcanzó el número máximo de hojas.");
+    }
+    return existing_;
+  }
+
+private:
+  csfj::Sheet* existing_;
+  std::string_view name_;
+};
+
+// `base` is the sheet's own path ("/" or "/s/{name}/") for the redirects.
+void handlePostSubmit(SheetTarget& target, std::string_view base, std::string_view body, Connection& client) {
+  const csfj::FormFields formValues(body, &client.arena);
   
   // Get item name from dropdown or custom field
   std::string itemName;
@@ -401,7 +829,7 @@ void handlePostSubmit(const std::string& body, SOCKET client) {
   
   int quantity = 0;
   try {
-    quantity = std::stoi(quantityIt->second);
+    quantity = std::stoi(std::string(quantityIt->second));
     if (quantity < 1) {
       throw std::invalid_argument("quantity must be positive");
     }
@@ -412,27 +840,34 @@ void handlePostSubmit(const std::string& body, SOCKET client) {
   }
   
   try {
-    const std::string normalizedCost = normalizeCostInput(costIt->second);
+    const std::string normalizedCost = csfj::normalizeCostInput(costIt->second);
     if (normalizedCost.empty()) {
       throw std::invalid_argument("empty");
     }
-    const double cost = std::stod(normalizedCost);
-    if (cost < 0.0) {
-      throw std::invalid_argument("negative");
+    csfj::Money cost;
+    csfj::Money itemTotal;
+    if (!csfj::parseMoney(normalizedCost, cost) || !csfj::multiplyMoney(cost, quantity, itemTotal)) {
+      throw std::invalid_argument("cost");
+    }
+    csfj::Sheet* sheet = target.write(client);
+    if (sheet == nullptr) {
+      return;
     }
-    {
-      std::lock_guard<std::mutex> guard(g_itemsMutex);
-      g_items.push_back({itemName, quantity, cost});
+    const auto sequence = sheet->store.append({itemName, quantity, cost});
+    if (!sequence) {
+      sendResponse(client, "HTTP/1.1 400 Bad Request", "text/plain; charset=utf-8", kSheetTotalOverflowMessage);
+      return;
     }
-    sendRedirect(client, "/");
+    awaitWrite(client, *sheet, *sequence);
+    sendRedirect(client, base);
   } catch (const std::exception&) {
     const std::string message = "Costo inválido. Usa un número positivo.";
     sendResponse(client, "HTTP/1.1 400 Bad Request", "text/plain; charset=utf-8", message);
   }
 }
 
-void handlePostUpdate(const std::string& body, SOCKET client) {
-  const auto formValues = parseFormBody(body);
+void handlePostUpdate(SheetTarget& target, std::string_view base, std::string_view body, Connection& client) {
+  const csfj::FormFields formValues(body, &client.arena);
   const auto indexIt = formValues.find("itemIndex");
   
   // Get item name from dropdown or custom field
@@ -459,7 +894,7 @@ void handlePostUpdate(const std::string& body, SOCKET client) {
 
   size_t itemIndex = 0U;
   try {
-    itemIndex = static_cast<size_t>(std::stoul(indexIt->second));
+    itemIndex = static_cast<size_t>(std::stoul(std::string(indexIt->second)));
   } catch (const std::exception&) {
     const std::string message = "Índice de item inválido.";
     sendResponse(client, "HTTP/1.1 400 Bad Request", "text/plain; charset=utf-8", message);
@@ -468,7 +903,7 @@ void handlePostUpdate(const std::string& body, SOCKET client) {
   
   int quantity = 0;
   try {
-    quantity = std::stoi(quantityIt->second);
+    quantity = std::stoi(std::string(quantityIt->second));
     if (quantity < 1) {
       throw std::invalid_argument("quantity must be positive");
     }
@@ -479,209 +914,753 @@ void handlePostUpdate(const std::string& body, SOCKET client) {
   }
 
   try {
-    const std::string normalizedCost = normalizeCostInput(costIt->second);
+    const std::string normalizedCost = csfj::normalizeCostInput(costIt->second);
     if (normalizedCost.empty()) {
       throw std::invalid_argument("empty");
     }
-    const double cost = std::stod(normalizedCost);
-    if (cost < 0.0) {
-      throw std::invalid_argument("negative");
+    csfj::Money cost;
+    csfj::Money itemTotal;
+    if (!csfj::parseMoney(normalizedCost, cost) || !csfj::multiplyMoney(cost, quantity, itemTotal)) {
+      throw std::invalid_argument("cost");
     }
 
-    bool itemMissing = false;
-    {
-      std::lock_guard<std::mutex> guard(g_itemsMutex);
-      if (itemIndex >= g_items.size()) {
-        itemMissing = true;
-      } else {
-        g_items[itemIndex] = {itemName, quantity, cost};
-      }
+    // A sheet that does not exist has no items to replace.
+    csfj::Sheet* sheet = target.existing();
+    csfj::BatchResult result;
+    result.status = csfj::BatchStatus::kNoSuchItem;
+    if (sheet != nullptr) {
+      result = sheet->store.replace(itemIndex, {itemName, quantity, cost});
     }
-
-    if (itemMissing) {
+    if (result.status == csfj::BatchStatus::kNoSuchItem) {
       const std::string message = "El item solicitado no existe.";
       sendResponse(client, "HTTP/1.1 404 Not Found", "text/plain; charset=utf-8", message);
       return;
     }
+    if (result.status != csfj::BatchStatus::kApplied) {
+      sendResponse(client, "HTTP/1.1 400 Bad Request", "text/plain; charset=utf-8", kSheetTotalOverflowMessage);
+      return;
+    }
+    awaitWrite(client, *sheet, result.sequence);
 
-    sendRedirect(client, "/");
+    // Back to the page that shows the edited item.
+    const size_t pageOffset = itemIndex / kDefaultPageSize * kDefaultPageSize;
+    std::string location(base);
+    if (pageOffset != 0U) {
+      location += "?offset=" + std::to_string(pageOffset);
+    }
+    sendRedirect(client, location);
   } catch (const std::exception&) {
     const std::string message = "Costo inválido. Usa un número positivo.";
     sendResponse(client, "HTTP/1.1 400 Bad Request", "text/plain; charset=utf-8", message);
   }
 }
 
-void handleClient(SOCKET client) {
-  std::string request;
-  request.reserve(2048);
-
-  int expectedContentLength = 0;
-  bool headersParsed = false;
-  size_t headerEndPos = std::string::npos;
-
-  char buffer[kSocketBufferSize];
-  while (true) {
-    const int bytesReceived = recv(client, buffer, sizeof(buffer), 0);
-    if (bytesReceived <= 0) {
-      break;
-    }
-    request.append(buffer, bytesReceived);
-
-    if (!headersParsed) {
-      headerEndPos = request.find("\r\n\r\n");
-      if (headerEndPos != std::string::npos) {
-        const std::string headersPart = request.substr(0, headerEndPos);
-        const auto headers = parseHeaders(headersPart);
-        const auto contentLengthIt = headers.find("content-length");
-        if (contentLengthIt != headers.end()) {
-          expectedContentLength = std::stoi(contentLengthIt->second);
-        }
-        headersParsed = true;
-      }
-    }
+bool isCsvImport(const csfj::HttpRequest& request) {
+  return request.method == "POST" && csfj::splitSheetPath(request.path).route == "/import" &&
+         request.header("content-type").find("text/csv") != std::string_view::npos;
+}
 
-    if (headersParsed) {
-      const size_t currentBodySize = (headerEndPos == std::string::npos) ? 0 : request.size() - (headerEndPos + 4);
-      if (static_cast<int>(currentBodySize) >= expectedContentLength) {
-        break;
-      }
-    }
+// Hands the import body received so far to the connection's CSV reader, so a
+// large upload is parsed while the rest of it is still in flight.
+void feedImportBody(Connection& client) {
+  const csfj::HttpRequest& request = client.request;
+  if (!client.importReader) {
+    client.importReader = std::make_unique<csfj::CsvItemReader>();
   }
+  const size_t bodyStart = client.inputStart + request.headerLength;
+  const size_t received = std::min(client.input.size() - bodyStart, request.contentLength);
+  if (received > client.importBodyFed) {
+    const std::string_view input(client.input);
+    client.importReader->feed(input.substr(bodyStart + client.importBodyFed, received - client.importBodyFed));
+    client.importBodyFed = received;
+  }
+}
 
-  if (request.empty()) {
+// Adds every row of the uploaded CSV in one store write, or none of them if
+// any row is invalid.
+void handlePostImport(SheetTarget& target, Connection& client) {
+  feedImportBody(client);
+  csfj::CsvItemReader& reader = *client.importReader;
+  if (!reader.finish()) {
+    sendResponse(client, "HTTP/1.1 400 Bad Request", "text/plain; charset=utf-8", reader.error());
     return;
   }
-
-  const auto requestLineEnd = request.find("\r\n");
-  if (requestLineEnd == std::string::npos) {
-    sendResponse(client, "HTTP/1.1 400 Bad Request", "text/plain; charset=utf-8", "Petición inválida");
+  std::vector<Item>& items = reader.items();
+  if (items.empty()) {
+    sendResponse(client, "HTTP/1.1 400 Bad Request", "text/plain; charset=utf-8", "El CSV no contiene items.");
     return;
   }
 
-  const auto requestLine = request.substr(0, requestLineEnd);
-  std::istringstream requestLineStream(requestLine);
-  std::string method;
-  std::string rawPath;
-  requestLineStream >> method >> rawPath;
-
-  if (method.empty() || rawPath.empty()) {
-    sendResponse(client, "HTTP/1.1 400 Bad Request", "text/plain; charset=utf-8", "Petición inválida");
+  csfj::Sheet* sheet = target.write(client);
+  if (sheet == nullptr) {
+    return;
+  }
+  const size_t imported = items.size();
+  const auto sequence = sheet->store.appendBatch(std::move(items));
+  if (!sequence) {
+    sendResponse(client, "HTTP/1.1 400 Bad Request", "text/plain; charset=utf-8", kSheetTotalOverflowMessage);
     return;
   }
+  awaitWrite(client, *sheet, *sequence);
+  std::string json = "{\"imported\":";
+  csfj::appendInteger(json, static_cast<long long>(imported));
+  json += '}';
+  sendResponse(client, "HTTP/1.1 200 OK", "application/json; charset=utf-8", json);
+}
+
+void sendJsonError(Connection& client, std::string_view statusLine, std::string_view message) {
+  std::string json = "{\"error\":";
+  csfj::appendJsonString(json, message);
+  json += '}';
+  sendResponse(client, statusLine, "application/json; charset=utf-8", json);
+}
+
+// Same, naming the position of the rejected change in a batch.
+void sendJsonError(Connection& client, std::string_view statusLine, std::string_view message, size_t change) {
+  std::string json = "{\"error\":";
+  csfj::appendJsonString(json, message);
+  json += ",\"change\":";
+  csfj::appendInteger(json, static_cast<long long>(change));
+  json += '}';
+  sendResponse(client, statusLine, "application/json; charset=utf-8", json);
+}
 
-  std::string path = rawPath;
-  std::string queryString;
-  const auto queryPos = rawPath.find('?');
-  if (queryPos != std::string::npos) {
-    path = rawPath.substr(0, queryPos);
-    queryString = rawPath.substr(queryPos + 1);
+bool requireJsonBody(Connection& client) {
+  if (client.request.header("content-type").find("application/json") == std::string_view::npos) {
+    sendJsonError(client, "HTTP/1.1 415 Unsupported Media Type", "Se esperaba Content-Type: application/json.");
+    return false;
   }
+  return true;
+}
 
-  const size_t headersBlockStart = requestLineEnd + 2;
-  const std::string headersBlock = (headerEndPos == std::string::npos || headerEndPos <= headersBlockStart)
-                                       ? std::string{}
-                                       : request.substr(headersBlockStart, headerEndPos - headersBlockStart);
-  const auto headers = parseHeaders(headersBlock);
-  std::string body;
-  if (headerEndPos != std::string::npos) {
-    const size_t bodyStart = headerEndPos + 4;
-    if (bodyStart < request.size()) {
-      body = request.substr(bodyStart);
+// Applies API changes as one store write. On success returns true with the
+// response held until the write is durable; otherwise answers with the error
+// (naming the change when the request was a batch).
+bool applyApiChanges(SheetTarget& target,
+                     Connection& client,
+                     const std::vector<csfj::ItemChange>& changes,
+                     bool batch,
+                     csfj::BatchResult& result) {
+  if (target.existing() == nullptr) {
+    // The sheet would start out empty, so the changes are first tried on an
+    // empty store; only changes that apply there create it.
+    csfj::ItemStore scratch;
+    result = scratch.applyBatch(changes);
+  }
+  csfj::Sheet* sheet = nullptr;
+  if (result.status == csfj::BatchStatus::kApplied) {
+    sheet = target.write(client);
+    if (sheet == nullptr) {
+      return false;
     }
+    result = sheet->store.applyBatch(changes);
   }
-
-  if (method == "GET" && tryServeStaticAsset(path, client)) {
-    return;
+  std::string_view statusLine = "HTTP/1.1 400 Bad Request";
+  std::string_view message;
+  switch (result.status) {
+    case csfj::BatchStatus::kApplied:
+      awaitWrite(client, *sheet, result.sequence);
+      return true;
+    case csfj::BatchStatus::kMissingField:
+      message = "Faltan campos requeridos (name, quantity, unitCost).";
+      break;
+    case csfj::BatchStatus::kNoSuchItem:
+      statusLine = "HTTP/1.1 404 Not Found";
+      message = "El item solicitado no existe.";
+      break;
+    case csfj::BatchStatus::kTotalOverflow:
+      message = "El total del item o de la hoja es demasiado grande.";
+      break;
   }
+  if (batch) {
+    sendJsonError(client, statusLine, message, result.failedChange);
+  } else {
+    sendJsonError(client, statusLine, message);
+  }
+  return false;
+}
 
-  if (method == "GET" && (path == "/" || path == "/index.html")) {
-    const auto html = renderItemsTable();
-    sendResponse(client, "HTTP/1.1 200 OK", "text/html; charset=utf-8", html);
-  } else if (method == "GET" && path == "/export") {
-    std::ostringstream csv;
-    csv << "Nombre,Cantidad,Costo Unitario,Total\r\n";
-
-    double totalCost = 0.0;
-    {
-      std::lock_guard<std::mutex> guard(g_itemsMutex);
-      for (const Item& item : g_items) {
-        const double itemTotal = item.getTotalCost();
-        csv << escapeCsv(item.name) << ',' 
-            << item.quantity << ','
-            << escapeCsv(formatCurrency(item.unitCost)) << ','
-            << escapeCsv(formatCurrency(itemTotal)) << "\r\n";
-        totalCost += itemTotal;
-      }
+// Reads the filters of /api/items/query from its query string:
+//   category               a predefined category, or "Otros" for the rest
+//   name, namePrefix       exact name, or its beginning
+//   minQuantity, maxQuantity, minUnitCost, maxUnitCost, minTotal, maxTotal
+//   sort                   index, name, quantity, unitCost or total; a
+//                          leading '-' sorts descending
+//   offset, limit          as for the paged listing
+// Costs accept the same grouping separators as the forms. Any other parameter
+// is rejected, so a misspelled filter is not silently dropped.
+bool parseItemQuery(std::string_view queryString, csfj::ItemQuery& query, std::string& error,
+                    std::pmr::memory_resource* resource) {
+  PageWindow window;
+  if (!parsePageWindow(queryString, window, resource)) {
+    error = "Parámetros de paginación inválidos.";
+    return false;
+  }
+  query.offset = window.offset;
+  query.limit = window.limit;
+
+  const csfj::FormFields values(queryString, resource);
+  static constexpr std::string_view kParameters[] = {
+      "category",    "name",        "namePrefix", "minQuantity", "maxQuantity", "minUnitCost",
+      "maxUnitCost", "minTotal",    "maxTotal",   "sort",        "offset",      "limit",
+  };
+  for (const auto& [key, value] : values) {
+    if (std::find(std::begin(kParameters), std::end(kParameters), key) == std::end(kParameters)) {
+      error = "Parámetro desconocido: " + std::string(key) + ".";
+      return false;
+    }
+  }
+  const auto find = [&values](const char* key) -> std::optional<std::string_view> {
+    const auto it = values.find(key);
+    return it == values.end() ? std::nullopt : std::optional<std::string_view>(it->second);
+  };
+  const auto readQuantity = [&](const char* key, std::optional<int>& out) {
+    const auto text = find(key);
+    if (!text) {
+      return true;
+    }
+    int value = 0;
+    const auto result = std::from_chars(text->data(), text->data() + text->size(), value);
+    if (text->empty() || result.ec != std::errc() || result.ptr != text->data() + text->size()) {
+      error = std::string("Cantidad inválida en ") + key + ".";
+      return false;
+    }
+    out = value;
+    return true;
+  };
+  const auto readMoney = [&](const char* key, std::optional<csfj::Money>& out) {
+    const auto text = find(key);
+    if (!text) {
+      return true;
+    }
+    csfj::Money value;
+    if (!csfj::parseMoney(csfj::normalizeCostInput(*text), value)) {
+      error = std::string("Monto inválido en ") + key + ".";
+      return false;
     }
+    out = value;
+    return true;
+  };
 
-    csv << escapeCsv("Total") << ",,," << escapeCsv(formatCurrency(totalCost)) << "\r\n";
+  if (const auto category = find("category")) {
+    query.category = csfj::categoryIndex(*category);
+    if (*query.category == csfj::kOtherCategory && *category != csfj::kOtherCategoryName) {
+      error = "Categoría desconocida.";
+      return false;
+    }
+  }
+  if (const auto name = find("name")) {
+    query.name = std::string(*name);
+  }
+  if (const auto prefix = find("namePrefix")) {
+    query.namePrefix = std::string(*prefix);
+  }
+  if (!readQuantity("minQuantity", query.minQuantity) || !readQuantity("maxQuantity", query.maxQuantity) ||
+      !readMoney("minUnitCost", query.minUnitCost) || !readMoney("maxUnitCost", query.maxUnitCost) ||
+      !readMoney("minTotal", query.minTotal) || !readMoney("maxTotal", query.maxTotal)) {
+    return false;
+  }
+  if (auto sort = find("sort")) {
+    query.descending = !sort->empty() && sort->front() == '-';
+    sort->remove_prefix(query.descending ? 1U : 0U);
+    static constexpr std::pair<std::string_view, csfj::ItemField> kSortKeys[] = {
+        {"index", csfj::ItemField::kIndex},       {"name", csfj::ItemField::kName},
+        {"quantity", csfj::ItemField::kQuantity}, {"unitCost", csfj::ItemField::kUnitCost},
+        {"total", csfj::ItemField::kTotal},
+    };
+    const auto key = std::find_if(std::begin(kSortKeys), std::end(kSortKeys),
+                                  [&sort](const auto& entry) { return entry.first == *sort; });
+    if (key == std::end(kSortKeys)) {
+      error = "Orden desconocido; usa index, name, quantity, unitCost o total.";
+      return false;
+    }
+    query.sortBy = key->second;
+  }
+  return true;
+}
 
-    const auto csvBody = csv.str();
-    const std::string disposition = "Content-Disposition: attachment; filename=\"items.csv\"\r\n";
-    sendResponse(client, "HTTP/1.1 200 OK", "text/csv; charset=utf-8", csvBody, disposition);
-  } else if (method == "GET" && path == "/edit") {
-    const auto queryValues = parseFormBody(queryString);
-    const auto indexIt = queryValues.find("index");
-    if (indexIt == queryValues.end()) {
-      sendResponse(client, "HTTP/1.1 400 Bad Request", "text/plain; charset=utf-8", "Índice de item requerido");
+// Everything under /api/items except the paged listing, which shares the
+// cached path of the HTML table. `rest` is what follows /api/items:
+//   POST  /api/items         appends one item, answers 201 with it
+//   POST  /api/items/batch   applies an array of appends and updates at once
+//   GET   /api/items/query   filtered, sorted page of items (parseItemQuery)
+//   GET   /api/items/{n}     one item
+//   PATCH /api/items/{n}     changes the fields given, keeps the others
+void handleApiItems(SheetTarget& target, std::string_view base, Connection& client, std::string_view rest) {
+  const csfj::HttpRequest& request = client.request;
+  const std::string_view method = request.method;
+  std::vector<csfj::ItemChange> changes(1U);
+  csfj::BatchResult result;
+  std::string error;
+
+  if (rest.empty()) {
+    if (method != "POST") {
+      sendResponse(client, "HTTP/1.1 405 Method Not Allowed", "text/plain; charset=utf-8", "Método no permitido",
+                   "Allow: GET, POST\r\n");
       return;
     }
-    size_t itemIndex = 0U;
-    try {
-      itemIndex = static_cast<size_t>(std::stoul(indexIt->second));
-    } catch (const std::exception&) {
-      sendResponse(client, "HTTP/1.1 400 Bad Request", "text/plain; charset=utf-8", "Índice de item inválido");
+    if (!requireJsonBody(client)) {
       return;
     }
-
-    Item itemSnapshot;
-    bool itemMissing = false;
-    {
-      std::lock_guard<std::mutex> guard(g_itemsMutex);
-      if (itemIndex >= g_items.size()) {
-        itemMissing = true;
-      } else {
-        itemSnapshot = g_items[itemIndex];
-      }
-    }
-
-    if (itemMissing) {
-      sendResponse(client, "HTTP/1.1 404 Not Found", "text/plain; charset=utf-8", "El item solicitado no existe");
+    if (!csfj::parseItemChange(request.body, changes[0], error)) {
+      sendJsonError(client, "HTTP/1.1 400 Bad Request", error);
       return;
     }
-
-    const auto html = renderEditPage(itemIndex, itemSnapshot);
-    sendResponse(client, "HTTP/1.1 200 OK", "text/html; charset=utf-8", html);
-  } else if (method == "POST" && path == "/submit") {
-    const auto contentTypeIt = headers.find("content-type");
-    if (contentTypeIt == headers.end() || contentTypeIt->second.find("application/x-www-form-urlencoded") == std::string::npos) {
-      sendResponse(client, "HTTP/1.1 415 Unsupported Media Type", "text/plain; charset=utf-8", "Contenido no soportado");
+    if (changes[0].index) {
+      sendJsonError(client, "HTTP/1.1 400 Bad Request", "Para modificar un item usa PATCH /api/items/{índice}.");
       return;
     }
-    handlePostSubmit(body, client);
-  } else if (method == "POST" && path == "/update") {
-    const auto contentTypeIt = headers.find("content-type");
-    if (contentTypeIt == headers.end() || contentTypeIt->second.find("application/x-www-form-urlencoded") == std::string::npos) {
-      sendResponse(client, "HTTP/1.1 415 Unsupported Media Type", "text/plain; charset=utf-8", "Contenido no soportado");
+    if (!applyApiChanges(target, client, changes, false, result)) {
       return;
     }
-    handlePostUpdate(body, client);
-  } else {
-    const std::string notFoundHtml = "<html><body><h1>404 - Recurso no encontrado</h1></body></html>";
-    sendResponse(client, "HTTP/1.1 404 Not Found", "text/html; charset=utf-8", notFoundHtml);
+    const csfj::ItemWrite& write = result.writes.front();
+    std::string json;
+    csfj::appendItemJson(json, write.index, write.item);
+    sendResponse(client, "HTTP/1.1 201 Created", "application/json; charset=utf-8", json,
+                 "Location: " + std::string(base) + "api/items/" + std::to_string(write.index) + "\r\n");
+    return;
   }
-}
 
-class SocketEnvironment {
-public:
-  SocketEnvironment() {
-#ifdef _WIN32
-    WSADATA data;
-    if (WSAStartup(MAKEWORD(2, 2), &data) != 0) {
-      throw std::runtime_error("No se pudo inicializar Winsock");
+  if (rest == "/batch") {
+    if (method != "POST") {
+      sendResponse(client, "HTTP/1.1 405 Method Not Allowed", "text/plain; charset=utf-8", "Método no permitido",
+                   "Allow: POST\r\n");
+      return;
     }
-#endif
-  }
+    if (!requireJsonBody(client)) {
+      return;
+    }
+    size_t failedChange = 0U;
+    if (!csfj::parseItemChanges(request.body, changes, error, failedChange)) {
+      sendJsonError(client, "HTTP/1.1 400 Bad Request", error, failedChange);
+      return;
+    }
+    if (changes.empty()) {
+      sendJsonError(client, "HTTP/1.1 400 Bad Request", "El lote no contiene cambios.");
+      return;
+    }
+    if (!applyApiChanges(target, client, changes, true, result)) {
+      return;
+    }
+    std::string json;
+    json.reserve(32U + result.writes.size() * 96U);
+    json += "{\"version\":";
+    csfj::appendInteger(json, static_cast<long long>(result.sequence));
+    json += ",\"items\":[";
+    for (size_t position = 0; position < result.writes.size(); ++position) {
+      if (position != 0U) {
+        json += ',';
+      }
+      csfj::appendItemJson(json, result.writes[position].index, result.writes[position].item);
+    }
+    json += "]}";
+    sendResponse(client, "HTTP/1.1 200 OK", "application/json; charset=utf-8", json);
+    return;
+  }
+
+  if (rest == "/query") {
+    if (method != "GET") {
+      sendResponse(client, "HTTP/1.1 405 Method Not Allowed", "text/plain; charset=utf-8", "Método no permitido",
+                   "Allow: GET\r\n");
+      return;
+    }
+    csfj::ItemQuery query;
+    if (!parseItemQuery(request.query, query, error, &client.arena)) {
+      sendJsonError(client, "HTTP/1.1 400 Bad Request", error);
+      return;
+    }
+    sendResponse(client, "HTTP/1.1 200 OK", "application/json; charset=utf-8",
+                 renderQueryJson(target.read().store.query(query), query.offset));
+    return;
+  }
+
+  size_t itemIndex = 0U;
+  const std::string_view indexText = rest.substr(1);
+  const auto [end, parseError] = std::from_chars(indexText.data(), indexText.data() + indexText.size(), itemIndex);
+  if (parseError != std::errc{} || end != indexText.data() + indexText.size() || indexText.empty()) {
+    sendJsonError(client, "HTTP/1.1 404 Not Found", "Recurso no encontrado.");
+    return;
+  }
+
+  if (method == "GET") {
+    const auto items = target.read().store.snapshot();
+    if (itemIndex >= items->size()) {
+      sendJsonError(client, "HTTP/1.1 404 Not Found", "El item solicitado no existe.");
+      return;
+    }
+    std::string json;
+    csfj::appendItemJson(json, itemIndex, (*items)[itemIndex]);
+    sendResponse(client, "HTTP/1.1 200 OK", "application/json; charset=utf-8", json);
+  } else if (method == "PATCH") {
+    if (!requireJsonBody(client)) {
+      return;
+    }
+    if (!csfj::parseItemChange(request.body, changes[0], error)) {
+      sendJsonError(client, "HTTP/1.1 400 Bad Request", error);
+      return;
+    }
+    if (changes[0].index && *changes[0].index != itemIndex) {
+      sendJsonError(client, "HTTP/1.1 400 Bad Request", "El índice del cuerpo no coincide con el de la ruta.");
+      return;
+    }
+    changes[0].index = itemIndex;
+    if (!applyApiChanges(target, client, changes, false, result)) {
+      return;
+    }
+    std::string json;
+    csfj::appendItemJson(json, itemIndex, result.writes.front().item);
+    sendResponse(client, "HTTP/1.1 200 OK", "application/json; charset=utf-8", json);
+  } else {
+    sendResponse(client, "HTTP/1.1 405 Method Not Allowed", "text/plain; charset=utf-8", "Método no permitido",
+                 "Allow: GET, PATCH\r\n");
+  }
+}
+
+void appendCategorySummary(std::string& out, std::string_view name, const csfj::CategorySummary& summary) {
+  out += "{\"name\":";
+  csfj::appendJsonString(out, name);
+  out += ",\"count\":";
+  csfj::appendInteger(out, static_cast<long long>(summary.count));
+  out += ",\"subtotal\":";
+  csfj::appendMoney(out, summary.subtotal);
+  out += ",\"minUnitCost\":";
+  csfj::appendMoney(out, summary.minUnitCost);
+  out += ",\"maxUnitCost\":";
+  csfj::appendMoney(out, summary.maxUnitCost);
+  out += '}';
+}
+
+// Serializes the aggregates the store maintains on every write; the cost does
+// not depend on the number of items.
+std::string renderSummaryJson(const csfj::ItemSummary& summary) {
+  std::string json;
+  json.reserve(1536U);
+  json += "{\"count\":";
+  csfj::appendInteger(json, static_cast<long long>(summary.count));
+  json += ",\"total\":";
+  csfj::appendMoney(json, summary.total);
+  json += ",\"categories\":[";
+  for (size_t index = 0; index < csfj::kItemCategories.size(); ++index) {
+    appendCategorySummary(json, csfj::kItemCategories[index], summary.categories[index]);
+    json += ',';
+  }
+  appendCategorySummary(json, csfj::kOtherCategoryName, summary.categories[csfj::kOtherCategory]);
+  json += "]}";
+  return json;
+}
+
+// Streams the CSV of one snapshot, formatting rows as the socket drains while
+// writers carry on. An export of up to kMaxCachedExportBytes is also kept, once
+// complete, in the sheet's response cache so later exports of the same version
+// skip formatting.
+class CsvExportStream : public BodyStream {
+public:
+  CsvExportStream(std::shared_ptr<const csfj::ItemSnapshot> items, csfj::ResponseCache& cache)
+      : items_(std::move(items)), cache_(cache) {}
+
+  bool next(std::string& out) override {
+    const size_t chunkStart = out.size();
+    const bool more = appendChunk(out);
+    if (caching_ && rendered_.size() + (out.size() - chunkStart) > kMaxCachedExportBytes) {
+      caching_ = false;
+      std::string().swap(rendered_);
+    }
+    if (!caching_) {
+      return more;
+    }
+    rendered_.append(out, chunkStart, std::string::npos);
+    if (!more) {
+      auto body = std::make_shared<const csfj::SegmentedText>(csfj::SegmentedText::fromString(std::move(rendered_)));
+      cache_.store(items_->version(), kCsvCacheKey, std::move(body));
+    }
+    return more;
+  }
+
+private:
+  bool appendChunk(std::string& out) {
+    const size_t limit = out.size() + kBodyChunkSize;
+    if (!headerWritten_) {
+      out += "Nombre,Cantidad,Costo Unitario,Total\r\n";
+      headerWritten_ = true;
+    }
+    for (; nextRow_ < items_->size() && out.size() < limit; ++nextRow_) {
+      const Item& item = (*items_)[nextRow_];
+      csfj::appendEscapedCsv(out, item.name);
+      out += ',';
+      csfj::appendInteger(out, item.quantity);
+      out += ",\"";
+      csfj::appendMoney(out, item.unitCost);
+      out += "\",\"";
+      csfj::appendMoney(out, item.getTotalCost());
+      out += "\"\r\n";
+    }
+    if (nextRow_ < items_->size()) {
+      return true;
+    }
+
+    out += "\"Total\",,,\"";
+    csfj::appendMoney(out, items_->summary().total);
+    out += "\"\r\n";
+    return false;
+  }
+
+  std::shared_ptr<const csfj::ItemSnapshot> items_;
+  csfj::ResponseCache& cache_;
+  size_t nextRow_ = 0U;
+  bool headerWritten_ = false;
+  bool caching_ = true;
+  std::string rendered_;
+};
+
+// Drains the bytes the kernel has buffered for the socket, stopping early once
+// `limit` bytes of input wait to be answered; `unreadInput` then tells the
+// worker to come back for the rest. Returns false when the connection failed
+// and has to be dropped.
+bool receivePending(Connection& client, size_t limit) {
+  char buffer[kSocketBufferSize];
+  client.unreadInput = false;
+  while (client.input.size() - client.inputStart < limit) {
+    const int bytesReceived = recv(client.socket, buffer, sizeof(buffer), 0);
+    if (bytesReceived > 0) {
+      client.input.append(buffer, bytesReceived);
+      client.lastActivity = std::chrono::steady_clock::now();
+      continue;
+    }
+    if (bytesReceived == 0) {
+      client.peerClosed = true;
+      return true;
+    }
+    return lastSocketErrorWouldBlock();
+  }
+  client.unreadInput = true;
+  return true;
+}
+
+// Parses the request at the front of the unanswered input.
+csfj::ParseStatus parsePending(Connection& client) {
+  const std::string_view pending = std::string_view(client.input).substr(client.inputStart);
+  return client.parser.parse(pending, client.request);
+}
+
+// Moves past the request that was just answered so the parser starts on the
+// next pipelined request, which may already be buffered. The buffer is only
+// compacted once most of it has been consumed.
+void consumeRequest(Connection& client) {
+  client.inputStart += client.request.length();
+  if (client.inputStart == client.input.size()) {
+    client.input.clear();
+    client.inputStart = 0U;
+  } else if (client.inputStart > client.input.size() / 2) {
+    client.input.erase(0, client.inputStart);
+    client.inputStart = 0U;
+  }
+  client.parser.reset();
+  client.arena.reset();
+  client.importReader.reset();
+  client.importBodyFed = 0U;
+  client.keepAlive = false;
+  client.requestStarted = {};
+  client.headersReceived = {};
+  client.parseNanos = 0U;
+}
+
+// The route a request is counted under in the metrics; every sheet counts
+// under the same routes.
+csfj::Route routeOf(std::string_view requestPath) {
+  const std::string_view path = csfj::splitSheetPath(requestPath).route;
+  if (path == "/" || path == "/index.html") {
+    return csfj::Route::kIndex;
+  }
+  if (path.substr(0, 8) == "/static/") {
+    return csfj::Route::kStatic;
+  }
+  if (path.substr(0, kApiItemsPath.size()) == kApiItemsPath &&
+      (path.size() == kApiItemsPath.size() || path[kApiItemsPath.size()] == '/')) {
+    return csfj::Route::kApiItems;
+  }
+  static constexpr std::pair<std::string_view, csfj::Route> kExactRoutes[] = {
+      {"/rows", csfj::Route::kRows},
+      {"/edit", csfj::Route::kEdit},
+      {"/export", csfj::Route::kExport},
+      {"/summary", csfj::Route::kSummary},
+      {"/submit", csfj::Route::kSubmit},
+      {"/update", csfj::Route::kUpdate},
+      {"/import", csfj::Route::kImport},
+      {"/metrics", csfj::Route::kMetrics},
+  };
+  for (const auto& [routePath, route] : kExactRoutes) {
+    if (path == routePath) {
+      return route;
+    }
+  }
+  return csfj::Route::kOther;
+}
+
+// Every worker's counters plus gauges for each sheet, in the Prometheus text
+// format. The default sheet has an empty `sheet` label, which Prometheus reads
+// as no label at all.
+std::string renderMetrics() {
+  std::string out;
+  g_metrics.writePrometheus(out);
+  std::string items = "# HELP csfj_items Items en la hoja.\n# TYPE csfj_items gauge\n";
+  std::string versions = "# HELP csfj_store_version Versión publicada del almacén de items.\n"
+                         "# TYPE csfj_store_version gauge\n";
+  g_sheets->forEach([&items, &versions](const csfj::Sheet& sheet) {
+    const auto snapshot = sheet.store.snapshot();
+    items.append("csfj_items{sheet=\"").append(sheet.name).append("\"} ");
+    csfj::appendInteger(items, static_cast<long long>(snapshot->size()));
+    items += '\n';
+    versions.append("csfj_store_version{sheet=\"").append(sheet.name).append("\"} ");
+    csfj::appendInteger(versions, static_cast<long long>(snapshot->version()));
+    versions += '\n';
+  });
+  out += items;
+  out += versions;
+  out += "# HELP csfj_sheets Hojas con nombre abiertas.\n# TYPE csfj_sheets gauge\ncsfj_sheets ";
+  csfj::appendInteger(out, static_cast<long long>(g_sheets->size()));
+  out += '\n';
+  return out;
+}
+
+void sendNotFound(Connection& client) {
+  const std::string notFoundHtml = "<html><body><h1>404 - Recurso no encontrado</h1></body></html>";
+  sendResponse(client, "HTTP/1.1 404 Not Found", "text/html; charset=utf-8", notFoundHtml);
+}
+
+void handleClient(Connection& client) {
+  const csfj::HttpRequest& request = client.request;
+  const std::string_view method = request.method;
+
+  // One set for the whole request, so the page, its tag and its cache entry
+  // agree even if the assets are reloaded meanwhile.
+  const AssetSet& assets = currentAssets();
+  if (method == "GET" && tryServeStaticAsset(assets.staticFiles, request.path, client)) {
+    return;
+  }
+
+  const csfj::SheetPath sheetPath = csfj::splitSheetPath(request.path);
+  if (!sheetPath.valid) {
+    sendNotFound(client);
+    return;
+  }
+  if (sheetPath.route.empty()) {
+    // Pages link relative to the sheet, which needs the final slash.
+    sendResponse(client, "HTTP/1.1 301 Moved Permanently", "text/plain; charset=utf-8", "",
+                 "Location: " + csfj::sheetBase(sheetPath.name) + "\r\n");
+    return;
+  }
+  const std::string_view path = sheetPath.route;
+  const std::string_view base = sheetPath.base;
+  SheetTarget target(sheetPath.name.empty() ? &g_sheets->defaultSheet() : g_sheets->find(sheetPath.name),
+                     sheetPath.name);
+  csfj::Sheet* sheet = &target.read();
+
+  if (method == "GET" && (path == "/" || path == "/index.html" || path == "/rows" || path == kApiItemsPath)) {
+    PageWindow window;
+    if (!parsePageWindow(request.query, window, &client.arena)) {
+      sendResponse(client, "HTTP/1.1 400 Bad Request", "text/plain; charset=utf-8", "Parámetros de paginación inválidos");
+      return;
+    }
+    const auto items = sheet->store.snapshot();
+    const std::pmr::string etag = entityTag(assets.generation, items->version(), &client.arena);
+    if (sendNotModifiedIfFresh(client, etag)) {
+      return;
+    }
+
+    const bool html = path != "/rows" && path != kApiItemsPath;
+    std::string cacheKey = html ? "page:" + std::to_string(assets.generation) + ":"
+                                : path == "/rows" ? "rows:" : "api:";
+    cacheKey += std::to_string(window.offset) + ":" + std::to_string(window.limit);
+    auto body = sheet->cache.find(items->version(), cacheKey);
+    if (!body) {
+      body = std::make_shared<const csfj::SegmentedText>(
+          html ? renderItemsTable(assets.indexTemplate, *items, window)
+               : csfj::SegmentedText::fromString(path == "/rows" ? renderRowsJson(*items, window)
+                                                                 : renderItemsJson(*items, window)));
+      sheet->cache.store(items->version(), cacheKey, body);
+    }
+    sendResponse(client, "HTTP/1.1 200 OK", html ? "text/html; charset=utf-8" : "application/json; charset=utf-8",
+                 body, validatorHeaders(etag, &client.arena));
+  } else if (method == "GET" && path == "/export") {
+    const auto items = sheet->store.snapshot();
+    const std::pmr::string etag = entityTag(assets.generation, items->version(), &client.arena);
+    if (sendNotModifiedIfFresh(client, etag)) {
+      return;
+    }
+
+    std::pmr::string headers("Content-Disposition: attachment; filename=\"items.csv\"\r\n", &client.arena);
+    headers += validatorHeaders(etag, &client.arena);
+    if (const auto body = sheet->cache.find(items->version(), kCsvCacheKey)) {
+      sendResponse(client, "HTTP/1.1 200 OK", "text/csv; charset=utf-8", body, headers);
+    } else {
+      sendStreamedResponse(client, "HTTP/1.1 200 OK", "text/csv; charset=utf-8",
+                           std::make_unique<CsvExportStream>(items, sheet->cache), headers);
+    }
+  } else if (method == "GET" && path == "/metrics" && sheetPath.name.empty()) {
+    sendResponse(client, "HTTP/1.1 200 OK", "text/plain; version=0.0.4; charset=utf-8", renderMetrics(),
+                 "Cache-Control: no-store\r\n");
+  } else if (method == "GET" && path == "/summary") {
+    const auto items = sheet->store.snapshot();
+    sendResponse(client, "HTTP/1.1 200 OK", "application/json; charset=utf-8", renderSummaryJson(items->summary()));
+  } else if (method == "GET" && path == "/edit") {
+    const csfj::FormFields queryValues(request.query, &client.arena);
+    const auto indexIt = queryValues.find("index");
+    if (indexIt == queryValues.end()) {
+      sendResponse(client, "HTTP/1.1 400 Bad Request", "text/plain; charset=utf-8", "Índice de item requerido");
+      return;
+    }
+    size_t itemIndex = 0U;
+    try {
+      itemIndex = static_cast<size_t>(std::stoul(std::string(indexIt->second)));
+    } catch (const std::exception&) {
+      sendResponse(client, "HTTP/1.1 400 Bad Request", "text/plain; charset=utf-8", "Índice de item inválido");
+      return;
+    }
+
+    const auto items = sheet->store.snapshot();
+    if (itemIndex >= items->size()) {
+      sendResponse(client, "HTTP/1.1 404 Not Found", "text/plain; charset=utf-8", "El item solicitado no existe");
+      return;
+    }
+
+    const auto html = renderEditPage(assets.editTemplate, itemIndex, (*items)[itemIndex]);
+    sendResponse(client, "HTTP/1.1 200 OK", "text/html; charset=utf-8", html);
+  } else if (method == "POST" && path == "/submit") {
+    if (request.header("content-type").find("application/x-www-form-urlencoded") == std::string_view::npos) {
+      sendResponse(client, "HTTP/1.1 415 Unsupported Media Type", "text/plain; charset=utf-8", "Contenido no soportado");
+      return;
+    }
+    handlePostSubmit(target, base, request.body, client);
+  } else if (method == "POST" && path == "/update") {
+    if (request.header("content-type").find("application/x-www-form-urlencoded") == std::string_view::npos) {
+      sendResponse(client, "HTTP/1.1 415 Unsupported Media Type", "text/plain; charset=utf-8", "Contenido no soportado");
+      return;
+    }
+    handlePostUpdate(target, base, request.body, client);
+  } else if (method == "POST" && path == "/import") {
+    if (!isCsvImport(request)) {
+      sendResponse(client, "HTTP/1.1 415 Unsupported Media Type", "text/plain; charset=utf-8", "Contenido no soportado");
+      return;
+    }
+    handlePostImport(target, client);
+  } else if (path.substr(0, kApiItemsPath.size()) == kApiItemsPath &&
+             (path.size() == kApiItemsPath.size() || path[kApiItemsPath.size()] == '/')) {
+    handleApiItems(target, base, client, path.substr(kApiItemsPath.size()));
+  } else {
+    sendNotFound(client);
+  }
+}
+
+class SocketEnvironment {
+public:
+  SocketEnvironment() {
+#ifdef _WIN32
+    WSADATA data;
+    if (WSAStartup(MAKEWORD(2, 2), &data) != 0) {
+      throw std::runtime_error("No se pudo inicializar Winsock");
+    }
+#endif
+  }
 
   ~SocketEnvironment() {
 #ifdef _WIN32
@@ -690,55 +1669,1036 @@ public:
   }
 };
 
-void runServer(unsigned short port) {
-  SocketEnvironment env;
+struct PollEvent {
+  SOCKET socket;
+  bool readable;
+  bool writable;
+};
 
-  SOCKET serverSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-  if (serverSocket == INVALID_SOCKET) {
-    throw std::runtime_error("No se pudo crear el socket del servidor");
+// Readiness notifications for the sockets owned by one worker. Linux uses an
+// edge-triggered epoll instance; other platforms fall back to poll/WSAPoll,
+// which is level-triggered, so write interest is only registered while a
+// response is pending.
+class Poller {
+public:
+  Poller();
+  ~Poller();
+  Poller(const Poller&) = delete;
+  Poller& operator=(const Poller&) = delete;
+
+  void watchListener(SOCKET listener);
+  void watch(SOCKET socket);
+  void unwatch(SOCKET socket);
+  void wantWrite(SOCKET socket, bool enabled);
+  void wait(std::vector<PollEvent>& events, int timeoutMs);
+
+private:
+#ifdef __linux__
+  int epollFd_ = -1;
+#else
+  std::vector<pollfd> sockets_;
+  std::unordered_map<SOCKET, size_t> slots_;
+#endif
+};
+
+#ifdef __linux__
+constexpr int kMaxPollEvents = 256;
+
+Poller::Poller() : epollFd_(epoll_create1(EPOLL_CLOEXEC)) {
+  if (epollFd_ == -1) {
+    throw std::runtime_error("No se pudo crear la instancia de epoll");
+  }
+}
+
+Poller::~Poller() {
+  close(epollFd_);
+}
+
+void Poller::watchListener(SOCKET listener) {
+  // Unless --reuse-port gives each worker its own, every worker waits on the
+  // same listener; EPOLLEXCLUSIVE wakes only one of them per incoming
+  // connection.
+  epoll_event event{};
+  event.events = EPOLLIN | EPOLLEXCLUSIVE;
+  event.data.fd = listener;
+  if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, listener, &event) == -1) {
+    throw std::runtime_error("No se pudo registrar el socket del servidor en epoll");
+  }
+}
+
+void Poller::watch(SOCKET socket) {
+  epoll_event event{};
+  event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+  event.data.fd = socket;
+  epoll_ctl(epollFd_, EPOLL_CTL_ADD, socket, &event);
+}
+
+void Poller::unwatch(SOCKET socket) {
+  epoll_ctl(epollFd_, EPOLL_CTL_DEL, socket, nullptr);
+}
+
+void Poller::wantWrite(SOCKET, bool) {
+  // Edge-triggered registrations already include EPOLLOUT.
+}
+
+void Poller::wait(std::vector<PollEvent>& events, int timeoutMs) {
+  events.clear();
+  epoll_event ready[kMaxPollEvents];
+  const int count = epoll_wait(epollFd_, ready, kMaxPollEvents, timeoutMs);
+  for (int index = 0; index < count; ++index) {
+    const uint32_t flags = ready[index].events;
+    events.push_back({ready[index].data.fd,
+                      (flags & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) != 0U,
+                      (flags & EPOLLOUT) != 0U});
+  }
+}
+#else
+Poller::Poller() = default;
+
+Poller::~Poller() = default;
+
+void Poller::watchListener(SOCKET listener) {
+  watch(listener);
+}
+
+void Poller::watch(SOCKET socket) {
+  slots_[socket] = sockets_.size();
+  pollfd entry{};
+  entry.fd = socket;
+  entry.events = POLLIN;
+  sockets_.push_back(entry);
+}
+
+void Poller::unwatch(SOCKET socket) {
+  const auto slotIt = slots_.find(socket);
+  if (slotIt == slots_.end()) {
+    return;
   }
+  const size_t slot = slotIt->second;
+  slots_.erase(slotIt);
+  if (slot + 1 != sockets_.size()) {
+    sockets_[slot] = sockets_.back();
+    slots_[sockets_[slot].fd] = slot;
+  }
+  sockets_.pop_back();
+}
 
-  int reuse = 1;
+void Poller::wantWrite(SOCKET socket, bool enabled) {
+  const auto slotIt = slots_.find(socket);
+  if (slotIt == slots_.end()) {
+    return;
+  }
+  auto& entry = sockets_[slotIt->second];
+  entry.events = enabled ? static_cast<short>(POLLIN | POLLOUT) : static_cast<short>(POLLIN);
+}
+
+void Poller::wait(std::vector<PollEvent>& events, int timeoutMs) {
+  events.clear();
 #ifdef _WIN32
-  setsockopt(serverSocket, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+  const int ready = WSAPoll(sockets_.data(), static_cast<ULONG>(sockets_.size()), timeoutMs);
+#else
+  const int ready = poll(sockets_.data(), static_cast<nfds_t>(sockets_.size()), timeoutMs);
+#endif
+  if (ready <= 0) {
+    return;
+  }
+  for (const pollfd& entry : sockets_) {
+    if (entry.revents == 0) {
+      continue;
+    }
+    events.push_back({entry.fd,
+                      (entry.revents & (POLLIN | POLLHUP | POLLERR)) != 0,
+                      (entry.revents & POLLOUT) != 0});
+  }
+}
+#endif
+
+// Appends the next piece of a streamed body to the (drained) output queue, with
+// chunk framing when the client speaks HTTP/1.1. The chunk size field is
+// written as a fixed-width placeholder and patched once the chunk is formatted,
+// so rows go straight into the queue's buffer.
+void pullBodyChunk(Connection& client) {
+  const auto start = std::chrono::steady_clock::now();
+  bool more = false;
+  client.output.write([&client, &more](std::string& out) {
+    constexpr std::string_view kSizePlaceholder = "00000000\r\n";
+    const size_t chunkStart = out.size();
+    if (client.chunkedBody) {
+      out.append(kSizePlaceholder.data(), kSizePlaceholder.size());
+    }
+    const size_t dataStart = out.size();
+    more = client.bodyStream->next(out);
+
+    if (client.chunkedBody) {
+      const size_t length = out.size() - dataStart;
+      if (length == 0U) {
+        out.resize(chunkStart);
+      } else {
+        static constexpr char kHexDigits[] = "0123456789abcdef";
+        for (size_t digit = 0; digit < 8U; ++digit) {
+          out[chunkStart + 7U - digit] = kHexDigits[(length >> (4U * digit)) & 0xFU];
+        }
+        out += "\r\n";
+      }
+      if (!more) {
+        out += "0\r\n\r\n";
+      }
+    }
+  });
+  if (!more) {
+    client.bodyStream.reset();
+  }
+  if (!client.inFlight.empty()) {
+    InFlightResponse& response = client.inFlight.back();
+    response.streamNanos += csfj::elapsedNanos(start, std::chrono::steady_clock::now());
+    if (!more) {
+      response.endOffset = client.output.queuedTotal();
+    }
+  }
+}
+
+// Writes as much of the queued output as the socket accepts without blocking,
+// up to kMaxGatherPieces pieces per call, refilling the queue from a streamed
+// body as it drains. Returns false when the peer is gone.
+bool flushOutput(Connection& client) {
+  std::string_view parts[kMaxGatherPieces];
+  while (true) {
+    while (!client.output.empty()) {
+      const size_t count = client.output.gather(parts, kMaxGatherPieces);
+      const long bytesSent = sendGather(client.socket, parts, count);
+      if (bytesSent > 0) {
+        client.output.consume(static_cast<size_t>(bytesSent));
+        client.lastActivity = std::chrono::steady_clock::now();
+        continue;
+      }
+      return bytesSent < 0 && lastSocketErrorWouldBlock();
+    }
+
+    if (!client.bodyStream) {
+      return true;
+    }
+    pullBodyChunk(client);
+  }
+}
+
+bool responsePending(const Connection& client) {
+  return !client.output.empty() || client.bodyStream != nullptr;
+}
+
+// Response bytes queued for the client but not sent yet.
+std::uint64_t outputBacklog(const Connection& client) {
+  return client.output.queuedTotal() - client.output.sentTotal();
+}
+
+bool writesDurable(const Connection& client) {
+  return client.awaitingSheet == nullptr || client.awaitingSheet->durable(client.awaitingSequence);
+}
+
+// Wakes one worker once a journal has synced a group commit, so the responses
+// it holds back for that fsync go out without the worker polling the journals.
+// The flushers only write to the pipe while the worker is armed, that is, while
+// it holds such responses, so idle workers sleep through commits.
+class DurabilityWakeup {
+public:
+  DurabilityWakeup() {
+#ifndef _WIN32
+    if (pipe(pipe_) != 0) {
+      throw std::runtime_error("No se pudo crear la tubería de aviso de escrituras durables");
+    }
+    for (const int descriptor : pipe_) {
+      setNonBlocking(descriptor);
+      fcntl(descriptor, F_SETFD, FD_CLOEXEC);
+    }
+#endif
+  }
+
+  ~DurabilityWakeup() {
+#ifndef _WIN32
+    close(pipe_[0]);
+    close(pipe_[1]);
+#endif
+  }
+
+  DurabilityWakeup(const DurabilityWakeup&) = delete;
+  DurabilityWakeup& operator=(const DurabilityWakeup&) = delete;
+
+  // The end the worker's poller watches; INVALID_SOCKET without a pipe.
+  SOCKET descriptor() const {
+#ifndef _WIN32
+    return pipe_[0];
 #else
-  setsockopt(serverSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    return INVALID_SOCKET;
 #endif
+  }
 
-  sockaddr_in serverAddress{};
-  serverAddress.sin_family = AF_INET;
-  serverAddress.sin_addr.s_addr = htonl(INADDR_ANY);
-  serverAddress.sin_port = htons(port);
+  // Called by the worker before it checks the journals. The fences pair with
+  // the one in notify(): either the worker sees the new durable sequence or the
+  // flusher sees the worker armed.
+  void arm(bool armed) {
+    armed_.store(armed, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+  }
 
-  if (bind(serverSocket, reinterpret_cast<sockaddr*>(&serverAddress), sizeof(serverAddress)) == SOCKET_ERROR) {
-    closeSocket(serverSocket);
-    throw std::runtime_error("No se pudo asociar el socket al puerto");
+  // Called by the journal flushers after advancing their durable sequence.
+  void notify() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!armed_.load(std::memory_order_relaxed)) {
+      return;
+    }
+#ifndef _WIN32
+    // A full pipe already holds a wakeup.
+    const char byte = 0;
+    [[maybe_unused]] const auto written = write(pipe_[1], &byte, 1);
+#endif
+  }
+
+  // Empties the pipe after the worker woke up on it.
+  void clear() {
+#ifndef _WIN32
+    char buffer[64];
+    while (read(pipe_[0], buffer, sizeof(buffer)) > 0) {
+    }
+#endif
   }
 
-  if (listen(serverSocket, SOMAXCONN) == SOCKET_ERROR) {
-    closeSocket(serverSocket);
+private:
+#ifndef _WIN32
+  int pipe_[2] = {-1, -1};
+#endif
+  std::atomic<bool> armed_{false};
+};
+
+struct ServerOptions {
+  unsigned short port = kServerPort;
+  // A numeric IPv4 or IPv6 address.
+  std::string bindAddress = kDefaultBindAddress;
+  // One SO_REUSEPORT listener per worker, each worker pinned to a core,
+  // instead of one listener shared by all of them.
+  bool reusePort = false;
+  bool noDelay = true;
+  // TCP_DEFER_ACCEPT: seconds the kernel holds a connection until its first
+  // bytes arrive before handing it to accept(). 0 leaves it off.
+  int deferAcceptSeconds = 0;
+  int drainTimeoutSeconds = kDefaultDrainTimeoutSeconds;
+  int workerCount = 1;
+  int keepAliveTimeoutSeconds = kDefaultKeepAliveTimeoutSeconds;
+  int headerTimeoutSeconds = kDefaultHeaderTimeoutSeconds;
+  int bodyTimeoutSeconds = kDefaultBodyTimeoutSeconds;
+  int sendTimeoutSeconds = kDefaultSendTimeoutSeconds;
+  int maxRequestsPerConnection = kDefaultMaxRequestsPerConnection;
+  int maxConnections = kDefaultMaxConnections;
+  csfj::RequestLimits limits;
+  std::string dataDirectory = kDefaultDataDirectory;
+  int maxSheets = kDefaultMaxSheets;
+  // When set, templates and static files come from here instead of the binary.
+  std::string assetDirectory;
+};
+
+// One reactor thread. Each worker owns its poller and every connection it
+// accepted, so connection state is never shared between threads. The listener
+// is either shared by all workers or, with --reuse-port, the worker's own.
+class Worker {
+public:
+  Worker(SOCKET listener,
+         const ServerOptions& options,
+         csfj::ThreadMetrics& metrics,
+         DurabilityWakeup& durability)
+      : listener_(listener),
+        idleTimeout_(std::chrono::seconds(options.keepAliveTimeoutSeconds)),
+        headerTimeout_(std::chrono::seconds(options.headerTimeoutSeconds)),
+        bodyTimeout_(std::chrono::seconds(options.bodyTimeoutSeconds)),
+        sendTimeout_(std::chrono::seconds(options.sendTimeoutSeconds)),
+        maxRequestsPerConnection_(options.maxRequestsPerConnection),
+        maxConnections_(options.maxConnections),
+        noDelay_(options.noDelay),
+        drainTimeout_(std::chrono::seconds(options.drainTimeoutSeconds)),
+        limits_(options.limits),
+        metrics_(metrics),
+        durability_(durability) {
+    poller_.watchListener(listener_);
+    if (durability_.descriptor() != INVALID_SOCKET) {
+      poller_.watch(durability_.descriptor());
+    }
+#ifndef _WIN32
+    wakeup_ = g_stopPipe[0];
+    poller_.watch(wakeup_);
+#endif
+  }
+
+  // Serves connections until a stop is requested, then returns once the
+  // drain (see beginDrain()) is over.
+  void run() {
+    std::vector<PollEvent> events;
+    auto lastSweep = std::chrono::steady_clock::now();
+    while (true) {
+      const bool pollDurability = !awaitingDurability_.empty() && durability_.descriptor() == INVALID_SOCKET;
+      poller_.wait(events, pollDurability ? kDurabilityPollMs : kIdleSweepIntervalMs);
+      for (const PollEvent& event : events) {
+        if (event.socket == listener_) {
+          if (!draining_) {
+            acceptPending();
+          }
+          continue;
+        }
+        if (event.socket == durability_.descriptor()) {
+          durability_.clear();
+          continue;
+        }
+        const auto connectionIt = connections_.find(event.socket);
+        if (connectionIt != connections_.end()) {
+          service(*connectionIt->second, event.readable);
+        }
+      }
+      resumeDurable();
+
+      const auto now = std::chrono::steady_clock::now();
+      if (!draining_ && g_stopRequested.load(std::memory_order_relaxed)) {
+        beginDrain(now);
+      }
+      if (draining_ && drained(now)) {
+        return;
+      }
+      if (now - lastSweep >= std::chrono::milliseconds(kIdleSweepIntervalMs)) {
+        enforceDeadlines(now);
+        lastSweep = now;
+      }
+    }
+  }
+
+private:
+  // Stops taking connections and lets the open ones finish. Connections the
+  // kernel already queued on the listener are still accepted, every response
+  // from here on carries Connection: close, and connections sitting between
+  // requests are closed. Whatever is still open at the deadline is dropped.
+  void beginDrain(std::chrono::steady_clock::time_point now) {
+    acceptPending();
+    poller_.unwatch(listener_);
+    if (wakeup_ != INVALID_SOCKET) {
+      // The pipe is never read, so it would keep a level-triggered poller awake.
+      poller_.unwatch(wakeup_);
+    }
+    draining_ = true;
+    drainDeadline_ = now + drainTimeout_;
+  }
+
+  // Closes the connections with nothing left to answer, including those that
+  // never sent a byte; true once none are left or the drain deadline has
+  // passed, after dropping the rest.
+  bool drained(std::chrono::steady_clock::time_point now) {
+    std::vector<SOCKET> closing;
+    for (const auto& [socket, connection] : connections_) {
+      const Connection& client = *connection;
+      const bool betweenRequests = writesDurable(client) && !responsePending(client) &&
+                                   !client.parser.headersParsed() && client.inputStart >= client.input.size();
+      if (betweenRequests || now >= drainDeadline_) {
+        closing.push_back(socket);
+      }
+    }
+    for (const SOCKET socket : closing) {
+      drop(socket);
+    }
+    return connections_.empty();
+  }
+
+  void acceptPending() {
+    while (true) {
+      const SOCKET clientSocket = accept(listener_, nullptr, nullptr);
+      if (clientSocket == INVALID_SOCKET) {
+        return;
+      }
+      if (!setNonBlocking(clientSocket)) {
+        closeSocket(clientSocket);
+        continue;
+      }
+      if (noDelay_) {
+        // Each response goes out in as few sends as the socket allows; Nagle's
+        // algorithm would only hold back its last partial segment until the
+        // client's delayed ACK.
+        setSocketOption(clientSocket, IPPROTO_TCP, TCP_NODELAY, 1);
+      }
+      if (g_openConnections.fetch_add(1, std::memory_order_relaxed) >= maxConnections_) {
+        g_openConnections.fetch_sub(1, std::memory_order_relaxed);
+        refuse(clientSocket);
+        continue;
+      }
+      auto connection = std::make_unique<Connection>();
+      connection->socket = clientSocket;
+      connection->parser = csfj::HttpRequestParser(limits_);
+      connection->lastActivity = std::chrono::steady_clock::now();
+      connections_.emplace(clientSocket, std::move(connection));
+      poller_.watch(clientSocket);
+    }
+  }
+
+  // How much unanswered input a connection may buffer: all of the request
+  // being parsed (up to the header limit until its headers tell its length)
+  // and some read-ahead.
+  size_t inputLimit(const Connection& connection) const {
+    const size_t current =
+        connection.parser.headersParsed() ? connection.request.length() : limits_.maxHeaderBytes;
+    return std::max(current, kInputReadAhead);
+  }
+
+  // Answers a socket event. Input is only read while the client keeps up with
+  // its responses, and only as much as inputLimit() allows, so a client that
+  // pipelines without reading cannot make the worker buffer without bound.
+  void service(Connection& connection, bool readable) {
+    connection.unreadInput = connection.unreadInput || readable;
+
+    // A streamed response holds back the pipelined requests behind it; once it
+    // has been written out, dispatch resumes on what is already buffered,
+    // including when it finishes on a later writable event.
+    bool resume = true;
+    while (resume) {
+      if (connection.unreadInput && !connection.closeAfterWrite && outputBacklog(connection) < kMaxOutputBacklog) {
+        if (!receivePending(connection, inputLimit(connection))) {
+          drop(connection.socket);
+          return;
+        }
+      }
+      const bool blocked = responsePending(connection);
+      resume = dispatchBuffered(connection) || blocked;
+      if (!writesDurable(connection)) {
+        if (std::find(awaitingDurability_.begin(), awaitingDurability_.end(), connection.socket) ==
+            awaitingDurability_.end()) {
+          awaitingDurability_.push_back(connection.socket);
+        }
+        return;
+      }
+      if (!flushOutput(connection)) {
+        drop(connection.socket);
+        return;
+      }
+      recordSent(connection);
+      if (responsePending(connection)) {
+        poller_.wantWrite(connection.socket, true);
+        return;
+      }
+      // Input held back while responses were queued can be read now.
+      resume = resume || (connection.unreadInput && !connection.closeAfterWrite);
+    }
+
+    poller_.wantWrite(connection.socket, false);
+    if (connection.closeAfterWrite || connection.peerClosed) {
+      drop(connection.socket);
+    }
+  }
+
+  // Answers every complete request in the buffer, in order, so pipelined
+  // requests are served back to back from a single read. Stops at a streamed
+  // response. Returns whether any request was answered.
+  bool dispatchBuffered(Connection& connection) {
+    bool dispatched = false;
+    while (!connection.closeAfterWrite && !connection.bodyStream && connection.inputStart < connection.input.size() &&
+           outputBacklog(connection) < kMaxOutputBacklog) {
+      const auto parseStart = std::chrono::steady_clock::now();
+      if (connection.requestStarted == std::chrono::steady_clock::time_point{}) {
+        connection.requestStarted = parseStart;
+      }
+      const csfj::ParseStatus status = parsePending(connection);
+      if (status == csfj::ParseStatus::kIncomplete) {
+        if (connection.parser.headersParsed()) {
+          if (connection.headersReceived == std::chrono::steady_clock::time_point{}) {
+            connection.headersReceived = parseStart;
+          }
+          if (isCsvImport(connection.request)) {
+            feedImportBody(connection);
+          }
+        }
+        connection.parseNanos += csfj::elapsedNanos(parseStart, std::chrono::steady_clock::now());
+        return dispatched;
+      }
+      const auto handlerStart = std::chrono::steady_clock::now();
+      connection.parseNanos += csfj::elapsedNanos(parseStart, handlerStart);
+      const std::uint64_t startOffset = connection.output.queuedTotal();
+      dispatched = true;
+      if (status == csfj::ParseStatus::kInvalid) {
+        reject(connection, "HTTP/1.1 400 Bad Request", "Petición inválida", csfj::Route::kOther, startOffset,
+               handlerStart);
+        return dispatched;
+      }
+      if (status == csfj::ParseStatus::kHeadersTooLarge) {
+        reject(connection, "HTTP/1.1 431 Request Header Fields Too Large",
+               "Las cabeceras de la petición son demasiado grandes.", csfj::Route::kOther, startOffset, handlerStart);
+        return dispatched;
+      }
+      if (status == csfj::ParseStatus::kTransferEncoding) {
+        reject(connection, "HTTP/1.1 501 Not Implemented",
+               "Transfer-Encoding no está soportado; envía el cuerpo con Content-Length.",
+               routeOf(connection.request.path), startOffset, handlerStart);
+        return dispatched;
+      }
+      if (status == csfj::ParseStatus::kBodyTooLarge) {
+        reject(connection, "HTTP/1.1 413 Payload Too Large", "El cuerpo de la petición es demasiado grande.",
+               routeOf(connection.request.path), startOffset, handlerStart);
+        return dispatched;
+      }
+
+      ++connection.requestsServed;
+      connection.keepAlive =
+          connection.request.keepAlive && connection.requestsServed < maxRequestsPerConnection_ && !draining_;
+      if (!connection.keepAlive) {
+        connection.closeAfterWrite = true;
+      }
+
+      try {
+        handleClient(connection);
+      } catch (const std::exception& ex) {
+        sendResponse(connection, "HTTP/1.1 500 Internal Server Error", "text/html; charset=utf-8",
+                     renderTemplateError(ex.what()));
+      }
+      queueSample(connection, routeOf(connection.request.path), connection.request.length(), startOffset,
+                  handlerStart);
+      consumeRequest(connection);
+    }
+    return dispatched;
+  }
+
+  // Releases the responses whose writes the journal has synced since the last
+  // check. Many connections usually share one fsync.
+  void resumeDurable() {
+    // Armed before the check, so a commit that lands after it still wakes the
+    // worker.
+    durability_.arm(!awaitingDurability_.empty());
+    if (awaitingDurability_.empty()) {
+      return;
+    }
+    std::vector<SOCKET> waiting;
+    waiting.swap(awaitingDurability_);
+    for (const SOCKET socket : waiting) {
+      const auto connectionIt = connections_.find(socket);
+      if (connectionIt == connections_.end()) {
+        continue;
+      }
+      if (writesDurable(*connectionIt->second)) {
+        service(*connectionIt->second, false);
+      } else {
+        awaitingDurability_.push_back(socket);
+      }
+    }
+  }
+
+  // Answers a request that cannot be served and closes the connection once the
+  // answer is sent; the rest of what the client sent is not read.
+  void reject(Connection& connection,
+              std::string_view statusLine,
+              std::string_view message,
+              csfj::Route route,
+              std::uint64_t startOffset,
+              std::chrono::steady_clock::time_point handlerStart) {
+    connection.keepAlive = false;
+    connection.closeAfterWrite = true;
+    sendResponse(connection, statusLine, "text/plain; charset=utf-8", message);
+    queueSample(connection, route, connection.input.size() - connection.inputStart, startOffset, handlerStart);
+  }
+
+  // Turns a client away when --max-connections are already open, without
+  // giving it a Connection. A request that already arrived is read first, so
+  // closing does not reset the connection before the 503 reaches the client.
+  void refuse(SOCKET socket) {
+    static constexpr std::string_view kMessage = "Servidor saturado, intente de nuevo.";
+    csfj::ResponseHead head;
+    appendHead(head, "HTTP/1.1 503 Service Unavailable", "text/plain; charset=utf-8", "Retry-After: 1\r\n",
+               kMessage.size());
+    head.append("Connection: close\r\n\r\n").append(kMessage);
+    char discarded[kSocketBufferSize];
+    recv(socket, discarded, sizeof(discarded), 0);
+    const auto sent = send(socket, head.view().data(), static_cast<int>(head.view().size()), kSendFlags);
+    closeSocket(socket);
+
+    csfj::RequestSample sample;
+    sample.status = 503;
+    sample.bytesOut = sent > 0 ? static_cast<std::uint64_t>(sent) : 0U;
+    metrics_.record(sample);
+  }
+
+  // Enforces the deadlines of every connection: a response must keep making
+  // progress, a request must arrive in full in time, and a connection between
+  // requests may only stay idle so long. Late requests are answered with 408.
+  void enforceDeadlines(std::chrono::steady_clock::time_point now) {
+    std::vector<SOCKET> expired;
+    std::vector<SOCKET> late;
+    for (const auto& [socket, connection] : connections_) {
+      const Connection& client = *connection;
+      if (!writesDurable(client)) {
+        // Waiting for the journal, not for the client.
+        continue;
+      }
+      if (responsePending(client)) {
+        if (now - client.lastActivity >= sendTimeout_) {
+          expired.push_back(socket);
+        }
+      } else if (client.closeAfterWrite) {
+        continue;
+      } else if (client.parser.headersParsed()) {
+        if (now - client.headersReceived >= bodyTimeout_) {
+          late.push_back(socket);
+        }
+      } else if (client.inputStart < client.input.size()) {
+        if (now - client.requestStarted >= headerTimeout_) {
+          late.push_back(socket);
+        }
+      } else if (now - client.lastActivity >= idleTimeout_) {
+        expired.push_back(socket);
+      }
+    }
+    for (const SOCKET socket : expired) {
+      drop(socket);
+    }
+    for (const SOCKET socket : late) {
+      Connection& connection = *connections_.at(socket);
+      const std::uint64_t startOffset = connection.output.queuedTotal();
+      reject(connection, "HTTP/1.1 408 Request Timeout", "La petición no llegó completa a tiempo.",
+             csfj::Route::kOther, startOffset, now);
+      service(connection, false);
+    }
+  }
+
+  // Remembers the response the handler just queued; it is recorded once the
+  // socket has taken all of it.
+  void queueSample(Connection& connection,
+                   csfj::Route route,
+                   size_t bytesIn,
+                   std::uint64_t startOffset,
+                   std::chrono::steady_clock::time_point handlerStart) {
+    InFlightResponse& response = connection.inFlight.emplace_back();
+    response.queued = std::chrono::steady_clock::now();
+    response.started = connection.requestStarted;
+    response.startOffset = startOffset;
+    response.endOffset = connection.bodyStream ? InFlightResponse::kStreaming : connection.output.queuedTotal();
+
+    csfj::RequestSample& sample = response.sample;
+    sample.route = route;
+    sample.status = connection.responseStatus;
+    sample.bytesIn = bytesIn;
+    const std::uint64_t lockWait = csfj::ItemStore::takeLockWaitNanos();
+    const std::uint64_t handling = csfj::elapsedNanos(handlerStart, response.queued);
+    sample.nanos[static_cast<size_t>(csfj::Phase::kParse)] = connection.parseNanos;
+    sample.nanos[static_cast<size_t>(csfj::Phase::kLockWait)] = lockWait;
+    sample.nanos[static_cast<size_t>(csfj::Phase::kRender)] = handling > lockWait ? handling - lockWait : 0U;
+  }
+
+  // Records every response whose last byte the socket has taken. When the
+  // connection is being dropped, `dropping` records the rest with what was
+  // sent of them.
+  void recordSent(Connection& connection, bool dropping = false) {
+    const auto now = std::chrono::steady_clock::now();
+    const std::uint64_t sent = connection.output.sentTotal();
+    size_t done = 0U;
+    for (; done < connection.inFlight.size(); ++done) {
+      InFlightResponse& response = connection.inFlight[done];
+      if (response.endOffset > sent && !dropping) {
+        break;
+      }
+      csfj::RequestSample& sample = response.sample;
+      const std::uint64_t sending = csfj::elapsedNanos(response.queued, now);
+      sample.bytesOut = std::min(response.endOffset, sent) - std::min(response.startOffset, sent);
+      sample.nanos[static_cast<size_t>(csfj::Phase::kRender)] += response.streamNanos;
+      sample.nanos[static_cast<size_t>(csfj::Phase::kSend)] =
+          sending > response.streamNanos ? sending - response.streamNanos : 0U;
+      sample.nanos[static_cast<size_t>(csfj::Phase::kTotal)] = csfj::elapsedNanos(response.started, now);
+      metrics_.record(sample);
+    }
+    connection.inFlight.erase(connection.inFlight.begin(), connection.inFlight.begin() + done);
+  }
+
+  void drop(SOCKET socket) {
+    const auto connectionIt = connections_.find(socket);
+    if (connectionIt != connections_.end()) {
+      recordSent(*connectionIt->second, true);
+      g_openConnections.fetch_sub(1, std::memory_order_relaxed);
+    }
+    poller_.unwatch(socket);
+    closeSocket(socket);
+    connections_.erase(socket);
+  }
+
+  SOCKET listener_;
+  std::chrono::steady_clock::duration idleTimeout_;
+  std::chrono::steady_clock::duration headerTimeout_;
+  std::chrono::steady_clock::duration bodyTimeout_;
+  std::chrono::steady_clock::duration sendTimeout_;
+  int maxRequestsPerConnection_;
+  int maxConnections_;
+  bool noDelay_;
+  std::chrono::steady_clock::duration drainTimeout_;
+  csfj::RequestLimits limits_;
+  csfj::ThreadMetrics& metrics_;
+  DurabilityWakeup& durability_;
+  SOCKET wakeup_ = INVALID_SOCKET;
+  bool draining_ = false;
+  std::chrono::steady_clock::time_point drainDeadline_;
+  Poller poller_;
+  std::unordered_map<SOCKET, std::unique_ptr<Connection>> connections_;
+  std::vector<SOCKET> awaitingDurability_;
+};
+
+int parsePositiveOption(const std::string& name, const std::string& value) {
+  try {
+    size_t consumed = 0U;
+    const int parsed = std::stoi(value, &consumed);
+    if (consumed == value.size() && parsed > 0) {
+      return parsed;
+    }
+  } catch (const std::exception&) {
+  }
+  throw std::invalid_argument("Valor inválido para " + name + ": " + value);
+}
+
+ServerOptions parseServerOptions(int argc, char** argv) {
+  ServerOptions options;
+  const unsigned int hardwareThreads = std::thread::hardware_concurrency();
+  options.workerCount = hardwareThreads == 0U ? 1 : static_cast<int>(hardwareThreads);
+
+  for (int index = 1; index < argc; ++index) {
+    const std::string argument = argv[index];
+    if (argument == "--workers" && index + 1 < argc) {
+      options.workerCount = parsePositiveOption(argument, argv[++index]);
+    } else if (argument == "--port" && index + 1 < argc) {
+      const std::string value = argv[++index];
+      const int port = parsePositiveOption(argument, value);
+      if (port > 65535) {
+        throw std::invalid_argument("Valor inválido para " + argument + ": " + value);
+      }
+      options.port = static_cast<unsigned short>(port);
+    } else if (argument == "--bind" && index + 1 < argc) {
+      options.bindAddress = argv[++index];
+    } else if (argument == "--reuse-port") {
+#ifdef __linux__
+      options.reusePort = true;
+#else
+      throw std::invalid_argument("--reuse-port solo está disponible en Linux");
+#endif
+    } else if (argument == "--no-tcp-nodelay") {
+      options.noDelay = false;
+    } else if (argument == "--defer-accept" && index + 1 < argc) {
+#ifdef __linux__
+      options.deferAcceptSeconds = parsePositiveOption(argument, argv[++index]);
+#else
+      throw std::invalid_argument("--defer-accept solo está disponible en Linux");
+#endif
+    } else if (argument == "--drain-timeout" && index + 1 < argc) {
+      options.drainTimeoutSeconds = parsePositiveOption(argument, argv[++index]);
+    } else if (argument == "--keep-alive-timeout" && index + 1 < argc) {
+      options.keepAliveTimeoutSeconds = parsePositiveOption(argument, argv[++index]);
+    } else if (argument == "--header-timeout" && index + 1 < argc) {
+      options.headerTimeoutSeconds = parsePositiveOption(argument, argv[++index]);
+    } else if (argument == "--body-timeout" && index + 1 < argc) {
+      options.bodyTimeoutSeconds = parsePositiveOption(argument, argv[++index]);
+    } else if (argument == "--send-timeout" && index + 1 < argc) {
+      options.sendTimeoutSeconds = parsePositiveOption(argument, argv[++index]);
+    } else if (argument == "--max-requests" && index + 1 < argc) {
+      options.maxRequestsPerConnection = parsePositiveOption(argument, argv[++index]);
+    } else if (argument == "--max-connections" && index + 1 < argc) {
+      options.maxConnections = parsePositiveOption(argument, argv[++index]);
+    } else if (argument == "--max-header-bytes" && index + 1 < argc) {
+      options.limits.maxHeaderBytes = static_cast<size_t>(parsePositiveOption(argument, argv[++index]));
+    } else if (argument == "--max-body-bytes" && index + 1 < argc) {
+      options.limits.maxBodyBytes = static_cast<size_t>(parsePositiveOption(argument, argv[++index]));
+    } else if (argument == "--max-sheets" && index + 1 < argc) {
+      options.maxSheets = parsePositiveOption(argument, argv[++index]);
+    } else if (argument == "--data-dir" && index + 1 < argc) {
+      options.dataDirectory = argv[++index];
+    } else if (argument == "--dev-assets" && index + 1 < argc) {
+      options.assetDirectory = argv[++index];
+    } else {
+      throw std::invalid_argument("Argumento desconocido: " + argument);
+    }
+  }
+  return options;
+}
+
+// Resolves --bind, which must be a numeric address, together with the port.
+std::unique_ptr<addrinfo, decltype(&freeaddrinfo)> resolveBindAddress(const ServerOptions& options) {
+  addrinfo hints{};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_protocol = IPPROTO_TCP;
+  hints.ai_flags = AI_PASSIVE | AI_NUMERICHOST | AI_NUMERICSERV;
+  addrinfo* resolved = nullptr;
+  if (getaddrinfo(options.bindAddress.c_str(), std::to_string(options.port).c_str(), &hints, &resolved) != 0 ||
+      resolved == nullptr) {
+    throw std::invalid_argument("Dirección inválida para --bind: " + options.bindAddress);
+  }
+  return {resolved, &freeaddrinfo};
+}
+
+// Opens a non-blocking listening socket. With --reuse-port every worker opens
+// its own on the same address and the kernel spreads new connections across
+// them.
+SOCKET openListener(const addrinfo& address, const ServerOptions& options) {
+  SOCKET listener = socket(address.ai_family, address.ai_socktype, address.ai_protocol);
+  if (listener == INVALID_SOCKET) {
+    throw std::runtime_error("No se pudo crear el socket del servidor");
+  }
+
+  setSocketOption(listener, SOL_SOCKET, SO_REUSEADDR, 1);
+#ifdef __linux__
+  if (options.reusePort && !setSocketOption(listener, SOL_SOCKET, SO_REUSEPORT, 1)) {
+    closeSocket(listener);
+    throw std::runtime_error("No se pudo activar SO_REUSEPORT en el socket del servidor");
+  }
+  if (options.deferAcceptSeconds > 0) {
+    setSocketOption(listener, IPPROTO_TCP, TCP_DEFER_ACCEPT, options.deferAcceptSeconds);
+  }
+#endif
+
+  if (bind(listener, address.ai_addr, static_cast<int>(address.ai_addrlen)) == SOCKET_ERROR) {
+    closeSocket(listener);
+    throw std::runtime_error("No se pudo asociar el socket a " + options.bindAddress + ":" +
+                             std::to_string(options.port));
+  }
+
+  if (listen(listener, SOMAXCONN) == SOCKET_ERROR) {
+    closeSocket(listener);
     throw std::runtime_error("No se pudo iniciar la escucha del servidor");
   }
 
-  std::cout << "Servidor iniciado en http://localhost:" << port << std::endl;
+  if (!setNonBlocking(listener)) {
+    closeSocket(listener);
+    throw std::runtime_error("No se pudo configurar el socket del servidor como no bloqueante");
+  }
+  return listener;
+}
 
-  while (true) {
-    SOCKET clientSocket = accept(serverSocket, nullptr, nullptr);
-    if (clientSocket == INVALID_SOCKET) {
-      continue;
+#ifdef __linux__
+// The CPUs this process may run on, in order.
+std::vector<int> allowedCpus() {
+  std::vector<int> cpus;
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &allowed)) {
+        cpus.push_back(cpu);
+      }
+    }
+  }
+  return cpus;
+}
+
+void pinCurrentThread(int cpu) {
+  cpu_set_t single;
+  CPU_ZERO(&single);
+  CPU_SET(cpu, &single);
+  pthread_setaffinity_np(pthread_self(), sizeof(single), &single);
+}
+#endif
+
+// Sets up the stop signals; see requestStop(). They stay installed while the
+// sheets are closed, so a second signal still cuts that short.
+void installStopHandlers() {
+#ifndef _WIN32
+  if (pipe(g_stopPipe) != 0) {
+    throw std::runtime_error("No se pudo crear la tubería de parada");
+  }
+  for (const int descriptor : g_stopPipe) {
+    setNonBlocking(descriptor);
+    fcntl(descriptor, F_SETFD, FD_CLOEXEC);
+  }
+#endif
+  std::signal(SIGINT, requestStop);
+  std::signal(SIGTERM, requestStop);
+}
+
+void runServer(const ServerOptions& options) {
+  SocketEnvironment env;
+
+  const auto address = resolveBindAddress(options);
+  std::vector<SOCKET> listeners;
+  const size_t listenerCount = options.reusePort ? static_cast<size_t>(options.workerCount) : 1U;
+  try {
+    while (listeners.size() < listenerCount) {
+      listeners.push_back(openListener(*address, options));
+    }
+  } catch (...) {
+    for (const SOCKET listener : listeners) {
+      closeSocket(listener);
     }
-    handleClient(clientSocket);
-    closeSocket(clientSocket);
+    throw;
   }
 
-  closeSocket(serverSocket);
+  // Created before the sheets, whose flushers notify them until they close.
+  std::vector<std::unique_ptr<DurabilityWakeup>> durabilityWakeups;
+  while (durabilityWakeups.size() < static_cast<size_t>(options.workerCount)) {
+    durabilityWakeups.push_back(std::make_unique<DurabilityWakeup>());
+  }
+  csfj::SheetRegistry sheets(options.dataDirectory, kCompactionThresholdBytes, kResponseCacheEntries,
+                             static_cast<size_t>(options.maxSheets), [&durabilityWakeups] {
+                               for (const auto& wakeup : durabilityWakeups) {
+                                 wakeup->notify();
+                               }
+                             });
+  sheets.open();
+  g_sheets = &sheets;
+
+  csfj::DirectoryWatcher assetWatcher;
+  if (options.assetDirectory.empty()) {
+    g_assets.store(embeddedAssets().release(), std::memory_order_release);
+  } else {
+    const std::filesystem::path directory = options.assetDirectory;
+    g_assets.store(loadAssets(directory, 0U).release(), std::memory_order_release);
+    if (assetWatcher.start({directory / "templates", directory / "static"}, [directory] { reloadAssets(directory); })) {
+      std::cout << "Plantillas y archivos estáticos leídos de " << directory.string()
+                << "; se recargan al modificarse" << std::endl;
+    } else {
+      std::cout << "Plantillas y archivos estáticos leídos de " << directory.string()
+                << "; la recarga automática no está disponible en esta plataforma" << std::endl;
+    }
+  }
+
+  installStopHandlers();
+  std::vector<std::unique_ptr<Worker>> workers;
+  for (size_t index = 0; index < static_cast<size_t>(options.workerCount); ++index) {
+    workers.push_back(std::make_unique<Worker>(listeners[index % listeners.size()], options,
+                                               g_metrics.registerThread(), *durabilityWakeups[index]));
+  }
+
+  const bool anyAddress = options.bindAddress == "0.0.0.0" || options.bindAddress == "::";
+  const std::string host = anyAddress                                          ? std::string("localhost")
+                           : options.bindAddress.find(':') != std::string::npos ? "[" + options.bindAddress + "]"
+                                                                                : options.bindAddress;
+  std::cout << "Servidor iniciado en http://" << host << ":" << options.port << " con " << options.workerCount
+            << " hilo(s) de trabajo"
+            << (options.reusePort ? ", cada uno con su propio socket SO_REUSEPORT y fijo a un núcleo" : "")
+            << std::endl;
+  std::cout << "Datos en " << options.dataDirectory << " (" << sheets.defaultSheet().store.snapshot()->size()
+            << " item(s) recuperado(s) en la hoja principal, " << sheets.size() << " hoja(s) con nombre)" << std::endl;
+
+  // Worker i runs on the i-th allowed CPU (wrapping around), so the
+  // connections its listener receives stay on one core.
+#ifdef __linux__
+  const std::vector<int> cpus = options.reusePort ? allowedCpus() : std::vector<int>();
+#endif
+  const auto runWorker = [&](size_t index) {
+#ifdef __linux__
+    if (!cpus.empty()) {
+      pinCurrentThread(cpus[index % cpus.size()]);
+    }
+#endif
+    workers[index]->run();
+  };
+  std::vector<std::thread> threads;
+  for (size_t index = 1; index < workers.size(); ++index) {
+    threads.emplace_back(runWorker, index);
+  }
+  runWorker(0U);
+
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  for (const SOCKET listener : listeners) {
+    closeSocket(listener);
+  }
+  g_sheets = nullptr;
+  std::cout << "Servidor detenido; guardando los datos pendientes" << std::endl;
 }
 
 }  // namespace
 
-int main() {
+int main(int argc, char** argv) {
   try {
-    runServer(kServerPort);
+    runServer(parseServerOptions(argc, argv));
   } catch (const std::exception& ex) {
     std::cerr << "Error fatal: " << ex.what() << std::endl;
     return 1;
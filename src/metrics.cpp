@@ -0,0 +1,275 @@
+#include "metrics.hpp"
+
+#include <cstdio>
+#include <memory>
+
+#include "text_format.hpp"
+
+namespace csfj {
+
+namespace {
+
+constexpr std::string_view kRouteLabels[kRouteCount] = {
+    "/",       "/rows",   "/edit",   "/export",    "/summary", "/static",
+    "/submit", "/update", "/import", "/api/items", "/metrics", "other",
+};
+
+constexpr std::string_view kPhaseLabels[kPhaseCount] = {"parse", "lock_wait", "render", "send", "total"};
+
+// Histogram boundaries exposed to Prometheus: every other power of two of
+// nanoseconds, about 1 µs to 68.7 s. They coincide with fine bucket edges, so
+// the coarse counts are exact.
+constexpr unsigned kFirstBoundaryBit = 10U;
+constexpr unsigned kBoundaryStep = 2U;
+
+constexpr double kQuantiles[] = {0.5, 0.9, 0.99, 0.999};
+
+unsigned highestBit(std::uint64_t value) {
+  unsigned bit = 0U;
+  while (value >>= 1U) {
+    ++bit;
+  }
+  return bit;
+}
+
+void appendSeconds(std::string& out, double nanos) {
+  char text[32];
+  const int length = std::snprintf(text, sizeof(text), "%.9g", nanos / 1e9);
+  out.append(text, static_cast<size_t>(length));
+}
+
+void appendUnsigned(std::string& out, std::uint64_t value) {
+  appendInteger(out, static_cast<long long>(value));
+}
+
+void appendFamily(std::string& out, std::string_view name, std::string_view type, std::string_view help) {
+  out.append("# HELP ").append(name).append(" ").append(help).append("\n");
+  out.append("# TYPE ").append(name).append(" ").append(type).append("\n");
+}
+
+void appendRouteLabel(std::string& out, std::string_view metric, size_t route) {
+  out.append(metric).append("{route=\"").append(kRouteLabels[route]).append("\"");
+}
+
+// The counters of every thread added together. Each value is read once, so
+// the totals may mix requests finished during the scrape with older ones, which
+// Prometheus tolerates.
+struct RouteTotals {
+  std::uint64_t requests = 0U;
+  std::uint64_t bytesIn = 0U;
+  std::uint64_t bytesOut = 0U;
+  std::uint64_t statuses[kStatusSlots] = {};
+  struct Histogram {
+    std::uint64_t count = 0U;
+    std::uint64_t sumNanos = 0U;
+    std::uint64_t buckets[LatencyHistogram::kBucketCount] = {};
+  } phases[kPhaseCount];
+
+  void add(const RouteMetrics& metrics) {
+    requests += metrics.requests.load(std::memory_order_relaxed);
+    bytesIn += metrics.bytesIn.load(std::memory_order_relaxed);
+    bytesOut += metrics.bytesOut.load(std::memory_order_relaxed);
+    for (size_t slot = 0; slot < kStatusSlots; ++slot) {
+      statuses[slot] += metrics.statuses[slot].load(std::memory_order_relaxed);
+    }
+    for (size_t phase = 0; phase < kPhaseCount; ++phase) {
+      const LatencyHistogram& source = metrics.phases[phase];
+      Histogram& target = phases[phase];
+      target.count += source.count();
+      target.sumNanos += source.sumNanos();
+      for (size_t bucket = 0; bucket < LatencyHistogram::kBucketCount; ++bucket) {
+        target.buckets[bucket] += source.bucket(bucket);
+      }
+    }
+  }
+};
+
+// Smallest recorded value such that at least `quantile` of the samples are at
+// or below it, to the histogram's precision.
+std::uint64_t valueAtQuantile(const RouteTotals::Histogram& histogram, double quantile) {
+  const auto rank = static_cast<std::uint64_t>(quantile * static_cast<double>(histogram.count) + 0.5);
+  std::uint64_t seen = 0U;
+  for (size_t bucket = 0; bucket < LatencyHistogram::kBucketCount; ++bucket) {
+    seen += histogram.buckets[bucket];
+    if (seen >= rank && seen > 0U) {
+      return LatencyHistogram::bucketUpperBound(bucket);
+    }
+  }
+  return LatencyHistogram::kMaxNanos;
+}
+
+}  // namespace
+
+size_t LatencyHistogram::bucketFor(std::uint64_t nanos) {
+  if (nanos > kMaxNanos) {
+    nanos = kMaxNanos;
+  }
+  if (nanos < 2U * kSubBuckets) {
+    return static_cast<size_t>(nanos);
+  }
+  // The top kSubBucketBits + 1 bits pick the bucket within the value's power
+  // of two.
+  const unsigned bit = highestBit(nanos);
+  const std::uint64_t top = nanos >> (bit - kSubBucketBits);
+  return static_cast<size_t>((bit - kSubBucketBits + 1U) * kSubBuckets + (top - kSubBuckets));
+}
+
+std::uint64_t LatencyHistogram::bucketUpperBound(size_t bucket) {
+  if (bucket < 2U * kSubBuckets) {
+    return bucket;
+  }
+  const size_t group = bucket / kSubBuckets;
+  const std::uint64_t top = kSubBuckets + bucket % kSubBuckets;
+  const auto shift = static_cast<unsigned>(group - 1U);
+  return ((top + 1U) << shift) - 1U;
+}
+
+void LatencyHistogram::record(std::uint64_t nanos) {
+  bump(buckets_[bucketFor(nanos)]);
+  bump(count_);
+  bump(sumNanos_, nanos);
+}
+
+void ThreadMetrics::record(const RequestSample& sample) {
+  RouteMetrics& metrics = routes_[static_cast<size_t>(sample.route)];
+  bump(metrics.requests);
+  bump(metrics.bytesIn, sample.bytesIn);
+  bump(metrics.bytesOut, sample.bytesOut);
+
+  size_t slot = kCountedStatuses.size();
+  for (size_t index = 0; index < kCountedStatuses.size(); ++index) {
+    if (kCountedStatuses[index] == sample.status) {
+      slot = index;
+      break;
+    }
+  }
+  bump(metrics.statuses[slot]);
+
+  for (size_t phase = 0; phase < kPhaseCount; ++phase) {
+    metrics.phases[phase].record(sample.nanos[phase]);
+  }
+}
+
+ThreadMetrics& MetricsRegistry::registerThread() {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return threads_.emplace_back();
+}
+
+void MetricsRegistry::writePrometheus(std::string& out) const {
+  // About 130 KiB per scrape; kept off the worker's stack.
+  auto totals = std::make_unique<RouteTotals[]>(kRouteCount);
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    for (const ThreadMetrics& thread : threads_) {
+      for (size_t route = 0; route < kRouteCount; ++route) {
+        totals[route].add(thread.route(static_cast<Route>(route)));
+      }
+    }
+  }
+
+  appendFamily(out, "csfj_http_requests_total", "counter", "Peticiones respondidas, por ruta y código de estado.");
+  for (size_t route = 0; route < kRouteCount; ++route) {
+    for (size_t slot = 0; slot < kStatusSlots; ++slot) {
+      if (totals[route].statuses[slot] == 0U) {
+        continue;
+      }
+      appendRouteLabel(out, "csfj_http_requests_total", route);
+      out.append(",code=\"");
+      if (slot < kCountedStatuses.size()) {
+        appendInteger(out, kCountedStatuses[slot]);
+      } else {
+        out.append("other");
+      }
+      out.append("\"} ");
+      appendUnsigned(out, totals[route].statuses[slot]);
+      out.push_back('\n');
+    }
+  }
+
+  appendFamily(out, "csfj_http_request_bytes_total", "counter", "Bytes recibidos en peticiones, por ruta.");
+  for (size_t route = 0; route < kRouteCount; ++route) {
+    if (totals[route].requests != 0U) {
+      appendRouteLabel(out, "csfj_http_request_bytes_total", route);
+      out.append("} ");
+      appendUnsigned(out, totals[route].bytesIn);
+      out.push_back('\n');
+    }
+  }
+
+  appendFamily(out, "csfj_http_response_bytes_total", "counter", "Bytes enviados en respuestas, por ruta.");
+  for (size_t route = 0; route < kRouteCount; ++route) {
+    if (totals[route].requests != 0U) {
+      appendRouteLabel(out, "csfj_http_response_bytes_total", route);
+      out.append("} ");
+      appendUnsigned(out, totals[route].bytesOut);
+      out.push_back('\n');
+    }
+  }
+
+  appendFamily(out, "csfj_http_request_duration_seconds", "histogram",
+               "Duración de las peticiones, por ruta y fase (parse, lock_wait, render, send, total).");
+  for (size_t route = 0; route < kRouteCount; ++route) {
+    for (size_t phase = 0; phase < kPhaseCount; ++phase) {
+      const RouteTotals::Histogram& histogram = totals[route].phases[phase];
+      if (histogram.count == 0U) {
+        continue;
+      }
+      std::uint64_t cumulative = 0U;
+      size_t bucket = 0U;
+      for (unsigned bit = kFirstBoundaryBit; bit <= LatencyHistogram::kMaxBits; bit += kBoundaryStep) {
+        const std::uint64_t boundary = std::uint64_t{1} << bit;
+        for (; bucket < LatencyHistogram::kBucketCount && LatencyHistogram::bucketUpperBound(bucket) < boundary;
+             ++bucket) {
+          cumulative += histogram.buckets[bucket];
+        }
+        appendRouteLabel(out, "csfj_http_request_duration_seconds_bucket", route);
+        out.append(",phase=\"").append(kPhaseLabels[phase]).append("\",le=\"");
+        appendSeconds(out, static_cast<double>(boundary));
+        out.append("\"} ");
+        appendUnsigned(out, cumulative);
+        out.push_back('\n');
+      }
+      appendRouteLabel(out, "csfj_http_request_duration_seconds_bucket", route);
+      out.append(",phase=\"").append(kPhaseLabels[phase]).append("\",le=\"+Inf\"} ");
+      appendUnsigned(out, histogram.count);
+      out.push_back('\n');
+
+      appendRouteLabel(out, "csfj_http_request_duration_seconds_sum", route);
+      out.append(",phase=\"").append(kPhaseLabels[phase]).append("\"} ");
+      appendSeconds(out, static_cast<double>(histogram.sumNanos));
+      out.push_back('\n');
+      appendRouteLabel(out, "csfj_http_request_duration_seconds_count", route);
+      out.append(",phase=\"").append(kPhaseLabels[phase]).append("\"} ");
+      appendUnsigned(out, histogram.count);
+      out.push_back('\n');
+    }
+  }
+
+  // The coarse buckets above aggregate well across instances; these quantiles
+  // come from the fine buckets and are only meaningful per instance.
+  appendFamily(out, "csfj_http_request_duration_quantile_seconds", "gauge",
+               "Cuantiles de duración desde el arranque, por ruta y fase, con un error relativo máximo de 12,5 %.");
+  for (size_t route = 0; route < kRouteCount; ++route) {
+    for (size_t phase = 0; phase < kPhaseCount; ++phase) {
+      const RouteTotals::Histogram& histogram = totals[route].phases[phase];
+      if (histogram.count == 0U) {
+        continue;
+      }
+      for (const double quantile : kQuantiles) {
+        char label[16];
+        const int length = std::snprintf(label, sizeof(label), "%g", quantile);
+        appendRouteLabel(out, "csfj_http_request_duration_quantile_seconds", route);
+        out.append(",phase=\"").append(kPhaseLabels[phase]).append("\",quantile=\"");
+        out.append(label, static_cast<size_t>(length)).append("\"} ");
+        appendSeconds(out, static_cast<double>(valueAtQuantile(histogram, quantile)));
+        out.push_back('\n');
+      }
+    }
+  }
+}
+
+std::string_view routeLabel(Route route) {
+  return kRouteLabels[static_cast<size_t>(route)];
+}
+
+}  // namespace csfj
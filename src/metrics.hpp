@@ -0,0 +1,151 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+namespace csfj {
+
+enum class Route : size_t {
+  kIndex,
+  kRows,
+  kEdit,
+  kExport,
+  kSummary,
+  kStatic,
+  kSubmit,
+  kUpdate,
+  kImport,
+  kApiItems,
+  kMetrics,
+  kOther,
+  kCount,
+};
+
+// Where a request's time goes. kParse is the CPU spent parsing it, kLockWait
+// the wait for the item store's write mutex, or for its index lock while a
+// write publishes (other reads never wait), kRender the rest of the handler
+// plus formatting streamed bodies, kSend the time from the response being
+// queued until the socket took its last byte (including any wait for the
+// write to become durable), kTotal all of it from the first parse attempt.
+enum class Phase : size_t {
+  kParse,
+  kLockWait,
+  kRender,
+  kSend,
+  kTotal,
+  kCount,
+};
+
+constexpr size_t kRouteCount = static_cast<size_t>(Route::kCount);
+constexpr size_t kPhaseCount = static_cast<size_t>(Phase::kCount);
+
+// Adds to a counter that only its owning thread writes, so a relaxed load and
+// store replace the locked read-modify-write; readers on other threads see a
+// slightly stale but never torn value.
+inline void bump(std::atomic<std::uint64_t>& counter, std::uint64_t amount = 1U) {
+  counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+// Log-linear histogram in the style of HdrHistogram: each power of two of
+// nanoseconds is split into kSubBuckets equal buckets, so any recorded value is
+// known to within 1/kSubBuckets (12.5%) from 1 ns up to kMaxNanos (~68 s);
+// larger values land in the last bucket. Single writer, like bump().
+class LatencyHistogram {
+public:
+  static constexpr unsigned kSubBucketBits = 3U;
+  static constexpr std::uint64_t kSubBuckets = std::uint64_t{1} << kSubBucketBits;
+  static constexpr unsigned kMaxBits = 36U;
+  static constexpr std::uint64_t kMaxNanos = (std::uint64_t{1} << kMaxBits) - 1U;
+  static constexpr size_t kBucketCount = (kMaxBits - kSubBucketBits + 1U) * kSubBuckets;
+
+  void record(std::uint64_t nanos);
+
+  static size_t bucketFor(std::uint64_t nanos);
+  // Largest value that falls in `bucket`.
+  static std::uint64_t bucketUpperBound(size_t bucket);
+
+  std::uint64_t count() const {
+    return count_.load(std::memory_order_relaxed);
+  }
+
+  std::uint64_t sumNanos() const {
+    return sumNanos_.load(std::memory_order_relaxed);
+  }
+
+  std::uint64_t bucket(size_t index) const {
+    return buckets_[index].load(std::memory_order_relaxed);
+  }
+
+private:
+  std::array<std::atomic<std::uint64_t>, kBucketCount> buckets_{};
+  std::atomic<std::uint64_t> count_{0U};
+  std::atomic<std::uint64_t> sumNanos_{0U};
+};
+
+// Response status codes counted one by one; anything else is counted as other.
+constexpr std::array<int, 18> kCountedStatuses = {200, 201, 204, 301, 302, 303, 304, 400, 404,
+                                                  405, 408, 413, 415, 431, 500, 501, 503, 507};
+constexpr size_t kStatusSlots = kCountedStatuses.size() + 1U;
+
+struct RouteMetrics {
+  std::atomic<std::uint64_t> requests{0U};
+  std::atomic<std::uint64_t> bytesIn{0U};
+  std::atomic<std::uint64_t> bytesOut{0U};
+  std::array<std::atomic<std::uint64_t>, kStatusSlots> statuses{};
+  std::array<LatencyHistogram, kPhaseCount> phases;
+};
+
+// One finished request, as a reactor worker hands it to its metrics.
+struct RequestSample {
+  Route route = Route::kOther;
+  int status = 0;
+  std::uint64_t bytesIn = 0U;
+  std::uint64_t bytesOut = 0U;
+  std::array<std::uint64_t, kPhaseCount> nanos{};
+};
+
+// The counters of one thread. Only that thread records into them.
+class ThreadMetrics {
+public:
+  void record(const RequestSample& sample);
+
+  const RouteMetrics& route(Route route) const {
+    return routes_[static_cast<size_t>(route)];
+  }
+
+private:
+  std::array<RouteMetrics, kRouteCount> routes_;
+};
+
+// Every thread's counters. Threads register once at startup; a scrape sums
+// them without stopping the writers and renders the Prometheus text format.
+class MetricsRegistry {
+public:
+  ThreadMetrics& registerThread();
+
+  // Appends the request counters and latency histograms of every thread.
+  void writePrometheus(std::string& out) const;
+
+private:
+  mutable std::mutex mutex_;
+  std::deque<ThreadMetrics> threads_;
+};
+
+std::string_view routeLabel(Route route);
+
+inline std::uint64_t elapsedNanos(std::chrono::steady_clock::time_point from,
+                                  std::chrono::steady_clock::time_point to) {
+  if (to <= from) {
+    return 0U;
+  }
+  return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count());
+}
+
+}  // namespace csfj
@@ -0,0 +1,171 @@
+#include "money.hpp"
+
+#include <cctype>
+#include <charconv>
+#include <limits>
+
+namespace csfj {
+
+namespace {
+
+constexpr std::int64_t kCentsPerUnit = 100;
+
+struct Digits {
+  char text[24];
+  size_t length;
+  bool negative;
+  unsigned fraction;
+};
+
+// Splits an amount into the decimal digits of its whole part and its cents.
+Digits splitAmount(Money amount) {
+  Digits digits{};
+  const std::int64_t cents = amount.cents();
+  digits.negative = cents < 0;
+  const std::uint64_t magnitude = digits.negative ? 0U - static_cast<std::uint64_t>(cents)
+                                                  : static_cast<std::uint64_t>(cents);
+  const auto result = std::to_chars(digits.text, digits.text + sizeof(digits.text), magnitude / kCentsPerUnit);
+  digits.length = static_cast<size_t>(result.ptr - digits.text);
+  digits.fraction = static_cast<unsigned>(magnitude % kCentsPerUnit);
+  return digits;
+}
+
+char* writeFraction(char* cursor, unsigned fraction) {
+  *cursor++ = '.';
+  *cursor++ = static_cast<char>('0' + fraction / 10U);
+  *cursor++ = static_cast<char>('0' + fraction % 10U);
+  return cursor;
+}
+
+}  // namespace
+
+std::string normalizeCostInput(std::string_view raw) {
+  std::string normalized;
+  normalized.reserve(raw.size());
+  for (const char ch : raw) {
+    if (ch == '\'' || ch == ',' || std::isspace(static_cast<unsigned char>(ch))) {
+      continue;
+    }
+    normalized.push_back(ch);
+  }
+  return normalized;
+}
+
+bool parseMoney(std::string_view text, Money& amount) {
+  std::int64_t whole = 0;
+  size_t cursor = 0U;
+  size_t wholeDigits = 0U;
+  constexpr std::int64_t kMaxWhole = std::numeric_limits<std::int64_t>::max() / (kCentsPerUnit * 10);
+  for (; cursor < text.size() && text[cursor] >= '0' && text[cursor] <= '9'; ++cursor, ++wholeDigits) {
+    if (whole > kMaxWhole) {
+      return false;
+    }
+    whole = whole * 10 + (text[cursor] - '0');
+  }
+
+  std::int64_t fraction = 0;
+  size_t fractionDigits = 0U;
+  bool roundUp = false;
+  if (cursor < text.size() && text[cursor] == '.') {
+    for (++cursor; cursor < text.size() && text[cursor] >= '0' && text[cursor] <= '9'; ++cursor, ++fractionDigits) {
+      if (fractionDigits < 2U) {
+        fraction = fraction * 10 + (text[cursor] - '0');
+      } else if (fractionDigits == 2U) {
+        roundUp = text[cursor] >= '5';
+      }
+    }
+  }
+  if (cursor != text.size() || wholeDigits + fractionDigits == 0U) {
+    return false;
+  }
+  if (fractionDigits == 1U) {
+    fraction *= 10;
+  }
+
+  const Money parsed = Money::fromCents(whole * kCentsPerUnit + fraction + (roundUp ? 1 : 0));
+  if (parsed > kMaxUnitCost) {
+    return false;
+  }
+  amount = parsed;
+  return true;
+}
+
+bool multiplyMoney(Money amount, std::int64_t quantity, Money& product) {
+  if (amount.cents() < 0 || quantity < 0) {
+    return false;
+  }
+  if (quantity != 0 && amount.cents() > std::numeric_limits<std::int64_t>::max() / quantity) {
+    return false;
+  }
+  product = amount * quantity;
+  return true;
+}
+
+bool addMoney(Money left, Money right, Money& sum) {
+  constexpr std::int64_t kMax = std::numeric_limits<std::int64_t>::max();
+  constexpr std::int64_t kMin = std::numeric_limits<std::int64_t>::min();
+  if ((right.cents() > 0 && left.cents() > kMax - right.cents()) ||
+      (right.cents() < 0 && left.cents() < kMin - right.cents())) {
+    return false;
+  }
+  sum = left + right;
+  return true;
+}
+
+size_t writeMoney(char* buffer, Money amount) {
+  const Digits digits = splitAmount(amount);
+  char* cursor = buffer;
+  if (digits.negative) {
+    *cursor++ = '-';
+  }
+  for (size_t index = 0; index < digits.length; ++index) {
+    *cursor++ = digits.text[index];
+  }
+  cursor = writeFraction(cursor, digits.fraction);
+  return static_cast<size_t>(cursor - buffer);
+}
+
+size_t writeMoneyWithGrouping(char* buffer, Money amount) {
+  const Digits digits = splitAmount(amount);
+  const size_t groups = (digits.length + 2U) / 3U;
+  const size_t leading = digits.length - 3U * (groups - 1U);
+
+  char* cursor = buffer;
+  if (digits.negative) {
+    *cursor++ = '-';
+  }
+  const char* source = digits.text;
+  for (size_t index = 0; index < leading; ++index) {
+    *cursor++ = *source++;
+  }
+  for (size_t group = 1; group < groups; ++group) {
+    *cursor++ = (group == 1U && groups > 2U) ? '\'' : ',';
+    *cursor++ = *source++;
+    *cursor++ = *source++;
+    *cursor++ = *source++;
+  }
+  cursor = writeFraction(cursor, digits.fraction);
+  return static_cast<size_t>(cursor - buffer);
+}
+
+void appendMoney(std::string& out, Money amount) {
+  char buffer[kMaxMoneyChars];
+  out.append(buffer, writeMoney(buffer, amount));
+}
+
+void appendMoneyWithGrouping(std::string& out, Money amount) {
+  char buffer[kMaxMoneyChars];
+  out.append(buffer, writeMoneyWithGrouping(buffer, amount));
+}
+
+std::string formatMoney(Money amount) {
+  char buffer[kMaxMoneyChars];
+  return std::string(buffer, writeMoney(buffer, amount));
+}
+
+std::string formatMoneyWithGrouping(Money amount) {
+  char buffer[kMaxMoneyChars];
+  return std::string(buffer, writeMoneyWithGrouping(buffer, amount));
+}
+
+}  // namespace csfj
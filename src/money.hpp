@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace csfj {
+
+// An exact amount of money stored as a whole number of cents, so item totals
+// and sheet totals add up without floating-point drift.
+class Money {
+public:
+  constexpr Money() = default;
+
+  static constexpr Money fromCents(std::int64_t cents) {
+    return Money(cents);
+  }
+
+  constexpr std::int64_t cents() const {
+    return cents_;
+  }
+
+  constexpr Money& operator+=(Money other) {
+    cents_ += other.cents_;
+    return *this;
+  }
+
+  constexpr Money& operator-=(Money other) {
+    cents_ -= other.cents_;
+    return *this;
+  }
+
+  friend constexpr Money operator+(Money left, Money right) {
+    return left += right;
+  }
+
+  friend constexpr Money operator-(Money left, Money right) {
+    return left -= right;
+  }
+
+  friend constexpr Money operator*(Money amount, std::int64_t factor) {
+    return Money(amount.cents_ * factor);
+  }
+
+  friend constexpr bool operator==(Money left, Money right) {
+    return left.cents_ == right.cents_;
+  }
+
+  friend constexpr bool operator!=(Money left, Money right) {
+    return left.cents_ != right.cents_;
+  }
+
+  friend constexpr bool operator<(Money left, Money right) {
+    return left.cents_ < right.cents_;
+  }
+
+  friend constexpr bool operator<=(Money left, Money right) {
+    return left.cents_ <= right.cents_;
+  }
+
+  friend constexpr bool operator>(Money left, Money right) {
+    return left.cents_ > right.cents_;
+  }
+
+  friend constexpr bool operator>=(Money left, Money right) {
+    return left.cents_ >= right.cents_;
+  }
+
+private:
+  constexpr explicit Money(std::int64_t cents) : cents_(cents) {}
+
+  std::int64_t cents_ = 0;
+};
+
+// Largest unit cost accepted from user input (10^13 currency units).
+constexpr Money kMaxUnitCost = Money::fromCents(1'000'000'000'000'000);
+
+// Drops the grouping separators (`'` and `,`) and whitespace people type in
+// cost fields, so "1'234,567.89" becomes "1234567.89".
+std::string normalizeCostInput(std::string_view raw);
+
+// Parses a plain decimal amount such as "1234", "1234.5" or ".75", i.e. the
+// output of normalizeCostInput. Digits past the second decimal are rounded
+// half up. Returns false for anything else, including negative amounts and
+// amounts above kMaxUnitCost.
+bool parseMoney(std::string_view text, Money& amount);
+
+// Stores amount * quantity in `product`, or returns false if it does not fit.
+bool multiplyMoney(Money amount, std::int64_t quantity, Money& product);
+
+// Stores left + right in `sum`, or returns false if it does not fit.
+bool addMoney(Money left, Money right, Money& sum);
+
+// Enough room for any Money with grouping separators and sign.
+constexpr size_t kMaxMoneyChars = 32U;
+
+// Write the amount into `buffer` (at least kMaxMoneyChars long) and return the
+// number of characters written. The plain form is "1234567.89"; the grouped
+// form uses the sheet's separators, `'` after the millions group and `,`
+// elsewhere: "1'234,567.89".
+size_t writeMoney(char* buffer, Money amount);
+size_t writeMoneyWithGrouping(char* buffer, Money amount);
+
+void appendMoney(std::string& out, Money amount);
+void appendMoneyWithGrouping(std::string& out, Money amount);
+std::string formatMoney(Money amount);
+std::string formatMoneyWithGrouping(Money amount);
+
+}  // namespace csfj
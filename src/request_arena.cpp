@@ -0,0 +1,40 @@
+#include "request_arena.hpp"
+
+#include <algorithm>
+
+namespace csfj {
+
+void* RequestArena::do_allocate(size_t bytes, size_t alignment) {
+  for (; current_ < blocks_.size(); ++current_, offset_ = 0U) {
+    Block& block = blocks_[current_];
+    void* start = block.data.get() + offset_;
+    size_t space = block.size - offset_;
+    if (std::align(alignment, bytes, start, space) != nullptr) {
+      offset_ = block.size - space + bytes;
+      return start;
+    }
+  }
+
+  // Out of retained blocks: add one big enough for this request.
+  const size_t size = std::max(kBlockSize, bytes + alignment);
+  blocks_.push_back({std::unique_ptr<std::byte[]>(new std::byte[size]), size});
+  current_ = blocks_.size() - 1U;
+  void* start = blocks_.back().data.get();
+  size_t space = size;
+  std::align(alignment, bytes, start, space);
+  offset_ = size - space + bytes;
+  return start;
+}
+
+void RequestArena::reset() {
+  current_ = 0U;
+  offset_ = 0U;
+  size_t retained = 0U;
+  size_t keep = 0U;
+  while (keep < blocks_.size() && retained + blocks_[keep].size <= kMaxRetainedBytes) {
+    retained += blocks_[keep++].size;
+  }
+  blocks_.resize(keep);
+}
+
+}  // namespace csfj
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+namespace csfj {
+
+// Bump allocator for the temporaries of one request (decoded form fields,
+// validator headers...). Memory comes from blocks the arena keeps between
+// requests, so once a connection has served a request or two, parsing and
+// answering the next one never reaches malloc. Deallocation is a no-op;
+// reset() makes everything reusable at once, and must only be called when no
+// object allocated from the arena is still alive.
+class RequestArena : public std::pmr::memory_resource {
+public:
+  static constexpr size_t kBlockSize = 4096U;
+  // Blocks past this total are returned to the heap on reset, so one large
+  // request does not pin memory for the rest of the connection.
+  static constexpr size_t kMaxRetainedBytes = 64U * 1024U;
+
+  RequestArena() = default;
+  RequestArena(const RequestArena&) = delete;
+  RequestArena& operator=(const RequestArena&) = delete;
+
+  void reset();
+
+private:
+  struct Block {
+    std::unique_ptr<std::byte[]> data;
+    size_t size;
+  };
+
+  void* do_allocate(size_t bytes, size_t alignment) override;
+  void do_deallocate(void*, size_t, size_t) override {}
+  bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+    return this == &other;
+  }
+
+  std::vector<Block> blocks_;
+  // The block being filled and the first free byte in it.
+  size_t current_ = 0U;
+  size_t offset_ = 0U;
+};
+
+}  // namespace csfj
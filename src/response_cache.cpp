@@ -0,0 +1,30 @@
+#include "response_cache.hpp"
+
+#include <utility>
+
+namespace csfj {
+
+std::shared_ptr<const SegmentedText> ResponseCache::find(std::uint64_t version, const std::string& key) const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  if (version != version_) {
+    return nullptr;
+  }
+  const auto it = entries_.find(key);
+  return it == entries_.end() ? nullptr : it->second;
+}
+
+void ResponseCache::store(std::uint64_t version, const std::string& key, std::shared_ptr<const SegmentedText> body) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  if (version < version_) {
+    return;
+  }
+  if (version > version_) {
+    entries_.clear();
+    version_ = version;
+  }
+  if (entries_.size() < maxEntries_ || entries_.count(key) != 0U) {
+    entries_[key] = std::move(body);
+  }
+}
+
+}  // namespace csfj
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "template_engine.hpp"
+
+namespace csfj {
+
+// Rendered response bodies for the newest item store version seen. A body is
+// a pure function of the version and its key (route plus parameters), so
+// entries never need invalidating: the first store for a newer version simply
+// drops everything rendered for older ones.
+class ResponseCache {
+public:
+  explicit ResponseCache(size_t maxEntries) : maxEntries_(maxEntries) {}
+
+  // Returns nullptr when `key` has not been rendered for `version`.
+  std::shared_ptr<const SegmentedText> find(std::uint64_t version, const std::string& key) const;
+
+  // Ignores bodies rendered from an older version than the cached one, and new
+  // keys once the cache is full.
+  void store(std::uint64_t version, const std::string& key, std::shared_ptr<const SegmentedText> body);
+
+private:
+  mutable std::mutex mutex_;
+  size_t maxEntries_;
+  std::uint64_t version_ = 0U;
+  std::unordered_map<std::string, std::shared_ptr<const SegmentedText>> entries_;
+};
+
+}  // namespace csfj
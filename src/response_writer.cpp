@@ -0,0 +1,89 @@
+#include "response_writer.hpp"
+
+#include <charconv>
+#include <cstring>
+#include <utility>
+
+namespace csfj {
+
+ResponseHead& ResponseHead::append(std::string_view text) {
+  if (!spilled_ && size_ + text.size() > kCapacity) {
+    overflow_.assign(buffer_, size_);
+    spilled_ = true;
+  }
+  if (spilled_) {
+    overflow_.append(text.data(), text.size());
+  } else {
+    std::memcpy(buffer_ + size_, text.data(), text.size());
+    size_ += text.size();
+  }
+  return *this;
+}
+
+ResponseHead& ResponseHead::appendNumber(std::uint64_t value) {
+  char digits[20];
+  const auto result = std::to_chars(digits, digits + sizeof(digits), value);
+  return append(std::string_view(digits, static_cast<size_t>(result.ptr - digits)));
+}
+
+void OutputQueue::append(std::string_view bytes) {
+  const size_t start = buffer_.size();
+  buffer_.append(bytes.data(), bytes.size());
+  commitOwned(start);
+}
+
+void OutputQueue::appendExternal(std::string_view bytes, std::shared_ptr<const void> owner) {
+  if (!bytes.empty()) {
+    pieces_.push_back({bytes.data(), 0U, bytes.size(), std::move(owner)});
+    queuedTotal_ += bytes.size();
+  }
+}
+
+void OutputQueue::commitOwned(size_t start) {
+  const size_t length = buffer_.size() - start;
+  if (length == 0U) {
+    return;
+  }
+  queuedTotal_ += length;
+  // Owned pieces are recorded by offset because the buffer may still move.
+  if (!pieces_.empty() && pieces_.back().external == nullptr &&
+      pieces_.back().offset + pieces_.back().length == start) {
+    pieces_.back().length += length;
+    return;
+  }
+  pieces_.push_back({nullptr, start, length, nullptr});
+}
+
+size_t OutputQueue::gather(std::string_view* parts, size_t maxParts) const {
+  size_t count = 0U;
+  for (size_t index = next_; index < pieces_.size() && count < maxParts; ++index) {
+    const Piece& piece = pieces_[index];
+    const char* data = piece.external != nullptr ? piece.external : buffer_.data() + piece.offset;
+    const size_t skip = index == next_ ? nextOffset_ : 0U;
+    parts[count++] = std::string_view(data + skip, piece.length - skip);
+  }
+  return count;
+}
+
+void OutputQueue::consume(size_t bytes) {
+  sentTotal_ += bytes;
+  while (bytes > 0U && next_ < pieces_.size()) {
+    const size_t remaining = pieces_[next_].length - nextOffset_;
+    if (bytes < remaining) {
+      nextOffset_ += bytes;
+      return;
+    }
+    bytes -= remaining;
+    pieces_[next_].owner.reset();
+    ++next_;
+    nextOffset_ = 0U;
+  }
+  if (next_ == pieces_.size()) {
+    buffer_.clear();
+    pieces_.clear();
+    next_ = 0U;
+    nextOffset_ = 0U;
+  }
+}
+
+}  // namespace csfj
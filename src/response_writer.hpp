@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace csfj {
+
+// A status line and headers built in a fixed stack buffer. Heads longer than
+// the buffer, which no route produces today, spill to the heap.
+class ResponseHead {
+public:
+  static constexpr size_t kCapacity = 512U;
+
+  ResponseHead& append(std::string_view text);
+  ResponseHead& appendNumber(std::uint64_t value);
+
+  std::string_view view() const {
+    return spilled_ ? std::string_view(overflow_) : std::string_view(buffer_, size_);
+  }
+
+private:
+  char buffer_[kCapacity];
+  size_t size_ = 0U;
+  bool spilled_ = false;
+  std::string overflow_;
+};
+
+// The bytes a connection still has to send, as an ordered list of pieces.
+// Small pieces such as heads are copied into the queue's own buffer; large
+// bodies are referenced where they already live and kept alive by a shared
+// owner until they have been sent, so a response can go to the kernel as one
+// gather write without being joined first. Partial writes resume mid-piece.
+class OutputQueue {
+public:
+  bool empty() const {
+    return next_ == pieces_.size();
+  }
+
+  // Copies `bytes` into the queue.
+  void append(std::string_view bytes);
+
+  // Queues `bytes` by reference. They must stay valid until sent: either
+  // because `owner` keeps them alive or because they live for the whole
+  // process (static files, compiled templates).
+  void appendExternal(std::string_view bytes, std::shared_ptr<const void> owner = nullptr);
+
+  // Lets `writer` append to the queue's own buffer in place; whatever it
+  // appends is queued as one piece.
+  template <typename Write>
+  void write(const Write& writer) {
+    const size_t start = buffer_.size();
+    writer(buffer_);
+    commitOwned(start);
+  }
+
+  // Fills `parts` with up to `maxParts` unsent ranges, in order, and returns
+  // how many it filled.
+  size_t gather(std::string_view* parts, size_t maxParts) const;
+
+  // Marks the first `bytes` unsent bytes as sent. Once everything has been
+  // sent the buffer is reset (keeping its capacity) and owners are released.
+  void consume(size_t bytes);
+
+  // Bytes queued and sent over the queue's lifetime; a response is fully sent
+  // once sentTotal() reaches the queuedTotal() read right after queuing it.
+  std::uint64_t queuedTotal() const {
+    return queuedTotal_;
+  }
+
+  std::uint64_t sentTotal() const {
+    return sentTotal_;
+  }
+
+private:
+  struct Piece {
+    const char* external;
+    size_t offset;
+    size_t length;
+    std::shared_ptr<const void> owner;
+  };
+
+  void commitOwned(size_t start);
+
+  std::string buffer_;
+  std::vector<Piece> pieces_;
+  size_t next_ = 0U;
+  size_t nextOffset_ = 0U;
+  std::uint64_t queuedTotal_ = 0U;
+  std::uint64_t sentTotal_ = 0U;
+};
+
+}  // namespace csfj
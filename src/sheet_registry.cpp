@@ -0,0 +1,165 @@
+#include "sheet_registry.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace csfj {
+
+namespace {
+
+constexpr const char* kSheetsDirectory = "sheets";
+
+}  // namespace
+
+Sheet::Sheet(std::string sheetName,
+             const std::filesystem::path& directory,
+             std::uintmax_t compactionThresholdBytes,
+             size_t cacheEntries,
+             JournalThreads* journalThreads)
+    : name(std::move(sheetName)), cache(cacheEntries) {
+  if (!directory.empty()) {
+    journal = std::make_unique<ItemJournal>(directory, compactionThresholdBytes, *journalThreads);
+    journal->open(store);
+  }
+}
+
+SheetRegistry::SheetRegistry(std::filesystem::path dataDirectory,
+                             std::uintmax_t compactionThresholdBytes,
+                             size_t cacheEntries,
+                             size_t maxSheets,
+                             std::function<void()> onDurable)
+    : dataDirectory_(std::move(dataDirectory)),
+      compactionThresholdBytes_(compactionThresholdBytes),
+      cacheEntries_(cacheEntries),
+      maxSheets_(maxSheets),
+      journalThreads_(kFlusherThreads, std::move(onDurable)) {}
+
+void SheetRegistry::open() {
+  defaultSheet_ = std::make_unique<Sheet>("", dataDirectory_, compactionThresholdBytes_, cacheEntries_, &journalThreads_);
+  const std::filesystem::path sheetsRoot = dataDirectory_ / kSheetsDirectory;
+  if (!std::filesystem::is_directory(sheetsRoot)) {
+    return;
+  }
+  for (const auto& entry : std::filesystem::directory_iterator(sheetsRoot)) {
+    const std::string name = entry.path().filename().string();
+    if (!entry.is_directory() || !isValidName(name)) {
+      continue;
+    }
+    if (sheetCount_.load(std::memory_order_relaxed) >= maxSheets_) {
+      throw std::runtime_error("El directorio de datos tiene más de " + std::to_string(maxSheets_) +
+                               " hojas con nombre; aumenta --max-sheets");
+    }
+    std::unique_ptr<Sheet> sheet = build(name);
+    Shard& shard = shardOf(name);
+    std::unique_lock<std::shared_mutex> guard(shard.mutex);
+    shard.sheets.emplace(sheet->name, std::move(sheet));
+    sheetCount_.fetch_add(1U, std::memory_order_relaxed);
+  }
+}
+
+Sheet* SheetRegistry::find(std::string_view name) const {
+  Shard& shard = shardOf(name);
+  std::shared_lock<std::shared_mutex> guard(shard.mutex);
+  const auto it = shard.sheets.find(name);
+  return it == shard.sheets.end() ? nullptr : it->second.get();
+}
+
+Sheet* SheetRegistry::findOrCreate(std::string_view name) {
+  if (Sheet* sheet = find(name)) {
+    return sheet;
+  }
+  Shard& shard = shardOf(name);
+  std::unique_lock<std::shared_mutex> guard(shard.mutex);
+  while (true) {
+    const auto it = shard.sheets.find(name);
+    if (it != shard.sheets.end()) {
+      return it->second.get();
+    }
+    if (shard.creating.count(std::string(name)) == 0U) {
+      break;
+    }
+    shard.created.wait(guard);
+  }
+  // The slot is reserved before the sheet is created, since creations in
+  // other shards do not wait for this one.
+  if (sheetCount_.fetch_add(1U, std::memory_order_relaxed) >= maxSheets_) {
+    sheetCount_.fetch_sub(1U, std::memory_order_relaxed);
+    return nullptr;
+  }
+  const std::string claim(name);
+  shard.creating.insert(claim);
+  guard.unlock();
+
+  std::unique_ptr<Sheet> sheet;
+  try {
+    sheet = build(name);
+  } catch (...) {
+    guard.lock();
+    shard.creating.erase(claim);
+    sheetCount_.fetch_sub(1U, std::memory_order_relaxed);
+    shard.created.notify_all();
+    throw;
+  }
+  guard.lock();
+  Sheet& created = *sheet;
+  shard.sheets.emplace(created.name, std::move(sheet));
+  shard.creating.erase(claim);
+  shard.created.notify_all();
+  return &created;
+}
+
+bool SheetRegistry::isValidName(std::string_view name) {
+  if (name.empty() || name.size() > kMaxNameLength) {
+    return false;
+  }
+  for (const char ch : name) {
+    const bool valid = (ch >= 'a' && ch <= 'z') || (ch >= '0' && ch <= '9') || ch == '-' || ch == '_';
+    if (!valid) {
+      return false;
+    }
+  }
+  return true;
+}
+
+SheetRegistry::Shard& SheetRegistry::shardOf(std::string_view name) const {
+  return shards_[std::hash<std::string_view>{}(name) % kShardCount];
+}
+
+// Recovers or creates the sheet's journal, which creates and syncs files; no
+// lock is held meanwhile.
+std::unique_ptr<Sheet> SheetRegistry::build(std::string_view name) {
+  return std::make_unique<Sheet>(std::string(name), dataDirectory_ / kSheetsDirectory / std::string(name),
+                                 compactionThresholdBytes_, cacheEntries_, &journalThreads_);
+}
+
+SheetPath splitSheetPath(std::string_view path) {
+  SheetPath split;
+  if (path.substr(0, kSheetPathPrefix.size()) != kSheetPathPrefix) {
+    split.base = "/";
+    split.route = path;
+    return split;
+  }
+  const size_t nameEnd = std::min(path.find('/', kSheetPathPrefix.size()), path.size());
+  split.name = path.substr(kSheetPathPrefix.size(), nameEnd - kSheetPathPrefix.size());
+  if (nameEnd < path.size()) {
+    split.base = path.substr(0, nameEnd + 1U);
+    split.route = path.substr(nameEnd);
+  }
+  split.valid = SheetRegistry::isValidName(split.name);
+  return split;
+}
+
+std::string sheetBase(std::string_view name) {
+  if (name.empty()) {
+    return "/";
+  }
+  std::string base(kSheetPathPrefix);
+  base += name;
+  base.push_back('/');
+  return base;
+}
+
+}  // namespace csfj
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "item_journal.hpp"
+#include "item_store.hpp"
+#include "response_cache.hpp"
+
+namespace csfj {
+
+// One named item list: its own store, write-ahead journal and cache of
+// rendered responses, so nothing a write to it locks or invalidates is shared
+// with any other sheet.
+struct Sheet {
+  // Without a directory the sheet is kept in memory only; with one, its
+  // journal runs on `journalThreads`.
+  Sheet(std::string name,
+        const std::filesystem::path& directory,
+        std::uintmax_t compactionThresholdBytes,
+        size_t cacheEntries,
+        JournalThreads* journalThreads = nullptr);
+  Sheet(const Sheet&) = delete;
+  Sheet& operator=(const Sheet&) = delete;
+
+  // Whether the sheet's writes up to `sequence` have reached the disk.
+  bool durable(std::uint64_t sequence) const {
+    return journal == nullptr || sequence <= journal->durableSequence();
+  }
+
+  const std::string name;
+  ItemStore store;
+  // Declared after the store so that it detaches from it first on destruction.
+  std::unique_ptr<ItemJournal> journal;
+  ResponseCache cache;
+};
+
+// Every sheet of a data directory. The default sheet lives in the directory
+// itself, where the single sheet of earlier versions kept its files; named
+// sheets live in `sheets/<name>/` below it and are created by their first
+// write. Names are hashed over a fixed number of shards, each with its own
+// reader-writer lock, so lookups only ever share a lock with sheets of the
+// same shard, and only exclusively while one of them is being created.
+// Sheets are never removed, so the pointers handed out stay valid.
+class SheetRegistry {
+public:
+  static constexpr size_t kShardCount = 16U;
+  static constexpr size_t kMaxNameLength = 64U;
+  // Journals of different sheets sync in parallel on up to this many threads,
+  // however many sheets there are.
+  static constexpr size_t kFlusherThreads = 4U;
+
+  // `onDurable` is called after each group commit of any sheet, from the
+  // flusher thread that made it.
+  SheetRegistry(std::filesystem::path dataDirectory,
+                std::uintmax_t compactionThresholdBytes,
+                size_t cacheEntries,
+                size_t maxSheets,
+                std::function<void()> onDurable = {});
+  SheetRegistry(const SheetRegistry&) = delete;
+  SheetRegistry& operator=(const SheetRegistry&) = delete;
+
+  // Recovers the default sheet and every named sheet found on disk. Throws
+  // when there are more of the latter than the maximum number of sheets.
+  void open();
+
+  Sheet& defaultSheet() {
+    return *defaultSheet_;
+  }
+
+  // Returns nullptr when no sheet has that name.
+  Sheet* find(std::string_view name) const;
+
+  // Returns the sheet, creating it when needed; nullptr when that would
+  // exceed the maximum number of sheets. `name` must be valid. The journal of
+  // a new sheet is opened without holding the shard's lock, so only callers
+  // asking for that same sheet wait for it.
+  Sheet* findOrCreate(std::string_view name);
+
+  // Named sheets, not counting the default one.
+  size_t size() const {
+    return sheetCount_.load(std::memory_order_relaxed);
+  }
+
+  // Calls visitor(sheet) for the default sheet and then every named one, in
+  // no particular order. Sheets created meanwhile may be missed.
+  template <typename Visitor>
+  void forEach(const Visitor& visitor) const {
+    visitor(static_cast<const Sheet&>(*defaultSheet_));
+    for (const Shard& shard : shards_) {
+      std::shared_lock<std::shared_mutex> guard(shard.mutex);
+      for (const auto& entry : shard.sheets) {
+        visitor(static_cast<const Sheet&>(*entry.second));
+      }
+    }
+  }
+
+  // 1 to kMaxNameLength lowercase letters, digits, '-' or '_', so a name is
+  // always a safe directory name and URL path segment, and two names never
+  // share a directory on case-insensitive file systems.
+  static bool isValidName(std::string_view name);
+
+private:
+  struct Shard {
+    mutable std::shared_mutex mutex;
+    // Keyed by views of Sheet::name, so lookups take the request path as is.
+    std::unordered_map<std::string_view, std::unique_ptr<Sheet>> sheets;
+    // Sheets being created, and the signal that one of them was inserted or
+    // failed; a second creator of the same sheet waits instead of opening its
+    // journal again.
+    std::unordered_set<std::string> creating;
+    std::condition_variable_any created;
+  };
+
+  Shard& shardOf(std::string_view name) const;
+  std::unique_ptr<Sheet> build(std::string_view name);
+
+  std::filesystem::path dataDirectory_;
+  std::uintmax_t compactionThresholdBytes_;
+  size_t cacheEntries_;
+  size_t maxSheets_;
+  // Declared before the sheets, which must close their journals first.
+  JournalThreads journalThreads_;
+  std::unique_ptr<Sheet> defaultSheet_;
+  mutable std::array<Shard, kShardCount> shards_;
+  std::atomic<size_t> sheetCount_{0U};
+};
+
+constexpr std::string_view kSheetPathPrefix = "/s/";
+
+// A request path split into the sheet it addresses and the route within that
+// sheet: "/s/{name}/route" names a sheet, any other path is a route of the
+// default sheet.
+struct SheetPath {
+  // Empty for the default sheet.
+  std::string_view name;
+  // "/" or "/s/{name}/"; pages link relative to it. Empty when the route is.
+  std::string_view base;
+  // Starts with '/', or is empty for "/s/{name}" without the final slash,
+  // which is redirected to sheetBase(name).
+  std::string_view route;
+  // False for "/s/..." paths whose name is not a valid sheet name.
+  bool valid = true;
+};
+
+SheetPath splitSheetPath(std::string_view path);
+
+// "/" for the default sheet (an empty name), "/s/{name}/" for any other.
+std::string sheetBase(std::string_view name);
+
+}  // namespace csfj
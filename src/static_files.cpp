@@ -0,0 +1,198 @@
+#include "static_files.hpp"
+
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+
+#ifdef CSFJ_HAVE_ZLIB
+  #include <zlib.h>
+#endif
+
+namespace csfj {
+
+std::string contentTag(std::string_view bytes, std::string_view suffix) {
+  std::uint64_t hash = 0xcbf29ce484222325ULL;
+  for (const char ch : bytes) {
+    hash = (hash ^ static_cast<unsigned char>(ch)) * 0x100000001b3ULL;
+  }
+  static constexpr char kHexDigits[] = "0123456789abcdef";
+  std::string tag = "\"";
+  for (int shift = 60; shift >= 0; shift -= 4) {
+    tag += kHexDigits[(hash >> shift) & 0xFU];
+  }
+  tag += suffix;
+  tag += '"';
+  return tag;
+}
+
+namespace {
+
+// Assets are served at fixed URLs, so browsers may reuse them for a while and
+// revalidate with the ETag afterwards.
+constexpr std::string_view kStaticCacheControl = "public, max-age=3600";
+constexpr std::string_view kGzipSuffix = ".gz";
+
+std::string_view contentTypeFor(const std::filesystem::path& file) {
+  const std::string extension = file.extension().string();
+  if (extension == ".css") {
+    return "text/css; charset=utf-8";
+  }
+  if (extension == ".js") {
+    return "application/javascript; charset=utf-8";
+  }
+  if (extension == ".html") {
+    return "text/html; charset=utf-8";
+  }
+  if (extension == ".json") {
+    return "application/json; charset=utf-8";
+  }
+  if (extension == ".svg") {
+    return "image/svg+xml";
+  }
+  if (extension == ".png") {
+    return "image/png";
+  }
+  if (extension == ".ico") {
+    return "image/x-icon";
+  }
+  if (extension == ".txt") {
+    return "text/plain; charset=utf-8";
+  }
+  return "application/octet-stream";
+}
+
+std::string readFile(const std::filesystem::path& file) {
+  std::ifstream input(file, std::ios::binary);
+  if (!input) {
+    throw std::runtime_error("No se pudo abrir el activo estático: " + file.string());
+  }
+  return std::string(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+}
+
+#ifdef CSFJ_HAVE_ZLIB
+// Returns an empty string when compression fails.
+std::string gzipCompress(std::string_view bytes) {
+  z_stream stream{};
+  if (deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 9, Z_DEFAULT_STRATEGY) != Z_OK) {
+    return {};
+  }
+  std::string compressed(deflateBound(&stream, static_cast<uLong>(bytes.size())), '\0');
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(bytes.data()));
+  stream.avail_in = static_cast<uInt>(bytes.size());
+  stream.next_out = reinterpret_cast<Bytef*>(compressed.data());
+  stream.avail_out = static_cast<uInt>(compressed.size());
+  const int status = deflate(&stream, Z_FINISH);
+  compressed.resize(stream.total_out);
+  deflateEnd(&stream);
+  return status == Z_STREAM_END ? compressed : std::string{};
+}
+#endif
+
+void buildHeads(StaticVariant& variant, std::string_view contentType, std::string_view contentEncoding) {
+  std::string common;
+  common += "ETag: ";
+  common += variant.etag;
+  common += "\r\nCache-Control: ";
+  common += kStaticCacheControl;
+  common += "\r\nVary: Accept-Encoding\r\n";
+
+  for (const bool keepAlive : {false, true}) {
+    const std::string connection = keepAlive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n";
+    std::string& ok = variant.okHead[keepAlive ? 1 : 0];
+    ok = "HTTP/1.1 200 OK\r\nContent-Type: ";
+    ok += contentType;
+    ok += "\r\n";
+    if (!contentEncoding.empty()) {
+      ok += "Content-Encoding: ";
+      ok += contentEncoding;
+      ok += "\r\n";
+    }
+    ok += common;
+    ok += "Content-Length: " + std::to_string(variant.body.size()) + "\r\n";
+    ok += connection;
+
+    variant.notModifiedHead[keepAlive ? 1 : 0] = "HTTP/1.1 304 Not Modified\r\n" + common + connection;
+  }
+}
+
+// Keeps the gzip variant only if it is smaller, and builds the heads of both.
+void finishFile(StaticFile& entry, const std::filesystem::path& file) {
+  entry.hasGzip = !entry.gzip.body.empty() && entry.gzip.body.size() < entry.identity.body.size();
+  if (!entry.hasGzip) {
+    entry.gzip.body = {};
+  }
+
+  const std::string_view contentType = contentTypeFor(file);
+  buildHeads(entry.identity, contentType, "");
+  if (entry.hasGzip) {
+    buildHeads(entry.gzip, contentType, "gzip");
+  }
+}
+
+// The bytes and tags are kept in `contents`, which the entry's views point into.
+StaticFile loadFile(const std::filesystem::path& file, std::deque<std::string>& contents) {
+  StaticFile entry;
+  entry.identity.body = contents.emplace_back(readFile(file));
+  entry.identity.etag = contents.emplace_back(contentTag(entry.identity.body, ""));
+  entry.gzip.etag = contents.emplace_back(contentTag(entry.identity.body, "-gz"));
+
+  std::filesystem::path precompressed = file;
+  precompressed += kGzipSuffix;
+  if (std::filesystem::is_regular_file(precompressed)) {
+    entry.gzip.body = contents.emplace_back(readFile(precompressed));
+  } else {
+#ifdef CSFJ_HAVE_ZLIB
+    entry.gzip.body = contents.emplace_back(gzipCompress(entry.identity.body));
+#endif
+  }
+  finishFile(entry, file);
+  return entry;
+}
+
+}  // namespace
+
+StaticFileTable StaticFileTable::load(const std::filesystem::path& root, std::string_view urlPrefix) {
+  StaticFileTable table;
+  if (!std::filesystem::is_directory(root)) {
+    return table;
+  }
+  for (const auto& entry : std::filesystem::recursive_directory_iterator(root)) {
+    if (!entry.is_regular_file()) {
+      continue;
+    }
+    const std::filesystem::path& file = entry.path();
+    // A precompressed variant belongs to the file it was made from.
+    if (file.extension() == kGzipSuffix && std::filesystem::is_regular_file(file.parent_path() / file.stem())) {
+      continue;
+    }
+    table.urls_.push_back(std::string(urlPrefix) + std::filesystem::relative(file, root).generic_string());
+    table.files_.emplace(table.urls_.back(), loadFile(file, table.contents_));
+  }
+  return table;
+}
+
+StaticFileTable StaticFileTable::fromEmbedded(const EmbeddedFile* files, size_t count, std::string_view urlPrefix) {
+  StaticFileTable table;
+  for (size_t index = 0; index < count; ++index) {
+    const EmbeddedFile& file = files[index];
+    StaticFile entry;
+    entry.identity.body = file.bytes;
+    entry.identity.etag = file.etag;
+    entry.gzip.body = file.gzip;
+    entry.gzip.etag = file.gzipEtag;
+    finishFile(entry, std::filesystem::path(file.name));
+    table.urls_.push_back(std::string(urlPrefix) + std::string(file.name));
+    table.files_.emplace(table.urls_.back(), std::move(entry));
+  }
+  return table;
+}
+
+const StaticFile* StaticFileTable::find(std::string_view path) const {
+  const auto it = files_.find(path);
+  return it == files_.end() ? nullptr : &it->second;
+}
+
+}  // namespace csfj
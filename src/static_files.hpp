@@ -0,0 +1,80 @@
+#pragma once
+
+#include <deque>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace csfj {
+
+// Strong ETag for `bytes` (FNV-1a): the hash in hex plus `suffix`, quoted. It
+// only has to change whenever the bytes do.
+std::string contentTag(std::string_view bytes, std::string_view suffix);
+
+// One encoding of a static file, with its complete response heads built ahead
+// of time. Index the heads with a connection's keep-alive flag. The body and
+// tag point into the binary for embedded files and into the table otherwise.
+struct StaticVariant {
+  std::string_view body;
+  std::string_view etag;
+  std::string okHead[2];
+  std::string notModifiedHead[2];
+};
+
+struct StaticFile {
+  StaticVariant identity;
+  StaticVariant gzip;
+  bool hasGzip = false;
+};
+
+// A static file compiled into the binary (see embedded_assets.hpp). `gzip` is
+// empty when the file has no gzip variant; the tags are precomputed by the
+// build.
+struct EmbeddedFile {
+  std::string_view name;
+  std::string_view bytes;
+  std::string_view etag;
+  std::string_view gzip;
+  std::string_view gzipEtag;
+};
+
+// Every file under a directory, read once at startup and served from memory.
+// Each file gets a strong ETag from its contents and, when it compresses, a
+// gzip variant: `name.gz` from disk if present next to it, otherwise one
+// compressed at load time (when built with zlib).
+class StaticFileTable {
+public:
+  // Maps `root/a/b.css` to `urlPrefix + "a/b.css"`. A missing root yields an
+  // empty table.
+  static StaticFileTable load(const std::filesystem::path& root, std::string_view urlPrefix);
+
+  // Serves `files` at `urlPrefix + name`, in place: only the URLs and the
+  // response heads are built.
+  static StaticFileTable fromEmbedded(const EmbeddedFile* files, size_t count, std::string_view urlPrefix);
+
+  // Returns nullptr for unknown paths.
+  const StaticFile* find(std::string_view path) const;
+
+  size_t size() const {
+    return files_.size();
+  }
+
+  // Calls visitor(url, file) for every file, in no particular order.
+  template <typename Visitor>
+  void forEach(const Visitor& visitor) const {
+    for (const auto& [url, file] : files_) {
+      visitor(url, file);
+    }
+  }
+
+private:
+  // Keyed by views into urls_, so lookups take the request path as is.
+  std::deque<std::string> urls_;
+  // The bodies and tags of files read from disk; a deque, so the views into it
+  // stay put as it grows.
+  std::deque<std::string> contents_;
+  std::unordered_map<std::string_view, StaticFile> files_;
+};
+
+}  // namespace csfj
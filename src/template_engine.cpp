@@ -0,0 +1,222 @@
+#include "template_engine.hpp"
+
+#include <utility>
+
+#include "text_format.hpp"
+
+namespace csfj {
+
+namespace {
+
+constexpr std::string_view kOpen = "{{";
+constexpr std::string_view kClose = "}}";
+
+void appendSlot(std::string& out, const SlotValue& value) {
+  switch (value.kind) {
+    case SlotKind::kText:
+      out.append(value.text.data(), value.text.size());
+      break;
+    case SlotKind::kEscapedHtml:
+      appendEscapedHtml(out, value.text);
+      break;
+    case SlotKind::kInteger:
+      appendInteger(out, value.integer);
+      break;
+    case SlotKind::kCurrency:
+      appendMoney(out, value.amount);
+      break;
+    case SlotKind::kGroupedCurrency:
+      appendMoneyWithGrouping(out, value.amount);
+      break;
+    case SlotKind::kWriter:
+      value.write(out, value.context);
+      break;
+    case SlotKind::kUnset:
+      break;
+  }
+}
+
+}  // namespace
+
+SegmentedText SegmentedText::fromString(std::string text) {
+  SegmentedText result;
+  result.owned_ = std::move(text);
+  result.commitOwned(0U);
+  return result;
+}
+
+void SegmentedText::appendExternal(std::string_view text) {
+  if (!text.empty()) {
+    pieces_.push_back({text.data(), 0U, text.size()});
+    size_ += text.size();
+  }
+}
+
+void SegmentedText::commitOwned(size_t start) {
+  const size_t length = owned_.size() - start;
+  if (length == 0U) {
+    return;
+  }
+  size_ += length;
+  // Owned pieces are recorded by offset because the buffer may still move.
+  if (!pieces_.empty() && pieces_.back().external == nullptr &&
+      pieces_.back().offset + pieces_.back().length == start) {
+    pieces_.back().length += length;
+    return;
+  }
+  pieces_.push_back({nullptr, start, length});
+}
+
+std::string SegmentedText::join() const {
+  std::string joined;
+  joined.reserve(size_);
+  for (size_t index = 0; index < pieces_.size(); ++index) {
+    const std::string_view text = piece(index);
+    joined.append(text.data(), text.size());
+  }
+  return joined;
+}
+
+SlotValue textSlot(std::string_view markup) {
+  SlotValue value;
+  value.kind = SlotKind::kText;
+  value.text = markup;
+  return value;
+}
+
+SlotValue htmlSlot(std::string_view text) {
+  SlotValue value;
+  value.kind = SlotKind::kEscapedHtml;
+  value.text = text;
+  return value;
+}
+
+SlotValue integerSlot(long long integer) {
+  SlotValue value;
+  value.kind = SlotKind::kInteger;
+  value.integer = integer;
+  return value;
+}
+
+SlotValue currencySlot(Money amount) {
+  SlotValue value;
+  value.kind = SlotKind::kCurrency;
+  value.amount = amount;
+  return value;
+}
+
+SlotValue groupedCurrencySlot(Money amount) {
+  SlotValue value;
+  value.kind = SlotKind::kGroupedCurrency;
+  value.amount = amount;
+  return value;
+}
+
+std::vector<TemplatePlaceholder> findPlaceholders(std::string_view source) {
+  std::vector<TemplatePlaceholder> placeholders;
+  size_t cursor = 0U;
+  while ((cursor = source.find(kOpen, cursor)) != std::string_view::npos) {
+    const size_t nameStart = cursor + kOpen.size();
+    const size_t close = source.find(kClose, nameStart);
+    if (close == std::string_view::npos) {
+      break;
+    }
+    placeholders.push_back({cursor, close + kClose.size() - cursor});
+    cursor = nameStart;
+  }
+  return placeholders;
+}
+
+CompiledTemplate::CompiledTemplate(std::string source, std::initializer_list<std::string_view> slotNames)
+    : CompiledTemplate(std::move(source), nullptr, 0U, slotNames) {}
+
+CompiledTemplate::CompiledTemplate(std::string source,
+                                   const TemplatePlaceholder* placeholders,
+                                   size_t placeholderCount,
+                                   std::initializer_list<std::string_view> slotNames)
+    : ownedSource_(std::move(source)) {
+  compile(placeholders, placeholderCount, slotNames);
+}
+
+CompiledTemplate::CompiledTemplate(const EmbeddedTemplate& embedded, std::initializer_list<std::string_view> slotNames)
+    : embeddedSource_(embedded.source.data() != nullptr ? embedded.source : std::string_view("")) {
+  compile(embedded.placeholders, embedded.placeholderCount, slotNames);
+}
+
+void CompiledTemplate::compile(const TemplatePlaceholder* placeholders,
+                               size_t placeholderCount,
+                               std::initializer_list<std::string_view> slotNames) {
+  const std::string_view view = source();
+  std::vector<TemplatePlaceholder> found;
+  if (placeholders == nullptr) {
+    found = findPlaceholders(view);
+    placeholders = found.data();
+    placeholderCount = found.size();
+  }
+
+  // A span whose name is not declared is left as text; the spans nested in it
+  // are still candidates, so scanning resumes right after its "{{".
+  size_t literalStart = 0U;
+  for (size_t index = 0; index < placeholderCount; ++index) {
+    const TemplatePlaceholder& placeholder = placeholders[index];
+    if (placeholder.offset < literalStart) {
+      continue;
+    }
+    const std::string_view name = view.substr(placeholder.offset + kOpen.size(),
+                                              placeholder.length - kOpen.size() - kClose.size());
+    size_t slot = 0U;
+    for (const std::string_view declared : slotNames) {
+      if (declared == name) {
+        break;
+      }
+      ++slot;
+    }
+    if (slot == slotNames.size()) {
+      continue;
+    }
+
+    if (placeholder.offset > literalStart) {
+      segments_.push_back({literalStart, placeholder.offset - literalStart, kLiteral});
+      literalSize_ += placeholder.offset - literalStart;
+    }
+    segments_.push_back({placeholder.offset, placeholder.length, slot});
+    literalStart = placeholder.offset + placeholder.length;
+  }
+  if (literalStart < view.size()) {
+    segments_.push_back({literalStart, view.size() - literalStart, kLiteral});
+    literalSize_ += view.size() - literalStart;
+  }
+}
+
+void CompiledTemplate::renderTo(std::string& out, const SlotValue* values, size_t valueCount, size_t sizeHint) const {
+  out.reserve(out.size() + literalSize_ + sizeHint);
+  const std::string_view text = source();
+  for (const Segment& segment : segments_) {
+    const std::string_view source = text.substr(segment.offset, segment.length);
+    const SlotValue* value = segment.slot < valueCount ? &values[segment.slot] : nullptr;
+    if (segment.slot == kLiteral || value == nullptr || value->kind == SlotKind::kUnset) {
+      out.append(source.data(), source.size());
+      continue;
+    }
+    appendSlot(out, *value);
+  }
+}
+
+void CompiledTemplate::renderSegments(SegmentedText& out,
+                                      const SlotValue* values,
+                                      size_t valueCount,
+                                      size_t sizeHint) const {
+  out.reserveOwned(sizeHint);
+  const std::string_view text = source();
+  for (const Segment& segment : segments_) {
+    const std::string_view source = text.substr(segment.offset, segment.length);
+    const SlotValue* value = segment.slot < valueCount ? &values[segment.slot] : nullptr;
+    if (segment.slot == kLiteral || value == nullptr || value->kind == SlotKind::kUnset) {
+      out.appendExternal(source);
+      continue;
+    }
+    out.writeOwned([value](std::string& buffer) { appendSlot(buffer, *value); });
+  }
+}
+
+}  // namespace csfj
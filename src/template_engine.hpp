@@ -0,0 +1,176 @@
+#pragma once
+
+#include <cstddef>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "money.hpp"
+
+namespace csfj {
+
+enum class SlotKind {
+  kUnset,
+  kText,
+  kEscapedHtml,
+  kInteger,
+  kCurrency,
+  kGroupedCurrency,
+  kWriter,
+};
+
+// The value bound to one template slot for a single render. Typed kinds are
+// formatted straight into the output; kWriter hands the output buffer to a
+// callback so large fragments such as the item rows are produced in place.
+struct SlotValue {
+  SlotKind kind = SlotKind::kUnset;
+  std::string_view text;
+  long long integer = 0;
+  Money amount;
+  void (*write)(std::string& out, const void* context) = nullptr;
+  const void* context = nullptr;
+};
+
+SlotValue textSlot(std::string_view markup);
+SlotValue htmlSlot(std::string_view text);
+SlotValue integerSlot(long long value);
+SlotValue currencySlot(Money amount);
+SlotValue groupedCurrencySlot(Money amount);
+
+// `writer` must outlive the render call.
+template <typename Writer>
+SlotValue writerSlot(const Writer& writer) {
+  SlotValue value;
+  value.kind = SlotKind::kWriter;
+  value.write = [](std::string& out, const void* context) { (*static_cast<const Writer*>(context))(out); };
+  value.context = &writer;
+  return value;
+}
+
+// Text held as an ordered list of pieces that either point at memory living
+// elsewhere (a compiled template's literal runs) or into the object's own
+// buffer, so rendering never copies the literals and a writer can hand the
+// pieces to the kernel without joining them.
+class SegmentedText {
+public:
+  static SegmentedText fromString(std::string text);
+
+  // `text` must outlive this object.
+  void appendExternal(std::string_view text);
+
+  // Lets `writer` append to the own buffer in place; whatever it appends
+  // becomes one piece.
+  template <typename Writer>
+  void writeOwned(const Writer& writer) {
+    const size_t start = owned_.size();
+    writer(owned_);
+    commitOwned(start);
+  }
+
+  void reserveOwned(size_t bytes) {
+    owned_.reserve(bytes);
+  }
+
+  size_t size() const {
+    return size_;
+  }
+
+  size_t pieceCount() const {
+    return pieces_.size();
+  }
+
+  std::string_view piece(size_t index) const {
+    const Piece& entry = pieces_[index];
+    return std::string_view(entry.external != nullptr ? entry.external : owned_.data() + entry.offset, entry.length);
+  }
+
+  std::string join() const;
+
+private:
+  struct Piece {
+    const char* external;
+    size_t offset;
+    size_t length;
+  };
+
+  void commitOwned(size_t start);
+
+  std::string owned_;
+  std::vector<Piece> pieces_;
+  size_t size_ = 0U;
+};
+
+// A `{{...}}` span of a template source: where its opening braces are and how
+// long it is, closing braces included.
+struct TemplatePlaceholder {
+  size_t offset;
+  size_t length;
+};
+
+// Every span CompiledTemplate may bind to a slot, in source order: each "{{"
+// followed somewhere by "}}", including those nested in a longer span. The
+// build computes them for the embedded templates.
+std::vector<TemplatePlaceholder> findPlaceholders(std::string_view source);
+
+// A template compiled into the binary (see embedded_assets.hpp).
+struct EmbeddedTemplate {
+  std::string_view name;
+  std::string_view source;
+  const TemplatePlaceholder* placeholders;
+  size_t placeholderCount;
+};
+
+// A template split once into literal runs and `{{name}}` slots. Slots are
+// numbered in the order their names are given to the constructor; the same
+// name may appear several times in the source. Placeholders that are not
+// declared, and declared slots left unset at render time, are emitted verbatim.
+class CompiledTemplate {
+public:
+  CompiledTemplate(std::string source, std::initializer_list<std::string_view> slotNames);
+  // Same, with the placeholders of `source` already found by findPlaceholders().
+  CompiledTemplate(std::string source,
+                   const TemplatePlaceholder* placeholders,
+                   size_t placeholderCount,
+                   std::initializer_list<std::string_view> slotNames);
+  // Reads the embedded source in place instead of copying it.
+  CompiledTemplate(const EmbeddedTemplate& embedded, std::initializer_list<std::string_view> slotNames);
+
+  // Renders in one pass into `out`, reserving the literal size plus `sizeHint`
+  // up front. `values` is indexed by slot number.
+  void renderTo(std::string& out, const SlotValue* values, size_t valueCount, size_t sizeHint = 0U) const;
+
+  // Same output, with the literal runs referenced instead of copied; `out`
+  // must not outlive the template. `sizeHint` sizes the slot text buffer.
+  void renderSegments(SegmentedText& out, const SlotValue* values, size_t valueCount, size_t sizeHint = 0U) const;
+
+  size_t literalSize() const {
+    return literalSize_;
+  }
+
+private:
+  static constexpr size_t kLiteral = static_cast<size_t>(-1);
+
+  struct Segment {
+    size_t offset;
+    size_t length;
+    size_t slot;
+  };
+
+  void compile(const TemplatePlaceholder* placeholders,
+               size_t placeholderCount,
+               std::initializer_list<std::string_view> slotNames);
+
+  std::string_view source() const {
+    return embeddedSource_.data() != nullptr ? embeddedSource_ : std::string_view(ownedSource_);
+  }
+
+  // An embedded template is read where the binary holds it; one read from
+  // disk (--dev-assets) is owned.
+  std::string_view embeddedSource_;
+  std::string ownedSource_;
+  std::vector<Segment> segments_;
+  size_t literalSize_ = 0U;
+};
+
+}  // namespace csfj
@@ -0,0 +1,124 @@
+#include "text_format.hpp"
+
+#include <algorithm>
+#include <charconv>
+
+#include "byte_scan.hpp"
+
+namespace csfj {
+
+namespace {
+
+std::string_view htmlEntity(char ch) {
+  switch (ch) {
+    case '&':
+      return "&amp;";
+    case '<':
+      return "&lt;";
+    case '>':
+      return "&gt;";
+    case '"':
+      return "&quot;";
+    default:
+      return "&#39;";
+  }
+}
+
+}  // namespace
+
+void appendEscapedHtml(std::string& out, std::string_view value) {
+  const size_t special = findAnyByte<'&', '<', '>', '"', '\''>(value);
+  if (special == value.size()) {
+    out.append(value);
+    return;
+  }
+
+  // Size the output exactly: every entity is its character plus 3 bytes, one
+  // more for '&' and '\'' and two more for '"'.
+  const std::string_view rest = value.substr(special);
+  const size_t extra = 3U * countAnyByte<'&', '<', '>', '"', '\''>(rest) + countAnyByte<'&', '"', '\''>(rest) +
+                       countAnyByte<'"'>(rest);
+  size_t cursor = out.size();
+  out.resize(cursor + value.size() + extra);
+  char* target = out.data();
+  size_t runStart = 0U;
+  // Markup tends to come in clusters, so every match of a block is handled
+  // from its mask instead of scanning again after each one.
+  for (size_t offset = special; offset < value.size(); offset += kScanBlock) {
+    for (unsigned mask = blockMatchMask<'&', '<', '>', '"', '\''>(value, offset); mask != 0U; mask &= mask - 1U) {
+      const size_t match = offset + scan_detail::lowestSetBit(mask);
+      std::copy_n(value.data() + runStart, match - runStart, target + cursor);
+      cursor += match - runStart;
+      for (const char ch : htmlEntity(value[match])) {
+        target[cursor++] = ch;
+      }
+      runStart = match + 1U;
+    }
+  }
+  std::copy_n(value.data() + runStart, value.size() - runStart, target + cursor);
+}
+
+std::string escapeHtml(std::string_view value) {
+  std::string sanitized;
+  appendEscapedHtml(sanitized, value);
+  return sanitized;
+}
+
+void appendEscapedCsv(std::string& out, std::string_view value) {
+  size_t cursor = out.size();
+  out.resize(cursor + value.size() + countAnyByte<'"'>(value) + 2U);
+  char* target = out.data();
+  target[cursor++] = '"';
+  size_t runStart = 0U;
+  for (size_t quote = value.find('"'); quote != std::string_view::npos; quote = value.find('"', quote + 1)) {
+    std::copy_n(value.data() + runStart, quote + 1 - runStart, target + cursor);
+    cursor += quote + 1 - runStart;
+    target[cursor++] = '"';
+    runStart = quote + 1;
+  }
+  std::copy_n(value.data() + runStart, value.size() - runStart, target + cursor);
+  cursor += value.size() - runStart;
+  target[cursor] = '"';
+}
+
+void appendJsonString(std::string& out, std::string_view value) {
+  static constexpr char kHexDigits[] = "0123456789abcdef";
+  out.push_back('"');
+  for (const char ch : value) {
+    switch (ch) {
+      case '"':
+        out += "\\\"";
+        break;
+      case '\\':
+        out += "\\\\";
+        break;
+      case '\n':
+        out += "\\n";
+        break;
+      case '\r':
+        out += "\\r";
+        break;
+      case '\t':
+        out += "\\t";
+        break;
+      default:
+        if (static_cast<unsigned char>(ch) < 0x20U) {
+          out += "\\u00";
+          out.push_back(kHexDigits[(ch >> 4) & 0xF]);
+          out.push_back(kHexDigits[ch & 0xF]);
+        } else {
+          out.push_back(ch);
+        }
+        break;
+    }
+  }
+  out.push_back('"');
+}
+
+void appendInteger(std::string& out, long long value) {
+  char buffer[24];
+  const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+  out.append(buffer, result.ptr);
+}
+
+}  // namespace csfj
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace csfj {
+
+// Appends `value` with the five HTML-significant characters escaped.
+void appendEscapedHtml(std::string& out, std::string_view value);
+std::string escapeHtml(std::string_view value);
+
+// Appends `value` as a quoted CSV field, doubling embedded quotes.
+void appendEscapedCsv(std::string& out, std::string_view value);
+
+// Appends `value` as a quoted JSON string.
+void appendJsonString(std::string& out, std::string_view value);
+
+void appendInteger(std::string& out, long long value);
+
+}  // namespace csfj
@@ -0,0 +1,49 @@
+(function() {
+  // Sends the chosen file as the body of POST /import, which takes the same
+  // CSV layout as "Descargar CSV" and adds every row or none of them.
+  const controls = document.getElementById('importControls');
+  const fileInput = document.getElementById('importFile');
+  const button = document.getElementById('importButton');
+  const status = document.getElementById('importStatus');
+  if (!controls || !fileInput || !button || !status) {
+    return;
+  }
+  controls.hidden = false;
+
+  function showStatus(message, isError) {
+    status.textContent = message;
+    status.classList.toggle('error', isError);
+  }
+
+  button.addEventListener('click', function() {
+    fileInput.click();
+  });
+
+  fileInput.addEventListener('change', function() {
+    const file = fileInput.files[0];
+    fileInput.value = '';
+    if (!file) {
+      return;
+    }
+    button.disabled = true;
+    showStatus('Importando ' + file.name + '...', false);
+    fetch('import', { method: 'POST', headers: { 'Content-Type': 'text/csv' }, body: file })
+      .then(function(response) {
+        if (response.ok) {
+          return response.json().then(function(result) {
+            showStatus('Se importaron ' + result.imported + ' items.', false);
+            window.location.reload();
+          });
+        }
+        return response.text().then(function(message) {
+          showStatus(message, true);
+        });
+      })
+      .catch(function() {
+        showStatus('No se pudo contactar al servidor.', true);
+      })
+      .then(function() {
+        button.disabled = false;
+      });
+  });
+})();
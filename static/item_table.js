@@ -0,0 +1,151 @@
+(function() {
+  // Rows are fetched from /rows in blocks of this many and kept once loaded.
+  const kBlockSize = 200;
+  // Rows rendered above and below the visible ones.
+  const kOverscanRows = 20;
+
+  function createCell(text) {
+    const cell = document.createElement('td');
+    cell.textContent = text;
+    return cell;
+  }
+
+  // Mirrors appendItemRow in main.cpp.
+  function createRow(index, row) {
+    const tr = document.createElement('tr');
+    tr.appendChild(createCell(String(index + 1)));
+    tr.appendChild(createCell(row[0]));
+    tr.appendChild(createCell(String(row[1])));
+    tr.appendChild(createCell(row[2]));
+    tr.appendChild(createCell(row[3]));
+
+    const actions = document.createElement('td');
+    actions.className = 'actions';
+    const form = document.createElement('form');
+    form.className = 'action-form';
+    form.method = 'GET';
+    form.action = 'edit';
+    const hidden = document.createElement('input');
+    hidden.type = 'hidden';
+    hidden.name = 'index';
+    hidden.value = String(index);
+    const button = document.createElement('button');
+    button.className = 'action-button';
+    button.type = 'submit';
+    button.textContent = 'Editar';
+    form.appendChild(hidden);
+    form.appendChild(button);
+    actions.appendChild(form);
+    tr.appendChild(actions);
+    return tr;
+  }
+
+  function createSpacer(height) {
+    const tr = document.createElement('tr');
+    tr.className = 'spacer';
+    const td = document.createElement('td');
+    td.colSpan = 6;
+    td.style.height = height + 'px';
+    tr.appendChild(td);
+    return tr;
+  }
+
+  document.addEventListener('DOMContentLoaded', () => {
+    const viewport = document.getElementById('itemsViewport');
+    const table = document.getElementById('itemsTable');
+    const body = document.getElementById('itemsBody');
+    const pager = document.getElementById('itemsPager');
+    if (!viewport || !table || !body) {
+      return;
+    }
+
+    const itemCount = Number(table.getAttribute('data-item-count')) || 0;
+    const pageOffset = Number(table.getAttribute('data-page-offset')) || 0;
+    // Nothing to virtualize when the whole sheet is already on the page.
+    if (body.rows.length === 0 || body.rows.length >= itemCount) {
+      return;
+    }
+
+    viewport.classList.add('virtual');
+    if (pager) {
+      pager.hidden = true;
+    }
+    const rowHeight = body.rows[0].getBoundingClientRect().height || 40;
+    const blocks = new Map();
+    const pending = new Set();
+    let renderedStart = pageOffset;
+    let renderedEnd = pageOffset + body.rows.length;
+
+    const rowAt = (index) => {
+      const block = blocks.get(Math.floor(index / kBlockSize));
+      return block ? block[index % kBlockSize] : undefined;
+    };
+
+    const fetchBlock = (blockIndex) => {
+      if (blocks.has(blockIndex) || pending.has(blockIndex)) {
+        return;
+      }
+      pending.add(blockIndex);
+      fetch('rows?offset=' + blockIndex * kBlockSize + '&limit=' + kBlockSize)
+        .then((response) => response.json())
+        .then((page) => {
+          blocks.set(blockIndex, page.rows);
+          pending.delete(blockIndex);
+          render(true);
+        })
+        .catch(() => pending.delete(blockIndex));
+    };
+
+    // Replaces the rendered rows with the visible window plus two spacers
+    // that keep the scroll height equal to the whole sheet.
+    const render = (force) => {
+      const first = Math.max(0, Math.floor(viewport.scrollTop / rowHeight) - kOverscanRows);
+      const visibleRows = Math.ceil(viewport.clientHeight / rowHeight);
+      const last = Math.min(itemCount, first + visibleRows + 2 * kOverscanRows);
+      if (!force && first >= renderedStart && last <= renderedEnd) {
+        return;
+      }
+
+      let missing = false;
+      for (let blockIndex = Math.floor(first / kBlockSize); blockIndex * kBlockSize < last; blockIndex++) {
+        if (!blocks.has(blockIndex)) {
+          missing = true;
+          fetchBlock(blockIndex);
+        }
+      }
+      if (missing) {
+        return;
+      }
+
+      const fragment = document.createDocumentFragment();
+      fragment.appendChild(createSpacer(first * rowHeight));
+      for (let index = first; index < last; index++) {
+        const row = rowAt(index);
+        if (row) {
+          fragment.appendChild(createRow(index, row));
+        }
+      }
+      fragment.appendChild(createSpacer((itemCount - last) * rowHeight));
+      body.replaceChildren(fragment);
+      renderedStart = first;
+      renderedEnd = last;
+    };
+
+    // Keep the server-rendered window in place, surrounded by the spacers.
+    body.insertBefore(createSpacer(pageOffset * rowHeight), body.firstChild);
+    body.appendChild(createSpacer((itemCount - renderedEnd) * rowHeight));
+    viewport.scrollTop = pageOffset * rowHeight;
+
+    let scheduled = false;
+    viewport.addEventListener('scroll', () => {
+      if (scheduled) {
+        return;
+      }
+      scheduled = true;
+      window.requestAnimationFrame(() => {
+        scheduled = false;
+        render(false);
+      });
+    });
+  });
+})();
@@ -0,0 +1,203 @@
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <vector>
+
+#include "column_scan.hpp"
+#include "test_support.hpp"
+
+namespace {
+
+using csfj::ColumnFilter;
+
+// Every length up to here, so each vector loop (4 rows with AVX2, 2 or 16 with
+// SSE2, 32 bytes for the categories) ends at every possible tail.
+constexpr size_t kMaxRows = 300U;
+
+struct Random {
+  std::uint64_t state = 0x9E3779B97F4A7C15ULL;
+
+  std::uint64_t next() {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+  }
+};
+
+struct Columns {
+  std::vector<std::uint8_t> category;
+  std::vector<std::int32_t> quantity;
+  std::vector<std::int64_t> unitCents;
+  std::vector<std::int64_t> totalCents;
+};
+
+// Values drawn near the filter bounds below, with negative numbers and, in the
+// columns that are only compared, the extremes of each type mixed in, so the
+// signed comparisons are exercised. Totals stay far enough from the extremes
+// that no sum of them overflows.
+Columns randomColumns(Random& random, size_t rows) {
+  constexpr std::int64_t kWide[] = {std::numeric_limits<std::int64_t>::min(), -1, 0,
+                                    std::numeric_limits<std::int64_t>::max()};
+  constexpr std::int64_t kLargeTotals[] = {-1'000'000'000'000'000, -1, 0, 1'000'000'000'000'000};
+  Columns columns;
+  for (size_t row = 0; row < rows; ++row) {
+    columns.category.push_back(static_cast<std::uint8_t>(random.next() % csfj::kMaxCategoryIds));
+    const std::uint64_t pick = random.next();
+    columns.quantity.push_back(pick % 50U == 0U ? std::numeric_limits<std::int32_t>::min()
+                                                : static_cast<std::int32_t>(pick % 40U) - 5);
+    columns.unitCents.push_back(pick % 30U == 0U ? kWide[pick % 4U] : static_cast<std::int64_t>(pick % 2000U) - 100);
+    columns.totalCents.push_back(pick % 20U == 0U ? kLargeTotals[(pick >> 8U) % 4U]
+                                                  : static_cast<std::int64_t>((pick >> 16U) % 100'000U));
+  }
+  return columns;
+}
+
+ColumnFilter randomFilter(Random& random) {
+  ColumnFilter filter;
+  if (random.next() % 2U == 0U) {
+    filter.category = static_cast<int>(random.next() % csfj::kMaxCategoryIds);
+  }
+  if (random.next() % 2U == 0U) {
+    filter.minQuantity = static_cast<std::int32_t>(random.next() % 40U) - 5;
+    filter.maxQuantity = filter.minQuantity + static_cast<std::int32_t>(random.next() % 30U);
+  }
+  if (random.next() % 2U == 0U) {
+    filter.minUnitCents = static_cast<std::int64_t>(random.next() % 2000U) - 100;
+  }
+  if (random.next() % 2U == 0U) {
+    filter.maxUnitCents = static_cast<std::int64_t>(random.next() % 2000U) - 100;
+  }
+  if (random.next() % 3U == 0U) {
+    filter.minTotalCents = static_cast<std::int64_t>(random.next() % 100'000U);
+    filter.maxTotalCents = filter.minTotalCents + static_cast<std::int64_t>(random.next() % 50'000U);
+  }
+  return filter;
+}
+
+bool passes(const Columns& columns, size_t row, const ColumnFilter& filter) {
+  return (filter.category < 0 || columns.category[row] == filter.category) &&
+         columns.quantity[row] >= filter.minQuantity && columns.quantity[row] <= filter.maxQuantity &&
+         columns.unitCents[row] >= filter.minUnitCents && columns.unitCents[row] <= filter.maxUnitCents &&
+         columns.totalCents[row] >= filter.minTotalCents && columns.totalCents[row] <= filter.maxTotalCents;
+}
+
+// filterRows() sets exactly the bits of the rows that pass, and clears the
+// bits past the last row of the last word.
+void testFilterRows() {
+  Random random;
+  int mismatches = 0;
+  for (size_t rows = 0; rows <= kMaxRows; ++rows) {
+    const Columns columns = randomColumns(random, rows);
+    for (int sample = 0; sample < 20; ++sample) {
+      const ColumnFilter filter = sample == 0 ? ColumnFilter{} : randomFilter(random);
+      std::vector<std::uint64_t> mask((rows + 63U) / 64U, 0x5555555555555555ULL);
+      csfj::filterRows(columns.category.data(), columns.quantity.data(), columns.unitCents.data(),
+                       columns.totalCents.data(), rows, filter, mask.data());
+      for (size_t row = 0; row < mask.size() * 64U; ++row) {
+        const bool set = ((mask[row / 64U] >> (row % 64U)) & 1U) != 0U;
+        if (set != (row < rows && passes(columns, row, filter)) && mismatches++ == 0) {
+          std::fprintf(stderr, "  fila %zu de %zu\n", row, rows);
+        }
+      }
+    }
+  }
+  CHECK(mismatches == 0);
+}
+
+// Full, empty, alternating and random masks, and masks from filterRows().
+void testMaskedSum() {
+  Random random;
+  int mismatches = 0;
+  for (size_t rows = 0; rows <= kMaxRows; ++rows) {
+    const Columns columns = randomColumns(random, rows);
+    const size_t words = (rows + 63U) / 64U;
+    for (int sample = 0; sample < 8; ++sample) {
+      std::vector<std::uint64_t> mask(words);
+      for (std::uint64_t& word : mask) {
+        switch (sample) {
+          case 0:
+            word = ~std::uint64_t{0};
+            break;
+          case 1:
+            word = 0U;
+            break;
+          case 2:
+            word = 0xAAAAAAAAAAAAAAAAULL;
+            break;
+          default:
+            word = random.next() & random.next();
+            break;
+        }
+      }
+      if (sample == 7) {
+        csfj::filterRows(columns.category.data(), columns.quantity.data(), columns.unitCents.data(),
+                         columns.totalCents.data(), rows, randomFilter(random), mask.data());
+      }
+      std::int64_t expected = 0;
+      for (size_t row = 0; row < rows; ++row) {
+        if (((mask[row / 64U] >> (row % 64U)) & 1U) != 0U) {
+          expected += columns.totalCents[row];
+        }
+      }
+      if (csfj::maskedSum(columns.totalCents.data(), rows, mask.data()) != expected && mismatches++ == 0) {
+        std::fprintf(stderr, "  %zu filas, máscara %d\n", rows, sample);
+      }
+    }
+  }
+  CHECK(mismatches == 0);
+}
+
+void testSumColumn() {
+  Random random;
+  int mismatches = 0;
+  for (size_t rows = 0; rows <= kMaxRows; ++rows) {
+    const Columns columns = randomColumns(random, rows);
+    std::int64_t expected = 0;
+    for (size_t row = 0; row < rows; ++row) {
+      expected += columns.totalCents[row];
+    }
+    if (csfj::sumColumn(columns.totalCents.data(), rows) != expected && mismatches++ == 0) {
+      std::fprintf(stderr, "  %zu filas\n", rows);
+    }
+  }
+  CHECK(mismatches == 0);
+}
+
+// sumByCategory() adds to what the totals already hold, odd lengths included.
+void testSumByCategory() {
+  Random random;
+  int mismatches = 0;
+  for (size_t rows = 0; rows <= kMaxRows; ++rows) {
+    const Columns columns = randomColumns(random, rows);
+    std::uint64_t counts[csfj::kMaxCategoryIds];
+    std::int64_t sums[csfj::kMaxCategoryIds];
+    std::uint64_t expectedCounts[csfj::kMaxCategoryIds];
+    std::int64_t expectedSums[csfj::kMaxCategoryIds];
+    for (size_t id = 0; id < csfj::kMaxCategoryIds; ++id) {
+      counts[id] = expectedCounts[id] = id;
+      sums[id] = expectedSums[id] = static_cast<std::int64_t>(id) * 100;
+    }
+    for (size_t row = 0; row < rows; ++row) {
+      ++expectedCounts[columns.category[row]];
+      expectedSums[columns.category[row]] += columns.totalCents[row];
+    }
+    csfj::sumByCategory(columns.category.data(), columns.totalCents.data(), rows, counts, sums);
+    for (size_t id = 0; id < csfj::kMaxCategoryIds; ++id) {
+      if ((counts[id] != expectedCounts[id] || sums[id] != expectedSums[id]) && mismatches++ == 0) {
+        std::fprintf(stderr, "  %zu filas, categoría %zu\n", rows, id);
+      }
+    }
+  }
+  CHECK(mismatches == 0);
+}
+
+}  // namespace
+
+int main() {
+  testFilterRows();
+  testMaskedSum();
+  testSumColumn();
+  testSumByCategory();
+  return test::exitCode();
+}
@@ -0,0 +1,130 @@
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "csv_import.hpp"
+#include "test_support.hpp"
+
+namespace {
+
+using csfj::CsvItemReader;
+
+// What /export writes for two items, including the closing Total row.
+constexpr std::string_view kExport =
+    "Nombre,Cantidad,Costo Unitario,Total\r\n"
+    "\"Hora docente\",2,\"1'234.50\",\"2'469.00\"\r\n"
+    "\"Dijo \"\"hola\"\", con coma\",1,3,3.00\r\n"
+    "\"Total\",,,\"2'472.00\"\r\n";
+
+// Feeds `csv` in pieces of `pieceSize` bytes, or whole when it is 0.
+bool readAll(CsvItemReader& reader, std::string_view csv, size_t pieceSize = 0U) {
+  if (pieceSize == 0U) {
+    return reader.feed(csv) && reader.finish();
+  }
+  for (size_t offset = 0; offset < csv.size(); offset += pieceSize) {
+    if (!reader.feed(csv.substr(offset, pieceSize))) {
+      return false;
+    }
+  }
+  return reader.finish();
+}
+
+bool startsWith(std::string_view text, std::string_view prefix) {
+  return text.substr(0, prefix.size()) == prefix;
+}
+
+bool isExportedSheet(CsvItemReader& reader) {
+  const std::vector<csfj::Item>& items = reader.items();
+  return items.size() == 2U && items[0].name == "Hora docente" && items[0].quantity == 2 &&
+         items[0].unitCost == csfj::Money::fromCents(123450) && items[1].name == "Dijo \"hola\", con coma" &&
+         items[1].quantity == 1 && items[1].unitCost == csfj::Money::fromCents(300);
+}
+
+void testExportLayout() {
+  CsvItemReader reader;
+  CHECK(readAll(reader, kExport));
+  CHECK(isExportedSheet(reader));
+}
+
+// A split may land anywhere, including between the two quotes of an escaped
+// quote and between \r and \n.
+void testSplitInput() {
+  for (size_t pieceSize = 1U; pieceSize <= kExport.size(); ++pieceSize) {
+    CsvItemReader reader;
+    if (!CHECK(readAll(reader, kExport, pieceSize) && isExportedSheet(reader))) {
+      std::fprintf(stderr, "  con trozos de %zu bytes: %s\n", pieceSize, reader.error().c_str());
+      return;
+    }
+  }
+}
+
+void testQuoting() {
+  CsvItemReader reader;
+  CHECK(readAll(reader, "\"Varias\nlíneas\",1,1\n\"\"\"\",2,2\n\"a,b\",3,\"4,000\""));
+  const std::vector<csfj::Item>& items = reader.items();
+  CHECK(items.size() == 3U);
+  if (items.size() == 3U) {
+    CHECK(items[0].name == "Varias\nlíneas");
+    CHECK(items[1].name == "\"");
+    CHECK(items[2].name == "a,b");
+    CHECK(items[2].unitCost == csfj::Money::fromCents(400000));
+  }
+}
+
+// Only a Total row with an empty quantity is the closing row; an item that is
+// merely named Total is kept, and so is a Nombre row after the first line.
+void testTotalRows() {
+  CsvItemReader reader;
+  CHECK(readAll(reader, "Total,,,5\nTotal,1,5\nNombre,2,1\nTotal,,\n\n"));
+  const std::vector<csfj::Item>& items = reader.items();
+  CHECK(items.size() == 2U);
+  if (items.size() == 2U) {
+    CHECK(items[0].name == "Total" && items[0].quantity == 1);
+    CHECK(items[1].name == "Nombre" && items[1].quantity == 2);
+  }
+}
+
+// The error names the line the offending row starts on, counting the line
+// breaks inside quoted fields, and nothing read before it is kept.
+void testErrorLines() {
+  const struct {
+    std::string_view csv;
+    std::string_view error;
+  } cases[] = {
+      {"Nombre,Cantidad,Costo Unitario,Total\nA,1,1\nB,0,1\n", "Línea 3: cantidad inválida"},
+      {"A,1,1\n\"Dos\nlíneas\",1,1\nC,1,-4\n", "Línea 4: costo inválido"},
+      {"A,1,1\n,1,1\n", "Línea 2: falta el nombre"},
+      {"A,1\n", "Línea 1: se esperaban las columnas"},
+      {"A,1,1,1,1\n", "Línea 1: se esperaban las columnas"},
+      {"A,1,1\n\"B,1,1\nC,1,1\n", "Línea 2: comillas sin cerrar"},
+      {"A,1,100000000000000\n", "Línea 1: costo inválido"},
+  };
+  for (const auto& testCase : cases) {
+    CsvItemReader reader;
+    CHECK(!readAll(reader, testCase.csv));
+    CHECK(reader.failed());
+    CHECK(reader.items().empty());
+    if (!CHECK(startsWith(reader.error(), testCase.error))) {
+      std::fprintf(stderr, "  \"%s\": %s\n", test::printable(testCase.csv).c_str(), reader.error().c_str());
+    }
+  }
+
+  // Once rejected, later input is ignored.
+  CsvItemReader reader;
+  CHECK(!reader.feed("A,x,1\n"));
+  CHECK(!reader.feed("B,1,1\n"));
+  CHECK(!reader.finish());
+  CHECK(startsWith(reader.error(), "Línea 1:"));
+}
+
+}  // namespace
+
+int main() {
+  testExportLayout();
+  testSplitInput();
+  testQuoting();
+  testTotalRows();
+  testErrorLines();
+  return test::exitCode();
+}
@@ -0,0 +1,233 @@
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+#include "http_parser.hpp"
+#include "test_support.hpp"
+
+namespace {
+
+using csfj::HttpRequest;
+using csfj::HttpRequestParser;
+using csfj::ParseStatus;
+
+constexpr std::string_view kBrowserGet =
+    "GET /s/team/edit?index=12 HTTP/1.1\r\n"
+    "Host: localhost:8080\r\n"
+    "Accept: text/html,application/xhtml+xml;q=0.9,*/*;q=0.8\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Connection: keep-alive\r\n"
+    "\r\n";
+
+constexpr std::string_view kFormPost =
+    "POST /submit HTTP/1.1\r\n"
+    "Host: localhost:8080\r\n"
+    "Content-Type: application/x-www-form-urlencoded\r\n"
+    "content-length:  38 \r\n"
+    "\r\n"
+    "itemNameSelect=Hora+docente&itemCost=1";
+
+constexpr std::string_view kHttp10 =
+    "HEAD /export HTTP/1.0\r\n"
+    "Connection: Keep-Alive\r\n"
+    "\r\n";
+
+// What a parse produced, copied out of the buffer so that two parses can be
+// compared after their buffers are gone.
+struct Parsed {
+  ParseStatus status = ParseStatus::kIncomplete;
+  std::string method;
+  std::string path;
+  std::string query;
+  std::string body;
+  std::string headers;
+  size_t length = 0U;
+  bool http10 = false;
+  bool keepAlive = false;
+
+  bool operator==(const Parsed& other) const {
+    return status == other.status && method == other.method && path == other.path && query == other.query &&
+           body == other.body && headers == other.headers && length == other.length && http10 == other.http10 &&
+           keepAlive == other.keepAlive;
+  }
+};
+
+Parsed capture(ParseStatus status, const HttpRequest& request) {
+  Parsed parsed;
+  parsed.status = status;
+  if (status != ParseStatus::kComplete) {
+    return parsed;
+  }
+  parsed.method = std::string(request.method);
+  parsed.path = std::string(request.path);
+  parsed.query = std::string(request.query);
+  parsed.body = std::string(request.body);
+  for (size_t index = 0; index < request.headerCount; ++index) {
+    parsed.headers += std::string(request.headers[index].name) + ":" + std::string(request.headers[index].value) + "\n";
+  }
+  parsed.length = request.length();
+  parsed.http10 = request.http10;
+  parsed.keepAlive = request.keepAlive;
+  return parsed;
+}
+
+Parsed parseWhole(std::string_view text, const csfj::RequestLimits& limits = {}) {
+  HttpRequestParser parser(limits);
+  HttpRequest request;
+  const ParseStatus status = parser.parse(text, request);
+  return capture(status, request);
+}
+
+ParseStatus statusOf(std::string_view text, const csfj::RequestLimits& limits = {}) {
+  return parseWhole(text, limits).status;
+}
+
+// Feeds the first `split` bytes and then the whole request, copied to a new
+// buffer in between as a growing receive buffer would be, so the second call
+// has to rebase the views of the first.
+Parsed parseSplit(std::string_view text, size_t split) {
+  HttpRequestParser parser;
+  HttpRequest request;
+  std::string buffer(text.substr(0, split));
+  const ParseStatus first = parser.parse(buffer, request);
+  if (first != ParseStatus::kIncomplete) {
+    return capture(first, request);
+  }
+  std::string grown;
+  grown.reserve(text.size() + 64U);
+  grown.append(text);
+  buffer.clear();
+  buffer.shrink_to_fit();
+  return capture(parser.parse(grown, request), request);
+}
+
+// Every split point, and byte by byte, gives what one whole parse gives.
+void testSplitInput() {
+  for (const std::string_view text : {kBrowserGet, kFormPost, kHttp10}) {
+    const Parsed whole = parseWhole(text);
+    CHECK(whole.status == ParseStatus::kComplete);
+    CHECK(whole.length == text.size());
+    for (size_t split = 0; split < text.size(); ++split) {
+      if (!CHECK(parseSplit(text, split) == whole)) {
+        std::fprintf(stderr, "  corte en %zu de \"%s\"\n", split, test::printable(text).c_str());
+        break;
+      }
+    }
+
+    HttpRequestParser parser;
+    HttpRequest request;
+    std::string buffer;
+    ParseStatus status = ParseStatus::kIncomplete;
+    for (size_t received = 1; received <= text.size(); ++received) {
+      buffer.assign(text.substr(0, received));
+      status = parser.parse(buffer, request);
+      if (received < text.size() && !CHECK(status == ParseStatus::kIncomplete)) {
+        break;
+      }
+    }
+    CHECK(capture(status, request) == whole);
+  }
+}
+
+void testFields() {
+  const Parsed get = parseWhole(kBrowserGet);
+  CHECK(get.method == "GET" && get.path == "/s/team/edit" && get.query == "index=12" && get.body.empty());
+  CHECK(!get.http10 && get.keepAlive);
+
+  HttpRequestParser parser;
+  HttpRequest request;
+  CHECK(parser.parse(kFormPost, request) == ParseStatus::kComplete);
+  CHECK(request.contentLength == 38U && request.body == "itemNameSelect=Hora+docente&itemCost=1");
+  CHECK(request.header("CONTENT-TYPE") == "application/x-www-form-urlencoded");
+  CHECK(request.header("x-missing").empty());
+
+  const Parsed head = parseWhole(kHttp10);
+  CHECK(head.http10 && head.keepAlive);
+  CHECK(!parseWhole("GET / HTTP/1.0\r\n\r\n").keepAlive);
+  CHECK(!parseWhole("GET / HTTP/1.1\r\nConnection: close\r\n\r\n").keepAlive);
+}
+
+// Requests delivered in one read are parsed one after another, each ending
+// where the next begins.
+void testPipelined() {
+  const std::string pipeline = std::string(kFormPost) + std::string(kBrowserGet) + std::string(kHttp10);
+  std::string_view pending = pipeline;
+  HttpRequestParser parser;
+  HttpRequest request;
+  size_t count = 0U;
+  for (const std::string_view expected : {kFormPost, kBrowserGet, kHttp10}) {
+    if (!CHECK(parser.parse(pending, request) == ParseStatus::kComplete)) {
+      return;
+    }
+    CHECK(capture(ParseStatus::kComplete, request) == parseWhole(expected));
+    pending.remove_prefix(request.length());
+    parser.reset();
+    ++count;
+  }
+  CHECK(count == 3U && pending.empty());
+}
+
+std::string withHeaders(size_t count) {
+  std::string text = "GET / HTTP/1.1\r\n";
+  for (size_t index = 0; index < count; ++index) {
+    text += "X-Header-" + std::to_string(index) + ": " + std::to_string(index) + "\r\n";
+  }
+  return text + "\r\n";
+}
+
+void testRequestLine() {
+  CHECK(statusOf("GET / HTTP/1.1\r\n\r\n") == ParseStatus::kComplete);
+  CHECK(statusOf("GET / HTTP/1.0\r\n\r\n") == ParseStatus::kComplete);
+  // HTTP/0.9 has no version and no headers; other versions are not spoken.
+  CHECK(statusOf("GET /\r\n\r\n") == ParseStatus::kInvalid);
+  CHECK(statusOf("GET / HTTP/2.0\r\n\r\n") == ParseStatus::kInvalid);
+  CHECK(statusOf("GET / http/1.1\r\n\r\n") == ParseStatus::kInvalid);
+  CHECK(statusOf("GET / HTTP/1.1 extra\r\n\r\n") == ParseStatus::kInvalid);
+  CHECK(statusOf("GET\r\n\r\n") == ParseStatus::kInvalid);
+  CHECK(statusOf("\r\n\r\n") == ParseStatus::kInvalid);
+}
+
+void testLimits() {
+  CHECK(statusOf(withHeaders(csfj::kMaxRequestHeaders)) == ParseStatus::kComplete);
+  CHECK(statusOf(withHeaders(csfj::kMaxRequestHeaders + 1U)) == ParseStatus::kHeadersTooLarge);
+
+  csfj::RequestLimits limits;
+  limits.maxHeaderBytes = kBrowserGet.size();
+  CHECK(statusOf(kBrowserGet, limits) == ParseStatus::kComplete);
+  limits.maxHeaderBytes = kBrowserGet.size() - 1U;
+  CHECK(statusOf(kBrowserGet, limits) == ParseStatus::kHeadersTooLarge);
+  // Without the end of the headers in sight, as soon as the limit is reached.
+  CHECK(statusOf(kBrowserGet.substr(0, limits.maxHeaderBytes), limits) == ParseStatus::kHeadersTooLarge);
+  CHECK(statusOf(kBrowserGet.substr(0, limits.maxHeaderBytes - 1U), limits) == ParseStatus::kIncomplete);
+
+  // The body limit applies as soon as the headers are in, before the body.
+  limits = {};
+  limits.maxBodyBytes = 37U;
+  const std::string_view headersOnly = kFormPost.substr(0, kFormPost.find("\r\n\r\n") + 4U);
+  CHECK(statusOf(headersOnly, limits) == ParseStatus::kBodyTooLarge);
+  limits.maxBodyBytes = 38U;
+  CHECK(statusOf(kFormPost, limits) == ParseStatus::kComplete);
+}
+
+// Only Content-Length delimits a body, and only when it is unambiguous.
+void testFraming() {
+  CHECK(statusOf("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n") == ParseStatus::kTransferEncoding);
+  CHECK(statusOf("POST / HTTP/1.1\r\nContent-Length: 1\r\nContent-Length: 1\r\n\r\nx") == ParseStatus::kInvalid);
+  CHECK(statusOf("POST / HTTP/1.1\r\nContent-Length: -1\r\n\r\n") == ParseStatus::kInvalid);
+  CHECK(statusOf("POST / HTTP/1.1\r\nContent-Length: 1x\r\n\r\nx") == ParseStatus::kInvalid);
+  CHECK(statusOf("POST / HTTP/1.1\r\nContent-Length:\r\n\r\n") == ParseStatus::kInvalid);
+  CHECK(statusOf("POST / HTTP/1.1\r\nContent-Length: 99999999999999999999999\r\n\r\n") == ParseStatus::kInvalid);
+  CHECK(statusOf("POST / HTTP/1.1\r\nContent-Length: 4\r\n\r\nabc") == ParseStatus::kIncomplete);
+}
+
+}  // namespace
+
+int main() {
+  testSplitInput();
+  testFields();
+  testPipelined();
+  testRequestLine();
+  testLimits();
+  testFraming();
+  return test::exitCode();
+}
@@ -0,0 +1,289 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "item_index.hpp"
+#include "item_store.hpp"
+#include "money.hpp"
+#include "test_support.hpp"
+
+namespace {
+
+// Large enough that every index wins as the source of some query: a column
+// pass costs as much as 1/64 of the items.
+constexpr size_t kItems = 20'000U;
+
+struct Random {
+  std::uint64_t state = 0x2545F4914F6CDD1DULL;
+
+  std::uint64_t next() {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+  }
+
+  bool pick(std::uint64_t percent) {
+    return next() % 100U < percent;
+  }
+};
+
+// Few distinct quantities and costs, so every sort key has long runs of ties.
+// The last category is rare, so that its index can be a query's source.
+csfj::Item randomItem(Random& random) {
+  std::string name;
+  const std::uint64_t kind = random.next() % 100U;
+  if (kind == 0U) {
+    name = csfj::kItemCategories.back();
+  } else if (kind < 67U) {
+    name = csfj::kItemCategories[random.next() % (csfj::kItemCategories.size() - 1U)];
+  } else {
+    name = "Taller " + std::to_string(random.next() % 300U);
+  }
+  return {std::move(name), static_cast<int>(1U + random.next() % 100U),
+          csfj::Money::fromCents(static_cast<std::int64_t>(100U * (1U + random.next() % 200U)))};
+}
+
+csfj::ItemQuery randomQuery(Random& random) {
+  csfj::ItemQuery query;
+  if (random.pick(30U)) {
+    query.category = random.next() % (csfj::kItemCategories.size() + 1U);
+  }
+  if (random.pick(10U)) {
+    query.name = random.pick(50U) ? std::string(csfj::kItemCategories[random.next() % csfj::kItemCategories.size()])
+                                  : "Taller " + std::to_string(random.next() % 300U);
+  }
+  if (random.pick(15U)) {
+    query.namePrefix = "Taller " + std::to_string(random.next() % 40U);
+  }
+  if (random.pick(30U)) {
+    query.minQuantity = static_cast<int>(random.next() % 102U);
+  }
+  if (random.pick(30U)) {
+    query.maxQuantity = static_cast<int>(random.next() % 102U);
+  }
+  if (random.pick(30U)) {
+    query.minUnitCost = csfj::Money::fromCents(static_cast<std::int64_t>(random.next() % 21'000U));
+  }
+  if (random.pick(30U)) {
+    query.maxUnitCost = csfj::Money::fromCents(static_cast<std::int64_t>(random.next() % 21'000U));
+  }
+  if (random.pick(20U)) {
+    query.minTotal = csfj::Money::fromCents(static_cast<std::int64_t>(random.next() % 2'100'000U));
+  }
+  if (random.pick(20U)) {
+    query.maxTotal = csfj::Money::fromCents(static_cast<std::int64_t>(random.next() % 2'100'000U));
+  }
+  query.sortBy = static_cast<csfj::ItemField>(random.next() % 5U);
+  query.descending = random.pick(50U);
+  query.offset = random.pick(50U) ? 0U : random.next() % 300U;
+  query.limit = 1U + random.next() % 200U;
+  return query;
+}
+
+// The pass over every item the indexes replace: filter, then sort with ties
+// in item order either way, then page.
+csfj::ItemQueryResult scanQuery(const csfj::ItemSnapshot& items, const csfj::ItemQuery& query) {
+  csfj::ItemQueryResult result;
+  std::vector<size_t> matches;
+  for (size_t index = 0; index < items.size(); ++index) {
+    if (query.matches(items[index])) {
+      matches.push_back(index);
+      result.totalCost += items[index].getTotalCost();
+    }
+  }
+  const auto key = [&](size_t index) {
+    const csfj::Item& item = items[index];
+    switch (query.sortBy) {
+      case csfj::ItemField::kQuantity:
+        return static_cast<std::int64_t>(item.quantity);
+      case csfj::ItemField::kUnitCost:
+        return item.unitCost.cents();
+      case csfj::ItemField::kTotal:
+        return item.getTotalCost().cents();
+      case csfj::ItemField::kIndex:
+        return static_cast<std::int64_t>(index);
+      case csfj::ItemField::kName:
+        break;
+    }
+    return std::int64_t{0};
+  };
+  std::stable_sort(matches.begin(), matches.end(), [&](size_t left, size_t right) {
+    const size_t low = query.descending ? right : left;
+    const size_t high = query.descending ? left : right;
+    if (query.sortBy == csfj::ItemField::kName) {
+      return items[low].name < items[high].name;
+    }
+    return key(low) < key(high);
+  });
+  result.total = matches.size();
+  const size_t first = std::min(query.offset, matches.size());
+  const size_t last = std::min(matches.size(), first + query.limit);
+  result.positions.assign(matches.begin() + static_cast<std::ptrdiff_t>(first),
+                          matches.begin() + static_cast<std::ptrdiff_t>(last));
+  return result;
+}
+
+bool matchesScan(const csfj::ItemQueryResult& result, const csfj::ItemQuery& query) {
+  const csfj::ItemQueryResult expected = scanQuery(*result.items, query);
+  return result.total == expected.total && result.totalCost == expected.totalCost &&
+         result.positions == expected.positions;
+}
+
+// Fills `store` through every write path, so the indexes are checked after
+// loads, appends, batches and replacements alike.
+void fill(csfj::ItemStore& store, Random& random) {
+  std::vector<csfj::Item> loaded;
+  for (size_t index = 0; index < kItems / 2U; ++index) {
+    loaded.push_back(randomItem(random));
+  }
+  store.load(std::move(loaded), 0U);
+  while (store.snapshot()->size() < kItems) {
+    std::vector<csfj::Item> batch;
+    for (size_t index = 0; index < 500U; ++index) {
+      batch.push_back(randomItem(random));
+    }
+    store.appendBatch(std::move(batch));
+    store.append(randomItem(random));
+    for (int write = 0; write < 50; ++write) {
+      store.replace(random.next() % store.snapshot()->size(), randomItem(random));
+    }
+    std::vector<csfj::ItemChange> changes(20U);
+    for (csfj::ItemChange& change : changes) {
+      csfj::Item item = randomItem(random);
+      change.index = random.next() % store.snapshot()->size();
+      change.name = std::move(item.name);
+      change.unitCost = item.unitCost;
+    }
+    changes.back().index.reset();
+    changes.back().quantity = 1;
+    store.applyBatch(changes);
+  }
+}
+
+void report(const csfj::ItemQuery& query, const csfj::ItemQueryResult& result) {
+  std::fprintf(stderr, "  orden %d%s, offset %zu, limit %zu: %zu coincidencias\n", static_cast<int>(query.sortBy),
+               query.descending ? " descendente" : "", query.offset, query.limit, result.total);
+}
+
+void testRandomQueries() {
+  csfj::ItemStore store;
+  Random random;
+  fill(store, random);
+  int mismatches = 0;
+  for (int sample = 0; sample < 1000; ++sample) {
+    const csfj::ItemQuery query = randomQuery(random);
+    const csfj::ItemQueryResult result = store.query(query);
+    if (!matchesScan(result, query) && mismatches++ == 0) {
+      report(query, result);
+    }
+  }
+  CHECK(mismatches == 0);
+}
+
+// One filter at a time, selective enough for its own index to be the source,
+// in both directions of every sort key.
+void testEachSource() {
+  csfj::ItemStore store;
+  Random random;
+  fill(store, random);
+  const std::shared_ptr<const csfj::ItemSnapshot> items = store.snapshot();
+  csfj::ItemIndex index;
+  for (size_t position = 0; position < items->size(); ++position) {
+    index.insert(position, (*items)[position]);
+  }
+
+  std::vector<csfj::ItemQuery> queries(6U);
+  queries[0].category = csfj::kItemCategories.size() - 1U;
+  queries[1].name = "Taller 7";
+  queries[2].namePrefix = "Taller 15";
+  queries[3].minQuantity = 100;
+  queries[4].minUnitCost = csfj::Money::fromCents(19'900);
+  queries[5].minTotal = csfj::Money::fromCents(1'900'000);
+  int mismatches = 0;
+  for (csfj::ItemQuery query : queries) {
+    for (int field = 0; field < 5; ++field) {
+      for (const bool descending : {false, true}) {
+        query.sortBy = static_cast<csfj::ItemField>(field);
+        query.descending = descending;
+        query.limit = kItems;
+        csfj::ItemIndex::Candidates candidates = index.candidates(*items, query);
+        CHECK(!candidates.scan);
+        const csfj::ItemQueryResult direct = csfj::ItemIndex::finish(items, query, std::move(candidates));
+        const csfj::ItemQueryResult result = store.query(query);
+        if ((!matchesScan(result, query) || direct.positions != result.positions) && mismatches++ == 0) {
+          report(query, result);
+        }
+      }
+    }
+  }
+  CHECK(mismatches == 0);
+
+  // Descending ties keep item order: items 0 and 1 share every key.
+  csfj::ItemStore small;
+  small.appendBatch({{"A", 2, csfj::Money::fromCents(100)},
+                     {"A", 2, csfj::Money::fromCents(100)},
+                     {"B", 1, csfj::Money::fromCents(50)}});
+  for (const csfj::ItemField field :
+       {csfj::ItemField::kName, csfj::ItemField::kQuantity, csfj::ItemField::kUnitCost, csfj::ItemField::kTotal}) {
+    csfj::ItemQuery query;
+    query.sortBy = field;
+    query.descending = true;
+    const std::vector<size_t> expected =
+        field == csfj::ItemField::kName ? std::vector<size_t>{2U, 0U, 1U} : std::vector<size_t>{0U, 1U, 2U};
+    CHECK(small.query(query).positions == expected);
+  }
+}
+
+// Queries running while a writer publishes each see one version whole: the
+// result agrees with the snapshot it names.
+void testConcurrentWrites() {
+  csfj::ItemStore store;
+  Random random;
+  fill(store, random);
+  std::atomic<bool> stop{false};
+  std::thread writer([&store, &stop] {
+    Random writes;
+    writes.state = 0x8BADF00DULL;
+    while (!stop.load()) {
+      store.replace(writes.next() % kItems, randomItem(writes));
+      if (writes.pick(5U)) {
+        store.append(randomItem(writes));
+      }
+    }
+  });
+  std::atomic<int> mismatches{0};
+  std::vector<std::thread> readers;
+  for (int reader = 0; reader < 3; ++reader) {
+    readers.emplace_back([&store, &mismatches, reader] {
+      Random queries;
+      queries.state += static_cast<std::uint64_t>(reader);
+      for (int sample = 0; sample < 300; ++sample) {
+        const csfj::ItemQuery query = randomQuery(queries);
+        if (!matchesScan(store.query(query), query)) {
+          ++mismatches;
+        }
+      }
+    });
+  }
+  for (std::thread& reader : readers) {
+    reader.join();
+  }
+  stop = true;
+  writer.join();
+  CHECK(mismatches.load() == 0);
+}
+
+}  // namespace
+
+int main() {
+  testRandomQueries();
+  testEachSource();
+  testConcurrentWrites();
+  return test::exitCode();
+}
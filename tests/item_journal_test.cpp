@@ -0,0 +1,326 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "item_journal.hpp"
+#include "item_store.hpp"
+#include "test_support.hpp"
+
+namespace {
+
+using csfj::Item;
+using csfj::Money;
+using test::TempDirectory;
+
+// Never reached here, so every write stays in the one log file.
+constexpr std::uintmax_t kNoCompaction = std::uintmax_t{1} << 30U;
+// A few records' worth, so that writing a sheet compacts it.
+constexpr std::uintmax_t kSmallLog = 256U;
+
+// A store recovered from `directory` and logging its writes there, declared
+// in the same order as in Sheet so the journal detaches first.
+struct JournaledStore {
+  explicit JournaledStore(const std::filesystem::path& directory, std::uintmax_t compactionThreshold = kNoCompaction)
+      : journal(std::make_unique<csfj::ItemJournal>(directory, compactionThreshold, threads)) {
+    journal->open(store);
+  }
+
+  csfj::JournalThreads threads{1U};
+  csfj::ItemStore store;
+  std::unique_ptr<csfj::ItemJournal> journal;
+};
+
+std::vector<Item> itemsOf(const csfj::ItemStore& store) {
+  const auto snapshot = store.snapshot();
+  return std::vector<Item>(snapshot->begin(), snapshot->end());
+}
+
+bool sameItems(const std::vector<Item>& actual, const std::vector<Item>& expected) {
+  if (actual.size() != expected.size()) {
+    return false;
+  }
+  for (size_t index = 0; index < actual.size(); ++index) {
+    if (actual[index].name != expected[index].name || actual[index].quantity != expected[index].quantity ||
+        actual[index].unitCost != expected[index].unitCost) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::string readFile(const std::filesystem::path& path) {
+  std::ifstream input(path, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+}
+
+void writeFile(const std::filesystem::path& path, const std::string& bytes) {
+  std::ofstream output(path, std::ios::binary | std::ios::trunc);
+  output.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+}
+
+// One log written with a record of every type, and what replaying each prefix
+// of it must recover.
+struct WrittenLog {
+  std::filesystem::path path;
+  std::string bytes;
+  // ends[k] is the log size once k records are durable, and states[k] the
+  // items after them.
+  std::vector<size_t> ends;
+  std::vector<std::vector<Item>> states;
+};
+
+WrittenLog writeLog(const std::filesystem::path& directory) {
+  WrittenLog log;
+  JournaledStore sheet(directory);
+  for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+    log.path = entry.path();
+  }
+  const auto recordDurable = [&](std::uint64_t sequence) {
+    while (sheet.journal->durableSequence() < sequence) {
+      std::this_thread::yield();
+    }
+    log.ends.push_back(static_cast<size_t>(std::filesystem::file_size(log.path)));
+    log.states.push_back(itemsOf(sheet.store));
+  };
+  recordDurable(0U);
+
+  recordDurable(*sheet.store.append({"Refrigerio", 3, Money::fromCents(1250)}));
+  recordDurable(
+      *sheet.store.appendBatch({{"Transporte", 1, Money::fromCents(4000)}, {"Viáticos", 2, Money::fromCents(99)}}));
+  recordDurable(sheet.store.replace(0U, {"Refrigerio", 4, Money::fromCents(1250)}).sequence);
+  std::vector<csfj::ItemChange> changes(2U);
+  changes[0].index = 2U;
+  changes[0].quantity = 5;
+  changes[1].name = "Material didáctico";
+  changes[1].quantity = 1;
+  changes[1].unitCost = Money::fromCents(700);
+  const csfj::BatchResult result = sheet.store.applyBatch(changes);
+  CHECK(result.status == csfj::BatchStatus::kApplied);
+  recordDurable(result.sequence);
+
+  log.bytes = readFile(log.path);
+  return log;
+}
+
+// The number of whole records in the first `size` bytes of the log.
+size_t recordsWithin(const WrittenLog& log, size_t size) {
+  size_t records = 0U;
+  while (records + 1U < log.ends.size() && log.ends[records + 1U] <= size) {
+    ++records;
+  }
+  return records;
+}
+
+// Replays `directory` after its log was replaced by `damaged`; the logs that
+// earlier replays started are removed first, so only the damaged one counts.
+std::vector<Item> replayDamaged(const std::filesystem::path& directory,
+                                const WrittenLog& log,
+                                const std::string& damaged) {
+  for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+    if (entry.path() != log.path) {
+      std::filesystem::remove(entry.path());
+    }
+  }
+  writeFile(log.path, damaged);
+  JournaledStore reopened(directory);
+  return itemsOf(reopened.store);
+}
+
+void testCleanReplay() {
+  TempDirectory directory("clean");
+  const WrittenLog log = writeLog(directory.path());
+  CHECK(log.ends.size() == 5U);
+  CHECK(log.ends.back() == log.bytes.size());
+
+  JournaledStore reopened(directory.path());
+  CHECK(sameItems(itemsOf(reopened.store), log.states.back()));
+  CHECK(reopened.store.snapshot()->summary().total == Money::fromCents(4 * 1250 + 4000 + 5 * 99 + 700));
+
+  // Writes after a replay continue the sequence, so both runs are recovered.
+  const std::uint64_t recovered = reopened.journal->durableSequence();
+  const auto sequence = reopened.store.append({"Hora docente", 1, Money::fromCents(100)});
+  CHECK(sequence && *sequence > recovered);
+  reopened.journal.reset();
+  JournaledStore again(directory.path());
+  CHECK(again.store.snapshot()->size() == 5U);
+}
+
+// A crash in the middle of a write leaves part of its record at the end of
+// the log. Wherever the cut falls, the records before it are recovered and
+// nothing after it.
+void testTruncatedTail() {
+  TempDirectory directory("truncated");
+  const WrittenLog log = writeLog(directory.path());
+  int failures = 0;
+  for (size_t size = 0U; size < log.bytes.size(); ++size) {
+    const std::vector<Item> recovered = replayDamaged(directory.path(), log, log.bytes.substr(0, size));
+    if (!sameItems(recovered, log.states[recordsWithin(log, size)]) && failures++ == 0) {
+      std::fprintf(stderr, "cortado en %zu bytes: %zu item(s) recuperado(s)\n", size, recovered.size());
+    }
+  }
+  CHECK(failures == 0);
+}
+
+// A flipped bit anywhere in a record fails its checksum, or its length frame,
+// and ends the replay there.
+void testCorruptRecord() {
+  TempDirectory directory("corrupt");
+  const WrittenLog log = writeLog(directory.path());
+  int failures = 0;
+  for (size_t offset = log.ends[0]; offset < log.bytes.size(); ++offset) {
+    std::string damaged = log.bytes;
+    damaged[offset] = static_cast<char>(damaged[offset] ^ 0x10);
+    const std::vector<Item> recovered = replayDamaged(directory.path(), log, damaged);
+    if (!sameItems(recovered, log.states[recordsWithin(log, offset)]) && failures++ == 0) {
+      std::fprintf(stderr, "byte %zu alterado: %zu item(s) recuperado(s)\n", offset, recovered.size());
+    }
+  }
+  CHECK(failures == 0);
+}
+
+void waitDurable(const JournaledStore& sheet, std::uint64_t sequence) {
+  while (sheet.journal->durableSequence() < sequence) {
+    std::this_thread::yield();
+  }
+}
+
+// Compaction runs on its own thread once the log is big enough; false if it
+// has not published a snapshot within a few seconds.
+bool waitForSnapshot(const std::filesystem::path& directory) {
+  for (int attempt = 0; attempt < 1000; ++attempt) {
+    if (std::filesystem::exists(directory / "items.snapshot")) {
+      return true;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  return false;
+}
+
+std::vector<std::filesystem::path> logFiles(const std::filesystem::path& directory) {
+  std::vector<std::filesystem::path> logs;
+  for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+    if (entry.path().extension() == ".log") {
+      logs.push_back(entry.path());
+    }
+  }
+  return logs;
+}
+
+// Writes past the threshold, so the log is rotated and a snapshot replaces
+// the older log files, then writes on; a replay maps the snapshot and applies
+// only the newer log on top.
+void testCompaction() {
+  TempDirectory directory("compaction");
+  std::vector<Item> expected;
+  {
+    JournaledStore sheet(directory.path(), kSmallLog);
+    std::uint64_t sequence = 0U;
+    for (int index = 0; index < 40; ++index) {
+      expected.push_back({"Item " + std::to_string(index), index + 1, Money::fromCents(100 + index)});
+      sequence = *sheet.store.append(expected.back());
+    }
+    waitDurable(sheet, sequence);
+    CHECK(waitForSnapshot(directory.path()));
+
+    expected[3] = {"Refrigerio", 7, Money::fromCents(1250)};
+    sheet.store.replace(3U, expected[3]);
+    expected.push_back({"Transporte", 1, Money::fromCents(4000)});
+    sheet.store.append(expected.back());
+  }
+  // The older generations are gone once the snapshot covers them.
+  CHECK(logFiles(directory.path()).size() == 1U);
+  CHECK(!std::filesystem::exists(directory.path() / "items.snapshot.tmp"));
+
+  JournaledStore reopened(directory.path(), kSmallLog);
+  CHECK(sameItems(itemsOf(reopened.store), expected));
+}
+
+// A crash between publishing the snapshot and deleting the logs it covers
+// leaves both behind; the records the snapshot already holds are skipped.
+void testSnapshotWithCoveredLog() {
+  TempDirectory directory("covered-log");
+  std::vector<Item> expected;
+  {
+    JournaledStore sheet(directory.path());
+    std::uint64_t sequence = 0U;
+    for (int index = 0; index < 10; ++index) {
+      expected.push_back({"Item " + std::to_string(index), 1, Money::fromCents(100)});
+      sequence = *sheet.store.append(expected.back());
+    }
+    waitDurable(sheet, sequence);
+  }
+  const std::filesystem::path coveredLog = logFiles(directory.path()).front();
+  const std::string coveredBytes = readFile(coveredLog);
+  {
+    // Opening with a log past the threshold compacts it straight away.
+    JournaledStore sheet(directory.path(), kSmallLog);
+    CHECK(waitForSnapshot(directory.path()));
+    expected.push_back({"Después", 2, Money::fromCents(300)});
+    waitDurable(sheet, *sheet.store.append(expected.back()));
+  }
+  CHECK(!std::filesystem::exists(coveredLog));
+  writeFile(coveredLog, coveredBytes);
+
+  JournaledStore reopened(directory.path());
+  CHECK(sameItems(itemsOf(reopened.store), expected));
+}
+
+// A damaged snapshot stops the startup instead of loading a wrong sheet, and
+// a temporary snapshot left by an interrupted compaction is ignored.
+void testDamagedSnapshot() {
+  TempDirectory directory("damaged-snapshot");
+  {
+    JournaledStore sheet(directory.path(), kSmallLog);
+    std::uint64_t sequence = 0U;
+    for (int index = 0; index < 20; ++index) {
+      sequence = *sheet.store.append({"Item", 1, Money::fromCents(100)});
+    }
+    waitDurable(sheet, sequence);
+    CHECK(waitForSnapshot(directory.path()));
+  }
+  const std::filesystem::path snapshotPath = directory.path() / "items.snapshot";
+  const std::string snapshot = readFile(snapshotPath);
+
+  writeFile(directory.path() / "items.snapshot.tmp", "CSFJSNP1 interrumpida");
+  {
+    JournaledStore reopened(directory.path());
+    CHECK(reopened.store.snapshot()->size() == 20U);
+  }
+  CHECK(!std::filesystem::exists(directory.path() / "items.snapshot.tmp"));
+
+  const auto rejected = [&](const std::string& damaged) {
+    writeFile(snapshotPath, damaged);
+    try {
+      JournaledStore reopened(directory.path());
+    } catch (const std::runtime_error&) {
+      return true;
+    }
+    return false;
+  };
+  std::string flipped = snapshot;
+  flipped[flipped.size() / 2U] = static_cast<char>(flipped[flipped.size() / 2U] ^ 0x01);
+  CHECK(rejected(flipped));
+  CHECK(rejected(snapshot.substr(0, snapshot.size() - 1U)));
+  CHECK(rejected(snapshot.substr(0, 6U)));
+  CHECK(rejected(""));
+}
+
+}  // namespace
+
+int main() {
+  testCleanReplay();
+  testTruncatedTail();
+  testCorruptRecord();
+  testCompaction();
+  testSnapshotWithCoveredLog();
+  testDamagedSnapshot();
+  return test::exitCode();
+}
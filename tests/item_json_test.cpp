@@ -0,0 +1,264 @@
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "item_json.hpp"
+#include "json_reader.hpp"
+#include "money.hpp"
+#include "test_support.hpp"
+
+namespace {
+
+using csfj::ItemChange;
+using csfj::JsonReader;
+using csfj::JsonType;
+
+struct Random {
+  std::uint64_t state = 0x9E3779B97F4A7C15ULL;
+
+  std::uint64_t next() {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+  }
+};
+
+// Names made of any byte but 0, so every escape appendJsonString writes and
+// every byte it passes through are read back.
+std::vector<csfj::Item> randomItems(size_t count) {
+  Random random;
+  std::vector<csfj::Item> items;
+  for (size_t index = 0; index < count; ++index) {
+    std::string name;
+    const size_t length = 1U + random.next() % 24U;
+    for (size_t byte = 0; byte < length; ++byte) {
+      name.push_back(static_cast<char>(1U + random.next() % 255U));
+    }
+    items.push_back({std::move(name), static_cast<int>(1U + random.next() % 1000U),
+                     csfj::Money::fromCents(static_cast<std::int64_t>(random.next() % 10'000'000'000ULL))});
+  }
+  return items;
+}
+
+bool sameItem(const ItemChange& change, size_t index, const csfj::Item& item) {
+  return change.index == index && change.name == item.name && change.quantity == item.quantity &&
+         change.unitCost == item.unitCost;
+}
+
+// What /api/items writes, read back one by one and as a batch, gives the same
+// items.
+void testRoundTrip() {
+  const std::vector<csfj::Item> items = randomItems(2000U);
+  std::string batch = "[";
+  int mismatches = 0;
+  for (size_t index = 0; index < items.size(); ++index) {
+    std::string json;
+    csfj::appendItemJson(json, index, items[index]);
+    ItemChange change;
+    std::string error;
+    if (!csfj::parseItemChange(json, change, error) || !sameItem(change, index, items[index])) {
+      if (mismatches++ == 0) {
+        std::fprintf(stderr, "  no se recuperó %s: %s\n", test::printable(json).c_str(), error.c_str());
+      }
+    }
+    batch += index == 0U ? "" : ",";
+    batch += json;
+  }
+  batch += "]";
+  CHECK(mismatches == 0);
+
+  std::vector<ItemChange> changes;
+  std::string error;
+  size_t failedChange = 0U;
+  CHECK(csfj::parseItemChanges(batch, changes, error, failedChange));
+  CHECK(changes.size() == items.size());
+  mismatches = 0;
+  for (size_t index = 0; index < changes.size() && index < items.size(); ++index) {
+    mismatches += sameItem(changes[index], index, items[index]) ? 0 : 1;
+  }
+  CHECK(mismatches == 0);
+}
+
+// Escapes and layouts a hand-written client may send.
+void testDecoding() {
+  const struct {
+    std::string_view json;
+    std::string_view name;
+  } cases[] = {
+      {R"({"name":"Caf\u00e9 \ud83d\ude00","quantity":1,"unitCost":1})", "Caf\xC3\xA9 \xF0\x9F\x98\x80"},
+      {R"({"name":"\"\\\/\b\f\n\r\t\u0041\u00E9","quantity":1,"unitCost":1})", "\"\\/\b\f\n\r\tA\xC3\xA9"},
+      {R"( { "total" : {"a":[1,{"b":null}],"c":true} , "name" : "a\/b\t" , "quantity" : 1 , "unitCost" : 0.5 } )",
+       "a/b\t"},
+      {"{\n\t\"name\":\"sin escapes\",\r\n\"quantity\":3,\"unitCost\":\"1'234.50\"}", "sin escapes"},
+  };
+  for (const auto& testCase : cases) {
+    ItemChange change;
+    std::string error;
+    if (!CHECK(csfj::parseItemChange(testCase.json, change, error) && change.name == testCase.name)) {
+      std::fprintf(stderr, "  %s: %s\n", test::printable(testCase.json).c_str(), error.c_str());
+    }
+  }
+
+  ItemChange change;
+  std::string error;
+  CHECK(csfj::parseItemChange(R"({"unitCost":"1'234,567.89","quantity":2,"index":7})", change, error));
+  CHECK(!change.name && change.quantity == 2 && change.index == 7U);
+  CHECK(change.unitCost == csfj::Money::fromCents(123456789));
+  CHECK(csfj::parseItemChange(R"({"unitCost":0.125})", change, error));
+  CHECK(change.unitCost == csfj::Money::fromCents(13));
+  CHECK(csfj::parseItemChange("{}", change, error) && !change.index && !change.name);
+}
+
+// Every proper prefix of a valid body is rejected, wherever it is cut.
+void testTruncated() {
+  const std::string_view whole =
+      R"({"index":3,"name":"Caf\u00e9 \"x\"","quantity":12,"unitCost":"1'234.50","total":{"a":[1,true,null]}})";
+  ItemChange change;
+  std::string error;
+  CHECK(csfj::parseItemChange(whole, change, error));
+  for (size_t length = 0; length < whole.size(); ++length) {
+    if (!CHECK(!csfj::parseItemChange(whole.substr(0, length), change, error))) {
+      std::fprintf(stderr, "  se aceptó \"%s\"\n", test::printable(whole.substr(0, length)).c_str());
+      return;
+    }
+  }
+}
+
+void testRejected() {
+  for (const std::string_view invalid : {
+           R"({"name":"a",})",
+           R"({"name":"a"} x)",
+           R"({"name":"a"}{})",
+           R"({"name":"\ud800"})",
+           R"({"name":"\udc00"})",
+           R"({"name":"\ud800A"})",
+           R"({"name":"\ud800\ue000"})",
+           R"({"name":"\x"})",
+           R"({"name":"\u12G4"})",
+           "{\"name\":\"a\nb\"}",
+           R"({"name" "a"})",
+           R"({"name":"a" "quantity":1})",
+           R"({name:"a"})",
+           R"({"quantity":01})",
+           R"({"quantity":-})",
+           R"({"quantity":1.})",
+           R"({"quantity":.5})",
+           R"({"quantity":1e})",
+           R"({"total":tru})",
+           R"({"total":nul})",
+           R"({"total":[1,]})",
+           R"({"total":[1 2]})",
+           "",
+           "[]",
+       }) {
+    ItemChange change;
+    std::string error;
+    if (!CHECK(!csfj::parseItemChange(invalid, change, error) && !error.empty())) {
+      std::fprintf(stderr, "  se aceptó %s\n", test::printable(invalid).c_str());
+    }
+  }
+
+  // Well-formed JSON whose values are not valid item fields; each names the
+  // field in the message.
+  const struct {
+    std::string_view json;
+    std::string_view field;
+  } fields[] = {
+      {R"({"name":""})", "name"},
+      {R"({"name":3})", "name"},
+      {R"({"quantity":0})", "quantity"},
+      {R"({"quantity":-1})", "quantity"},
+      {R"({"quantity":1.5})", "quantity"},
+      {R"({"quantity":"2"})", "quantity"},
+      {R"({"quantity":99999999999})", "quantity"},
+      {R"({"unitCost":-1})", "unitCost"},
+      {R"({"unitCost":1e3})", "unitCost"},
+      {R"({"unitCost":"abc"})", "unitCost"},
+      {R"({"unitCost":null})", "unitCost"},
+      {R"({"index":-1})", "index"},
+      {R"({"index":0.5})", "index"},
+      {R"({"nombre":"a"})", "nombre"},
+  };
+  for (const auto& testCase : fields) {
+    ItemChange change;
+    std::string error;
+    if (!CHECK(!csfj::parseItemChange(testCase.json, change, error) &&
+               error.find(testCase.field) != std::string::npos)) {
+      std::fprintf(stderr, "  %s: %s\n", test::printable(testCase.json).c_str(), error.c_str());
+    }
+  }
+}
+
+// A batch names the change that failed, or the one after the last when the
+// array itself is malformed.
+void testBatchErrors() {
+  std::vector<ItemChange> changes;
+  std::string error;
+  size_t failedChange = 99U;
+  CHECK(csfj::parseItemChanges("[]", changes, error, failedChange) && changes.empty());
+  CHECK(!csfj::parseItemChanges(R"([{"name":"a"},{"quantity":0},{"name":"c"}])", changes, error, failedChange));
+  CHECK(failedChange == 1U);
+  CHECK(!csfj::parseItemChanges(R"([{"name":"a"},])", changes, error, failedChange));
+  CHECK(failedChange == 1U);
+  CHECK(!csfj::parseItemChanges(R"([{"name":"a"}] x)", changes, error, failedChange));
+  CHECK(failedChange == 1U);
+  CHECK(!csfj::parseItemChanges(R"({"name":"a"})", changes, error, failedChange));
+  CHECK(failedChange == 0U);
+  CHECK(!csfj::parseItemChanges(R"([1])", changes, error, failedChange));
+  CHECK(failedChange == 0U);
+}
+
+void testReader() {
+  JsonReader reader(R"( {"a":[1,-0.5e+2,"x",true,false,null,{}],"b":{"c":[]}} )");
+  CHECK(reader.peek() == JsonType::kObject);
+  std::string_view key;
+  std::string_view text;
+  bool flag = true;
+  CHECK(reader.beginObject() && reader.nextMember(key) && key == "a");
+  CHECK(reader.beginArray());
+  CHECK(reader.nextElement() && reader.peek() == JsonType::kNumber && reader.readNumber(text) && text == "1");
+  CHECK(reader.nextElement() && reader.readNumber(text) && text == "-0.5e+2");
+  CHECK(reader.nextElement() && reader.peek() == JsonType::kString && reader.readString(text) && text == "x");
+  CHECK(reader.nextElement() && reader.peek() == JsonType::kBoolean && reader.readBoolean(flag) && flag);
+  CHECK(reader.nextElement() && reader.readBoolean(flag) && !flag);
+  CHECK(reader.nextElement() && reader.peek() == JsonType::kNull && reader.readNull());
+  CHECK(reader.nextElement() && reader.skipValue());
+  CHECK(!reader.nextElement() && !reader.failed());
+  CHECK(reader.nextMember(key) && key == "b" && reader.skipValue());
+  CHECK(!reader.nextMember(key) && !reader.failed());
+  CHECK(reader.atEnd());
+
+  // Once failed, every call fails.
+  JsonReader broken("[1,,2]");
+  CHECK(broken.beginArray() && broken.nextElement() && broken.skipValue());
+  CHECK(broken.nextElement() && !broken.skipValue() && broken.failed());
+  CHECK(!broken.nextElement());
+  CHECK(broken.peek() == JsonType::kInvalid && !broken.readNumber(text) && !broken.atEnd());
+
+  // Nesting stops at 64 levels.
+  const auto nested = [](size_t depth) {
+    return std::string(depth, '[') + std::string(depth, ']');
+  };
+  // The reader keeps a view of its text.
+  const std::string deepText = nested(64U);
+  const std::string tooDeepText = nested(65U);
+  JsonReader deep(deepText);
+  CHECK(deep.skipValue() && deep.atEnd());
+  JsonReader tooDeep(tooDeepText);
+  CHECK(!tooDeep.skipValue() && tooDeep.failed());
+}
+
+}  // namespace
+
+int main() {
+  testRoundTrip();
+  testDecoding();
+  testTruncated();
+  testRejected();
+  testBatchErrors();
+  testReader();
+  return test::exitCode();
+}
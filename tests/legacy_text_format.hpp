@@ -0,0 +1,76 @@
+#pragma once
+
+#include <exception>
+#include <string>
+#include <string_view>
+
+// Shared by tests/text_format_test.cpp, which checks the vectorized versions
+// against these byte for byte, and bench/text_bench.cpp, which times both.
+namespace legacy {
+
+// The byte-at-a-time escaping and decoding the vectorized versions replaced,
+// kept here as the baseline.
+inline std::string escapeHtml(std::string_view value) {
+  std::string sanitized;
+  sanitized.reserve(value.size());
+  for (const char ch : value) {
+    switch (ch) {
+      case '&':
+        sanitized += "&amp;";
+        break;
+      case '<':
+        sanitized += "&lt;";
+        break;
+      case '>':
+        sanitized += "&gt;";
+        break;
+      case '"':
+        sanitized += "&quot;";
+        break;
+      case '\'':
+        sanitized += "&#39;";
+        break;
+      default:
+        sanitized.push_back(ch);
+        break;
+    }
+  }
+  return sanitized;
+}
+
+inline std::string escapeCsv(std::string_view value) {
+  std::string out = "\"";
+  for (const char ch : value) {
+    out.push_back(ch);
+    if (ch == '"') {
+      out.push_back('"');
+    }
+  }
+  out.push_back('"');
+  return out;
+}
+
+inline std::string urlDecode(std::string_view value) {
+  std::string result;
+  result.reserve(value.size());
+  for (size_t index = 0; index < value.size(); ++index) {
+    const char current = value[index];
+    if (current == '+') {
+      result.push_back(' ');
+    } else if (current == '%' && index + 2 < value.size()) {
+      const std::string hex(value.substr(index + 1, 2));
+      try {
+        const auto decoded = static_cast<char>(std::stoi(hex, nullptr, 16));
+        result.push_back(decoded);
+        index += 2;
+      } catch (const std::exception&) {
+        result.push_back(current);
+      }
+    } else {
+      result.push_back(current);
+    }
+  }
+  return result;
+}
+
+}  // namespace legacy
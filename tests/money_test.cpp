@@ -0,0 +1,128 @@
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <string>
+
+#include "money.hpp"
+#include "test_support.hpp"
+
+namespace {
+
+using csfj::Money;
+
+// The cents parsed from `text`, or -1 when it is rejected.
+std::int64_t parsedCents(const std::string& text) {
+  Money amount = Money::fromCents(-2);
+  return csfj::parseMoney(text, amount) ? amount.cents() : -1;
+}
+
+void testParsing() {
+  CHECK(parsedCents("0") == 0);
+  CHECK(parsedCents("1234") == 123400);
+  CHECK(parsedCents("1234.5") == 123450);
+  CHECK(parsedCents("1234.56") == 123456);
+  CHECK(parsedCents(".75") == 75);
+  CHECK(parsedCents("7.") == 700);
+  // Digits past the second decimal round half up; only the third one counts.
+  CHECK(parsedCents("0.124") == 12);
+  CHECK(parsedCents("0.125") == 13);
+  CHECK(parsedCents("0.1249999") == 12);
+  CHECK(parsedCents("0.995") == 100);
+
+  CHECK(parsedCents("") == -1);
+  CHECK(parsedCents(".") == -1);
+  CHECK(parsedCents("-1") == -1);
+  CHECK(parsedCents("+1") == -1);
+  CHECK(parsedCents("1.2.3") == -1);
+  CHECK(parsedCents("12a") == -1);
+  CHECK(parsedCents(" 12") == -1);
+  CHECK(parsedCents("1'234") == -1);
+
+  CHECK(parsedCents("10000000000000") == csfj::kMaxUnitCost.cents());
+  CHECK(parsedCents("10000000000000.01") == -1);
+  CHECK(parsedCents("99999999999999999999999") == -1);
+}
+
+void testNormalization() {
+  CHECK(csfj::normalizeCostInput("1'234,567.89") == "1234567.89");
+  CHECK(csfj::normalizeCostInput(" 12 345.6\t") == "12345.6");
+  CHECK(parsedCents(csfj::normalizeCostInput("1'234,567.89")) == 123456789);
+}
+
+void testFormatting() {
+  CHECK(csfj::formatMoney(Money()) == "0.00");
+  CHECK(csfj::formatMoney(Money::fromCents(5)) == "0.05");
+  CHECK(csfj::formatMoney(Money::fromCents(123450)) == "1234.50");
+  CHECK(csfj::formatMoneyWithGrouping(Money::fromCents(99999)) == "999.99");
+  CHECK(csfj::formatMoneyWithGrouping(Money::fromCents(100000)) == "1,000.00");
+  CHECK(csfj::formatMoneyWithGrouping(Money::fromCents(123456789)) == "1'234,567.89");
+  CHECK(csfj::formatMoneyWithGrouping(Money::fromCents(-123456789)) == "-1'234,567.89");
+
+  // The widest amounts still fit the buffer writeMoney is documented to need.
+  const Money extremes[] = {Money::fromCents(std::numeric_limits<std::int64_t>::max()),
+                            Money::fromCents(std::numeric_limits<std::int64_t>::min())};
+  for (const Money amount : extremes) {
+    CHECK(csfj::formatMoneyWithGrouping(amount).size() <= csfj::kMaxMoneyChars);
+  }
+  CHECK(csfj::formatMoney(extremes[0]) == "92233720368547758.07");
+  CHECK(csfj::formatMoney(extremes[1]) == "-92233720368547758.08");
+
+  std::string appended = "costo: ";
+  csfj::appendMoneyWithGrouping(appended, Money::fromCents(100000000));
+  CHECK(appended == "costo: 1'000,000.00");
+}
+
+// Whatever is formatted parses back to the same amount, with or without the
+// grouping separators, across every magnitude up to kMaxUnitCost.
+void testRoundTrip() {
+  int mismatches = 0;
+  std::uint64_t state = 0x2545F4914F6CDD1DULL;
+  for (std::int64_t scale = 1; scale <= csfj::kMaxUnitCost.cents() / 10; scale *= 10) {
+    for (int sample = 0; sample < 1000; ++sample) {
+      state ^= state << 13;
+      state ^= state >> 7;
+      state ^= state << 17;
+      const Money amount = Money::fromCents(static_cast<std::int64_t>(state % static_cast<std::uint64_t>(scale * 10)));
+      Money plain;
+      Money grouped;
+      if (!csfj::parseMoney(csfj::formatMoney(amount), plain) || plain != amount ||
+          !csfj::parseMoney(csfj::normalizeCostInput(csfj::formatMoneyWithGrouping(amount)), grouped) ||
+          grouped != amount) {
+        if (mismatches++ == 0) {
+          std::fprintf(stderr, "no se recuperó %s\n", csfj::formatMoney(amount).c_str());
+        }
+      }
+    }
+  }
+  Money largest;
+  CHECK(csfj::parseMoney(csfj::formatMoney(csfj::kMaxUnitCost), largest) && largest == csfj::kMaxUnitCost);
+  CHECK(mismatches == 0);
+}
+
+void testArithmetic() {
+  constexpr std::int64_t kMax = std::numeric_limits<std::int64_t>::max();
+  Money result;
+  CHECK(csfj::multiplyMoney(Money::fromCents(1250), 4, result) && result == Money::fromCents(5000));
+  CHECK(csfj::multiplyMoney(Money::fromCents(kMax), 1, result) && result == Money::fromCents(kMax));
+  CHECK(csfj::multiplyMoney(Money::fromCents(kMax), 0, result) && result == Money());
+  CHECK(!csfj::multiplyMoney(Money::fromCents(kMax / 2 + 1), 2, result));
+  CHECK(!csfj::multiplyMoney(csfj::kMaxUnitCost, 10000, result));
+  CHECK(!csfj::multiplyMoney(Money::fromCents(-1), 1, result));
+  CHECK(!csfj::multiplyMoney(Money::fromCents(1), -1, result));
+
+  CHECK(csfj::addMoney(Money::fromCents(kMax - 1), Money::fromCents(1), result) && result == Money::fromCents(kMax));
+  CHECK(!csfj::addMoney(Money::fromCents(kMax), Money::fromCents(1), result));
+  CHECK(csfj::addMoney(Money::fromCents(kMax), Money::fromCents(-kMax), result) && result == Money());
+  CHECK(!csfj::addMoney(Money::fromCents(-kMax), Money::fromCents(-2), result));
+}
+
+}  // namespace
+
+int main() {
+  testParsing();
+  testNormalization();
+  testFormatting();
+  testRoundTrip();
+  testArithmetic();
+  return test::exitCode();
+}
@@ -0,0 +1,135 @@
+#include <atomic>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "sheet_registry.hpp"
+#include "test_support.hpp"
+
+namespace {
+
+using test::TempDirectory;
+
+constexpr std::uintmax_t kCompactionThreshold = 1U << 20U;
+constexpr size_t kCacheEntries = 4U;
+
+bool splitsInto(std::string_view path, std::string_view name, std::string_view base, std::string_view route) {
+  const csfj::SheetPath split = csfj::splitSheetPath(path);
+  return split.valid && split.name == name && split.base == base && split.route == route;
+}
+
+void testSplitSheetPath() {
+  CHECK(splitsInto("/", "", "/", "/"));
+  CHECK(splitsInto("/export", "", "/", "/export"));
+  CHECK(splitsInto("/static/app.js", "", "/", "/static/app.js"));
+  CHECK(splitsInto("/s/team/", "team", "/s/team/", "/"));
+  CHECK(splitsInto("/s/team/api/items", "team", "/s/team/", "/api/items"));
+  CHECK(splitsInto("/s/team", "team", "", ""));
+
+  CHECK(!csfj::splitSheetPath("/s/").valid);
+  CHECK(!csfj::splitSheetPath("/s//export").valid);
+  CHECK(!csfj::splitSheetPath("/s/Team/").valid);
+  CHECK(!csfj::splitSheetPath("/s/a.b/").valid);
+}
+
+// "/s/{name}" is redirected to sheetBase(name), which must reach the sheet
+// itself rather than redirect again.
+void testRedirectTarget() {
+  CHECK(csfj::sheetBase("") == "/");
+  CHECK(csfj::sheetBase("team") == "/s/team/");
+  const std::string location = csfj::sheetBase(csfj::splitSheetPath("/s/team").name);
+  const csfj::SheetPath target = csfj::splitSheetPath(location);
+  CHECK(target.valid && target.name == "team" && target.route == "/");
+}
+
+// Threads asking for the same new sheet all get the one sheet, whose journal
+// is opened once, and creations never go past the maximum.
+void testConcurrentCreation() {
+  TempDirectory directory("registry-concurrent");
+  constexpr size_t kMaxSheets = 6U;
+  constexpr int kThreads = 8;
+  csfj::SheetRegistry registry(directory.path(), kCompactionThreshold, kCacheEntries, kMaxSheets);
+  registry.open();
+
+  std::vector<csfj::Sheet*> shared(kThreads);
+  std::atomic<int> created{0};
+  std::atomic<int> refused{0};
+  std::vector<std::thread> threads;
+  for (int index = 0; index < kThreads; ++index) {
+    threads.emplace_back([&, index] {
+      shared[static_cast<size_t>(index)] = registry.findOrCreate("shared");
+      for (int name = 0; name < 4; ++name) {
+        if (registry.findOrCreate("t" + std::to_string(index) + "-" + std::to_string(name)) != nullptr) {
+          ++created;
+        } else {
+          ++refused;
+        }
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  for (csfj::Sheet* sheet : shared) {
+    CHECK(sheet != nullptr && sheet == shared[0]);
+  }
+  CHECK(registry.size() == kMaxSheets);
+  CHECK(static_cast<size_t>(created.load()) == kMaxSheets - 1U);
+  CHECK(refused.load() == kThreads * 4 - static_cast<int>(kMaxSheets - 1U));
+  CHECK(registry.find("shared") == shared[0]);
+  CHECK(registry.find("missing") == nullptr);
+
+  // Refused sheets leave nothing behind on disk.
+  size_t directories = 0U;
+  for (const auto& entry : std::filesystem::directory_iterator(directory.path() / "sheets")) {
+    directories += entry.is_directory() ? 1U : 0U;
+  }
+  CHECK(directories == kMaxSheets);
+}
+
+// Sheets found on disk count towards the maximum; more of them than it allows
+// is an error rather than sheets silently left out.
+void testMaximumAtStartup() {
+  TempDirectory directory("registry-startup");
+  {
+    csfj::SheetRegistry registry(directory.path(), kCompactionThreshold, kCacheEntries, 3U);
+    registry.open();
+    for (const char* name : {"a", "b", "c"}) {
+      csfj::Sheet* sheet = registry.findOrCreate(name);
+      CHECK(sheet != nullptr);
+      if (sheet != nullptr) {
+        sheet->store.append({name, 1, csfj::Money::fromCents(100)});
+      }
+    }
+    CHECK(registry.findOrCreate("d") == nullptr);
+  }
+  {
+    csfj::SheetRegistry registry(directory.path(), kCompactionThreshold, kCacheEntries, 3U);
+    registry.open();
+    CHECK(registry.size() == 3U);
+    CHECK(registry.findOrCreate("d") == nullptr);
+    const csfj::Sheet* sheet = registry.find("b");
+    CHECK(sheet != nullptr && sheet->store.snapshot()->size() == 1U);
+  }
+  bool refused = false;
+  try {
+    csfj::SheetRegistry registry(directory.path(), kCompactionThreshold, kCacheEntries, 2U);
+    registry.open();
+  } catch (const std::runtime_error&) {
+    refused = true;
+  }
+  CHECK(refused);
+}
+
+}  // namespace
+
+int main() {
+  testSplitSheetPath();
+  testRedirectTarget();
+  testConcurrentCreation();
+  testMaximumAtStartup();
+  return test::exitCode();
+}
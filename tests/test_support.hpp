@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+// Just enough of a test framework for the executables in tests/: CHECK notes
+// a failure and carries on, and main() returns test::exitCode() so that CTest
+// sees any failure.
+namespace test {
+
+inline int& failureCount() {
+  static int count = 0;
+  return count;
+}
+
+inline bool check(bool passed, const char* expression, const char* file, int line) {
+  if (!passed) {
+    ++failureCount();
+    std::fprintf(stderr, "%s:%d: falló %s\n", file, line, expression);
+  }
+  return passed;
+}
+
+// `text` with control and non-ASCII bytes as \xNN, for failure messages.
+inline std::string printable(std::string_view text) {
+  static constexpr char kHexDigits[] = "0123456789ABCDEF";
+  std::string out;
+  for (const char ch : text) {
+    const auto byte = static_cast<unsigned char>(ch);
+    if (byte >= 0x20U && byte < 0x7FU && ch != '\\') {
+      out.push_back(ch);
+    } else {
+      out += "\\x";
+      out.push_back(kHexDigits[byte >> 4U]);
+      out.push_back(kHexDigits[byte & 0xFU]);
+    }
+  }
+  return out;
+}
+
+// A scratch directory of its own under the system temporary directory,
+// removed afterwards.
+class TempDirectory {
+public:
+  explicit TempDirectory(const char* name)
+      : path_(std::filesystem::temp_directory_path() / (std::string("csfj-test-") + name)) {
+    std::filesystem::remove_all(path_);
+  }
+
+  ~TempDirectory() {
+    std::error_code ignored;
+    std::filesystem::remove_all(path_, ignored);
+  }
+
+  TempDirectory(const TempDirectory&) = delete;
+  TempDirectory& operator=(const TempDirectory&) = delete;
+
+  const std::filesystem::path& path() const {
+    return path_;
+  }
+
+private:
+  std::filesystem::path path_;
+};
+
+inline int exitCode() {
+  if (failureCount() != 0) {
+    std::fprintf(stderr, "%d comprobación(es) fallida(s)\n", failureCount());
+    return 1;
+  }
+  return 0;
+}
+
+}  // namespace test
+
+#define CHECK(condition) ::test::check(static_cast<bool>(condition), #condition, __FILE__, __LINE__)
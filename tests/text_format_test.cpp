@@ -0,0 +1,80 @@
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "http_parser.hpp"
+#include "legacy_text_format.hpp"
+#include "test_support.hpp"
+#include "text_format.hpp"
+
+namespace {
+
+// Random text over a small alphabet rich in the characters each function
+// treats specially, at every length up to a few SIMD blocks so that every
+// split between the vector loop and the scalar tail is exercised.
+std::vector<std::string> differentialInputs() {
+  static constexpr char kAlphabet[] = "abcXYZ09fF%%%++&&<>\"\"' -\t\r\n\x00\xC3\xB1";
+  std::vector<std::string> inputs;
+  std::uint64_t state = 0x9E3779B97F4A7C15ULL;
+  for (size_t length = 0; length <= 100U; ++length) {
+    for (int sample = 0; sample < 200; ++sample) {
+      std::string text;
+      for (size_t index = 0; index < length; ++index) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        text.push_back(kAlphabet[state % (sizeof(kAlphabet) - 1U)]);
+      }
+      inputs.push_back(std::move(text));
+    }
+  }
+  // Every byte pair after a '%', in the middle of a block and at its end.
+  for (int first = 0; first < 256; ++first) {
+    for (int second = 0; second < 256; ++second) {
+      const std::string escape = {'%', static_cast<char>(first), static_cast<char>(second)};
+      inputs.push_back("0123456789abcd" + escape + "x");
+      inputs.push_back(escape);
+    }
+  }
+  return inputs;
+}
+
+// Reports the first few inputs a function gets wrong, not every one of them.
+constexpr int kReportedMismatches = 5;
+
+void expectSame(const char* function, const std::string& input, const std::string& actual, const std::string& expected,
+                int& reported) {
+  if (actual == expected) {
+    return;
+  }
+  ++test::failureCount();
+  if (reported++ >= kReportedMismatches) {
+    return;
+  }
+  std::fprintf(stderr, "%s(\"%s\")\n  obtenido: \"%s\"\n  esperado: \"%s\"\n", function,
+               test::printable(input).c_str(), test::printable(actual).c_str(), test::printable(expected).c_str());
+}
+
+}  // namespace
+
+// The vectorized escaping and decoding must reproduce the byte-at-a-time
+// versions they replaced, byte for byte, with or without AVX2.
+int main() {
+  const std::vector<std::string> inputs = differentialInputs();
+  int reported = 0;
+  std::string appended;
+  for (const std::string& input : inputs) {
+    expectSame("escapeHtml", input, csfj::escapeHtml(input), legacy::escapeHtml(input), reported);
+    appended.assign("prefix");
+    csfj::appendEscapedHtml(appended, input);
+    expectSame("appendEscapedHtml", input, appended, "prefix" + legacy::escapeHtml(input), reported);
+    appended.assign("prefix,");
+    csfj::appendEscapedCsv(appended, input);
+    expectSame("appendEscapedCsv", input, appended, "prefix," + legacy::escapeCsv(input), reported);
+    expectSame("urlDecode", input, csfj::urlDecode(input), legacy::urlDecode(input), reported);
+  }
+  std::printf("%zu entradas comparadas\n", inputs.size());
+  return test::exitCode();
+}
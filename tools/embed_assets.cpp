@@ -0,0 +1,148 @@
+#include <algorithm>
+#include <cstdio>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "static_files.hpp"
+#include "template_engine.hpp"
+
+// Build step behind csfj_assets (see CMakeLists.txt): writes a C++ source that
+// holds templates/*.html and every file of static/ as byte arrays, together
+// with what the server would otherwise work out at startup: each template's
+// placeholders, and each static file's ETag and gzip variant.
+namespace {
+
+std::string readFile(const std::filesystem::path& file) {
+  std::ifstream input(file, std::ios::binary);
+  if (!input) {
+    throw std::runtime_error("No se pudo abrir " + file.string());
+  }
+  return std::string(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+}
+
+std::string stringLiteral(std::string_view text) {
+  std::string out = "\"";
+  for (const char ch : text) {
+    if (ch == '"' || ch == '\\') {
+      out += '\\';
+    }
+    out += ch;
+  }
+  out += '"';
+  return out;
+}
+
+// `constexpr char name[] = {...};`, sixteen bytes per line. An empty array is
+// not valid C++, so empty contents get a single unused byte.
+void writeBytes(std::string& out, const std::string& name, std::string_view bytes) {
+  static constexpr char kHexDigits[] = "0123456789abcdef";
+  out += "constexpr char " + name + "[] = {";
+  if (bytes.empty()) {
+    out += "'\\0'";
+  }
+  for (size_t index = 0; index < bytes.size(); ++index) {
+    out += index % 16U == 0U ? "\n    " : " ";
+    const auto byte = static_cast<unsigned char>(bytes[index]);
+    out += "'\\x";
+    out += kHexDigits[byte >> 4U];
+    out += kHexDigits[byte & 0xFU];
+    out += "',";
+  }
+  out += "\n};\n";
+}
+
+std::string view(const std::string& array, size_t size) {
+  return size == 0U ? "{}" : "{" + array + ", " + std::to_string(size) + "U}";
+}
+
+std::vector<std::filesystem::path> templateFiles(const std::filesystem::path& root) {
+  std::vector<std::filesystem::path> files;
+  for (const auto& entry : std::filesystem::directory_iterator(root)) {
+    if (entry.is_regular_file() && entry.path().extension() == ".html") {
+      files.push_back(entry.path());
+    }
+  }
+  std::sort(files.begin(), files.end());
+  return files;
+}
+
+std::string generate(const std::filesystem::path& templatesRoot, const std::filesystem::path& staticRoot) {
+  std::string out = "// Generado por csfj_embed_assets a partir de templates/ y static/. No editar.\n"
+                    "#include \"embedded_assets.hpp\"\n\n"
+                    "namespace csfj::embedded {\n\nnamespace {\n\n";
+  std::string templates;
+  size_t templateCount = 0U;
+  for (const std::filesystem::path& file : templateFiles(templatesRoot)) {
+    const std::string source = readFile(file);
+    const std::vector<csfj::TemplatePlaceholder> placeholders = csfj::findPlaceholders(source);
+    const std::string suffix = std::to_string(templateCount++);
+    writeBytes(out, "kTemplate" + suffix, source);
+    std::string layout = "nullptr";
+    if (!placeholders.empty()) {
+      layout = "kPlaceholders" + suffix;
+      out += "constexpr TemplatePlaceholder " + layout + "[] = {";
+      for (const csfj::TemplatePlaceholder& placeholder : placeholders) {
+        out += "\n    {" + std::to_string(placeholder.offset) + "U, " + std::to_string(placeholder.length) + "U},";
+      }
+      out += "\n};\n";
+    }
+    templates += "    {" + stringLiteral(file.filename().generic_string()) + ", " + view("kTemplate" + suffix, source.size()) +
+                 ", " + layout + ", " + std::to_string(placeholders.size()) + "U},\n";
+  }
+
+  // Loading the directory the way the server would yields the same tags and
+  // gzip variants it would have computed at startup.
+  std::vector<std::pair<std::string_view, const csfj::StaticFile*>> files;
+  const csfj::StaticFileTable table = csfj::StaticFileTable::load(staticRoot, "");
+  table.forEach([&files](std::string_view url, const csfj::StaticFile& file) { files.emplace_back(url, &file); });
+  std::sort(files.begin(), files.end());
+  std::string staticFiles;
+  for (size_t index = 0; index < files.size(); ++index) {
+    const auto& [name, file] = files[index];
+    const std::string suffix = std::to_string(index);
+    writeBytes(out, "kStatic" + suffix, file->identity.body);
+    std::string gzip = "{}, {}";
+    if (file->hasGzip) {
+      writeBytes(out, "kStaticGzip" + suffix, file->gzip.body);
+      gzip = view("kStaticGzip" + suffix, file->gzip.body.size()) + ", " + stringLiteral(file->gzip.etag);
+    }
+    staticFiles += "    {" + stringLiteral(name) + ", " + view("kStatic" + suffix, file->identity.body.size()) + ", " +
+                   stringLiteral(file->identity.etag) + ", " + gzip + "},\n";
+  }
+
+  out += "\n}  // namespace\n\n";
+  out += "const EmbeddedTemplate kTemplates[] = {\n" + (templates.empty() ? "    {},\n" : templates) + "};\n";
+  out += "const size_t kTemplateCount = " + std::to_string(templateCount) + "U;\n\n";
+  out += "const EmbeddedFile kStaticFiles[] = {\n" + (staticFiles.empty() ? "    {},\n" : staticFiles) + "};\n";
+  out += "const size_t kStaticFileCount = " + std::to_string(files.size()) + "U;\n\n";
+  out += "}  // namespace csfj::embedded\n";
+  return out;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc != 4) {
+    std::fprintf(stderr, "Uso: csfj_embed_assets SALIDA.cpp DIRECTORIO_TEMPLATES DIRECTORIO_STATIC\n");
+    return 2;
+  }
+  try {
+    const std::string source = generate(argv[2], argv[3]);
+    std::ofstream file(argv[1], std::ios::binary | std::ios::trunc);
+    file << source;
+    if (!file) {
+      throw std::runtime_error(std::string("No se pudo escribir ") + argv[1]);
+    }
+  } catch (const std::exception& ex) {
+    std::fprintf(stderr, "csfj_embed_assets: %s\n", ex.what());
+    return 1;
+  }
+  return 0;
+}